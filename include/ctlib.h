@@ -280,6 +280,23 @@ struct _cs_dynamic
 #define _CS_CANCEL_NOCANCEL     0
 #define _CS_CANCEL_PENDING      1
 
+/** How values of a bound column are copied to an array element */
+typedef enum {
+	_CT_BIND_GENERIC,	/**< use _cs_convert */
+	_CT_BIND_COPY,		/**< same fixed type, copy the value */
+	_CT_BIND_CONVERT,	/**< fixed types, convert with a resolved converter */
+} CT_BIND_KIND;
+
+/** Bind of a column of regular rows, resolved once per result */
+typedef struct _ct_bind_plan
+{
+	TDSCOLUMN *col;
+	CT_BIND_KIND kind;
+	/** bytes of converted value */
+	TDS_INT size;
+	TDS_CONVERTER conv;
+} CT_BIND_PLAN;
+
 struct _cs_command
 {
 	struct _cs_command *next;
@@ -305,6 +322,10 @@ struct _cs_command
 	TDSCURSOR *cursor;
 	void *userdata;
 	int userdata_len;
+	/** plans for array fetches, valid while bind_plans_res is current result */
+	CT_BIND_PLAN *bind_plans;
+	int num_bind_plans;
+	TDSRESULTINFO *bind_plans_res;
 };
 
 struct _cs_blkdesc
@@ -56,6 +56,12 @@ typedef struct
 	int current;		/* dbnextrow() reads this row */
 	int capacity;		/* how many elements the queue can hold  */
 	struct dblib_buffer_row *rows;		/* pointer to the row storage */
+	unsigned char *arena;	/* sizes and data of rows, a slot for each element */
+	size_t slot_size;	/* bytes of a slot in arena */
+	int arena_slots;	/* slots allocated in arena, grows up to capacity */
+	struct dblib_bind_plan *plans;	/* how bound columns of regular rows are copied */
+	int num_plans;		/* elements in plans */
+	TDSRESULTINFO *plans_res;	/* results plans were built for, NULL to build them again */
 } DBPROC_ROWBUF;
 
 typedef struct
@@ -81,6 +87,13 @@ typedef struct
 	TDS_INT lastrow;
 	TDS_INT maxerrs;
 	TDS_INT batch;
+	TDS_INT8 start_offset;
+	TDS_INT8 end_offset;
+	bool pipeline;
+	/** data file is gzip compressed, 0 no, 1 yes, -1 detect from file name */
+	int compress;
+	/** file recording committed batches, see bcp_checkpoint() */
+	TDS_CHAR *checkpoint;
 } BCP_HOSTFILEINFO;
 
 /* linked list of rpc parameters */
@@ -181,6 +194,7 @@ int _dblib_handle_err_message(const TDSCONTEXT * ctxptr, TDSSOCKET * tdsptr, TDS
 int _dblib_check_and_handle_interrupt(void * vdbproc);
 
 void _dblib_setTDS_version(TDSLOGIN * tds_login, DBINT version);
+int _dblib_convert_msgno(TDS_INT len);
 void _dblib_convert_err(DBPROCESS * dbproc, TDS_INT len);
 
 DBINT _convert_char(int srctype, BYTE * src, int destype, BYTE * dest, DBINT destlen);
@@ -89,7 +89,29 @@ TDS_SERVER_TYPE tds_get_null_type(TDS_SERVER_TYPE srctype);
 ptrdiff_t tds_char2hex(TDS_CHAR *dest, size_t destlen, const TDS_CHAR * src, size_t srclen);
 TDS_INT tds_convert(const TDSCONTEXT *context, int srctype, const void *src, TDS_UINT srclen, int desttype, CONV_RESULT *cr);
 
+typedef struct tds_converter TDS_CONVERTER;
+
+/** Function to convert a single value, see tds_convert_resolve */
+typedef TDS_INT (*TDS_CONVERT_FUNC)(const TDSCONTEXT *context, const TDS_CONVERTER *conv,
+				    const void *src, TDS_UINT srclen, CONV_RESULT *cr);
+
+/** Conversion from a type to another, resolved once */
+struct tds_converter
+{
+	TDS_CONVERT_FUNC convert;
+	int srctype;
+	int desttype;
+	/** precision and scale for numeric destinations, used by tds_convert_batch */
+	unsigned char precision, scale;
+};
+
+TDS_CONVERT_FUNC tds_convert_resolve(TDS_CONVERTER *conv, int srctype, int desttype);
+TDS_INT tds_convert_batch(const TDSCONTEXT *context, const TDS_CONVERTER *conv, unsigned int count,
+			  const void *src, TDS_UINT srclen, const TDS_UINT *srclens,
+			  void *dest, TDS_UINT destlen, TDS_INT *lengths);
+
 size_t tds_strftime(char *buf, size_t maxsize, const char *format, const TDSDATEREC * timeptr, int prec);
+void tds_free_date_plans(TDSLOCALE *locale);
 
 #ifdef __cplusplus
 #if 0
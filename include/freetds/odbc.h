@@ -582,6 +582,9 @@ typedef struct {
 	DSTR type_name;
 	TDS_DESC *apd;
 	TDS_DESC *ipd;
+	/* state used while streaming rows to the server */
+	TDS_STMT *stmt;
+	SQLLEN num_rows;
 } SQLTVP;
 
 TDS_DESC *desc_alloc(SQLHANDLE parent, int desc_type, SQLSMALLINT alloc_type);
@@ -732,6 +735,9 @@ int odbc_bcp_batch(TDS_DBC *dbc);
 int odbc_bcp_done(TDS_DBC *dbc);
 void odbc_bcp_bind(TDS_DBC *dbc, const void * varaddr, int prefixlen, int varlen, const void * terminator, int termlen,
 		   int vartype, int table_column);
+void odbc_bcp_bind_array(TDS_DBC *dbc, const void * varaddr, int stride, const int * lengths, const short * indicators,
+			 int vartype, int table_column);
+int odbc_bcp_sendrows(TDS_DBC *dbc, int num_rows);
 
 /*
  * sqlwchar.c
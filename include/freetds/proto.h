@@ -398,6 +398,7 @@ typedef struct
 
 enum {
 	TDS_STATUS_EOM = 1,
+	TDS_STATUS_IGNORE = 2,
 	TDS_STATUS_RESETCONNECTION = 8,
 };
 
@@ -424,6 +424,7 @@ is_tds_type_valid(int type)
 #define TDS_STR_HOST     "host"
 #define TDS_STR_PORT     "port"
 #define TDS_STR_TEXTSZ   "text size"
+#define TDS_STR_DYNCACHE "prepared statement cache size"
 /* for big endian hosts, obsolete, ignored */
 #define TDS_STR_EMUL_LE	"emulate little endian"
 #define TDS_STR_CHARSET	"charset"
@@ -532,6 +533,7 @@ typedef struct tds_login
 	tds_dir_char *dump_file;
 	int debug_flags;
 	int text_size;
+	int dyn_cache_size;
 	DSTR routing_address;
 	uint16_t routing_port;
 
@@ -565,6 +567,8 @@ typedef struct tds_headers
 	/* TDS 7.4+: trace activity ID char[20] */
 } TDSHEADERS;
 
+struct tds_date_plan;
+
 typedef struct tds_locale
 {
 	char *language;
@@ -572,6 +576,10 @@ typedef struct tds_locale
 	char *datetime_fmt;
 	char *date_fmt;
 	char *time_fmt;
+	/** compiled date formats, see tds_locale_compile_date_plans */
+	struct tds_date_plan *datetime_plan;
+	struct tds_date_plan *date_plan;
+	struct tds_date_plan *time_plan;
 } TDSLOCALE;
 
 /** 
@@ -618,6 +626,8 @@ typedef struct tds_bcpcoldata
 	TDS_UCHAR *data;
 	TDS_INT    datalen;
 	bool       is_null;
+	/** array bound with tds_bcp_bind_array or tds_bcp_bind_column, NULL if none */
+	struct tds_bcp_array *array;
 } BCPCOLDATA;
 
 
@@ -729,6 +739,8 @@ struct tds_column
 	TDS_SMALLINT column_bindtype;
 	TDS_SMALLINT column_bindfmt;
 	TDS_INT column_bindlen;
+	/** distance between values of an array binding, 0 if bound to a single variable */
+	TDS_INT column_bindstride;
 	TDS_SMALLINT *column_nullbind;
 	TDS_CHAR *column_varaddr;
 	TDS_INT *column_lenbind;
@@ -771,6 +783,8 @@ typedef struct tds_result_info
 	bool rows_exist;
 	/* TODO remove ?? used only in dblib */
 	bool more_results;
+	/** cached declaration of parameters, see tds7_write_param_def_from_query */
+	struct tds_param_decl *param_decl;
 } TDSRESULTINFO;
 
 /** values for tds->state */
@@ -926,6 +940,7 @@ typedef struct tds_cursor
 {
 	struct tds_cursor *next;	/**< next in linked list, keep first */
 	TDS_INT ref_count;		/**< reference counter so client can retain safely a pointer */
+	struct tds_cursor *prev;	/**< previous in linked list */
 	char *cursor_name;		/**< name of the cursor */
 	TDS_INT cursor_id;		/**< cursor id returned by the server after cursor declare */
 	TDS_TINYINT options;		/**< read only|updatable TODO use it */
@@ -967,6 +982,9 @@ typedef struct tds_dynamic
 {
 	struct tds_dynamic *next;	/**< next in linked list, keep first */
 	TDS_INT ref_count;		/**< reference counter so client can retain safely a pointer */
+	struct tds_dynamic *prev;	/**< previous in linked list */
+	struct tds_dynamic *hash_next;	/**< next in connection hash bucket */
+	unsigned int id_hash;		/**< hash of id */
 	/** numeric id for mssql7+*/
 	TDS_INT num_id;
 	/** 
@@ -997,6 +1015,21 @@ typedef struct tds_dynamic
 	TDSPARAMINFO *params;
 	/** saved query, we need to know original query if prepare is impossible */
 	char *query;
+	/**
+	 * key (query and parameter declarations) used to find the dynamic
+	 * in the connection cache, NULL if the dynamic cannot be cached
+	 */
+	char *cache_key;
+	size_t cache_key_len;
+	unsigned int cache_hash;
+	/** true if dynamic is in the connection cache (not used by clients) */
+	bool cached;
+	/** next (less recently used) dynamic in the connection cache */
+	struct tds_dynamic *cache_next;
+	/** previous (more recently used) dynamic in the connection cache */
+	struct tds_dynamic *cache_prev;
+	/** next dynamic in the same bucket of connection cache hash */
+	struct tds_dynamic *cache_hash_next;
 } TDSDYNAMIC;
 
 typedef enum {
@@ -1009,8 +1042,27 @@ typedef struct tds_multiple
 {
 	TDS_MULTIPLE_TYPE type;
 	unsigned int flags;
+	/** number of requests added */
+	unsigned int count;
+	/**
+	 * index of the request which results are processed by
+	 * tds_process_multiple_results
+	 */
+	unsigned int current;
 } TDSMULTIPLE;
 
+/** Results of a single request sent with TDS_MULTIPLE_RPC */
+typedef struct tds_multiple_result
+{
+	/** rows affected, TDS_NO_COUNT if not available */
+	TDS_INT8 rows_affected;
+	/** procedure return status, valid if has_status is set */
+	TDS_INT ret_status;
+	bool has_status;
+	/** request or a statement inside it failed */
+	bool failed;
+} TDSMULTIPLERESULT;
+
 /* forward declaration */
 typedef struct tds_context TDSCONTEXT;
 typedef int (*err_handler_t) (const TDSCONTEXT *, TDSSOCKET *, TDSMESSAGE *);
@@ -1097,11 +1149,33 @@ struct tds_connection
 	 * contains only cursors allocated on the server
 	 */
 	TDSCURSOR *cursors;
+	/** last cursor in cursors, new cursors are appended here */
+	TDSCURSOR *cursors_tail;
 	/**
 	 * list of dynamic allocated for this connection
 	 * contains only dynamic allocated on the server
 	 */
 	TDSDYNAMIC *dyns;
+	/** hash index of dyns by id, NULL if not allocated */
+	TDSDYNAMIC **dyns_hash;
+	/** number of buckets in dyns_hash, always a power of 2 */
+	unsigned int dyns_hash_size;
+	/** number of dynamics in dyns */
+	unsigned int num_dyns;
+	/**
+	 * prepared dynamics released by clients, most recently used first.
+	 * They are kept on the server to avoid preparing the same query again
+	 */
+	TDSDYNAMIC *dyn_cache;
+	/** least recently used dynamic in dyn_cache, first to be evicted */
+	TDSDYNAMIC *dyn_cache_tail;
+	unsigned int dyn_cache_count;
+	/** maximum number of dynamics in dyn_cache, 0 to disable the cache */
+	unsigned int dyn_cache_size;
+	/** hash index of dyn_cache by cache key, NULL if not allocated */
+	TDSDYNAMIC **dyn_cache_hash;
+	/** number of buckets in dyn_cache_hash, always a power of 2 */
+	unsigned int dyn_cache_hash_size;
 
 	int char_conv_count;
 	TDSICONV **char_convs;
@@ -1282,12 +1356,31 @@ typedef struct tds_tvp_row
 	struct tds_tvp_row *next;
 } TDS_TVP_ROW;
 
+struct tds_tvp;
+
+/**
+ * Produce next row of a table valued parameter while it's sent.
+ * Should store the row in table->fetch_row (the previous one can be reused)
+ * and return TDS_SUCCESS, TDS_NO_MORE_RESULTS if there are no more rows
+ * or TDS_FAIL on error.
+ * On failure the partially written request is cancelled.
+ */
+typedef TDSRET (*TDS_TVP_FETCH)(TDSSOCKET *tds, struct tds_tvp *table);
+
 typedef struct tds_tvp
 {
 	char *schema;
 	char *name;
 	TDSPARAMINFO *metadata;
 	TDS_TVP_ROW *row;
+	/** if set rows are streamed from this callback, after rows in list */
+	TDS_TVP_FETCH fetch;
+	/** opaque pointer for the callback */
+	void *fetch_param;
+	/** last row produced by fetch, freed with the table */
+	TDSPARAMINFO *fetch_row;
+	/** number of rows produced by fetch so far */
+	TDS_INT8 num_fetched;
 } TDS_TVP;
 
 
@@ -1310,6 +1403,7 @@ int tds_parse_boolean(const char *value, int default_value);
 int tds_config_boolean(const char *option, const char *value, TDSLOGIN * login);
 
 TDSLOCALE *tds_get_locale(void);
+void tds_locale_compile_date_plans(TDSLOCALE *locale);
 TDSRET tds_alloc_row(TDSRESULTINFO * res_info);
 TDSRET tds_alloc_compute_row(TDSCOMPUTEINFO * res_info);
 BCPCOLDATA * tds_alloc_bcp_column_data(unsigned int column_size);
@@ -1336,6 +1430,7 @@ void tds_free_all_results(TDSSOCKET * tds);
 void tds_free_results(TDSRESULTINFO * res_info);
 void tds_free_param_results(TDSPARAMINFO * param_info);
 void tds_free_param_result(TDSPARAMINFO * param_info);
+void tds_move_param_caches(TDSPARAMINFO * dest, TDSPARAMINFO * src);
 void tds_free_msg(TDSMESSAGE * message);
 void tds_cursor_deallocated(TDSCONNECTION *conn, TDSCURSOR *cursor);
 void tds_release_cursor(TDSCURSOR **pcursor);
@@ -1410,10 +1505,14 @@ TDSRET tds_submit_execdirect(TDSSOCKET * tds, const char *query, TDSPARAMINFO *
 TDSRET tds71_submit_prepexec(TDSSOCKET * tds, const char *query, const char *id, TDSDYNAMIC ** dyn_out, TDSPARAMINFO * params);
 TDSRET tds_submit_execute(TDSSOCKET * tds, TDSDYNAMIC * dyn);
 TDSRET tds_send_cancel(TDSSOCKET * tds);
+TDSRET tds_cancel_request(TDSSOCKET * tds);
 const char *tds_next_placeholder(const char *start);
 int tds_count_placeholders(const char *query);
 int tds_needs_unprepare(TDSCONNECTION * conn, TDSDYNAMIC * dyn);
 TDSRET tds_deferred_unprepare(TDSCONNECTION * conn, TDSDYNAMIC * dyn);
+TDSDYNAMIC *tds_dynamic_cache_get(TDSSOCKET * tds, const char *query, TDSPARAMINFO * params);
+bool tds_dynamic_cache_put(TDSCONNECTION * conn, TDSDYNAMIC * dyn);
+void tds_dynamic_cache_remove(TDSCONNECTION * conn, TDSDYNAMIC * dyn);
 TDSRET tds_submit_unprepare(TDSSOCKET * tds, TDSDYNAMIC * dyn);
 TDSRET tds_submit_rpc(TDSSOCKET * tds, const char *rpc_name, TDSPARAMINFO * params, TDSHEADERS * head);
 TDSRET tds_submit_optioncmd(TDSSOCKET * tds, TDS_OPTION_CMD command, TDS_OPTION option, TDS_OPTION_ARG *param, TDS_INT param_size);
@@ -1434,6 +1533,7 @@ void tds_convert_string_free(const char *original, const char *converted);
 	do { if (original != converted) free((char*) converted); } while(0)
 #endif
 TDSRET tds_get_column_declaration(TDSSOCKET * tds, TDSCOLUMN * curcol, char *out);
+void tds_free_param_decl(struct tds_param_decl *decl);
 
 TDSRET tds_cursor_declare(TDSSOCKET * tds, TDSCURSOR * cursor, bool *send);
 TDSRET tds_cursor_setrows(TDSSOCKET * tds, TDSCURSOR * cursor, bool *send);
@@ -1450,12 +1550,16 @@ TDSRET tds_multiple_init(TDSSOCKET *tds, TDSMULTIPLE *multiple, TDS_MULTIPLE_TYP
 TDSRET tds_multiple_done(TDSSOCKET *tds, TDSMULTIPLE *multiple);
 TDSRET tds_multiple_query(TDSSOCKET *tds, TDSMULTIPLE *multiple, const char *query, TDSPARAMINFO * params);
 TDSRET tds_multiple_execute(TDSSOCKET *tds, TDSMULTIPLE *multiple, TDSDYNAMIC * dyn);
+TDSRET tds_multiple_unprepare(TDSSOCKET *tds, TDSMULTIPLE *multiple, TDSDYNAMIC * dyn);
+TDSRET tds_multiple_rpc(TDSSOCKET *tds, TDSMULTIPLE *multiple, const char *rpc_name, TDSPARAMINFO * params);
+TDSRET tds_multiple_execdirect(TDSSOCKET *tds, TDSMULTIPLE *multiple, const char *query, TDSPARAMINFO * params);
 
 
 /* token.c */
 TDSRET tds_process_cancel(TDSSOCKET * tds);
 TDSRET tds_process_login_tokens(TDSSOCKET * tds);
 TDSRET tds_process_simple_query(TDSSOCKET * tds);
+TDSRET tds_process_multiple_results(TDSSOCKET * tds, TDSMULTIPLE * multiple, TDSMULTIPLERESULT * results);
 int tds5_send_optioncmd(TDSSOCKET * tds, TDS_OPTION_CMD tds_command, TDS_OPTION tds_option, TDS_OPTION_ARG * tds_argument,
 			TDS_INT * tds_argsize);
 TDSRET tds_process_tokens(TDSSOCKET * tds, /*@out@*/ TDS_INT * result_type, /*@out@*/ int *done_flags, unsigned flag);
@@ -1704,6 +1808,11 @@ TDSRET tds_bcp_init(TDSSOCKET *tds, TDSBCPINFO *bcpinfo);
 typedef TDSRET (*tds_bcp_get_col_data) (TDSBCPINFO *bulk, TDSCOLUMN *bcpcol, int offset);
 typedef void (*tds_bcp_null_error)   (TDSBCPINFO *bulk, int index, int offset);
 TDSRET tds_bcp_send_record(TDSSOCKET *tds, TDSBCPINFO *bcpinfo, tds_bcp_get_col_data get_col_data, tds_bcp_null_error null_error, int offset);
+TDSRET tds_bcp_bind_array(TDSSOCKET *tds, TDSBCPINFO *bcpinfo, int column, TDS_SERVER_TYPE type, const void *data,
+			  TDS_INT stride, const TDS_INT *lengths, const TDS_SMALLINT *indicators);
+TDSRET tds_bcp_bind_column(TDSSOCKET *tds, TDSBCPINFO *bcpinfo, int column, const TDSCOLUMN *src);
+TDSRET tds_bcp_send_rows(TDSSOCKET *tds, TDSBCPINFO *bcpinfo, int offset, int num_rows,
+			 tds_bcp_null_error null_error, int *rows_sent);
 TDSRET tds_bcp_done(TDSSOCKET *tds, int *rows_copied);
 TDSRET tds_bcp_start(TDSSOCKET *tds, TDSBCPINFO *bcpinfo);
 TDSRET tds_bcp_start_copy_in(TDSSOCKET *tds, TDSBCPINFO *bcpinfo);
@@ -1711,6 +1820,42 @@ TDSRET tds_bcp_start_copy_in(TDSSOCKET *tds, TDSBCPINFO *bcpinfo);
 TDSRET tds_bcp_fread(TDSSOCKET * tds, TDSICONV * conv, FILE * stream,
 		     const char *terminator, size_t term_len, char **outbuf, size_t * outbytes);
 
+/** Data file for bulk copy in, mapped in memory if possible */
+typedef struct tds_bcp_hostfile
+{
+	/** file, used directly only if not mapped or compressed */
+	FILE *f;
+	/** gzip stream reading from f, NULL if not compressed */
+	struct gzFile_s *gz;
+	/** file content (or part of decompressed content), NULL if read using stdio */
+	const char *map;
+	size_t map_size;
+	/** offset in the file of map content */
+	TDS_INT8 map_offset;
+	/** current position in mapped content */
+	size_t pos;
+	/** end of mapped content reached */
+	bool eof;
+	/** error reading or decompressing data, reads failing are not an end of file */
+	bool error;
+	/** buffer for decompressed data, map points here if compressed */
+	char *zbuf;
+	size_t zbuf_size;
+	/** buffer for data read or converted */
+	char *buf;
+	size_t buf_size;
+} TDSBCPHOSTFILE;
+
+TDSBCPHOSTFILE *tds_bcp_hostfile_open(FILE *f);
+TDSBCPHOSTFILE *tds_bcp_hostfile_open_compressed(FILE *f);
+int tds_bcp_hostfile_close(TDSBCPHOSTFILE *hf);
+bool tds_bcp_hostfile_eof(TDSBCPHOSTFILE *hf);
+TDS_INT8 tds_bcp_hostfile_tell(TDSBCPHOSTFILE *hf);
+TDSRET tds_bcp_hostfile_seek(TDSBCPHOSTFILE *hf, TDS_INT8 pos);
+TDSRET tds_bcp_hostfile_read(TDSBCPHOSTFILE *hf, size_t len, const char **data);
+TDSRET tds_bcp_hostfile_read_field(TDSSOCKET *tds, TDSICONV *char_conv, TDSBCPHOSTFILE *hf,
+				   const char *terminator, size_t term_len, const char **data, size_t *len);
+
 TDSRET tds_writetext_start(TDSSOCKET *tds, const char *objname, const char *textptr, const char *timestamp, int with_log, TDS_UINT size);
 TDSRET tds_writetext_continue(TDSSOCKET *tds, const TDS_UCHAR *text, TDS_UINT size);
 TDSRET tds_writetext_end(TDSSOCKET *tds);
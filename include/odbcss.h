@@ -189,6 +189,8 @@ typedef struct tagSS_TIMESTAMPOFFSET_STRUCT {
 #define SQL_COPT_TDSODBC_IMPL_BCP_BIND	(SQL_COPT_TDSODBC_IMPL_BASE+6)
 #define SQL_COPT_TDSODBC_IMPL_BCP_INITW	(SQL_COPT_TDSODBC_IMPL_BASE+7)
 #define SQL_COPT_TDSODBC_IMPL_BCP_CONTROL	(SQL_COPT_TDSODBC_IMPL_BASE+8)
+#define SQL_COPT_TDSODBC_IMPL_BCP_BIND_ARRAY	(SQL_COPT_TDSODBC_IMPL_BASE+9)
+#define SQL_COPT_TDSODBC_IMPL_BCP_SENDROWS	(SQL_COPT_TDSODBC_IMPL_BASE+10)
 
 #define SQL_VARLEN_DATA -10
 
@@ -367,6 +369,40 @@ bcp_bind(HDBC hdbc, const unsigned char * varaddr, int prefixlen, int varlen,
 	return SQL_SUCCEEDED(SQLSetConnectAttr(hdbc, SQL_COPT_TDSODBC_IMPL_BCP_BIND, &params, SQL_IS_POINTER)) ? SUCCEED : FAIL;
 }
 
+struct tdsodbc_impl_bcp_bind_array_params
+{
+	const unsigned char * varaddr;
+	int stride;
+	const int * lengths;
+	const short * indicators;
+	int vartype;
+	int table_column;
+};
+
+static TDSODBC_INLINE RETCODE SQL_API
+bcp_bind_array(HDBC hdbc, const unsigned char * varaddr, int stride, const int * lengths,
+	const short * indicators, int vartype, int table_column)
+{
+	struct tdsodbc_impl_bcp_bind_array_params params = {varaddr, stride, lengths, indicators, vartype, table_column};
+	return SQL_SUCCEEDED(SQLSetConnectAttr(hdbc, SQL_COPT_TDSODBC_IMPL_BCP_BIND_ARRAY, &params, SQL_IS_POINTER)) ? SUCCEED : FAIL;
+}
+
+struct tdsodbc_impl_bcp_sendrows_params
+{
+	int num_rows;
+	int rows_sent;
+};
+
+static TDSODBC_INLINE RETCODE SQL_API
+bcp_sendrows(HDBC hdbc, int num_rows, int * rows_sent)
+{
+	struct tdsodbc_impl_bcp_sendrows_params params = {num_rows, 0};
+	RETCODE ret = SQL_SUCCEEDED(SQLSetConnectAttr(hdbc, SQL_COPT_TDSODBC_IMPL_BCP_SENDROWS, &params, SQL_IS_POINTER)) ? SUCCEED : FAIL;
+	if (rows_sent)
+		*rows_sent = params.rows_sent;
+	return ret;
+}
+
 #ifdef UNICODE
 #define bcp_init bcp_initW
 #define BCPHINTS BCPHINTSW
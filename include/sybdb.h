@@ -109,6 +109,8 @@ extern "C"
 #define BCPLAST 3
 #define BCPBATCH 4
 #define BCPKEEPIDENTITY	8
+#define BCPPIPELINE 100	/* FreeTDS only */
+#define BCPCOMPRESS 101	/* FreeTDS only */
 
 #define BCPLABELED 5
 #define BCPHINTS 6
@@ -718,6 +720,8 @@ DBINT dbaltutype(DBPROCESS * dbproc, int computeid, int column);
 RETCODE dbanullbind(DBPROCESS * dbprocess, int computeid, int column, DBINT * indicator);
 RETCODE dbbind(DBPROCESS * dbproc, int column, int vartype, DBINT varlen, BYTE * varaddr);
 RETCODE dbbind_ps(DBPROCESS * dbprocess, int column, int vartype, DBINT varlen, BYTE * varaddr, DBTYPEINFO * typeinfo);
+RETCODE dbbind_array(DBPROCESS * dbproc, int column, int vartype, DBINT varlen, BYTE * varaddr, DBINT stride,
+		     DBINT * indicators); /* FreeTDS only */
 int dbbufsize(DBPROCESS * dbprocess);
 BYTE *dbbylist(DBPROCESS * dbproc, int computeid, int *size);
 RETCODE dbcancel(DBPROCESS * dbproc);
@@ -823,6 +827,7 @@ RETCODE dbmoretext(DBPROCESS * dbproc, DBINT size, const BYTE text[]);
 MHANDLEFUNC dbmsghandle(MHANDLEFUNC handler);
 char *dbname(DBPROCESS * dbproc);
 STATUS dbnextrow(DBPROCESS * dbproc);
+STATUS dbnextrows(DBPROCESS * dbproc, DBINT num_rows, DBINT * rows_read); /* FreeTDS only */
 RETCODE dbnullbind(DBPROCESS * dbproc, int column, DBINT * indicator);
 int dbnumalts(DBPROCESS * dbproc, int computeid);
 int dbnumcols(DBPROCESS * dbproc);
@@ -1222,6 +1227,9 @@ DBINT dbvarylen(DBPROCESS * dbproc, int column);
 #define SYBEDCL         20298	/* -004- DCL Error */
 #define SYBECS          20299	/* -004- cs context Error */
 #define SYBEBULKINSERT  20599	/* cannot build bulk insert statement */
+#define SYBEBCKPT       20600	/* I/O error on bcp checkpoint file. */
+#define SYBEBNDARR      20601	/* Null indicator of a column bound with dbbind_array must be passed to dbbind_array. */
+#define SYBEPVTCOLS     20602	/* dbpivot result would have more than 65535 columns. */
 #define SYBECOLSIZE     22000   /* Invalid column information structure size */
 
 int dbtds(DBPROCESS * dbprocess);
@@ -1321,11 +1329,17 @@ RETCODE bcp_colfmt_ps(DBPROCESS * dbproc, int host_column, int host_type, int ho
 RETCODE bcp_colptr(DBPROCESS * dbproc, BYTE * colptr, int table_column);
 RETCODE bcp_control(DBPROCESS * dbproc, int field, DBINT value);
 int bcp_getbatchsize(DBPROCESS * dbproc); /* FreeTDS only */
+RETCODE bcp_hostrange(DBPROCESS * dbproc, DBBIGINT start, DBBIGINT end); /* FreeTDS only */
+RETCODE bcp_checkpoint(DBPROCESS * dbproc, const char *filename); /* FreeTDS only */
 RETCODE bcp_exec(DBPROCESS * dbproc, DBINT * rows_copied);
 DBBOOL bcp_getl(LOGINREC * login);
 RETCODE bcp_options(DBPROCESS * dbproc, int option, BYTE * value, int valuelen);
 RETCODE bcp_readfmt(DBPROCESS * dbproc, const char filename[]);
 RETCODE bcp_sendrow(DBPROCESS * dbproc);
+RETCODE bcp_bind_array(DBPROCESS * dbproc, BYTE * varaddr, DBINT stride, DBINT * lengths, DBSMALLINT * indicators, int type,
+		       int table_column); /* FreeTDS only */
+RETCODE bcp_bind_result(DBPROCESS * dbproc, DBPROCESS * source, int source_column, int table_column); /* FreeTDS only */
+RETCODE bcp_sendrows(DBPROCESS * dbproc, DBINT num_rows, DBINT * rows_sent); /* FreeTDS only */
 
 #ifdef __cplusplus
 #if 0
@@ -50,6 +50,9 @@
 
 #include <freetds/replacements.h>
 #include <freetds/macros.h>
+#include <freetds/thread.h>
+
+#define MAX_JOBS 64
 
 typedef struct
 {
@@ -76,14 +79,47 @@ typedef struct pd
 	int pflag;
 	int Eflag;
 	int vflag;
+	int jobs;
+	char *keycol;
 } BCPPARAMDATA;
 
+/* a table, or a range of keys of a table, to copy */
+typedef struct
+{
+	char *src_table;
+	char *dest_table;
+	/* condition selecting a range of rows, NULL for all rows */
+	char *where;
+	DBINT rows_read;
+	DBINT rows_done;
+	double elapsed_time;
+	int ok;
+} COPYTASK;
+
+/* a pair of connections copying tasks */
+typedef struct
+{
+	const BCPPARAMDATA *params;
+	DBPROCESS *dbsrc;
+	DBPROCESS *dbdest;
+	COPYTASK *tasks;
+	int num_tasks;
+} COPYJOB;
+
+static tds_mutex task_mutex = TDS_MUTEX_INITIALIZER;
+static int next_task;
+
 static void pusage(void);
 static int process_parameters(int, char **, struct pd *);
 static int login_to_databases(const BCPPARAMDATA * pdata, DBPROCESS ** dbsrc, DBPROCESS ** dbdest);
 static int create_target_table(char *sobjname, char *owner, char *dobjname, DBPROCESS * dbsrc, DBPROCESS * dbdest);
 static int check_table_structures(char *sobjname, char *dobjname, DBPROCESS * dbsrc, DBPROCESS * dbdest);
-static int transfer_data(const BCPPARAMDATA * params, DBPROCESS * dbsrc, DBPROCESS * dbdest);
+static int split_tables(const BCPPARAMDATA * params, COPYTASK ** ptasks, int *pnum_tasks);
+static int split_key_ranges(const BCPPARAMDATA * params, DBPROCESS * dbsrc, COPYTASK ** ptasks, int *pnum_tasks);
+static void free_tasks(COPYTASK * tasks, int num_tasks);
+static int truncate_table(char *dobjname, DBPROCESS * dbdest);
+static int copy_tasks(const BCPPARAMDATA * params, DBPROCESS * dbsrc, DBPROCESS * dbdest, COPYTASK * tasks, int num_tasks);
+static int transfer_data(const BCPPARAMDATA * params, COPYTASK * task, int num_tasks, DBPROCESS * dbsrc, DBPROCESS * dbdest);
 static RETCODE set_textsize(DBPROCESS *dbproc, int textsize);
 
 static int err_handler(DBPROCESS *, int, int, int, char *, char *);
@@ -99,6 +135,9 @@ main(int argc, char **argv)
 	DBPROCESS *dbsrc;
 	DBPROCESS *dbtarget;
 
+	COPYTASK *tasks;
+	int i, num_tasks, num_tables;
+
 	setlocale(LC_ALL, "");
 
 	memset(&params, '\0', sizeof(params));
@@ -108,6 +147,23 @@ main(int argc, char **argv)
 		return 1;
 	}
 
+	if (split_tables(&params, &tasks, &num_tables) == FALSE)
+		return 1;
+	num_tasks = num_tables;
+
+	/* Initialize DB-Library. */
+
+	if (dbinit() == FAIL)
+		return 1;
+
+	/*
+	 * Install the user-supplied error-handling and message-handling
+	 * routines. They are defined at the bottom of this source file.
+	 */
+
+	dberrhandle(err_handler);
+	dbmsghandle(msg_handler);
+
 	if (login_to_databases(&params, &dbsrc, &dbtarget) == FALSE)
 		return 1;
 
@@ -115,32 +171,51 @@ main(int argc, char **argv)
 	    || set_textsize(dbsrc, params.textsize) != SUCCEED)
 		return 1;
 
-	if (params.cflag) {
-		if (create_target_table(params.src.dbobject, params.owner, params.dest.dbobject, dbsrc, dbtarget) == FALSE) {
-			fprintf(stderr, "datacopy: could not create target table %s.%s . terminating\n",
-			        params.owner, params.dest.dbobject);
+	for (i = 0; i < num_tables; ++i) {
+		COPYTASK *task = &tasks[i];
+
+		if (params.cflag) {
+			if (create_target_table(task->src_table, params.owner, task->dest_table, dbsrc, dbtarget) == FALSE) {
+				fprintf(stderr, "datacopy: could not create target table %s.%s . terminating\n",
+					params.owner, task->dest_table);
+				dbclose(dbsrc);
+				dbclose(dbtarget);
+				return 1;
+			}
+		}
+
+		if (check_table_structures(task->src_table, task->dest_table, dbsrc, dbtarget) == FALSE) {
+			fprintf(stderr, "datacopy: table structures do not match. terminating\n");
+			dbclose(dbsrc);
+			dbclose(dbtarget);
+			return 1;
+		}
+
+		/* truncate once, before rows are copied in parallel */
+		if (params.tflag && truncate_table(task->dest_table, dbtarget) == FALSE) {
 			dbclose(dbsrc);
 			dbclose(dbtarget);
 			return 1;
 		}
 	}
 
-	if (check_table_structures(params.src.dbobject, params.dest.dbobject, dbsrc, dbtarget) == FALSE) {
-		fprintf(stderr, "datacopy: table structures do not match. terminating\n");
+	if (params.keycol && params.jobs > 1
+	    && split_key_ranges(&params, dbsrc, &tasks, &num_tasks) == FALSE) {
 		dbclose(dbsrc);
 		dbclose(dbtarget);
 		return 1;
 	}
 
-	if (transfer_data(&params, dbsrc, dbtarget) == FALSE) {
+	if (copy_tasks(&params, dbsrc, dbtarget, tasks, num_tasks) == FALSE) {
 		fprintf(stderr, "datacopy: table copy failed.\n");
 		fprintf(stderr, "           the data may have been partially copied into the target database \n");
+		free_tasks(tasks, num_tasks);
 		dbclose(dbsrc);
 		dbclose(dbtarget);
 		return 1;
 	}
 
-
+	free_tasks(tasks, num_tasks);
 	dbclose(dbsrc);
 	dbclose(dbtarget);
 
@@ -211,10 +286,11 @@ process_parameters(int argc, char **argv, BCPPARAMDATA * pdata)
 
 	pdata->textsize = -1;
 	pdata->batchsize = 1000;
+	pdata->jobs = 1;
 
 	/* get the rest of the arguments */
 
-	while ((opt = getopt(argc, argv, "b:p:tac:dS:D:T:Ev")) != -1) {
+	while ((opt = getopt(argc, argv, "b:p:tac:dS:D:T:Evj:k:")) != -1) {
 		switch (opt) {
 		case 'b':
 			pdata->bflag++;
@@ -264,6 +340,16 @@ process_parameters(int argc, char **argv, BCPPARAMDATA * pdata)
 		case 'v':
 			pdata->vflag++;
 			break;
+		case 'j':
+			pdata->jobs = atoi(optarg);
+			if (pdata->jobs < 1 || pdata->jobs > MAX_JOBS) {
+				fprintf(stderr, "-j must be between 1 and %d.\n", MAX_JOBS);
+				return FALSE;
+			}
+			break;
+		case 'k':
+			pdata->keycol = strdup(optarg);
+			break;
 		default:
 			return FALSE;
 		}
@@ -324,19 +410,6 @@ login_to_databases(const BCPPARAMDATA * pdata, DBPROCESS ** dbsrc, DBPROCESS **
 	LOGINREC *slogin = NULL;
 	LOGINREC *dlogin = NULL;
 
-	/* Initialize DB-Library. */
-
-	if (dbinit() == FAIL)
-		return FALSE;
-
-	/*
-	 * Install the user-supplied error-handling and message-handling
-	 * routines. They are defined at the bottom of this source file.
-	 */
-
-	dberrhandle(err_handler);
-	dbmsghandle(msg_handler);
-
 	/*
 	 * Allocate and initialize the LOGINREC structure to be used
 	 * to open a connection to SQL Server.
@@ -576,61 +649,338 @@ check_table_structures(char *sobjname, char *dobjname, DBPROCESS * dbsrc, DBPROC
 	return TRUE;
 }
 
+/*
+ * Build the list of tables to copy.
+ * Source and destination can be lists of tables separated by commas.
+ */
 static int
-transfer_data(const BCPPARAMDATA * params, DBPROCESS * dbsrc, DBPROCESS * dbdest)
+split_tables(const BCPPARAMDATA * params, COPYTASK ** ptasks, int *pnum_tasks)
 {
-	char ls_command[256];
-	int col;
+	char *src_list, *dest_list, *src_next, *dest_next, *src, *dest;
+	COPYTASK *tasks = NULL;
+	int num_tasks = 0;
+
+	src_next = src_list = strdup(params->src.dbobject ? params->src.dbobject : "");
+	dest_next = dest_list = strdup(params->dest.dbobject ? params->dest.dbobject : "");
+	if (!src_list || !dest_list) {
+		fprintf(stderr, "Out of memory!\n");
+		return FALSE;
+	}
 
-	DBINT src_numcols = 0;
+	for (;;) {
+		COPYTASK *new_tasks;
 
-	typedef struct migcoldata
-	{
-		DBINT coltype;
-	} MIGCOLDATA;
+		src = strsep(&src_next, ",");
+		dest = strsep(&dest_next, ",");
+		if (!src && !dest)
+			break;
+		if (!src || !dest || !src[0] || !dest[0]) {
+			fprintf(stderr, "number of source and destination tables do not match\n");
+			free(tasks);
+			return FALSE;
+		}
 
-	MIGCOLDATA *srcdata;
+		new_tasks = (COPYTASK *) realloc(tasks, sizeof(COPYTASK) * (num_tasks + 1));
+		if (!new_tasks) {
+			fprintf(stderr, "Out of memory!\n");
+			free(tasks);
+			return FALSE;
+		}
+		tasks = new_tasks;
+		memset(&tasks[num_tasks], 0, sizeof(COPYTASK));
+		tasks[num_tasks].src_table = src;
+		tasks[num_tasks].dest_table = dest;
+		++num_tasks;
+	}
 
-	DBINT rows_read = 0;
-	DBINT rows_sent = 0;
-	DBINT rows_done = 0;
-	DBINT ret;
+	*ptasks = tasks;
+	*pnum_tasks = num_tasks;
+	return TRUE;
+}
 
-	struct timeval start_time;
-	struct timeval end_time;
+/*
+ * Split every table in ranges of the key column, one for each job.
+ */
+static int
+split_key_ranges(const BCPPARAMDATA * params, DBPROCESS * dbsrc, COPYTASK ** ptasks, int *pnum_tasks)
+{
+	const char *key = params->keycol;
+	COPYTASK *tables = *ptasks, *tasks;
+	int i, job, num_tasks = 0;
+
+	tasks = (COPYTASK *) calloc(sizeof(COPYTASK), (size_t) *pnum_tasks * params->jobs);
+	if (!tasks) {
+		fprintf(stderr, "Out of memory!\n");
+		return FALSE;
+	}
+
+	for (i = 0; i < *pnum_tasks; ++i) {
+		DBBIGINT min_key = 0, max_key = 0;
+		DBUBIGINT step;
+		int ret, found = 0;
+
+		if (dbfcmd(dbsrc, "select cast(min(%s) as bigint), cast(max(%s) as bigint) from %s",
+			   key, key, tables[i].src_table) == FAIL
+		    || dbsqlexec(dbsrc) == FAIL) {
+			fprintf(stderr, "could not get range of key %s of table %s\n", key, tables[i].src_table);
+			free(tasks);
+			return FALSE;
+		}
+		while ((ret = dbresults(dbsrc)) == SUCCEED) {
+			while (dbnextrow(dbsrc) == REG_ROW) {
+				if (dbdatlen(dbsrc, 1) > 0 && dbdatlen(dbsrc, 2) > 0) {
+					memcpy(&min_key, dbdata(dbsrc, 1), sizeof(min_key));
+					memcpy(&max_key, dbdata(dbsrc, 2), sizeof(max_key));
+					found = 1;
+				}
+			}
+		}
+		if (ret != NO_MORE_RESULTS) {
+			fprintf(stderr, "Error in dbresults\n");
+			free(tasks);
+			return FALSE;
+		}
+
+		/* empty table, nothing to split */
+		if (!found) {
+			tasks[num_tasks++] = tables[i];
+			continue;
+		}
+
+		/* first range includes NULL keys, last one is open */
+		step = ((DBUBIGINT) max_key - (DBUBIGINT) min_key) / params->jobs + 1;
+		for (job = 0; job < params->jobs; ++job) {
+			COPYTASK *task = &tasks[num_tasks++];
+			DBBIGINT low = (DBBIGINT) ((DBUBIGINT) min_key + step * job);
+			DBBIGINT high = (DBBIGINT) ((DBUBIGINT) min_key + step * (job + 1));
+			int len;
+
+			*task = tables[i];
+			if (job == 0)
+				len = asprintf(&task->where, "%s < %" PRId64 " or %s is null", key, high, key);
+			else if (job + 1 < params->jobs)
+				len = asprintf(&task->where, "%s >= %" PRId64 " and %s < %" PRId64, key, low, key, high);
+			else
+				len = asprintf(&task->where, "%s >= %" PRId64, key, low);
+			if (len < 0) {
+				fprintf(stderr, "Out of memory!\n");
+				free(tasks);
+				return FALSE;
+			}
+		}
+	}
+
+	free(tables);
+	*ptasks = tasks;
+	*pnum_tasks = num_tasks;
+	return TRUE;
+}
+
+static void
+free_tasks(COPYTASK * tasks, int num_tasks)
+{
+	int i;
+
+	for (i = 0; i < num_tasks; ++i)
+		free(tasks[i].where);
+	free(tasks);
+}
+
+static int
+truncate_table(char *dobjname, DBPROCESS * dbdest)
+{
+	if (dbfcmd(dbdest, "truncate table %s", dobjname) == FAIL) {
+		fprintf(stderr, "dbcmd failed\n");
+		return FALSE;
+	}
+
+	if (dbsqlexec(dbdest) == FAIL) {
+		fprintf(stderr, "dbsqlexec failed\n");
+		return FALSE;
+	}
+
+	if (dbresults(dbdest) == FAIL) {
+		fprintf(stderr, "Error in dbresults\n");
+		return FALSE;
+	}
+	return TRUE;
+}
+
+static COPYTASK *
+get_task(COPYJOB * job)
+{
+	COPYTASK *task = NULL;
+
+	tds_mutex_lock(&task_mutex);
+	if (next_task < job->num_tasks)
+		task = &job->tasks[next_task++];
+	tds_mutex_unlock(&task_mutex);
+	return task;
+}
+
+static TDS_THREAD_PROC_DECLARE(job_proc, arg)
+{
+	COPYJOB *job = (COPYJOB *) arg;
+	COPYTASK *task;
+
+	/* after a failure connections are in an unknown state, stop */
+	while ((task = get_task(job)) != NULL) {
+		task->ok = transfer_data(job->params, task, job->num_tasks, job->dbsrc, job->dbdest);
+		if (!task->ok)
+			break;
+	}
+	return TDS_THREAD_RESULT(0);
+}
+
+/*
+ * Copy all tasks using up to params->jobs pairs of connections.
+ * The first pair is the one already open.
+ */
+static int
+copy_tasks(const BCPPARAMDATA * params, DBPROCESS * dbsrc, DBPROCESS * dbdest, COPYTASK * tasks, int num_tasks)
+{
+	COPYJOB *jobs;
+#ifdef TDS_HAVE_MUTEX
+	tds_thread *threads;
+	int *started;
+#endif
+	int i, num_jobs, ok = TRUE;
+	DBINT rows_read = 0, rows_done = 0;
+	struct timeval start_time, end_time;
 	double elapsed_time;
 
-	DBCOL2 colinfo;
-	BOOL identity_column_exists = FALSE;
+	num_jobs = params->jobs < num_tasks ? params->jobs : num_tasks;
+	if (num_jobs < 1)
+		num_jobs = 1;
+
+	jobs = (COPYJOB *) calloc(sizeof(COPYJOB), num_jobs);
+#ifdef TDS_HAVE_MUTEX
+	threads = (tds_thread *) calloc(sizeof(tds_thread), num_jobs);
+	started = (int *) calloc(sizeof(int), num_jobs);
+	if (!threads || !started) {
+		fprintf(stderr, "Out of memory!\n");
+		ok = FALSE;
+		goto cleanup;
+	}
+#endif
+	if (!jobs) {
+		fprintf(stderr, "Out of memory!\n");
+		ok = FALSE;
+		goto cleanup;
+	}
+
+	for (i = 0; i < num_jobs; ++i) {
+		COPYJOB *job = &jobs[i];
+
+		job->params = params;
+		job->tasks = tasks;
+		job->num_tasks = num_tasks;
+		if (i == 0) {
+			job->dbsrc = dbsrc;
+			job->dbdest = dbdest;
+			continue;
+		}
+		if (login_to_databases(params, &job->dbsrc, &job->dbdest) == FALSE
+		    || set_textsize(job->dbdest, params->textsize) != SUCCEED
+		    || set_textsize(job->dbsrc, params->textsize) != SUCCEED) {
+			ok = FALSE;
+			goto cleanup;
+		}
+	}
 
 	if (params->vflag) {
 		printf("\nStarting copy...\n");
 	}
 
-	if (params->tflag) {
-
-		sprintf(ls_command, "truncate table %s", params->dest.dbobject);
+	gettimeofday(&start_time, 0);
 
-		if (dbcmd(dbdest, ls_command) == FAIL) {
-			fprintf(stderr, "dbcmd failed\n");
-			return FALSE;
+	/* first job runs in this thread */
+	next_task = 0;
+	for (i = 1; i < num_jobs; ++i) {
+#ifdef TDS_HAVE_MUTEX
+		if (tds_thread_create(&threads[i], job_proc, &jobs[i]) == 0) {
+			started[i] = 1;
+			continue;
 		}
+#endif
+		job_proc(&jobs[i]);
+	}
+	job_proc(&jobs[0]);
 
-		if (dbsqlexec(dbdest) == FAIL) {
-			fprintf(stderr, "dbsqlexec failed\n");
-			return FALSE;
-		}
+#ifdef TDS_HAVE_MUTEX
+	for (i = 1; i < num_jobs; ++i) {
+		if (started[i])
+			tds_thread_join(threads[i], NULL);
+	}
+#endif
 
-		if (dbresults(dbdest) == FAIL) {
-			fprintf(stderr, "Error in dbresults\n");
-			return FALSE;
+	gettimeofday(&end_time, 0);
+
+	elapsed_time = (double) (end_time.tv_sec - start_time.tv_sec) +
+		((double) (end_time.tv_usec - start_time.tv_usec) / 1000000.00);
+
+	for (i = 0; i < num_tasks; ++i) {
+		const COPYTASK *task = &tasks[i];
+
+		if (!task->ok)
+			ok = FALSE;
+		rows_read += task->rows_read;
+		rows_done += task->rows_done;
+		if (params->vflag && num_tasks > 1)
+			printf("%s%s%s: %d rows written in %f secs (%.0f rows per second)\n",
+			       task->dest_table, task->where ? " where " : "", task->where ? task->where : "",
+			       task->rows_done, task->elapsed_time,
+			       task->elapsed_time > 0 ? task->rows_done / task->elapsed_time : 0.0);
+	}
+
+	if (params->vflag) {
+		printf("\n");
+		if (num_tasks > 1) {
+			printf("tables/ranges copied : %d\n", num_tasks);
+			printf("parallel jobs        : %d\n", num_jobs);
 		}
+		printf("rows read            : %d\n", rows_read);
+		printf("rows written         : %d\n", rows_done);
+		printf("batch size           : %d\n", params->batchsize);
+		printf("elapsed time (secs)  : %f\n", elapsed_time);
+		printf("rows per second      : %f\n", rows_done / elapsed_time);
 	}
 
+cleanup:
+	/* first job uses connections of the caller */
+	for (i = 1; jobs && i < num_jobs; ++i) {
+		if (jobs[i].dbsrc)
+			dbclose(jobs[i].dbsrc);
+		if (jobs[i].dbdest)
+			dbclose(jobs[i].dbdest);
+	}
+#ifdef TDS_HAVE_MUTEX
+	free(threads);
+	free(started);
+#endif
+	free(jobs);
+	return ok;
+}
 
-	sprintf(ls_command, "select * from %s", params->src.dbobject);
+static int
+transfer_data(const BCPPARAMDATA * params, COPYTASK * task, int num_tasks, DBPROCESS * dbsrc, DBPROCESS * dbdest)
+{
+	int col;
 
-	if (dbcmd(dbsrc, ls_command) == FAIL) {
+	DBINT src_numcols = 0;
+
+	DBINT rows_sent = 0;
+	DBINT ret;
+	RETCODE row_code;
+
+	struct timeval start_time;
+	struct timeval end_time;
+
+	DBCOL2 colinfo;
+	BOOL identity_column_exists = FALSE;
+
+	if (dbfcmd(dbsrc, "select * from %s%s%s", task->src_table,
+		   task->where ? " where " : "", task->where ? task->where : "") == FAIL) {
 		fprintf(stderr, "dbcmd failed\n");
 		return FALSE;
 	}
@@ -649,56 +999,28 @@ transfer_data(const BCPPARAMDATA * params, DBPROCESS * dbsrc, DBPROCESS * dbdest
 
 
 
-	if (bcp_init(dbdest, params->dest.dbobject, (char *) NULL, (char *) NULL, DB_IN) == FAIL) {
+	if (bcp_init(dbdest, task->dest_table, (char *) NULL, (char *) NULL, DB_IN) == FAIL) {
 		fprintf(stderr, "Error in bcp_init\n");
 		return FALSE;
 	}
 
-	srcdata = (MIGCOLDATA *) calloc(sizeof(MIGCOLDATA), src_numcols);
-	if (!srcdata) {
-		fprintf(stderr, "Could not allocate memory for srcdata\n");
-		return FALSE;
-	}
 	for (col = 0; col < src_numcols; col++) {
 
 		/* Find out if there is an identity column. */
 		colinfo.SizeOfStruct = sizeof(colinfo);
 
-		if (dbtablecolinfo(dbsrc, col+1, (DBCOL *) &colinfo) != SUCCEED) {
-			free(srcdata);
+		if (dbtablecolinfo(dbsrc, col+1, (DBCOL *) &colinfo) != SUCCEED)
 			return FALSE;
-		}
 		if (colinfo.Identity)
 			identity_column_exists = TRUE;
 
-		srcdata[col].coltype = dbcoltype(dbsrc, col + 1);
-
-		switch (srcdata[col].coltype) {
-		case SYBBIT:
-		case SYBINT1:
-		case SYBINT2:
-		case SYBINT4:
-		case SYBINT8:
-		case SYBFLT8:
-		case SYBREAL:
-		case SYBMONEY:
-		case SYBMONEY4:
-		case SYBDATETIME:
-		case SYBDATETIME4:
-		case SYBTIME:
-		case SYBDATE:
-		case SYBBIGTIME:
-		case SYBBIGDATETIME:
-		case SYBCHAR:
-		case SYBTEXT:
-		case SYBBINARY:
-		case SYBIMAGE:
-		case SYBNUMERIC:
-		case SYBDECIMAL:
-			break;
-		default:
-			fprintf(stderr, "Type %d not handled by datacopy\n", srcdata[col].coltype);
-			exit(1);
+		/*
+		 * Rows are sent from the current row of the source,
+		 * values of the same type are copied as they are.
+		 */
+		if (bcp_bind_result(dbdest, dbsrc, col + 1, col + 1) == FAIL) {
+			fprintf(stderr, "Type %d not handled by datacopy\n", dbcoltype(dbsrc, col + 1));
+			return FALSE;
 		}
 	}
 
@@ -708,48 +1030,10 @@ transfer_data(const BCPPARAMDATA * params, DBPROCESS * dbsrc, DBPROCESS * dbdest
 
 	gettimeofday(&start_time, 0);
 
-	while (dbnextrow(dbsrc) != NO_MORE_ROWS) {
-		rows_read++;
-		for (col = 0; col < src_numcols; col++) {
-			BYTE *data = dbdata(dbsrc, col + 1);
-
-			switch (srcdata[col].coltype) {
-			case SYBBIT:
-			case SYBINT1:
-			case SYBINT2:
-			case SYBINT4:
-			case SYBINT8:
-			case SYBFLT8:
-			case SYBREAL:
-			case SYBDATETIME:
-			case SYBDATETIME4:
-			case SYBTIME:
-			case SYBDATE:
-			case SYBBIGTIME:
-			case SYBBIGDATETIME:
-			case SYBMONEY:
-			case SYBMONEY4:
-			case SYBCHAR:
-			case SYBTEXT:
-			case SYBBINARY:
-			case SYBIMAGE:
-			case SYBNUMERIC:
-			case SYBDECIMAL:
-				bcp_colptr(dbdest, data, col + 1);
-				if (data == NULL) {	/* NULL data retrieved from source */
-					bcp_collen(dbdest, 0, col + 1);
-				} else {
-					bcp_collen(dbdest, dbdatlen(dbsrc, col + 1), col + 1);
-				}
-				break;
-			default:
-				fprintf(stderr, "Type %d not handled by datacopy\n", srcdata[col].coltype);
-				exit(1);
-			}
-		}
-		if (bcp_sendrow(dbdest) == FAIL) {
+	while ((row_code = dbnextrow(dbsrc)) == REG_ROW) {
+		task->rows_read++;
+		if (bcp_sendrows(dbdest, 1, NULL) == FAIL) {
 			fprintf(stderr, "bcp_sendrow failed.  \n");
-			free(srcdata);
 			return FALSE;
 		} else {
 			rows_sent++;
@@ -757,43 +1041,38 @@ transfer_data(const BCPPARAMDATA * params, DBPROCESS * dbsrc, DBPROCESS * dbdest
 				ret = bcp_batch(dbdest);
 				if (ret == -1) {
 					fprintf(stderr, "bcp_batch error\n");
-					free(srcdata);
 					return FALSE;
 				} else {
-					rows_done += ret;
-					printf("%d rows successfully copied (total %d)\n", ret, rows_done);
+					task->rows_done += ret;
+					if (num_tasks > 1)
+						printf("%s: ", task->dest_table);
+					printf("%d rows successfully copied (total %d)\n", ret, task->rows_done);
 					rows_sent = 0;
 				}
 			}
 		}
 	}
+	if (row_code == FAIL) {
+		fprintf(stderr, "dbnextrow failed.  \n");
+		return FALSE;
+	}
 
-	if (rows_read) {
+	if (task->rows_read) {
 		ret = bcp_done(dbdest);
 		if (ret == -1) {
 			fprintf(stderr, "bcp_done failed.  \n");
-			free(srcdata);
 			return FALSE;
 		} else {
-			rows_done += ret;
+			task->rows_done += ret;
 		}
 	}
 
 	gettimeofday(&end_time, 0);
 
 
-	elapsed_time = (double) (end_time.tv_sec - start_time.tv_sec) +
+	task->elapsed_time = (double) (end_time.tv_sec - start_time.tv_sec) +
 		((double) (end_time.tv_usec - start_time.tv_usec) / 1000000.00);
 
-	if (params->vflag) {
-		printf("\n");
-		printf("rows read            : %d\n", rows_read);
-		printf("rows written         : %d\n", rows_done);
-		printf("elapsed time (secs)  : %f\n", elapsed_time);
-		printf("rows per second      : %f\n", rows_done / elapsed_time);
-	}
-
-	free(srcdata);
 	return TRUE;
 
 
@@ -803,8 +1082,9 @@ static void
 pusage(void)
 {
 	fprintf(stderr, "usage: datacopy [-t | -a | -c owner] [-b batchsize] [-p packetsize] [-T textsize] [-v] [-d] [-E]\n");
-	fprintf(stderr, "       [-S server/username/password/database/table]\n");
-	fprintf(stderr, "       [-D server/username/password/database/table]\n");
+	fprintf(stderr, "       [-j jobs] [-k keycolumn]\n");
+	fprintf(stderr, "       [-S server/username/password/database/table[,table...]]\n");
+	fprintf(stderr, "       [-D server/username/password/database/table[,table...]]\n");
 	fprintf(stderr, "       -t : truncate target table before loading data\n");
 	fprintf(stderr, "       -a : append data to target table\n");
 	fprintf(stderr, "       -c : create table owner.table before loading data\n");
@@ -814,6 +1094,8 @@ pusage(void)
 	fprintf(stderr, "       (larger packet size = faster)\n");
 	fprintf(stderr, "       -T : Text and image size\n");
 	fprintf(stderr, "       -E : keep identity values\n");
+	fprintf(stderr, "       -j : number of tables or key ranges copied at the same time\n");
+	fprintf(stderr, "       -k : integer key column used to split tables in ranges (requires -j)\n");
 	fprintf(stderr, "       -v : produce verbose output (timings etc.)\n");
 	fprintf(stderr, "       -d : produce TDS DUMP log (serious debug only!)\n");
 }
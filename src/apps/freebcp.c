@@ -58,10 +58,39 @@
 #include <freetds/tds.h>
 #include <freetds/utils.h>
 #include <freetds/replacements.h>
+#include <freetds/thread.h>
 #include <sybfront.h>
 #include <sybdb.h>
 #include "freebcp.h"
 
+#ifdef HAVE_FSEEKO
+typedef off_t offset_type;
+#elif defined(_WIN32) || defined(_WIN64)
+/* win32 version */
+typedef __int64 offset_type;
+# if defined(HAVE__FSEEKI64) && defined(HAVE__FTELLI64)
+#  define fseeko(f,o,w) _fseeki64((f),o,w)
+#  define ftello(f) _ftelli64((f))
+# else
+#  define fseeko(f,o,w) (_lseeki64(fileno(f),o,w) == -1 ? -1 : 0)
+#  define ftello(f) _telli64(fileno(f))
+# endif
+#else
+/* use old version */
+#define fseeko(f,o,w) fseek(f,o,w)
+#define ftello(f) ftell(f)
+typedef long offset_type;
+#endif
+
+#define MAX_JOBS 64
+
+typedef struct
+{
+	BCPPARAMDATA params;
+	DBPROCESS *dbproc;
+	int ok;
+} BCPJOB;
+
 void pusage(void);
 int process_parameters(int, char **, struct pd *);
 static int unescape(char arg[]);
@@ -71,11 +100,14 @@ int file_character(BCPPARAMDATA * pdata, DBPROCESS * dbproc, DBINT dir);
 int file_native(BCPPARAMDATA * pdata, DBPROCESS * dbproc, DBINT dir);
 int file_formatted(BCPPARAMDATA * pdata, DBPROCESS * dbproc, DBINT dir);
 int setoptions (DBPROCESS * dbproc, BCPPARAMDATA * params);
+static int copy_data(BCPPARAMDATA * pdata, DBPROCESS * dbproc);
+static int copy_parallel(BCPPARAMDATA * pdata);
 
 int err_handler(DBPROCESS * dbproc, int severity, int dberr, int oserr, char *dberrstr, char *oserrstr);
 int msg_handler(DBPROCESS * dbproc, DBINT msgno, int msgstate, int severity, char *msgtext, char *srvname, char *procname,
 		int line);
 static int set_bcp_hints(BCPPARAMDATA *pdata, DBPROCESS *pdbproc);
+static int set_checkpoint(BCPPARAMDATA * pdata, DBPROCESS * dbproc, DBINT dir);
 
 int
 main(int argc, char **argv)
@@ -102,6 +134,10 @@ main(int argc, char **argv)
 		fprintf(stderr, "User name: \"%s\"\n", params.user);
 	}
 
+	if (params.jobs > 1) {
+		ok = copy_parallel(&params);
+		exit((ok == TRUE) ? EXIT_SUCCESS : EXIT_FAILURE);
+	}
 
 	if (login_to_database(&params, &dbproc) == FALSE) {
 		exit(EXIT_FAILURE);
@@ -110,21 +146,290 @@ main(int argc, char **argv)
 	if (!setoptions(dbproc, &params))
 		return FALSE;
 
-	if (params.cflag) {	/* character format file */
-		ok = file_character(&params, dbproc, params.direction);
-	} else if (params.nflag) {	/* native format file    */
-		ok = file_native(&params, dbproc, params.direction);
-	} else if (params.fflag) {	/* formatted file        */
-		ok = file_formatted(&params, dbproc, params.direction);
-	} else {
-		ok = FALSE;
-	}
+	ok = copy_data(&params, dbproc);
+
+	/* load completed, next run starts again */
+	if (ok == TRUE && params.checkpoint)
+		remove(params.checkpoint);
 
 	exit((ok == TRUE) ? EXIT_SUCCESS : EXIT_FAILURE);
 
 	return 0;
 }
 
+static int
+copy_data(BCPPARAMDATA * pdata, DBPROCESS * dbproc)
+{
+	if (pdata->cflag) {	/* character format file */
+		return file_character(pdata, dbproc, pdata->direction);
+	} else if (pdata->nflag) {	/* native format file    */
+		return file_native(pdata, dbproc, pdata->direction);
+	} else if (pdata->fflag) {	/* formatted file        */
+		return file_formatted(pdata, dbproc, pdata->direction);
+	}
+	return FALSE;
+}
+
+/*
+ * Find the first row starting at or after pos in a character file.
+ * Row terminator is expected not to appear inside data.
+ */
+static DBBIGINT
+find_row_start(FILE *f, DBBIGINT pos, DBBIGINT size, const char *rowterm, int rowtermlen)
+{
+	char buf[65536];
+	const size_t keep = rowtermlen - 1;
+	size_t len = 0;
+	DBBIGINT base;
+
+	if (pos <= 0)
+		return 0;
+
+	/* a row starts at pos if preceded by a terminator */
+	base = pos > rowtermlen ? pos - rowtermlen : 0;
+	if (fseeko(f, (offset_type) base, SEEK_SET) != 0)
+		return size;
+
+	for (;;) {
+		const char *p, *end;
+		size_t got = fread(buf + len, 1, sizeof(buf) - len, f);
+
+		if (got == 0)
+			return size;
+		len += got;
+		end = buf + len;
+
+		for (p = buf; (p = (const char *) memchr(p, rowterm[0], end - p)) != NULL; ++p) {
+			if (end - p < rowtermlen)
+				break;
+			if (memcmp(p, rowterm, rowtermlen) == 0)
+				return base + (p - buf) + rowtermlen;
+		}
+
+		/* keep last bytes, they could be the start of a terminator */
+		if (len > keep) {
+			memmove(buf, end - keep, keep);
+			base += len - keep;
+			len = keep;
+		}
+	}
+}
+
+/*
+ * Split a character file in ranges of rows, one for each job.
+ */
+static int
+split_hostfile(BCPPARAMDATA * pdata, BCPJOB * jobs)
+{
+	FILE *f;
+	DBBIGINT size, prev = 0;
+	int i;
+
+	if ((f = fopen(pdata->hostfilename, "rb")) == NULL) {
+		fprintf(stderr, "%s: unable to open %s: %s\n", "freebcp", pdata->hostfilename, strerror(errno));
+		return FALSE;
+	}
+	if (fseeko(f, 0, SEEK_END) != 0 || (size = ftello(f)) < 0) {
+		fprintf(stderr, "%s: unable to split %s, -j requires a regular file\n", "freebcp", pdata->hostfilename);
+		fclose(f);
+		return FALSE;
+	}
+
+	for (i = 0; i < pdata->jobs; ++i) {
+		DBBIGINT next = size;
+
+		if (i + 1 < pdata->jobs)
+			next = find_row_start(f, TDS_MAX(size / pdata->jobs * (i + 1), prev), size,
+					      pdata->rowterm, pdata->rowtermlen);
+		jobs[i].params.startoffset = prev;
+		jobs[i].params.endoffset = next;
+		prev = next;
+	}
+	fclose(f);
+	return TRUE;
+}
+
+static TDS_THREAD_PROC_DECLARE(job_proc, arg)
+{
+	BCPJOB *job = (BCPJOB *) arg;
+
+	job->ok = copy_data(&job->params, job->dbproc);
+	return TDS_THREAD_RESULT(0);
+}
+
+/*
+ * Check the server can split rows of a table by page using %%physloc%%.
+ */
+static bool
+physloc_supported(DBPROCESS * dbproc, const char *table)
+{
+	char *query;
+	RETCODE erc;
+	bool ok = false;
+
+	if (asprintf(&query, "SELECT TOP 0 %%%%physloc%%%% FROM %s", table) < 0)
+		return false;
+	if (dbcmd(dbproc, query) == SUCCEED && dbsqlexec(dbproc) == SUCCEED) {
+		ok = true;
+		while ((erc = dbresults(dbproc)) == SUCCEED)
+			dbcanquery(dbproc);
+		if (erc == FAIL)
+			ok = false;
+	}
+	free(query);
+	return ok;
+}
+
+/*
+ * Copy data using multiple connections.
+ * Input files are split in ranges of rows, output tables are
+ * split by page into separate files.
+ * Every output job scans the whole table and files are not a consistent
+ * snapshot of a table changed during the copy.
+ */
+static int
+copy_parallel(BCPPARAMDATA * pdata)
+{
+	BCPJOB *jobs;
+#ifdef TDS_HAVE_MUTEX
+	tds_thread *threads;
+	bool *started;
+#endif
+	DBINT rows = 0;
+	int i, ok = FALSE;
+
+	jobs = tds_new0(BCPJOB, pdata->jobs);
+#ifdef TDS_HAVE_MUTEX
+	threads = tds_new0(tds_thread, pdata->jobs);
+	started = tds_new0(bool, pdata->jobs);
+	if (!threads || !started) {
+		fprintf(stderr, "Out of memory!\n");
+		goto cleanup;
+	}
+#endif
+	if (!jobs) {
+		fprintf(stderr, "Out of memory!\n");
+		goto cleanup;
+	}
+
+	/* every job has its own connection */
+	for (i = 0; i < pdata->jobs; ++i) {
+		jobs[i].params = *pdata;
+		jobs[i].params.pass = NULL;
+	}
+	for (i = 0; i < pdata->jobs; ++i) {
+		BCPJOB *job = &jobs[i];
+
+		if (pdata->pass && (job->params.pass = strdup(pdata->pass)) == NULL) {
+			fprintf(stderr, "Out of memory!\n");
+			goto cleanup;
+		}
+		if (login_to_database(&job->params, &job->dbproc) == FALSE)
+			goto cleanup;
+		free(job->params.pass);
+		job->params.pass = NULL;
+
+		if (!setoptions(job->dbproc, &job->params))
+			goto cleanup;
+
+		if (pdata->errorfile && asprintf(&job->params.errorfile, "%s.%d", pdata->errorfile, i + 1) < 0) {
+			job->params.errorfile = NULL;
+			fprintf(stderr, "Out of memory!\n");
+			goto cleanup;
+		}
+		if (pdata->checkpoint && asprintf(&job->params.checkpoint, "%s.%d", pdata->checkpoint, i + 1) < 0) {
+			job->params.checkpoint = NULL;
+			fprintf(stderr, "Out of memory!\n");
+			goto cleanup;
+		}
+
+		if (pdata->direction == DB_OUT) {
+			/* %%physloc%% is Microsoft SQL Server only, other servers are refused */
+			if (dbtds(job->dbproc) < DBTDS_7_3 || (i == 0 && !physloc_supported(job->dbproc, pdata->dbobject))) {
+				fprintf(stderr, "-j with out requires Microsoft SQL Server 2008 or later.\n");
+				goto cleanup;
+			}
+			/* split using lower byte of page number */
+			job->params.direction = DB_QUERYOUT;
+			if (asprintf(&job->params.dbobject,
+				     "SELECT * FROM %s WHERE CAST(SUBSTRING(%%%%physloc%%%%, 1, 1) AS INT) %% %d = %d",
+				     pdata->dbobject, pdata->jobs, i) < 0) {
+				job->params.dbobject = NULL;
+				fprintf(stderr, "Out of memory!\n");
+				goto cleanup;
+			}
+			if (asprintf(&job->params.hostfilename, "%s.%d", pdata->hostfilename, i + 1) < 0) {
+				job->params.hostfilename = NULL;
+				fprintf(stderr, "Out of memory!\n");
+				goto cleanup;
+			}
+		}
+	}
+	if (pdata->pass)
+		memset(pdata->pass, 0, strlen(pdata->pass));
+
+	if (pdata->direction == DB_IN && !split_hostfile(pdata, jobs))
+		goto cleanup;
+
+	for (i = 0; i < pdata->jobs; ++i) {
+		BCPJOB *job = &jobs[i];
+
+		job->ok = TRUE;
+		/* empty range, nothing to load */
+		if (pdata->direction == DB_IN && job->params.startoffset == job->params.endoffset)
+			continue;
+#ifdef TDS_HAVE_MUTEX
+		if (tds_thread_create(&threads[i], job_proc, job) == 0) {
+			started[i] = true;
+			continue;
+		}
+#endif
+		job_proc(job);
+	}
+
+	ok = TRUE;
+	for (i = 0; i < pdata->jobs; ++i) {
+#ifdef TDS_HAVE_MUTEX
+		if (started[i])
+			tds_thread_join(threads[i], NULL);
+#endif
+		if (!jobs[i].ok)
+			ok = FALSE;
+		rows += jobs[i].params.rowscopied;
+	}
+	printf("%d rows copied by %d jobs.\n", rows, pdata->jobs);
+
+	/* remove checkpoints only when all ranges are loaded */
+	for (i = 0; ok && i < pdata->jobs; ++i) {
+		if (jobs[i].params.checkpoint)
+			remove(jobs[i].params.checkpoint);
+	}
+
+cleanup:
+	for (i = 0; jobs && i < pdata->jobs; ++i) {
+		BCPJOB *job = &jobs[i];
+
+		if (job->dbproc)
+			dbclose(job->dbproc);
+		free(job->params.pass);
+		/* strings not allocated for the job are shared with pdata */
+		if (job->params.errorfile != pdata->errorfile)
+			free(job->params.errorfile);
+		if (job->params.checkpoint != pdata->checkpoint)
+			free(job->params.checkpoint);
+		if (job->params.dbobject != pdata->dbobject)
+			free(job->params.dbobject);
+		if (job->params.hostfilename != pdata->hostfilename)
+			free(job->params.hostfilename);
+	}
+#ifdef TDS_HAVE_MUTEX
+	free(threads);
+	free(started);
+#endif
+	free(jobs);
+	return ok;
+}
+
 
 static int unescape(char arg[])
 {
@@ -213,7 +518,7 @@ process_parameters(int argc, char **argv, BCPPARAMDATA *pdata)
 	 * Get the rest of the arguments
 	 */
 	optind = 4; /* start processing options after table, direction, & filename */
-	while ((ch = getopt(argc, argv, "m:f:e:F:L:b:t:r:U:P:i:I:S:h:T:A:o:O:0:C:ncEdvVD:")) != -1) {
+	while ((ch = getopt(argc, argv, "m:f:e:F:L:b:t:r:U:P:i:I:S:h:T:A:o:O:0:C:j:R:ncEdvVD:")) != -1) {
 		switch (ch) {
 		case 'v':
 		case 'V':
@@ -313,6 +618,14 @@ process_parameters(int argc, char **argv, BCPPARAMDATA *pdata)
 		case 'C':
 			pdata->charset = strdup(optarg);
 			break;
+		case 'j':
+			pdata->jflag++;
+			pdata->jobs = atoi(optarg);
+			break;
+		case 'R':
+			free(pdata->checkpoint);
+			pdata->checkpoint = strdup(optarg);
+			break;
 		case '?':
 		default:
 			pusage();
@@ -355,6 +668,41 @@ process_parameters(int argc, char **argv, BCPPARAMDATA *pdata)
 		}
 	}
 
+	if (pdata->checkpoint && pdata->direction != DB_IN) {
+		fprintf(stderr, "-R can be used only with in.\n");
+		return (FALSE);
+	}
+
+	/* Parallel copy */
+	if (pdata->jflag) {
+		if (pdata->jobs < 1 || pdata->jobs > MAX_JOBS) {
+			fprintf(stderr, "-j must be between 1 and %d.\n", MAX_JOBS);
+			return (FALSE);
+		}
+		if (pdata->jobs > 1 && (pdata->Fflag || pdata->Lflag)) {
+			fprintf(stderr, "-F and -L cannot be used with -j.\n");
+			return (FALSE);
+		}
+		if (pdata->jobs > 1 && pdata->direction == DB_QUERYOUT) {
+			fprintf(stderr, "-j cannot be used with queryout.\n");
+			return (FALSE);
+		}
+		/* offsets and names of job files do not work with compression */
+		if (pdata->jobs > 1 && strlen(pdata->hostfilename) > 3
+		    && strcasecmp(pdata->hostfilename + strlen(pdata->hostfilename) - 3, ".gz") == 0) {
+			fprintf(stderr, "-j cannot be used with compressed data files.\n");
+			return (FALSE);
+		}
+		/* rows can be found only in character files */
+		if (pdata->jobs > 1 && pdata->direction == DB_IN
+		    && (!pdata->cflag || pdata->rowtermlen < 1
+			|| (pdata->rowtermlen == pdata->fieldtermlen
+			    && memcmp(pdata->rowterm, pdata->fieldterm, pdata->rowtermlen) == 0))) {
+			fprintf(stderr, "-j with in requires -c and a row terminator different from the field terminator.\n");
+			return (FALSE);
+		}
+	}
+
 	/*
 	 * Override stdin and/or stdout if requested.
 	 */
@@ -449,6 +797,22 @@ login_to_database(BCPPARAMDATA * pdata, DBPROCESS ** pdbproc)
 
 }
 
+/*
+ * Record committed batches to resume a failed load.
+ */
+static int
+set_checkpoint(BCPPARAMDATA * pdata, DBPROCESS * dbproc, DBINT dir)
+{
+	if (dir != DB_IN || !pdata->checkpoint)
+		return TRUE;
+
+	if (bcp_checkpoint(dbproc, pdata->checkpoint) == FAIL) {
+		fprintf(stderr, "Error in bcp_checkpoint.\n");
+		return FALSE;
+	}
+	return TRUE;
+}
+
 int
 file_character(BCPPARAMDATA * pdata, DBPROCESS * dbproc, DBINT dir)
 {
@@ -485,6 +849,15 @@ file_character(BCPPARAMDATA * pdata, DBPROCESS * dbproc, DBINT dir)
 	bcp_control(dbproc, BCPLAST, pdata->lastrow);
 	bcp_control(dbproc, BCPMAXERRS, pdata->maxerrors);
 
+	if (!set_checkpoint(pdata, dbproc, dir))
+		return FALSE;
+
+	if (dir == DB_IN && pdata->endoffset > 0
+	    && bcp_hostrange(dbproc, pdata->startoffset, pdata->endoffset) == FAIL) {
+		fprintf(stderr, "Error in bcp_hostrange.\n");
+		return FALSE;
+	}
+
 	if (dir == DB_QUERYOUT) {
 		if (dbfcmd(dbproc, "SET FMTONLY ON %s SET FMTONLY OFF", pdata->dbobject) == FAIL) {
 			fprintf(stderr, "dbfcmd failed\n");
@@ -542,6 +915,7 @@ file_character(BCPPARAMDATA * pdata, DBPROCESS * dbproc, DBINT dir)
 	}
 
 	printf("%d rows copied.\n", li_rowsread);
+	pdata->rowscopied = li_rowsread;
 
 	return TRUE;
 }
@@ -583,6 +957,9 @@ file_native(BCPPARAMDATA * pdata, DBPROCESS * dbproc, DBINT dir)
 	bcp_control(dbproc, BCPLAST, pdata->lastrow);
 	bcp_control(dbproc, BCPMAXERRS, pdata->maxerrors);
 
+	if (!set_checkpoint(pdata, dbproc, dir))
+		return FALSE;
+
 	if (dir == DB_QUERYOUT) {
 		if (dbfcmd(dbproc, "SET FMTONLY ON %s SET FMTONLY OFF", pdata->dbobject) == FAIL) {
 			fprintf(stderr, "dbfcmd failed\n");
@@ -625,6 +1002,8 @@ file_native(BCPPARAMDATA * pdata, DBPROCESS * dbproc, DBINT dir)
 		}
 	}
 
+	bcp_control(dbproc, BCPBATCH, pdata->batchsize);
+
 	printf("\nStarting copy...\n\n");
 
 
@@ -634,6 +1013,7 @@ file_native(BCPPARAMDATA * pdata, DBPROCESS * dbproc, DBINT dir)
 	}
 
 	printf("%d rows copied.\n", li_rowsread);
+	pdata->rowscopied = li_rowsread;
 
 	return TRUE;
 }
@@ -672,9 +1052,14 @@ file_formatted(BCPPARAMDATA * pdata, DBPROCESS * dbproc, DBINT dir)
 	bcp_control(dbproc, BCPLAST, pdata->lastrow);
 	bcp_control(dbproc, BCPMAXERRS, pdata->maxerrors);
 
+	if (!set_checkpoint(pdata, dbproc, dir))
+		return FALSE;
+
 	if (FAIL == bcp_readfmt(dbproc, pdata->formatfile))
 		return FALSE;
 
+	bcp_control(dbproc, BCPBATCH, pdata->batchsize);
+
 	printf("\nStarting copy...\n\n");
 
 
@@ -684,6 +1069,7 @@ file_formatted(BCPPARAMDATA * pdata, DBPROCESS * dbproc, DBINT dir)
 	}
 
 	printf("%d rows copied.\n", li_rowsread);
+	pdata->rowscopied = li_rowsread;
 
 	return TRUE;
 }
@@ -774,7 +1160,8 @@ pusage(void)
 	fprintf(stderr, "        [-U username] [-P password] [-I interfaces_file] [-S server] [-D database]\n");
 	fprintf(stderr, "        [-v] [-d] [-h \"hint [,...]\" [-O \"set connection_option on|off, ...]\"\n");
 	fprintf(stderr, "        [-A packet size] [-T text or image size] [-E]\n");
-	fprintf(stderr, "        [-i input_file] [-o output_file]\n");
+	fprintf(stderr, "        [-i input_file] [-o output_file] [-j jobs] [-R checkpoint_file]\n");
+	fprintf(stderr, "        -j with out scans the table once per job, Microsoft SQL Server 2008 or later only\n");
 	fprintf(stderr, "        \n");
 	fprintf(stderr, "example: freebcp testdb.dbo.inserttest in inserttest.txt -S mssql -U guest -P password -c\n");
 }
@@ -783,10 +1170,14 @@ int
 err_handler(DBPROCESS * dbproc, int severity, int dberr, int oserr TDS_UNUSED, char *dberrstr, char *oserrstr TDS_UNUSED)
 {
 	static int sent = 0;
+	static tds_mutex sent_mutex = TDS_MUTEX_INITIALIZER;
 
 	if (dberr == SYBEBBCI) { /* Batch successfully bulk copied to the server */
 		int batch = bcp_getbatchsize(dbproc);
+
+		tds_mutex_lock(&sent_mutex);
 		printf("%d rows sent to SQL Server.\n", sent += batch);
+		tds_mutex_unlock(&sent_mutex);
 		return INT_CANCEL;
 	}
 
@@ -50,7 +50,12 @@ typedef struct pd
 	char *hint;
 	char *options;
 	char *charset;
+	char *checkpoint;
 	int packetsize;
+	int jobs;
+	DBBIGINT startoffset;
+	DBBIGINT endoffset;
+	DBINT rowscopied;
 	int mflag;
 	int fflag;
 	int eflag;
@@ -68,6 +73,7 @@ typedef struct pd
 	int Tflag;
 	int Aflag;
 	int Eflag;
+	int jflag;
 	char *inputfile;
 	char *outputfile;
 }
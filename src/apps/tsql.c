@@ -789,6 +789,7 @@ main(int argc, char **argv)
 	if (context->locale && !context->locale->datetime_fmt) {
 		/* set default in case there's no locale file */
 		context->locale->datetime_fmt = strdup(STD_DATETIME_FMT);
+		tds_locale_compile_date_plans(context->locale);
 	}
 
 	context->msg_handler = tsql_handle_message;
@@ -42,6 +42,7 @@ static void _blk_null_error(TDSBCPINFO *bcpinfo, int index, int offset);
 static TDSRET _blk_get_col_data(TDSBCPINFO *bulk, TDSCOLUMN *bcpcol, int offset);
 static CS_RETCODE _blk_rowxfer_in(CS_BLKDESC * blkdesc, CS_INT rows_to_xfer, CS_INT * rows_xferred);
 static CS_RETCODE _blk_rowxfer_out(CS_BLKDESC * blkdesc, CS_INT rows_to_xfer, CS_INT * rows_xferred);
+static bool _blk_bind_arrays(CS_BLKDESC * blkdesc);
 
 #define CONN(bulk) ((CS_CONNECTION *) (bulk)->bcpinfo.parent)
 
@@ -610,16 +611,87 @@ _blk_rowxfer_in(CS_BLKDESC * blkdesc, CS_INT rows_to_xfer, CS_INT * rows_xferred
 		blkdesc->bcpinfo.xfer_init = true;
 	} 
 
+	if (_blk_bind_arrays(blkdesc)) {
+		int rows_sent = 0;
+		TDSRET rc;
+
+		/* send all rows at once, stopping at the first row which can't be sent */
+		rc = tds_bcp_send_rows(tds, &blkdesc->bcpinfo, 0, rows_to_xfer, _blk_null_error, &rows_sent);
+		*rows_xferred = rows_sent;
+		if (TDS_FAILED(rc))
+			return IS_TDSDEAD(tds) ? CS_FAIL : CS_ROW_FAIL;
+		return CS_SUCCEED;
+	}
+
 	for (each_row = 0; each_row < rows_to_xfer; each_row++ ) {
 
 		if (tds_bcp_send_record(tds, &blkdesc->bcpinfo, _blk_get_col_data, _blk_null_error, each_row) == TDS_SUCCESS) {
-			/* FIXME */
+			++*rows_xferred;
 		}
 	}
 
 	return CS_SUCCEED;
 }
 
+/**
+ * Bind column arrays of libTDS to ct-lib bindings, if possible.
+ * This allows to resolve conversions once for all rows.
+ * \return true if all columns were bound.
+ */
+static bool
+_blk_bind_arrays(CS_BLKDESC * blkdesc)
+{
+	TDSBCPINFO *bcpinfo = &blkdesc->bcpinfo;
+	TDSSOCKET *tds = CONN(blkdesc)->tds_socket;
+	int i;
+
+	for (i = 0; i < bcpinfo->bindinfo->num_cols; i++) {
+		TDSCOLUMN *bindcol = bcpinfo->bindinfo->columns[i];
+		TDS_SERVER_TYPE type = TDS_INVALID_TYPE;
+
+		if ((!bcpinfo->identity_insert_on && bindcol->column_identity) ||
+		    bindcol->column_timestamp || bindcol->column_computed)
+			continue;
+
+		/* only types with same representation in ct-lib and libTDS */
+		switch (bindcol->column_bindtype) {
+		case CS_CHAR_TYPE:
+		case CS_TEXT_TYPE:
+		case CS_BINARY_TYPE:
+		case CS_IMAGE_TYPE:
+		case CS_BIT_TYPE:
+		case CS_TINYINT_TYPE:
+		case CS_SMALLINT_TYPE:
+		case CS_INT_TYPE:
+		case CS_BIGINT_TYPE:
+		case CS_REAL_TYPE:
+		case CS_FLOAT_TYPE:
+		case CS_MONEY_TYPE:
+		case CS_MONEY4_TYPE:
+		case CS_DATETIME_TYPE:
+		case CS_DATETIME4_TYPE:
+		case CS_NUMERIC_TYPE:
+		case CS_DECIMAL_TYPE:
+		case CS_UNIQUE_TYPE:
+			type = _ct_get_server_type(tds, bindcol->column_bindtype);
+			break;
+		}
+
+		if (type == TDS_INVALID_TYPE || !bindcol->column_varaddr || !bindcol->column_lenbind
+		    || bindcol->column_bindfmt != CS_FMT_UNUSED
+		    || _cs_convert_not_client(NULL, bindcol, NULL, NULL) != CS_ILLEGAL_TYPE
+		    || TDS_FAILED(tds_bcp_bind_array(tds, bcpinfo, i, type, bindcol->column_varaddr,
+						     bindcol->column_bindlen, bindcol->column_lenbind,
+						     bindcol->column_nullbind))) {
+			/* rows will be sent one by one, remove arrays already bound */
+			for (i = 0; i < bcpinfo->bindinfo->num_cols; i++)
+				tds_bcp_bind_array(tds, bcpinfo, i, TDS_INVALID_TYPE, NULL, 0, NULL, NULL);
+			return false;
+		}
+	}
+	return true;
+}
+
 static void
 _blk_null_error(TDSBCPINFO *bcpinfo, int index, int offset)
 {
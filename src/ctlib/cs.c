@@ -351,6 +351,7 @@ cs_ctx_alloc(CS_INT version, CS_CONTEXT ** out_ctx)
 	if (tds_ctx->locale && !tds_ctx->locale->datetime_fmt) {
 		/* set default in case there's no locale file */
 		tds_ctx->locale->datetime_fmt = strdup(STD_DATETIME_FMT);
+		tds_locale_compile_date_plans(tds_ctx->locale);
 	}
 
 	ctx->login_timeout = -1;
@@ -49,6 +49,7 @@ static const char * ct_describe_cmd_state(CS_INT state);
  */
 static int _ct_fetch_cursor(CS_COMMAND * cmd, CS_INT type, CS_INT offset, CS_INT option, CS_INT * rows_read);
 static int _ct_fetchable_results(CS_COMMAND * cmd);
+static int _ct_bind_row(CS_COMMAND *cmd, TDSRESULTINFO *resinfo, TDS_INT res_type, CS_INT offset);
 static TDSRET _ct_process_return_status(TDSSOCKET * tds);
 
 static int _ct_fill_param(CS_INT cmd_type, CS_PARAM * param, const CS_DATAFMT_LARGE * datafmt, CS_VOID * data,
@@ -832,6 +833,7 @@ ct_connect(CS_CONNECTION * con, CS_CHAR * servername, CS_INT snamelen)
 			locale->datetime_fmt = strdup(con->locale->time);
 			if (!locale->datetime_fmt)
 				goto Cleanup;
+			tds_locale_compile_date_plans(locale);
 		}
 		/* TODO how to handle this?
 		if (con->locale->collate) {
@@ -1321,6 +1323,7 @@ ct_results(CS_COMMAND * cmd, CS_INT * result_type)
 		return CS_FAIL;
 
 	cmd->bind_count = CS_UNUSED;
+	cmd->bind_plans_res = NULL;
 
 	context = cmd->con->ctx;
 
@@ -1706,6 +1709,8 @@ ct_bind(CS_COMMAND * cmd, CS_INT item, CS_DATAFMT * datafmt_arg, CS_VOID * buffe
 
 	/* bind the column_varaddr to the address of the buffer */
 
+	cmd->bind_plans_res = NULL;
+
 	colinfo = resinfo->columns[item - 1];
 	colinfo->column_varaddr = (char *) buffer;
 	colinfo->column_bindtype = datafmt->datatype;
@@ -1802,7 +1807,7 @@ ct_fetch(CS_COMMAND * cmd, CS_INT type, CS_INT offset, CS_INT option, CS_INT * p
 				if (ret_type == TDS_ROW_RESULT || ret_type == TDS_COMPUTE_RESULT) {
 					cmd->get_data_item = 0;
 					cmd->get_data_bytes_returned = 0;
-					if (_ct_bind_data(cmd->con->ctx, tds->current_results, tds->current_results, temp_count))
+					if (_ct_bind_row(cmd, tds->current_results, ret_type, temp_count))
 						return CS_ROW_FAIL;
 					(*prows_read)++;
 					break;
@@ -1925,26 +1930,95 @@ _ct_fetch_cursor(CS_COMMAND * cmd, CS_INT type, CS_INT offset, CS_INT option, CS
 }
 
 
-int
-_ct_bind_data(CS_CONTEXT *ctx, TDSRESULTINFO * resinfo, TDSRESULTINFO *bindinfo, CS_INT offset)
+/**
+ * Copy a column of current row to the bound variables of bindcol.
+ * @return 0 on success, 1 if value could not be converted
+ */
+static int
+_ct_bind_column(CS_CONTEXT *ctx, TDSCOLUMN *curcol, TDSCOLUMN *bindcol, CS_INT offset)
 {
-	TDSCOLUMN *curcol, *bindcol;
 	unsigned char *src, *dest;
-	int i, result = 0;
 	CS_DATAFMT_COMMON srcfmt, destfmt;
 	TDS_INT datalen_dummy, *pdatalen;
 	TDS_SMALLINT nullind_dummy, *nullind;
+	CS_RETCODE ret;
+	CONV_RESULT convert_buffer;
+	CS_INT srctype;
+
+	/*
+	 * Retrieve the initial bound column_varaddress and increment it if offset specified
+	 */
+
+	dest = (unsigned char *) bindcol->column_varaddr;
+	if (dest)
+		dest += offset * bindcol->column_bindlen;
+
+	nullind = &nullind_dummy;
+	if (bindcol->column_nullbind) {
+		nullind = bindcol->column_nullbind;
+		assert(nullind);
+		nullind += offset;
+	}
+	pdatalen = &datalen_dummy;
+	if (bindcol->column_lenbind) {
+		pdatalen = bindcol->column_lenbind;
+		assert(pdatalen);
+		pdatalen += offset;
+	}
+
+	/* no destination specified */
+	if (!dest) {
+		*pdatalen = 0;
+		return 0;
+	}
+
+	/* NULL column */
+	if (curcol->column_cur_size < 0) {
+		*nullind = -1;
+		*pdatalen = 0;
+		return 0;
+	}
+
+	src = curcol->column_data;
+	if (is_blob_col(curcol))
+		src = (unsigned char *) ((TDSBLOB *) src)->textvalue;
+
+	srctype = _cs_convert_not_client(ctx, curcol, &convert_buffer, &src);
+	if (srctype == CS_ILLEGAL_TYPE)
+		srctype = _ct_get_client_type(curcol, false);
+	if (srctype == CS_ILLEGAL_TYPE)
+		return 1;
+
+	srcfmt.datatype  = srctype;
+	srcfmt.maxlength = curcol->column_cur_size;
+
+	destfmt.datatype = bindcol->column_bindtype;
+	destfmt.maxlength = bindcol->column_bindlen;
+	destfmt.format = bindcol->column_bindfmt;
+
+	/* if convert return FAIL mark error but process other columns */
+	ret = _cs_convert(ctx, &srcfmt, src, &destfmt, dest, pdatalen, TDS_INVALID_TYPE);
+	*nullind = 0;
+	if (ret != CS_SUCCEED) {
+		tdsdump_log(TDS_DBG_FUNC, "cs_convert-result = %d\n", ret);
+		tdsdump_log(TDS_DBG_INFO1, "error: converted only %d bytes for type %d \n",
+						*pdatalen, srctype);
+		return 1;
+	}
+	return 0;
+}
+
+int
+_ct_bind_data(CS_CONTEXT *ctx, TDSRESULTINFO * resinfo, TDSRESULTINFO *bindinfo, CS_INT offset)
+{
+	TDSCOLUMN *curcol;
+	int i, result = 0;
 
 	tdsdump_log(TDS_DBG_FUNC, "_ct_bind_data(%p, %p, %p, %d)\n", ctx, resinfo, bindinfo, offset);
 
 	for (i = 0; i < resinfo->num_cols; i++) {
 
-		CS_RETCODE ret;
-		CONV_RESULT convert_buffer;
-		CS_INT srctype;
-
 		curcol = resinfo->columns[i];
-		bindcol = bindinfo->columns[i];
 
 		tdsdump_log(TDS_DBG_FUNC, "_ct_bind_data(): column %d is type %d and has length %d\n",
 						i, curcol->column_type, curcol->column_cur_size);
@@ -1952,73 +2026,166 @@ _ct_bind_data(CS_CONTEXT *ctx, TDSRESULTINFO * resinfo, TDSRESULTINFO *bindinfo,
 		if (curcol->column_hidden)
 			continue;
 
-		/*
-		 * Retrieve the initial bound column_varaddress and increment it if offset specified
-		 */
+		result |= _ct_bind_column(ctx, curcol, bindinfo->columns[i], offset);
+	}
+	return result;
+}
+
+/**
+ * Size of fixed types copied as is by _cs_convert, 0 for other types.
+ */
+static TDS_INT
+_ct_fixed_size(TDS_SERVER_TYPE type)
+{
+	switch (type) {
+	case SYBINT1:
+	case SYBINT2:
+	case SYBINT4:
+	case SYBINT8:
+	case SYBFLT8:
+	case SYBREAL:
+	case SYBBIT:
+	case SYBMONEY:
+	case SYBMONEY4:
+	case SYBDATETIME:
+	case SYBDATETIME4:
+	case SYBTIME:
+	case SYBDATE:
+	case SYB5BIGDATETIME:
+	case SYB5BIGTIME:
+		return tds_get_size_by_type(type);
+	default:
+		break;
+	}
+	return 0;
+}
 
-		dest = (unsigned char *) bindcol->column_varaddr;
-		if (dest)
-			dest += offset * bindcol->column_bindlen;
+/**
+ * Resolve how the bound columns of resinfo are copied, so array fetches
+ * don't look at formats and types again for every row.
+ * Plans are built again after ct_bind() or ct_results().
+ */
+static bool
+_ct_build_bind_plans(CS_COMMAND *cmd, TDSRESULTINFO *resinfo)
+{
+	CS_CONTEXT *ctx = cmd->con->ctx;
+	CT_BIND_PLAN *plan;
+	int i;
 
-		nullind = &nullind_dummy;
-		if (bindcol->column_nullbind) {
-			nullind = bindcol->column_nullbind;
-			assert(nullind);
-			nullind += offset;
-		}
-		pdatalen = &datalen_dummy;
-		if (bindcol->column_lenbind) {
-			pdatalen = bindcol->column_lenbind;
-			assert(pdatalen);
-			pdatalen += offset;
-		}
+	TDS_ZERO_FREE(cmd->bind_plans);
+	cmd->num_bind_plans = 0;
+	cmd->bind_plans_res = NULL;
+
+	cmd->bind_plans = tds_new(CT_BIND_PLAN, TDS_MAX(resinfo->num_cols, 1));
+	if (!cmd->bind_plans)
+		return false;
 
-		/* no destination specified */
-		if (!dest) {
-			*pdatalen = 0;
+	for (i = 0; i < resinfo->num_cols; i++) {
+		TDSCOLUMN *curcol = resinfo->columns[i];
+		TDS_SERVER_TYPE srctype, desttype;
+		CS_INT client_type;
+
+		if (curcol->column_hidden)
 			continue;
-		}
 
-		/* NULL column */
-		if (curcol->column_cur_size < 0) {
-			*nullind = -1;
-			*pdatalen = 0;
+		plan = &cmd->bind_plans[cmd->num_bind_plans++];
+		plan->col = curcol;
+		plan->kind = _CT_BIND_GENERIC;
+		plan->size = 0;
+		if (!curcol->column_varaddr || curcol->column_type == SYBVARIANT)
 			continue;
-		}
 
-		src = curcol->column_data;
-		if (is_blob_col(curcol))
-			src = (unsigned char *) ((TDSBLOB *) src)->textvalue;
+		/* types converted before being returned to the client */
+		if (_cs_convert_not_client(ctx, curcol, NULL, NULL) != CS_ILLEGAL_TYPE)
+			continue;
+		client_type = _ct_get_client_type(curcol, false);
+		if (client_type == CS_ILLEGAL_TYPE)
+			continue;
+		srctype = _ct_get_server_type(NULL, client_type);
+		desttype = _ct_get_server_type(NULL, curcol->column_bindtype);
+		if (srctype == TDS_INVALID_TYPE || desttype == TDS_INVALID_TYPE)
+			continue;
 
-		srctype = _cs_convert_not_client(ctx, curcol, &convert_buffer, &src);
-		if (srctype == CS_ILLEGAL_TYPE)
-			srctype = _ct_get_client_type(curcol, false);
-		if (srctype == CS_ILLEGAL_TYPE) {
-			result = 1;
+		plan->size = _ct_fixed_size(desttype);
+		if (!plan->size || !_ct_fixed_size(srctype) || curcol->column_bindlen < plan->size)
 			continue;
+
+		if (srctype == desttype) {
+			plan->kind = _CT_BIND_COPY;
+		} else if (tds_willconvert(srctype, desttype)) {
+			plan->kind = _CT_BIND_CONVERT;
+			tds_convert_resolve(&plan->conv, srctype, desttype);
 		}
+	}
+	cmd->bind_plans_res = resinfo;
+	return true;
+}
 
-		srcfmt.datatype  = srctype;
-		srcfmt.maxlength = curcol->column_cur_size;
+/**
+ * Copy current row to element offset of bound arrays using plans.
+ * Values not handled by a plan, or failing to convert, go through
+ * _ct_bind_column() which reports errors.
+ * @return 0 on success, 1 if some value could not be converted
+ */
+static int
+_ct_bind_planned(CS_COMMAND *cmd, CS_INT offset)
+{
+	CS_CONTEXT *ctx = cmd->con->ctx;
+	const CT_BIND_PLAN *plan, *end = cmd->bind_plans + cmd->num_bind_plans;
+	int result = 0;
 
-		destfmt.datatype = bindcol->column_bindtype;
-		destfmt.maxlength = bindcol->column_bindlen;
-		destfmt.format = bindcol->column_bindfmt;
+	for (plan = cmd->bind_plans; plan != end; ++plan) {
+		TDSCOLUMN *curcol = plan->col;
+		unsigned char *dest;
 
-		/* if convert return FAIL mark error but process other columns */
-		ret = _cs_convert(ctx, &srcfmt, src, &destfmt, dest, pdatalen, TDS_INVALID_TYPE);
-		if (ret != CS_SUCCEED) {
-			tdsdump_log(TDS_DBG_FUNC, "cs_convert-result = %d\n", ret);
-			result = 1;
-			tdsdump_log(TDS_DBG_INFO1, "error: converted only %d bytes for type %d \n",
-							*pdatalen, srctype);
+		if (plan->kind == _CT_BIND_GENERIC) {
+			result |= _ct_bind_column(ctx, curcol, curcol, offset);
+			continue;
 		}
 
-		*nullind = 0;
+		if (curcol->column_cur_size < 0) {
+			if (curcol->column_nullbind)
+				curcol->column_nullbind[offset] = -1;
+			if (curcol->column_lenbind)
+				curcol->column_lenbind[offset] = 0;
+			continue;
+		}
+
+		dest = (unsigned char *) curcol->column_varaddr + offset * curcol->column_bindlen;
+		if (plan->kind == _CT_BIND_COPY) {
+			memcpy(dest, curcol->column_data, plan->size);
+		} else {
+			CONV_RESULT cr;
+			TDS_INT len = plan->conv.convert(ctx->tds_ctx, &plan->conv, curcol->column_data,
+							 curcol->column_cur_size, &cr);
+
+			if (len < 0) {
+				result |= _ct_bind_column(ctx, curcol, curcol, offset);
+				continue;
+			}
+			memcpy(dest, &cr, plan->size);
+		}
+		if (curcol->column_nullbind)
+			curcol->column_nullbind[offset] = 0;
+		if (curcol->column_lenbind)
+			curcol->column_lenbind[offset] = plan->size;
 	}
 	return result;
 }
 
+/**
+ * Copy current row to bound variables.
+ * Regular rows fetched into arrays use the plans of the current result.
+ */
+static int
+_ct_bind_row(CS_COMMAND *cmd, TDSRESULTINFO *resinfo, TDS_INT res_type, CS_INT offset)
+{
+	if (cmd->bind_count > 1 && res_type == TDS_ROW_RESULT
+	    && (cmd->bind_plans_res == resinfo || _ct_build_bind_plans(cmd, resinfo)))
+		return _ct_bind_planned(cmd, offset);
+	return _ct_bind_data(cmd->con->ctx, resinfo, resinfo, offset);
+}
+
 CS_RETCODE
 ct_cmd_drop(CS_COMMAND * cmd)
 {
@@ -2038,6 +2205,7 @@ ct_cmd_drop(CS_COMMAND * cmd)
 			free(cmd->rpc);
 		}
 		free(cmd->iodesc);
+		free(cmd->bind_plans);
 
 		/* now remove this command from the list of commands in the connection */
 		con = cmd->con;
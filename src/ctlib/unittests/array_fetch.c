@@ -0,0 +1,401 @@
+/* FreeTDS - Library of routines accessing Sybase and Microsoft databases
+ * Copyright (C) 2026  Frediano Ziglio
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Purpose: test ct_fetch into arrays bound with a count greater than one.
+ * A fake server sends rows with NULLs; values are copied, converted
+ * or formatted, conversion errors must fail only the row involved
+ * and bindings can change in the middle of results.
+ * Arrays are filled with garbage before every fetch so values or
+ * indicators not written are detected.
+ * To test performance, call this program with a number of rows.
+ */
+#include "common.h"
+#include "../../tds/unittests/fakeserver.h"
+
+/* server functions use libTDS definitions */
+#include <freetds/tds.h>
+
+#if HAVE_UNISTD_H
+#include <unistd.h>
+#endif /* HAVE_UNISTD_H */
+
+#include <freetds/server.h>
+#include <freetds/thread.h>
+#include <freetds/replacements.h>
+#include <freetds/time.h>
+
+#ifdef TDS_HAVE_MUTEX
+
+#define NUM_ROWS 1000
+#define ARRAY_ROWS 64
+
+/* rows sent by the fake server for next query */
+static int num_rows = NUM_ROWS;
+
+/* values of a row, NULL values are not sent */
+static bool
+row_null(int row, int col)
+{
+	return (col == 1 && row % 7 == 3) || (col == 3 && row % 5 == 0) || (col == 4 && row % 9 == 4);
+}
+
+static TDS_SMALLINT
+row_small(int row)
+{
+	return (TDS_SMALLINT) (row % 300);
+}
+
+/* money value of amount column, row * 1.25 */
+static TDS_INT8
+row_amount(int row)
+{
+	return row * (TDS_INT8) 12500;
+}
+
+static void
+send_rows(TDSSOCKET *tds)
+{
+	TDSRESULTINFO *resinfo;
+	TDSCOLUMN *col;
+	int i, row;
+
+	static const char *const names[] = { "id", "val", "small", "name", "amount" };
+	static const TDS_SERVER_TYPE types[] = { SYBINTN, SYBFLTN, SYBINTN, XSYBVARCHAR, SYBMONEYN };
+	static const int sizes[] = { 4, 8, 2, 20, 8 };
+
+	resinfo = tds_alloc_results(5);
+	assert(resinfo);
+	for (i = 0; i < 5; ++i) {
+		col = resinfo->columns[i];
+		tds_set_column_type(tds->conn, col, types[i]);
+		col->column_size = col->on_server.column_size = sizes[i];
+		col->column_flags = 1;	/* nullable */
+		memcpy(col->column_collation, tds->conn->collation, 5);
+		assert(tds_dstr_copy(&col->column_name, names[i]));
+	}
+	assert(TDS_SUCCEED(tds_alloc_row(resinfo)));
+	tds_send_table_header(tds, resinfo);
+
+	for (row = 1; row <= num_rows; ++row) {
+		*(TDS_INT *) resinfo->columns[0]->column_data = row;
+		resinfo->columns[0]->column_cur_size = 4;
+
+		col = resinfo->columns[1];
+		*(TDS_FLOAT *) col->column_data = row * 0.5;
+		col->column_cur_size = row_null(row, 1) ? -1 : 8;
+
+		col = resinfo->columns[2];
+		*(TDS_SMALLINT *) col->column_data = row_small(row);
+		col->column_cur_size = 2;
+
+		col = resinfo->columns[3];
+		col->column_cur_size = sprintf((char *) col->column_data, "row %d", row);
+		if (row_null(row, 3))
+			col->column_cur_size = -1;
+
+		col = resinfo->columns[4];
+		((TDS_MONEY *) col->column_data)->tdsoldmoney.mnyhigh = (TDS_INT) (row_amount(row) >> 32);
+		((TDS_MONEY *) col->column_data)->tdsoldmoney.mnylow = (TDS_UINT) row_amount(row);
+		col->column_cur_size = row_null(row, 4) ? -1 : 8;
+
+		tds_send_row(tds, resinfo);
+	}
+	tds_free_results(resinfo);
+	tds_send_done_token(tds, TDS_DONE_FINAL | TDS_DONE_COUNT, num_rows);
+}
+
+static CS_INT ids[ARRAY_ROWS], copied[5][ARRAY_ROWS];
+static CS_FLOAT vals[ARRAY_ROWS];
+static CS_INT small_ints[ARRAY_ROWS];
+static CS_TINYINT tinys[ARRAY_ROWS];
+static CS_CHAR names[ARRAY_ROWS][32];
+static CS_SMALLINT inds[5][ARRAY_ROWS];
+/* amount is bound as money, then as float in the same buffer */
+static union
+{
+	CS_MONEY money;
+	CS_FLOAT flt;
+} amounts[ARRAY_ROWS];
+
+#define GARBAGE 0x55
+
+/* fill arrays so values not written by a fetch are detected */
+static void
+scramble(void)
+{
+	memset(ids, GARBAGE, sizeof(ids));
+	memset(copied, GARBAGE, sizeof(copied));
+	memset(vals, GARBAGE, sizeof(vals));
+	memset(small_ints, GARBAGE, sizeof(small_ints));
+	memset(tinys, GARBAGE, sizeof(tinys));
+	memset(names, GARBAGE, sizeof(names));
+	memset(inds, GARBAGE, sizeof(inds));
+	memset(amounts, GARBAGE, sizeof(amounts));
+}
+
+static void
+query(CS_COMMAND *cmd)
+{
+	CS_INT result_type;
+
+	check_call(ct_command, (cmd, CS_LANG_CMD, "select * from arrays", CS_NULLTERM, CS_UNUSED));
+	check_call(ct_send, (cmd));
+	check_call(ct_results, (cmd, &result_type));
+	assert(result_type == CS_ROW_RESULT);
+}
+
+static void
+end_query(CS_COMMAND *cmd)
+{
+	CS_INT result_type;
+	CS_RETCODE ret;
+
+	while ((ret = ct_results(cmd, &result_type)) == CS_SUCCEED)
+		continue;
+	assert(ret == CS_END_RESULTS);
+}
+
+static void
+bind_column(CS_COMMAND *cmd, CS_INT item, CS_INT datatype, CS_INT maxlength, CS_INT count, void *buffer)
+{
+	CS_DATAFMT datafmt;
+
+	memset(&datafmt, 0, sizeof(datafmt));
+	datafmt.datatype = datatype;
+	datafmt.maxlength = maxlength;
+	datafmt.format = datatype == CS_CHAR_TYPE ? CS_FMT_NULLTERM : CS_FMT_UNUSED;
+	datafmt.count = count;
+	check_call(ct_bind, (cmd, item, &datafmt, buffer, copied[item - 1], inds[item - 1]));
+}
+
+/* check element n of arrays contains row */
+static void
+check_row(int n, int row, bool float_ids, bool tiny)
+{
+	char buf[32];
+
+	if (float_ids)
+		assert(vals[n] == row);
+	else
+		assert(ids[n] == row && copied[0][n] == sizeof(CS_INT) && inds[0][n] == 0);
+
+	if (float_ids) {
+		/* val is bound as an integer */
+		if (row_null(row, 1)) {
+			assert(inds[1][n] == -1 && copied[1][n] == 0);
+		} else {
+			assert(inds[1][n] == 0 && copied[1][n] == sizeof(CS_INT));
+			assert(small_ints[n] == (CS_INT) (row * 0.5));
+		}
+	} else if (row_null(row, 1)) {
+		assert(inds[1][n] == -1 && copied[1][n] == 0);
+	} else {
+		assert(inds[1][n] == 0 && copied[1][n] == sizeof(CS_FLOAT) && vals[n] == row * 0.5);
+	}
+
+	/* small is not bound after ids are bound as float */
+	if (tiny)
+		assert(tinys[n] == row_small(row) && copied[2][n] == sizeof(CS_TINYINT) && inds[2][n] == 0);
+	else if (!float_ids)
+		assert(small_ints[n] == row_small(row) && copied[2][n] == sizeof(CS_INT) && inds[2][n] == 0);
+	else
+		assert(copied[2][n] == 0);
+
+	if (row_null(row, 3)) {
+		assert(inds[3][n] == -1 && copied[3][n] == 0);
+	} else {
+		sprintf(buf, "row %d", row);
+		assert(inds[3][n] == 0 && strcmp(names[n], buf) == 0 && copied[3][n] == (CS_INT) strlen(buf) + 1);
+	}
+
+	/* amount is copied as money, converted after ids are bound as float */
+	if (row_null(row, 4)) {
+		assert(inds[4][n] == -1 && copied[4][n] == 0);
+	} else if (float_ids) {
+		assert(inds[4][n] == 0 && copied[4][n] == sizeof(CS_FLOAT) && amounts[n].flt == row * 1.25);
+	} else {
+		assert(inds[4][n] == 0 && copied[4][n] == sizeof(CS_MONEY));
+		assert(amounts[n].money.mnyhigh == (CS_INT) (row_amount(row) >> 32)
+		       && amounts[n].money.mnylow == (CS_UINT) row_amount(row));
+	}
+}
+
+static void
+bind_all(CS_COMMAND *cmd, CS_INT count)
+{
+	bind_column(cmd, 1, CS_INT_TYPE, sizeof(CS_INT), count, ids);
+	bind_column(cmd, 2, CS_FLOAT_TYPE, sizeof(CS_FLOAT), count, vals);
+	bind_column(cmd, 3, CS_INT_TYPE, sizeof(CS_INT), count, small_ints);
+	bind_column(cmd, 4, CS_CHAR_TYPE, sizeof(names[0]), count, names);
+	bind_column(cmd, 5, CS_MONEY_TYPE, sizeof(amounts[0]), count, amounts);
+}
+
+/* read all rows, changing bindings after some fetches */
+static void
+test_fetch(CS_COMMAND *cmd, CS_INT count)
+{
+	CS_INT rows_read, n;
+	CS_RETCODE ret;
+	int row = 0, fetches = 0;
+	bool float_ids = false;
+
+	printf("Testing fetch of %d rows\n", (int) count);
+	query(cmd);
+	bind_all(cmd, count);
+
+	scramble();
+	while ((ret = ct_fetch(cmd, CS_UNUSED, CS_UNUSED, CS_UNUSED, &rows_read)) == CS_SUCCEED) {
+		assert(rows_read > 0 && rows_read <= count);
+		for (n = 0; n < rows_read; ++n)
+			check_row(n, ++row, float_ids, false);
+		assert(rows_read == count || row == num_rows);
+
+		/* id as float, val as integer, amount as float in same buffer */
+		if (++fetches == 3) {
+			float_ids = true;
+			bind_column(cmd, 1, CS_FLOAT_TYPE, sizeof(CS_FLOAT), count, vals);
+			bind_column(cmd, 2, CS_INT_TYPE, sizeof(CS_INT), count, small_ints);
+			bind_column(cmd, 3, CS_INT_TYPE, sizeof(CS_INT), count, NULL);
+			bind_column(cmd, 5, CS_FLOAT_TYPE, sizeof(amounts[0]), count, amounts);
+		}
+		scramble();
+	}
+	assert(ret == CS_END_DATA);
+	assert(row == num_rows);
+	end_query(cmd);
+}
+
+/* values not fitting a tinyint fail their rows only */
+static void
+test_errors(CS_COMMAND *cmd, CS_INT count)
+{
+	CS_INT rows_read, n;
+	CS_RETCODE ret;
+	int row = 0, failed = 0, messages;
+
+	printf("Testing conversion errors in fetch of %d rows\n", (int) count);
+	query(cmd);
+	bind_all(cmd, count);
+	bind_column(cmd, 3, CS_TINYINT_TYPE, sizeof(CS_TINYINT), count, tinys);
+
+	messages = clientmsg_cb_invoked + cslibmsg_cb_invoked;
+	scramble();
+	while ((ret = ct_fetch(cmd, CS_UNUSED, CS_UNUSED, CS_UNUSED, &rows_read)) == CS_SUCCEED
+	       || ret == CS_ROW_FAIL) {
+		for (n = 0; n < rows_read; ++n)
+			check_row(n, ++row, false, true);
+		if (ret == CS_ROW_FAIL) {
+			/* failed row is consumed */
+			assert(row_small(++row) > 255);
+			++failed;
+		}
+		scramble();
+	}
+	assert(ret == CS_END_DATA);
+	assert(row == num_rows);
+	/* rows 256-299 of every 300 */
+	assert(failed == 44 * (num_rows / 300) + (num_rows % 300 > 256 ? num_rows % 300 - 256 : 0));
+	assert(clientmsg_cb_invoked + cslibmsg_cb_invoked - messages == failed);
+	end_query(cmd);
+}
+
+static void
+benchmark(CS_COMMAND *cmd, int rows)
+{
+	static const CS_INT counts[] = { 1, ARRAY_ROWS };
+	struct timeval start;
+	CS_INT rows_read;
+	int read, i;
+
+	num_rows = rows;
+	for (i = 0; i < 2; ++i) {
+		gettimeofday(&start, NULL);
+		query(cmd);
+		bind_column(cmd, 1, CS_INT_TYPE, sizeof(CS_INT), counts[i], ids);
+		bind_column(cmd, 2, CS_FLOAT_TYPE, sizeof(CS_FLOAT), counts[i], vals);
+		bind_column(cmd, 3, CS_INT_TYPE, sizeof(CS_INT), counts[i], small_ints);
+		read = 0;
+		while (ct_fetch(cmd, CS_UNUSED, CS_UNUSED, CS_UNUSED, &rows_read) == CS_SUCCEED)
+			read += rows_read;
+		end_query(cmd);
+		print_rate(&start, read, "rows/second fetching %d rows", (int) counts[i]);
+	}
+	num_rows = NUM_ROWS;
+}
+
+static const FAKE_SERVER fake_server = { "arrays", send_rows, NULL };
+
+TEST_MAIN()
+{
+	CS_CONTEXT *ctx;
+	CS_CONNECTION *conn;
+	CS_COMMAND *cmd;
+	CS_INT version = CS_TDS_74;
+	tds_thread th;
+	char server[64];
+	int port;
+
+	setbuf(stdout, NULL);
+	setbuf(stderr, NULL);
+	error_to_stdout = true;
+
+	unsetenv("TDSHOST");
+	unsetenv("TDSPORT");
+	unsetenv("TDSVER");
+
+	port = fake_server_start(&th, &fake_server);
+	sprintf(server, "127.0.0.1:%d", port);
+
+	check_call(cs_ctx_alloc, (CS_VERSION_100, &ctx));
+	check_call(ct_init, (ctx, CS_VERSION_100));
+	check_call(cs_config, (ctx, CS_SET, CS_MESSAGE_CB, (CS_VOID *) cslibmsg_cb, CS_UNUSED, NULL));
+	check_call(ct_callback, (ctx, NULL, CS_SET, CS_CLIENTMSG_CB, (CS_VOID *) clientmsg_cb));
+	check_call(ct_con_alloc, (ctx, &conn));
+	check_call(ct_con_props, (conn, CS_SET, CS_USERNAME, "guest", CS_NULLTERM, NULL));
+	check_call(ct_con_props, (conn, CS_SET, CS_PASSWORD, "sybase", CS_NULLTERM, NULL));
+	check_call(ct_con_props, (conn, CS_SET, CS_APPNAME, "array_fetch", CS_NULLTERM, NULL));
+	check_call(ct_con_props, (conn, CS_SET, CS_TDS_VERSION, &version, CS_UNUSED, NULL));
+	check_call(ct_connect, (conn, server, CS_NULLTERM));
+	check_call(ct_cmd_alloc, (conn, &cmd));
+
+	test_fetch(cmd, 1);
+	test_fetch(cmd, 7);
+	test_fetch(cmd, ARRAY_ROWS);
+
+	test_errors(cmd, 1);
+	test_errors(cmd, ARRAY_ROWS);
+
+	if (argc > 1)
+		benchmark(cmd, atoi(argv[1]));
+
+	ct_cmd_drop(cmd);
+	ct_close(conn, CS_UNUSED);
+	ct_con_drop(conn);
+	ct_exit(ctx, CS_UNUSED);
+	cs_ctx_drop(ctx);
+	tds_thread_join(th, NULL);
+	return 0;
+}
+#else
+TEST_MAIN()
+{
+	return 0;
+}
+#endif
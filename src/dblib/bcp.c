@@ -40,6 +40,10 @@
 #include <io.h>
 #endif
 
+#if HAVE_ZLIB
+#include <zlib.h>
+#endif /* HAVE_ZLIB */
+
 #include <freetds/tds.h>
 #include <freetds/iconv.h>
 #include <freetds/convert.h>
@@ -47,6 +51,7 @@
 #include <freetds/utils/string.h>
 #include <freetds/encodings.h>
 #include <freetds/replacements.h>
+#include <freetds/thread.h>
 #include <sybfront.h>
 #include <sybdb.h>
 #include <syberror.h>
@@ -55,25 +60,6 @@
 #define HOST_COL_CONV_ERROR 1
 #define HOST_COL_NULL_ERROR 2
 
-#ifdef HAVE_FSEEKO
-typedef off_t offset_type;
-#elif defined(_WIN32) || defined(_WIN64)
-/* win32 version */
-typedef __int64 offset_type;
-# if defined(HAVE__FSEEKI64) && defined(HAVE__FTELLI64)
-#  define fseeko(f,o,w) _fseeki64((f),o,w)
-#  define ftello(f) _ftelli64((f))
-# else
-#  define fseeko(f,o,w) (_lseeki64(fileno(f),o,w) == -1 ? -1 : 0)
-#  define ftello(f) _telli64(fileno(f))
-# endif
-#else
-/* use old version */
-#define fseeko(f,o,w) fseek(f,o,w)
-#define ftello(f) ftell(f)
-typedef long offset_type;
-#endif
-
 static void _bcp_free_storage(DBPROCESS * dbproc);
 static void _bcp_free_columns(DBPROCESS * dbproc);
 static void _bcp_null_error(TDSBCPINFO *bcpinfo, int index, int offset);
@@ -82,7 +68,6 @@ static TDSRET _bcp_no_get_col_data(TDSBCPINFO *bcpinfo, TDSCOLUMN *bindcol, int
 
 static int rtrim(char *, int);
 static int rtrim_u16(uint16_t *str, int len, uint16_t space);
-static STATUS _bcp_read_hostfile(DBPROCESS * dbproc, FILE * hostfile, bool *row_error, bool skip);
 static int _bcp_readfmt_colinfo(DBPROCESS * dbproc, char *buf, BCP_HOSTCOLINFO * ci);
 static int _bcp_get_term_var(const BYTE * pdata, const BYTE * term, int term_len);
 
@@ -226,6 +211,7 @@ bcp_init(DBPROCESS * dbproc, const char *tblname, const char *hfile, const char
 		goto memory_error;
 	dbproc->hostfileinfo->maxerrs = 10;
 	dbproc->hostfileinfo->firstrow = 1;
+	dbproc->hostfileinfo->compress = -1;
 	if ((dbproc->hostfileinfo->hostfile = strdup(hfile)) == NULL)
 		goto memory_error;
 
@@ -529,6 +515,11 @@ bcp_colfmt_ps(DBPROCESS * dbproc, int host_colnum, int host_type,
  *  		- \b BCPLAST The last row to read in the datafile. The default is to copy all rows. A value of
  *                  	-1 resets this field to its default?
  *  		- \b BCPBATCH The number of rows per batch.  Default is 0, meaning a single batch. 
+ *  		- \b BCPPIPELINE If not zero the datafile is read by a separate thread while rows are
+ *                  	sent to the server.  FreeTDS only.  Errors found reading the datafile are raised
+ *                  	by the thread calling bcp_exec(), the error handler is never called from the reader.
+ *  		- \b BCPCOMPRESS 1 if the datafile is gzip compressed, 0 if not.  The default, -1, 
+ *                  	uses compression if the file name ends with ".gz".  FreeTDS only, requires zlib.
  * \param value The value for \a field.
  *
  * \remarks These options control the behavior of bcp_exec().  
@@ -570,6 +561,18 @@ bcp_control(DBPROCESS * dbproc, int field, DBINT value)
 	case BCPBATCH:
 		dbproc->hostfileinfo->batch = value;
 		break;
+	case BCPPIPELINE:
+		dbproc->hostfileinfo->pipeline = (value != 0);
+		break;
+	case BCPCOMPRESS:
+#if !HAVE_ZLIB
+		if (value > 0) {
+			dbperror(dbproc, SYBEIFNB, 0);
+			return FAIL;
+		}
+#endif
+		dbproc->hostfileinfo->compress = value < 0 ? -1 : (value != 0);
+		break;
 
 	default:
 		dbperror(dbproc, SYBEIFNB, 0);
@@ -594,6 +597,75 @@ bcp_getbatchsize(DBPROCESS * dbproc)
 	return dbproc->hostfileinfo->batch;
 }
 
+/**
+ * \ingroup dblib_bcp
+ * \brief Limit the part of the datafile read by bcp_exec().  A FreeTDS-only function.
+ *
+ * \param dbproc contains all information needed by db-lib to manage communications with the server.
+ * \param start offset in bytes of the first row to read, it must be the start of a row.
+ * \param end only rows starting before this offset are read. Zero means till end of file.
+ *
+ * \remarks Allows to load different parts of the same file using multiple connections.
+ * BCPFIRST and BCPLAST are counted from \a start.
+ *
+ * \return SUCCEED or FAIL.
+ * \sa 	bcp_control(), bcp_exec()
+ */
+RETCODE
+bcp_hostrange(DBPROCESS * dbproc, DBBIGINT start, DBBIGINT end)
+{
+	tdsdump_log(TDS_DBG_FUNC, "bcp_hostrange(%p, %" PRId64 ", %" PRId64 ")\n", dbproc, start, end);
+	CHECK_CONN(FAIL);
+	CHECK_PARAMETER(dbproc->bcpinfo, SYBEBCPI, FAIL);
+	CHECK_PARAMETER(dbproc->hostfileinfo, SYBEBIVI, FAIL);
+
+	if (start < 0 || end < 0 || (end > 0 && end < start)) {
+		dbperror(dbproc, SYBEIFNB, 0);
+		return FAIL;
+	}
+
+	dbproc->hostfileinfo->start_offset = start;
+	dbproc->hostfileinfo->end_offset = end;
+	return SUCCEED;
+}
+
+/**
+ * \ingroup dblib_bcp
+ * \brief Record committed batches loaded by bcp_exec() to resume a failed load.  A FreeTDS-only function.
+ *
+ * \param dbproc contains all information needed by db-lib to manage communications with the server.
+ * \param filename checkpoint file, NULL to disable checkpoints.
+ *
+ * \remarks After every batch committed by bcp_exec() the number of rows read from the datafile
+ * and the offset of the next row are appended to \a filename.
+ * If the file already exists bcp_exec() continues after the last batch recorded, without reading
+ * again the rows already loaded.  The file is never removed, delete it to load the datafile again.
+ * Use BCPBATCH to commit rows while loading, otherwise the load is committed only at the end.
+ * A failure after a batch is committed but before it is recorded loads that batch again on resume.
+ *
+ * \return SUCCEED or FAIL.
+ * \sa 	bcp_control(), bcp_exec(), bcp_hostrange()
+ */
+RETCODE
+bcp_checkpoint(DBPROCESS * dbproc, const char *filename)
+{
+	char *name = NULL;
+
+	tdsdump_log(TDS_DBG_FUNC, "bcp_checkpoint(%p, %s)\n", dbproc, filename ? filename : "NULL");
+	CHECK_CONN(FAIL);
+	CHECK_PARAMETER(dbproc->bcpinfo, SYBEBCPI, FAIL);
+	CHECK_PARAMETER(dbproc->hostfileinfo, SYBEBIVI, FAIL);
+
+	if (filename && (name = strdup(filename)) == NULL) {
+		dbperror(dbproc, SYBEMEM, errno);
+		return FAIL;
+	}
+
+	free(dbproc->hostfileinfo->checkpoint);
+	dbproc->hostfileinfo->checkpoint = name;
+	return SUCCEED;
+}
+
 /** 
  * \ingroup dblib_bcp
  * \brief Set "hints" for uploading a file.  A FreeTDS-only function.  
@@ -822,8 +894,67 @@ bcp_cache_prefix_len(BCP_HOSTCOLINFO *hostcol, const TDSCOLUMN *curcol)
 	return hostcol->prefix_len = plen;
 }
 
+/**
+ * \ingroup dblib_bcp_internal
+ * \brief Check if the data file should be compressed.
+ */
+static bool
+_bcp_hostfile_compressed(DBPROCESS * dbproc)
+{
+	const char *name = dbproc->hostfileinfo->hostfile;
+
+	if (dbproc->hostfileinfo->compress >= 0)
+		return dbproc->hostfileinfo->compress != 0;
+#if HAVE_ZLIB
+	return strlen(name) > 3 && strcasecmp(name + strlen(name) - 3, ".gz") == 0;
+#else
+	return false;
+#endif
+}
+
+/** data file written by bcp_exec() */
+typedef struct
+{
+	FILE *f;
+#if HAVE_ZLIB
+	/** compressed output, used instead of f if not NULL */
+	gzFile gz;
+#endif
+} BCP_HOSTOUT;
+
+static bool
+_bcp_hostout_open(DBPROCESS * dbproc, BCP_HOSTOUT * out)
+{
+	memset(out, 0, sizeof(*out));
+#if HAVE_ZLIB
+	if (_bcp_hostfile_compressed(dbproc))
+		return (out->gz = gzopen(dbproc->hostfileinfo->hostfile, "wb")) != NULL;
+#endif
+	return (out->f = fopen(dbproc->hostfileinfo->hostfile, "w")) != NULL;
+}
+
+static bool
+_bcp_hostout_write(BCP_HOSTOUT * out, const void *data, size_t len)
+{
+#if HAVE_ZLIB
+	if (out->gz)
+		return gzwrite(out->gz, data, (unsigned) len) == (int) len;
+#endif
+	return fwrite(data, len, 1, out->f) == 1;
+}
+
+static int
+_bcp_hostout_close(BCP_HOSTOUT * out)
+{
+#if HAVE_ZLIB
+	if (out->gz)
+		return gzclose(out->gz) == Z_OK ? 0 : EOF;
+#endif
+	return fclose(out->f);
+}
+
 static RETCODE
-bcp_write_prefix(FILE *hostfile, BCP_HOSTCOLINFO *hostcol, TDSCOLUMN *curcol, int buflen)
+bcp_write_prefix(BCP_HOSTOUT *hostfile, BCP_HOSTCOLINFO *hostcol, TDSCOLUMN *curcol, int buflen)
 {
 	union {
 		TDS_TINYINT ti;
@@ -850,7 +981,7 @@ bcp_write_prefix(FILE *hostfile, BCP_HOSTCOLINFO *hostcol, TDSCOLUMN *curcol, in
 		u.li = buflen;
 		break;
 	}
-	if (fwrite(&u, plen, 1, hostfile) == 1)
+	if (_bcp_hostout_write(hostfile, &u, plen))
 		return SUCCEED;
 
 	return FAIL;
@@ -870,7 +1001,8 @@ bcp_write_prefix(FILE *hostfile, BCP_HOSTCOLINFO *hostcol, TDSCOLUMN *curcol, in
 static RETCODE
 _bcp_exec_out(DBPROCESS * dbproc, DBINT * rows_copied)
 {
-	FILE *hostfile = NULL;
+	BCP_HOSTOUT hostfile;
+	bool opened = false;
 	TDS_UCHAR *data = NULL;
 	int i;
 
@@ -934,10 +1066,11 @@ _bcp_exec_out(DBPROCESS * dbproc, DBINT * rows_copied)
 	 * to file.. avoid all that passages...
 	 */
 
-	if (!(hostfile = fopen(dbproc->hostfileinfo->hostfile, "w"))) {
+	if (!_bcp_hostout_open(dbproc, &hostfile)) {
 		dbperror(dbproc, SYBEBCUO, errno);
 		goto Cleanup;
 	}
+	opened = true;
 
 	/* fetch a row of data from the server */
 
@@ -973,7 +1106,7 @@ _bcp_exec_out(DBPROCESS * dbproc, DBINT * rows_copied)
 			}
 
 			/* The prefix */
-			if (bcp_write_prefix(hostfile, hostcol, curcol, buflen) != SUCCEED)
+			if (bcp_write_prefix(&hostfile, hostcol, curcol, buflen) != SUCCEED)
 				goto write_error;
 
 			/* The data */
@@ -982,23 +1115,23 @@ _bcp_exec_out(DBPROCESS * dbproc, DBINT * rows_copied)
 			}
 
 			if (buflen > 0) {
-				if (fwrite(data, buflen, 1, hostfile) != 1)
+				if (!_bcp_hostout_write(&hostfile, data, buflen))
 					goto write_error;
 			}
 
 			/* The terminator */
 			if (hostcol->terminator && hostcol->term_len > 0) {
-				if (fwrite(hostcol->terminator, hostcol->term_len, 1, hostfile) != 1)
+				if (!_bcp_hostout_write(&hostfile, hostcol->terminator, hostcol->term_len))
 					goto write_error;
 			}
 		}
 		rows_written++;
 	}
-	if (fclose(hostfile) != 0) {
+	opened = false;
+	if (_bcp_hostout_close(&hostfile) != 0) {
 		dbperror(dbproc, SYBEBCUC, errno);
 		goto Cleanup;
 	}
-	hostfile = NULL;
 
 	if (row_of_query + 1 < dbproc->hostfileinfo->firstrow) {
 		/*
@@ -1019,38 +1152,131 @@ write_error:
 	dbperror(dbproc, SYBEBCWE, errno);
 
 Cleanup:
-	if (hostfile)
-		fclose(hostfile);
+	if (opened)
+		_bcp_hostout_close(&hostfile);
 	free(data);
 	return FAIL;
 }
 
+/** error found reading the data file */
+typedef struct
+{
+	/** row of the data file */
+	int row;
+	/** column of the data file, 0 if not related to a column */
+	int column;
+	int msgno;
+	int oserr;
+} BCP_HOSTERROR;
+
+/** errors found by a thread reading ahead, raised by the thread sending rows */
+typedef struct
+{
+	int num_errors;
+	int allocated;
+	BCP_HOSTERROR *errors;
+} BCP_HOSTERRORS;
+
+/** position in the data file after a row */
+typedef struct
+{
+	/** offset of the next row */
+	TDS_INT8 offset;
+	/** rows read so far */
+	int row;
+} BCP_HOSTPOS;
+
+/** state of a data file read by bcp_exec() */
+typedef struct
+{
+	TDSBCPHOSTFILE *hostfile;
+	FILE *errfile;
+	int row_of_hostfile;
+	int row_error_count;
+	/** checkpoint file, written by the thread sending rows */
+	FILE *checkpoint;
+	/** position after last row sent */
+	BCP_HOSTPOS sent;
+	/** true if resuming from a checkpoint, rows rejected before are kept in the error file */
+	bool resuming;
+	/** context used to convert data */
+	const TDSCONTEXT *tds_ctx;
+	/** socket passed to character conversions, used only to report errors */
+	TDSSOCKET *tds;
+	/** if not NULL errors are recorded here instead of being raised */
+	BCP_HOSTERRORS *errors;
+	/** column being read, 0 if none */
+	int column;
+} BCP_HOSTREADER;
+
+/**
+ * \ingroup dblib_bcp_internal
+ * \brief Raise an error found reading the data file.
+ *
+ * If the data file is read by another thread the error is recorded and raised
+ * later by the thread sending rows, before sending the following row.
+ *
+ * \param dbproc contains all information needed by db-lib to manage communications with the server.
+ * \param reader data file being read
+ * \param msgno error to raise
+ * \param errnum operating system error
+ */
+static void
+_bcp_host_error(DBPROCESS * dbproc, BCP_HOSTREADER * reader, int msgno, int errnum)
+{
+	BCP_HOSTERRORS *errors = reader->errors;
+	BCP_HOSTERROR *err;
+
+	if (!errors) {
+		dbperror(dbproc, msgno, errnum);
+		return;
+	}
+
+	if (errors->num_errors >= errors->allocated) {
+		int allocated = errors->allocated ? errors->allocated * 2 : 16;
+
+		if (!TDS_RESIZE(errors->errors, allocated)) {
+			tdsdump_log(TDS_DBG_ERROR, "bcp: lost error %d on row %d, out of memory\n",
+				    msgno, reader->row_of_hostfile);
+			return;
+		}
+		errors->allocated = allocated;
+	}
+	err = &errors->errors[errors->num_errors++];
+	err->row = reader->row_of_hostfile;
+	err->column = reader->column;
+	err->msgno = msgno;
+	err->oserr = errnum;
+}
+
 static STATUS
-_bcp_check_eof(DBPROCESS * dbproc, FILE *file, int icol)
+_bcp_check_eof(DBPROCESS * dbproc, BCP_HOSTREADER * reader, int icol)
 {
 	int errnum = errno;
 
-	tdsdump_log(TDS_DBG_FUNC, "_bcp_check_eof(%p, %p, %d)\n", dbproc, file, icol);
+	tdsdump_log(TDS_DBG_FUNC, "_bcp_check_eof(%p, %p, %d)\n", dbproc, reader, icol);
 	assert(dbproc);
-	assert(file);
+	assert(reader);
 
-	if (feof(file)) {
+	if (tds_bcp_hostfile_eof(reader->hostfile)) {
 		if (icol == 0) {
 			tdsdump_log(TDS_DBG_FUNC, "Normal end-of-file reached while loading bcp data file.\n");
 			return NO_MORE_ROWS;
 		}
-		dbperror(dbproc, SYBEBEOF, errnum);
+		_bcp_host_error(dbproc, reader, SYBEBEOF, errnum);
 		return FAIL;
 	} 
-	dbperror(dbproc, SYBEBCRE, errnum);
+	_bcp_host_error(dbproc, reader, SYBEBCRE, errnum);
 	return FAIL;
 }
 
 /**
  * Convert column for input to a table
+ *
+ * \return length of data converted or a negative tds_convert() error.
  */
-static TDSRET
-_bcp_convert_in(DBPROCESS *dbproc, TDS_SERVER_TYPE srctype, const TDS_CHAR *src, TDS_UINT srclen,
+static TDS_INT
+_bcp_convert_in(const TDSCONTEXT *tds_ctx, TDS_SERVER_TYPE srctype, const TDS_CHAR *src, TDS_UINT srclen,
 		TDS_SERVER_TYPE desttype, BCPCOLDATA *coldata)
 {
 	bool variable = true;
@@ -1066,33 +1292,31 @@ _bcp_convert_in(DBPROCESS *dbproc, TDS_SERVER_TYPE srctype, const TDS_CHAR *src,
 		p_cr = &cr;
 	}
 
-	len = tds_convert(dbproc->tds_socket->conn->tds_ctx, srctype, src, srclen, desttype, p_cr);
-	if (len < 0) {
-		_dblib_convert_err(dbproc, len);
-		return TDS_FAIL;
-	}
+	len = tds_convert(tds_ctx, srctype, src, srclen, desttype, p_cr);
+	if (len < 0)
+		return len;
 
 	coldata->datalen = len;
 	if (variable) {
 		free(coldata->data);
 		coldata->data = (TDS_UCHAR *) cr.c;
 	}
-	return TDS_SUCCESS;
+	return len;
 }
 
 static void
-rtrim_bcpcol(TDSCOLUMN *bcpcol)
+rtrim_bcpcol(TDSCOLUMN *bcpcol, BCPCOLDATA *coldata)
 {
 	/* trim trailing blanks from character data */
 	if (is_ascii_type(bcpcol->on_server.column_type)) {
 		/* A single NUL byte indicates an empty string. */
-		if (bcpcol->bcp_column_data->datalen == 1
-		    && bcpcol->bcp_column_data->data[0] == '\0') {
-			bcpcol->bcp_column_data->datalen = 0;
+		if (coldata->datalen == 1
+		    && coldata->data[0] == '\0') {
+			coldata->datalen = 0;
 			return;
 		}
-		bcpcol->bcp_column_data->datalen = rtrim((char *) bcpcol->bcp_column_data->data,
-								  bcpcol->bcp_column_data->datalen);
+		coldata->datalen = rtrim((char *) coldata->data,
+								  coldata->datalen);
 		return;
 	}
 
@@ -1103,10 +1327,10 @@ rtrim_bcpcol(TDSCOLUMN *bcpcol)
 		if (!bcpcol->char_conv || bcpcol->char_conv->to.charset.min_bytes_per_char != 2)
 			return;
 
-		data = (uint16_t *) bcpcol->bcp_column_data->data;
+		data = (uint16_t *) coldata->data;
 		/* A single NUL byte indicates an empty string. */
-		if (bcpcol->bcp_column_data->datalen == 2 && data[0] == 0) {
-			bcpcol->bcp_column_data->datalen = 0;
+		if (coldata->datalen == 2 && data[0] == 0) {
+			coldata->datalen = 0;
 			return;
 		}
 		switch (bcpcol->char_conv->to.charset.canonic) {
@@ -1121,7 +1345,7 @@ rtrim_bcpcol(TDSCOLUMN *bcpcol)
 		default:
 			return;
 		}
-		bcpcol->bcp_column_data->datalen = rtrim_u16(data, bcpcol->bcp_column_data->datalen, space);
+		coldata->datalen = rtrim_u16(data, coldata->datalen, space);
 	}
 }
 
@@ -1130,18 +1354,20 @@ rtrim_bcpcol(TDSCOLUMN *bcpcol)
  * \brief 
  *
  * \param dbproc contains all information needed by db-lib to manage communications with the server.
- * \param hostfile 
+ * \param reader data file being read
+ * \param rowdata where to store data read, one for each table column
  * \param row_error 
  * 
  * \return MORE_ROWS, NO_MORE_ROWS, or FAIL.
  * \sa 	BCP_SETL(), bcp_batch(), bcp_bind(), bcp_colfmt(), bcp_colfmt_ps(), bcp_collen(), bcp_colptr(), bcp_columns(), bcp_control(), bcp_done(), bcp_exec(), bcp_getl(), bcp_init(), bcp_moretext(), bcp_options(), bcp_readfmt(), bcp_sendrow()
  */
 static STATUS
-_bcp_read_hostfile(DBPROCESS * dbproc, FILE * hostfile, bool *row_error, bool skip)
+_bcp_read_hostfile(DBPROCESS * dbproc, BCP_HOSTREADER * reader, BCPCOLDATA ** rowdata, bool *row_error, bool skip)
 {
+	TDSBCPHOSTFILE *hostfile = reader->hostfile;
 	int i;
 
-	tdsdump_log(TDS_DBG_FUNC, "_bcp_read_hostfile(%p, %p, %p, %d)\n", dbproc, hostfile, row_error, skip);
+	tdsdump_log(TDS_DBG_FUNC, "_bcp_read_hostfile(%p, %p, %p, %d)\n", dbproc, reader, row_error, skip);
 	assert(dbproc);
 	assert(hostfile);
 	assert(row_error);
@@ -1151,15 +1377,16 @@ _bcp_read_hostfile(DBPROCESS * dbproc, FILE * hostfile, bool *row_error, bool sk
 	for (i = 0; i < dbproc->hostfileinfo->host_colcount; i++) {
 		TDSCOLUMN *bcpcol = NULL;
 		BCP_HOSTCOLINFO *hostcol;
-		TDS_CHAR *coldata;
+		const TDS_CHAR *coldata;
 		int collen = 0;
 		bool data_is_null = false;
-		offset_type col_start;
+		TDS_INT8 col_start;
 
 		tdsdump_log(TDS_DBG_FUNC, "parsing host column %d\n", i + 1);
 		hostcol = dbproc->hostfileinfo->host_columns[i];
 
 		hostcol->column_error = 0;
+		reader->column = i + 1;
 
 		/* 
 		 * If this host file column contains table data,
@@ -1169,7 +1396,7 @@ _bcp_read_hostfile(DBPROCESS * dbproc, FILE * hostfile, bool *row_error, bool sk
 			if (hostcol->tab_colnum > dbproc->bcpinfo->bindinfo->num_cols) {
 				tdsdump_log(TDS_DBG_FUNC, "error: file wider than table: %d/%d\n", 
 							  i+1, dbproc->bcpinfo->bindinfo->num_cols);
-				dbperror(dbproc, SYBEBEOF, 0);
+				_bcp_host_error(dbproc, reader, SYBEBEOF, 0);
 				return FAIL;
 			}
 			tdsdump_log(TDS_DBG_FUNC, "host column %d uses bcpcol %d (%p)\n", 
@@ -1192,18 +1419,21 @@ _bcp_read_hostfile(DBPROCESS * dbproc, FILE * hostfile, bool *row_error, bool sk
 
 			switch (hostcol->prefix_len) {
 			case 1:
-				if (fread(&u.ti, 1, 1, hostfile) != 1)
-					return _bcp_check_eof(dbproc, hostfile, i);
+				if (TDS_FAILED(tds_bcp_hostfile_read(hostfile, 1, &coldata)))
+					return _bcp_check_eof(dbproc, reader, i);
+				memcpy(&u.ti, coldata, 1);
 				collen = u.ti ? u.ti : -1;
 				break;
 			case 2:
-				if (fread(&u.si, 2, 1, hostfile) != 1)
-					return _bcp_check_eof(dbproc, hostfile, i);
+				if (TDS_FAILED(tds_bcp_hostfile_read(hostfile, 2, &coldata)))
+					return _bcp_check_eof(dbproc, reader, i);
+				memcpy(&u.si, coldata, 2);
 				collen = u.si;
 				break;
 			case 4:
-				if (fread(&u.li, 4, 1, hostfile) != 1)
-					return _bcp_check_eof(dbproc, hostfile, i);
+				if (TDS_FAILED(tds_bcp_hostfile_read(hostfile, 4, &coldata)))
+					return _bcp_check_eof(dbproc, reader, i);
+				memcpy(&u.li, coldata, 4);
 				collen = u.li;
 				break;
 			default:
@@ -1238,7 +1468,7 @@ _bcp_read_hostfile(DBPROCESS * dbproc, FILE * hostfile, bool *row_error, bool sk
 		if (is_fixed_type(hostcol->datatype))
 			collen = tds_get_size_by_type(hostcol->datatype);
 
-		col_start = ftello(hostfile);
+		col_start = tds_bcp_hostfile_tell(hostfile);
 
 		/*
 		 * The data file either contains prefixes stating the length, or is delimited.  
@@ -1250,31 +1480,31 @@ _bcp_read_hostfile(DBPROCESS * dbproc, FILE * hostfile, bool *row_error, bool sk
 			TDSRET conv_res;
 
 			/* 
-			 * Read and convert the data
+			 * Read and convert the data, data are not copied if possible
 			 */
-			coldata = NULL;
-			conv_res = tds_bcp_fread(dbproc->tds_socket, bcpcol ? bcpcol->char_conv : NULL, hostfile,
-						 (const char *) hostcol->terminator, hostcol->term_len, &coldata, &col_bytes);
+			conv_res = tds_bcp_hostfile_read_field(reader->tds, bcpcol ? bcpcol->char_conv : NULL,
+							       hostfile, (const char *) hostcol->terminator,
+							       hostcol->term_len, &coldata, &col_bytes);
+
+			/* data file cannot be read, this is not an error of the row */
+			if (TDS_FAILED(conv_res) && hostfile->error)
+				return _bcp_check_eof(dbproc, reader, i);
 
 			if (TDS_FAILED(conv_res)) {
 				tdsdump_log(TDS_DBG_FUNC, "col %d: error converting %ld bytes!\n",
 							(i+1), (long) collen);
 				*row_error = true;
-				free(coldata);
-				dbperror(dbproc, SYBEBCOR, 0);
+				_bcp_host_error(dbproc, reader, SYBEBCOR, 0);
 				return FAIL;
 			}
 
-			if (conv_res == TDS_NO_MORE_RESULTS) {
-				free(coldata);
-				return _bcp_check_eof(dbproc, hostfile, i);
-			}
+			if (conv_res == TDS_NO_MORE_RESULTS)
+				return _bcp_check_eof(dbproc, reader, i);
 
 			if (col_bytes > 0x7fffffffl) {
-				free(coldata);
 				*row_error = true;
 				tdsdump_log(TDS_DBG_FUNC, "data from file is too large!\n");
-				dbperror(dbproc, SYBEBCOR, 0);
+				_bcp_host_error(dbproc, reader, SYBEBCOR, 0);
 				return FAIL;
 			}
 
@@ -1293,30 +1523,16 @@ _bcp_read_hostfile(DBPROCESS * dbproc, FILE * hostfile, bool *row_error, bool sk
 			 */
 		} else {	/* unterminated field */
 
-			coldata = tds_new(TDS_CHAR, 1 + collen);
-			if (coldata == NULL) {
-				*row_error = true;
-				dbperror(dbproc, SYBEMEM, errno);
-				return FAIL;
-			}
-
-			coldata[collen] = 0;
-			if (collen) {
-				/* 
-				 * Read and convert the data
-				 * TODO: Call tds_bcp_fread() instead of fread(3).
-				 *       The columns should each have their iconv cd set, and noncharacter data
-				 *       should have -1 as the iconv cd, causing tds_bcp_fread() to not attempt
-				 * 	 any conversion.  We do not need a datatype switch here to decide what to do.  
-				 *	 As of 0.62, this *should* actually work.  All that remains is to change the
-				 *	 call and test it. 
-				 */
-				tdsdump_log(TDS_DBG_FUNC, "Reading %d bytes from hostfile.\n", collen);
-				if (fread(coldata, collen, 1, hostfile) != 1) {
-					free(coldata);
-					return _bcp_check_eof(dbproc, hostfile, i);
-				}
-			}
+			/* 
+			 * Read the data
+			 * TODO: Convert character data with the column iconv cd, as
+			 *       tds_bcp_hostfile_read_field() does for terminated fields.
+			 *       Noncharacter data should have -1 as the iconv cd, so no
+			 * 	 conversion is attempted.  We do not need a datatype switch here to decide what to do.  
+			 */
+			tdsdump_log(TDS_DBG_FUNC, "Reading %d bytes from hostfile.\n", collen);
+			if (TDS_FAILED(tds_bcp_hostfile_read(hostfile, collen, &coldata)))
+				return _bcp_check_eof(dbproc, reader, i);
 		}
 
 		/* 
@@ -1324,18 +1540,22 @@ _bcp_read_hostfile(DBPROCESS * dbproc, FILE * hostfile, bool *row_error, bool sk
 		 */
 		tdsdump_log(TDS_DBG_FUNC, "Data read from hostfile: collen is now %d, data_is_null is %d\n", collen, data_is_null);
 		if (!skip && bcpcol) {
+			BCPCOLDATA *bcpdata = rowdata[hostcol->tab_colnum - 1];
+
 			if (data_is_null) {
-				bcpcol->bcp_column_data->is_null = true;
-				bcpcol->bcp_column_data->datalen = 0;
+				bcpdata->is_null = true;
+				bcpdata->datalen = 0;
 			} else {
-				TDSRET rc;
+				TDS_INT len;
 				TDS_SERVER_TYPE desttype;
 
 				desttype = tds_get_conversion_type(bcpcol->column_type, bcpcol->column_size);
 
-				rc = _bcp_convert_in(dbproc, hostcol->datatype, (const TDS_CHAR*) coldata, collen,
-						     desttype, bcpcol->bcp_column_data);
-				if (TDS_FAILED(rc)) {
+				len = _bcp_convert_in(reader->tds_ctx, hostcol->datatype, (const TDS_CHAR*) coldata, collen,
+						      desttype, bcpdata);
+				if (len < 0) {
+					_bcp_host_error(dbproc, reader, _dblib_convert_msgno(len),
+							len == TDS_CONVERT_NOMEM ? ENOMEM : 0);
 					hostcol->column_error = HOST_COL_CONV_ERROR;
 					*row_error = true;
 					tdsdump_log(TDS_DBG_FUNC, 
@@ -1343,22 +1563,21 @@ _bcp_read_hostfile(DBPROCESS * dbproc, FILE * hostfile, bool *row_error, bool sk
 						    collen, (TDS_INT8) col_start);
 				}
 
-				rtrim_bcpcol(bcpcol);
+				rtrim_bcpcol(bcpcol, bcpdata);
 			}
 #if USING_SYBEBCNN
 			if (!hostcol->column_error) {
-				if (bcpcol->bcp_column_data->datalen <= 0) {	/* Are we trying to insert a NULL ? */
+				if (bcpdata->datalen <= 0) {	/* Are we trying to insert a NULL ? */
 					if (!bcpcol->column_nullable) {
 						/* too bad if the column is not nullable */
 						hostcol->column_error = HOST_COL_NULL_ERROR;
 						*row_error = true;
-						dbperror(dbproc, SYBEBCNN, 0);
+						_bcp_host_error(dbproc, reader, SYBEBCNN, 0);
 					}
 				}
 			}
 #endif
 		}
-		free(coldata);
 	}
 	return MORE_ROWS;
 }
@@ -1419,184 +1638,873 @@ bcp_sendrow(DBPROCESS * dbproc)
 }
 
 
-/** 
- * \ingroup dblib_bcp_internal
- * \brief 
+/**
+ * \ingroup dblib_bcp
+ * \brief Bind an array of program variables to a table column, FreeTDS only.
  *
  * \param dbproc contains all information needed by db-lib to manage communications with the server.
- * \param rows_copied 
- * 
+ * \param varaddr address of first value, NULL to remove the binding.
+ * \param stride distance in bytes between values, 0 for packed fixed size values.
+ * \param lengths length of every value, can be NULL.
+ *	A negative length is the size of the type for fixed types, the length
+ *	of the string (up to \a stride bytes) for characters and \a stride for binaries.
+ * \param indicators NULL indicators, -1 means NULL, can be NULL.
+ * \param vartype datatype of the values, 0 for the type of the column.
+ * \param table_column Nth column, starting at 1, in the table.
+ *
+ * \remarks Conversions are resolved once here, not for every row.
+ *	Use bcp_sendrows() to send many rows from the arrays in a single call.
+ *	Character data is not trimmed like it is by bcp_bind().
  * \return SUCCEED or FAIL.
- * \sa 	BCP_SETL(), bcp_batch(), bcp_bind(), bcp_colfmt(), bcp_colfmt_ps(), bcp_collen(), bcp_colptr(), bcp_columns(), bcp_control(), bcp_done(), bcp_exec(), bcp_getl(), bcp_init(), bcp_moretext(), bcp_options(), bcp_readfmt(), bcp_sendrow()
+ * \sa 	bcp_bind(), bcp_sendrows()
  */
-static RETCODE
-_bcp_exec_in(DBPROCESS * dbproc, DBINT * rows_copied)
+RETCODE
+bcp_bind_array(DBPROCESS * dbproc, BYTE * varaddr, DBINT stride, DBINT * lengths, DBSMALLINT * indicators,
+	       int vartype, int table_column)
 {
-	FILE *hostfile, *errfile = NULL;
-	TDSSOCKET *tds = dbproc->tds_socket;
-	BCP_HOSTCOLINFO *hostcol;
-	STATUS ret;
+	TDSCOLUMN *colinfo;
 
-	int i, row_of_hostfile, rows_written_so_far;
-	int row_error_count;
-	bool row_error;
-	offset_type row_start, row_end;
-	offset_type error_row_size;
-	const size_t chunk_size = 0x20000u;
-	
-	tdsdump_log(TDS_DBG_FUNC, "_bcp_exec_in(%p, %p)\n", dbproc, rows_copied);
-	assert(dbproc);
-	assert(rows_copied);
+	tdsdump_log(TDS_DBG_FUNC, "bcp_bind_array(%p, %p, %d, %p, %p, %s, %d)\n",
+		    dbproc, varaddr, stride, lengths, indicators, dbprtype(vartype), table_column);
+	CHECK_CONN(FAIL);
+	CHECK_PARAMETER(dbproc->bcpinfo, SYBEBCPI, FAIL);
+	DBPERROR_RETURN(vartype != 0 && !is_tds_type_valid(vartype), SYBEUDTY);
 
-	*rows_copied = 0;
-	
-	if (!(hostfile = fopen(dbproc->hostfileinfo->hostfile, "r"))) {
-		dbperror(dbproc, SYBEBCUO, 0);
+	if (dbproc->hostfileinfo != NULL) {
+		dbperror(dbproc, SYBEBCPB, 0);
 		return FAIL;
 	}
 
-	if (TDS_FAILED(tds_bcp_start_copy_in(tds, dbproc->bcpinfo))) {
-		fclose(hostfile);
+	if (dbproc->bcpinfo->direction != DB_IN) {
+		dbperror(dbproc, SYBEBCPN, 0);
 		return FAIL;
 	}
 
-	row_of_hostfile = 0;
-	rows_written_so_far = 0;
+	if (table_column <= 0 ||  table_column > dbproc->bcpinfo->bindinfo->num_cols) {
+		dbperror(dbproc, SYBECNOR, 0);
+		return FAIL;
+	}
+
+	colinfo = dbproc->bcpinfo->bindinfo->columns[table_column - 1];
+	if (vartype == 0)
+		vartype = tds_get_conversion_type(colinfo->column_type, colinfo->column_size);
+
+	if (stride < 0 || (stride == 0 && !is_fixed_type(vartype))) {
+		dbperror(dbproc, SYBEBCVLEN, 0);
+		return FAIL;
+	}
+
+	if (TDS_FAILED(tds_bcp_bind_array(dbproc->tds_socket, dbproc->bcpinfo, table_column - 1, (TDS_SERVER_TYPE) vartype,
+					  varaddr, stride, lengths, indicators))) {
+		_dblib_convert_err(dbproc, TDS_CONVERT_NOAVAIL);
+		return FAIL;
+	}
+
+	return SUCCEED;
+}
+
+/**
+ * \ingroup dblib_bcp
+ * \brief Bind a column of the results of another connection to a table column, FreeTDS only.
+ *
+ * \param dbproc contains all information needed by db-lib to manage communications with the server.
+ * \param source connection with the results to copy, rows are read with dbnextrow().
+ * \param source_column Nth column, starting at 1, in the results of \a source.
+ * \param table_column Nth column, starting at 1, in the table.
+ *
+ * \remarks Every row sent with bcp_sendrows() takes the value from the current
+ *	row of \a source, send one row after every dbnextrow().
+ *	Values of the same type are sent as read, without conversion.
+ *	The binding is valid until the results of \a source change.
+ * \return SUCCEED or FAIL.
+ * \sa 	bcp_bind_array(), bcp_sendrows(), dbnextrow()
+ */
+RETCODE
+bcp_bind_result(DBPROCESS * dbproc, DBPROCESS * source, int source_column, int table_column)
+{
+	TDSRESULTINFO *resinfo;
+
+	tdsdump_log(TDS_DBG_FUNC, "bcp_bind_result(%p, %p, %d, %d)\n", dbproc, source, source_column, table_column);
+	CHECK_CONN(FAIL);
+	CHECK_PARAMETER(dbproc->bcpinfo, SYBEBCPI, FAIL);
+	CHECK_NULP(source, "bcp_bind_result", 2, FAIL);
+
+	if (dbproc->hostfileinfo != NULL) {
+		dbperror(dbproc, SYBEBCPB, 0);
+		return FAIL;
+	}
+
+	if (dbproc->bcpinfo->direction != DB_IN) {
+		dbperror(dbproc, SYBEBCPN, 0);
+		return FAIL;
+	}
+
+	resinfo = source->tds_socket ? source->tds_socket->res_info : NULL;
+	if (table_column <= 0 ||  table_column > dbproc->bcpinfo->bindinfo->num_cols
+	    || !resinfo || source_column <= 0 || source_column > resinfo->num_cols) {
+		dbperror(dbproc, SYBECNOR, 0);
+		return FAIL;
+	}
+
+	if (TDS_FAILED(tds_bcp_bind_column(dbproc->tds_socket, dbproc->bcpinfo, table_column - 1,
+					   resinfo->columns[source_column - 1]))) {
+		_dblib_convert_err(dbproc, TDS_CONVERT_NOAVAIL);
+		return FAIL;
+	}
+
+	return SUCCEED;
+}
+
+/**
+ * \ingroup dblib_bcp
+ * \brief Write many rows to the table from arrays bound with bcp_bind_array(), FreeTDS only.
+ *
+ * \param dbproc contains all information needed by db-lib to manage communications with the server.
+ * \param num_rows number of rows to send.
+ * \param rows_sent where to store the number of rows sent, can be NULL.
+ *
+ * \remarks Row N is taken from the Nth element of every array, columns without
+ *	an array are sent as NULL. Columns bound with bcp_bind_result() take the
+ *	current row of the source. Sending stops at the first row that fails.
+ *	Use bcp_batch() to commit sets of rows, after sending the last row call bcp_done().
+ * \return SUCCEED or FAIL.
+ * \sa 	bcp_bind_array(), bcp_bind_result(), bcp_batch(), bcp_done(), bcp_sendrow()
+ */
+RETCODE
+bcp_sendrows(DBPROCESS * dbproc, DBINT num_rows, DBINT * rows_sent)
+{
+	TDSSOCKET *tds;
+	int sent = 0;
+	TDSRET rc;
+
+	tdsdump_log(TDS_DBG_FUNC, "bcp_sendrows(%p, %d, %p)\n", dbproc, num_rows, rows_sent);
+	CHECK_CONN(FAIL);
+	CHECK_PARAMETER(dbproc->bcpinfo, SYBEBCPI, FAIL);
+
+	if (rows_sent)
+		*rows_sent = 0;
+
+	tds = dbproc->tds_socket;
+
+	if (dbproc->bcpinfo->direction != DB_IN) {
+		dbperror(dbproc, SYBEBCPN, 0);
+		return FAIL;
+	}
+
+	if (dbproc->hostfileinfo != NULL) {
+		dbperror(dbproc, SYBEBCPB, 0);
+		return FAIL;
+	}
+
+	if (!dbproc->bcpinfo->xfer_init) {
+		if (TDS_FAILED(tds_bcp_start_copy_in(tds, dbproc->bcpinfo))) {
+			dbperror(dbproc, SYBEBULKINSERT, 0);
+			return FAIL;
+		}
+		dbproc->bcpinfo->xfer_init = true;
+	}
 
-	row_error_count = 0;
 	dbproc->bcpinfo->parent = dbproc;
+	rc = tds_bcp_send_rows(tds, dbproc->bcpinfo, 0, num_rows, _bcp_null_error, &sent);
+	if (rows_sent)
+		*rows_sent = sent;
+	return TDS_FAILED(rc) ? FAIL : SUCCEED;
+}
 
-	for (;;) {
-		bool skip;
 
-		row_start = ftello(hostfile);
-		row_error = false;
+#define BCP_CHECKPOINT_HEADER "FreeTDS bcp checkpoint 1\n"
+
+/**
+ * \ingroup dblib_bcp_internal
+ * \brief Write a row which failed to the error file.
+ *
+ * \param dbproc contains all information needed by db-lib to manage communications with the server.
+ * \param reader data file being read
+ * \param row_start offset of the row in the data file
+ *
+ * \return SUCCEED or FAIL if the error file cannot be opened.
+ */
+static RETCODE
+_bcp_write_error_row(DBPROCESS * dbproc, BCP_HOSTREADER * reader, TDS_INT8 row_start)
+{
+	TDSBCPHOSTFILE *hostfile = reader->hostfile;
+	BCP_HOSTCOLINFO *hostcol;
+	const char *row_in_error;
+	TDS_INT8 row_end, error_row_size;
+	const size_t chunk_size = 0x20000u;
+	int i, count;
+
+	if (reader->errfile == NULL && dbproc->hostfileinfo->errorfile) {
+		if (!(reader->errfile = fopen(dbproc->hostfileinfo->errorfile, reader->resuming ? "a" : "w"))) {
+			_bcp_host_error(dbproc, reader, SYBEBUOE, 0);
+			return FAIL;
+		}
+	}
+
+	if (reader->errfile == NULL)
+		return SUCCEED;
+
+	for (i = 0; i < dbproc->hostfileinfo->host_colcount; i++) {
+		hostcol = dbproc->hostfileinfo->host_columns[i];
+		if (hostcol->column_error == HOST_COL_CONV_ERROR) {
+			count = fprintf(reader->errfile, 
+				"#@ data conversion error on host data file Row %d Column %d\n",
+				reader->row_of_hostfile, i + 1);
+			if( count < 0 ) {
+				_bcp_host_error(dbproc, reader, SYBEBWEF, errno);
+			}
+		} else if (hostcol->column_error == HOST_COL_NULL_ERROR) {
+			count = fprintf(reader->errfile, "#@ Attempt to bulk-copy a NULL value into Server column"
+					" which does not accept NULL values. Row %d, Column %d\n",
+					reader->row_of_hostfile, i + 1);
+			if( count < 0 ) {
+				_bcp_host_error(dbproc, reader, SYBEBWEF, errno);
+			}
+
+		}
+	}
+
+	row_end = tds_bcp_hostfile_tell(hostfile);
 
-		row_of_hostfile++;
+	/* error data can be very long so split in chunks */
+	error_row_size = row_end - row_start;
+	tds_bcp_hostfile_seek(hostfile, row_start);
 
-		if (row_of_hostfile > TDS_MAX(dbproc->hostfileinfo->lastrow, 0x7FFFFFFF))
+	while (error_row_size > 0) {
+		size_t chunk = TDS_MIN((size_t) error_row_size, chunk_size);
+
+		if (TDS_FAILED(tds_bcp_hostfile_read(hostfile, chunk, &row_in_error))) {
+			tdsdump_log(TDS_DBG_ERROR, "BILL fread failed after fseek\n");
 			break;
+		}
+		count = (int)fwrite(row_in_error, chunk, 1, reader->errfile);
+		if( (size_t)count < chunk ) {
+			_bcp_host_error(dbproc, reader, SYBEBWEF, errno);
+		}
+		error_row_size -= chunk;
+	}
+
+	tds_bcp_hostfile_seek(hostfile, row_end);
+	count = fprintf(reader->errfile, "\n");
+	if( count < 0 ) {
+		_bcp_host_error(dbproc, reader, SYBEBWEF, errno);
+	}
+	return SUCCEED;
+}
 
-		skip = dbproc->hostfileinfo->firstrow > row_of_hostfile;
-		ret = _bcp_read_hostfile(dbproc, hostfile, &row_error, skip);
+/**
+ * \ingroup dblib_bcp_internal
+ * \brief Read next row to send from the data file.
+ *
+ * Rows with errors are written to the error file, rows before BCPFIRST are skipped.
+ *
+ * \param dbproc contains all information needed by db-lib to manage communications with the server.
+ * \param reader data file being read
+ * \param rowdata where to store data read, one for each table column
+ * \param pos where to store the position after the row
+ *
+ * \return MORE_ROWS if a row was read, NO_MORE_ROWS at end of data, or FAIL.
+ */
+static STATUS
+_bcp_next_row(DBPROCESS * dbproc, BCP_HOSTREADER * reader, BCPCOLDATA ** rowdata, BCP_HOSTPOS * pos)
+{
+	for (;;) {
+		TDS_INT8 row_start;
+		bool row_error = false, skip;
+		STATUS ret;
+
+		row_start = tds_bcp_hostfile_tell(reader->hostfile);
+
+		reader->row_of_hostfile++;
+
+		if (reader->row_of_hostfile > TDS_MAX(dbproc->hostfileinfo->lastrow, 0x7FFFFFFF))
+			return NO_MORE_ROWS;
+
+		/* rest of the file is read by somebody else */
+		if (dbproc->hostfileinfo->end_offset > 0 && row_start >= dbproc->hostfileinfo->end_offset)
+			return NO_MORE_ROWS;
+
+		skip = dbproc->hostfileinfo->firstrow > reader->row_of_hostfile;
+		ret = _bcp_read_hostfile(dbproc, reader, rowdata, &row_error, skip);
+		reader->column = 0;
 		if (ret != MORE_ROWS)
-			break;
+			return ret;
 
 		if (row_error) {
-			int count;
+			if (_bcp_write_error_row(dbproc, reader, row_start) == FAIL)
+				return FAIL;
+			reader->row_error_count++;
+			if (reader->row_error_count >= dbproc->hostfileinfo->maxerrs)
+				return FAIL;
+			continue;
+		}
 
-			if (errfile == NULL && dbproc->hostfileinfo->errorfile) {
-				if (!(errfile = fopen(dbproc->hostfileinfo->errorfile, "w"))) {
-					fclose(hostfile);
-					dbperror(dbproc, SYBEBUOE, 0);
-					return FAIL;
-				}
+		if (!skip) {
+			pos->offset = tds_bcp_hostfile_tell(reader->hostfile);
+			pos->row = reader->row_of_hostfile;
+			return MORE_ROWS;
+		}
+	}
+}
+
+/**
+ * \ingroup dblib_bcp_internal
+ * \brief Open the checkpoint file and find where to resume loading.
+ *
+ * \param dbproc contains all information needed by db-lib to manage communications with the server.
+ * \param reader data file being read, position is updated to the last batch recorded
+ *
+ * \return SUCCEED or FAIL.
+ */
+static RETCODE
+_bcp_open_checkpoint(DBPROCESS * dbproc, BCP_HOSTREADER * reader)
+{
+	const char *name = dbproc->hostfileinfo->checkpoint;
+	char line[128];
+	bool empty = true;
+	FILE *f;
+
+	reader->sent.offset = -1;
+	if ((f = fopen(name, "r")) != NULL) {
+		if (fgets(line, sizeof(line), f)) {
+			empty = false;
+			if (strcmp(line, BCP_CHECKPOINT_HEADER) != 0) {
+				fclose(f);
+				dbperror(dbproc, SYBEBCKPT, 0, name);
+				return FAIL;
+			}
+		}
+		/* last complete line is the last batch committed */
+		while (fgets(line, sizeof(line), f) && strchr(line, '\n')) {
+			char *end;
+			long row = strtol(line, &end, 10);
+			TDS_INT8 offset = tds_strtoll(end, &end, 10);
+
+			if (*end != '\n' || row < 0 || row > 0x7FFFFFFF || offset < 0) {
+				fclose(f);
+				dbperror(dbproc, SYBEBCKPT, 0, name);
+				return FAIL;
 			}
+			reader->sent.row = (int) row;
+			reader->sent.offset = offset;
+		}
+		fclose(f);
+	} else if (errno != ENOENT) {
+		dbperror(dbproc, SYBEBCKPT, errno, name);
+		return FAIL;
+	}
+	reader->resuming = reader->sent.offset >= 0;
 
-			if (errfile != NULL) {
-				char *row_in_error = NULL;
-
-				for (i = 0; i < dbproc->hostfileinfo->host_colcount; i++) {
-					hostcol = dbproc->hostfileinfo->host_columns[i];
-					if (hostcol->column_error == HOST_COL_CONV_ERROR) {
-						count = fprintf(errfile, 
-							"#@ data conversion error on host data file Row %d Column %d\n",
-							row_of_hostfile, i + 1);
-						if( count < 0 ) {
-							dbperror(dbproc, SYBEBWEF, errno);
-						}
-					} else if (hostcol->column_error == HOST_COL_NULL_ERROR) {
-						count = fprintf(errfile, "#@ Attempt to bulk-copy a NULL value into Server column"
-								" which does not accept NULL values. Row %d, Column %d\n",
-								row_of_hostfile, i + 1);
-						if( count < 0 ) {
-							dbperror(dbproc, SYBEBWEF, errno);
-						}
+	if (!(reader->checkpoint = fopen(name, empty ? "w" : "a"))
+	    || (empty && (fputs(BCP_CHECKPOINT_HEADER, reader->checkpoint) < 0 || fflush(reader->checkpoint) != 0))) {
+		dbperror(dbproc, SYBEBCKPT, errno, name);
+		return FAIL;
+	}
+	return SUCCEED;
+}
 
-					}
-				}
+/**
+ * \ingroup dblib_bcp_internal
+ * \brief Record the position of the last batch committed.
+ *
+ * \return SUCCEED or FAIL.
+ */
+static RETCODE
+_bcp_write_checkpoint(DBPROCESS * dbproc, BCP_HOSTREADER * reader)
+{
+	if (!reader->checkpoint)
+		return SUCCEED;
 
-				row_end = ftello(hostfile);
+	if (fprintf(reader->checkpoint, "%d %" PRId64 "\n", reader->sent.row, reader->sent.offset) < 0
+	    || fflush(reader->checkpoint) != 0) {
+		dbperror(dbproc, SYBEBCKPT, errno, dbproc->hostfileinfo->checkpoint);
+		return FAIL;
+	}
+	return SUCCEED;
+}
 
-				/* error data can be very long so split in chunks */
-				error_row_size = row_end - row_start;
-				fseeko(hostfile, row_start, SEEK_SET);
+/**
+ * \ingroup dblib_bcp_internal
+ * \brief Send a row read from the data file, committing batches.
+ *
+ * \param dbproc contains all information needed by db-lib to manage communications with the server.
+ * \param reader data file being read
+ * \param pos position after the row
+ * \param rows_written_so_far rows sent in current batch
+ * \param rows_copied rows committed
+ *
+ * \return SUCCEED or FAIL if a batch cannot be committed.
+ */
+static RETCODE
+_bcp_send_hostrow(DBPROCESS * dbproc, BCP_HOSTREADER * reader, const BCP_HOSTPOS * pos,
+		  int *rows_written_so_far, DBINT * rows_copied)
+{
+	TDSSOCKET *tds = dbproc->tds_socket;
 
-				while (error_row_size > 0) {
-					size_t chunk = TDS_MIN((size_t) error_row_size, chunk_size);
+	reader->sent = *pos;
+	if (TDS_FAILED(tds_bcp_send_record(tds, dbproc->bcpinfo, _bcp_no_get_col_data, _bcp_null_error, 0)))
+		return SUCCEED;
 
-					if (!row_in_error) {
-						if ((row_in_error = tds_new(char, chunk)) == NULL) {
-							dbperror(dbproc, SYBEMEM, errno);
-						}
-					}
+	(*rows_written_so_far)++;
 
-					if (fread(row_in_error, chunk, 1, hostfile) != 1) {
-						tdsdump_log(TDS_DBG_ERROR, "BILL fread failed after fseek\n");
-					}
-					count = (int)fwrite(row_in_error, chunk, 1, errfile);
-					if( (size_t)count < chunk ) {
-						dbperror(dbproc, SYBEBWEF, errno);
-					}
-					error_row_size -= chunk;
-				}
-				free(row_in_error);
+	if (dbproc->hostfileinfo->batch > 0 && *rows_written_so_far == dbproc->hostfileinfo->batch) {
+		if (TDS_FAILED(tds_bcp_done(tds, rows_written_so_far)))
+			return FAIL;
 
-				fseeko(hostfile, row_end, SEEK_SET);
-				count = fprintf(errfile, "\n");
-				if( count < 0 ) {
-					dbperror(dbproc, SYBEBWEF, errno);
-				}
-			}
-			row_error_count++;
-			if (row_error_count >= dbproc->hostfileinfo->maxerrs)
-				break;
+		*rows_copied += *rows_written_so_far;
+		*rows_written_so_far = 0;
+
+		dbperror(dbproc, SYBEBBCI, 0); /* batch copied to server */
+
+		if (_bcp_write_checkpoint(dbproc, reader) == FAIL)
+			return FAIL;
+
+		tds_bcp_start(tds, dbproc->bcpinfo);
+	}
+	return SUCCEED;
+}
+
+#ifdef TDS_HAVE_MUTEX
+/** number of batches of rows which can be read ahead */
+#define BCP_PIPELINE_BATCHES 2
+/** rows in a batch */
+#define BCP_PIPELINE_ROWS 256
+
+typedef struct
+{
+	int num_rows;
+	/** data of rows, BCP_PIPELINE_ROWS * number of columns */
+	BCPCOLDATA **rows;
+	/** position after every row */
+	BCP_HOSTPOS pos[BCP_PIPELINE_ROWS];
+	/** errors found reading these rows */
+	BCP_HOSTERRORS errors;
+} BCP_PIPELINE_BATCH;
+
+/** rows read by a thread while other rows are sent */
+typedef struct
+{
+	DBPROCESS *dbproc;
+	BCP_HOSTREADER *reader;
+	int num_cols;
+	tds_mutex mtx;
+	tds_condition cond;
+	/** batches filled by reader, protected by mtx */
+	unsigned int produced;
+	/** batches sent, protected by mtx */
+	unsigned int consumed;
+	/** reader finished, protected by mtx */
+	bool done;
+	/** sender failed, reader should stop, protected by mtx */
+	bool cancel;
+	/** result of last read */
+	STATUS ret;
+	/** context used by reader, errors are recorded in the batch being read */
+	TDSCONTEXT tds_ctx;
+	/** socket used by reader for character conversions, never connected */
+	TDSSOCKET *tds;
+	BCP_PIPELINE_BATCH batches[BCP_PIPELINE_BATCHES];
+} BCP_PIPELINE;
+
+/**
+ * \ingroup dblib_bcp_internal
+ * \brief Allocate a buffer to store a column of a row read ahead.
+ */
+static BCPCOLDATA *
+_bcp_alloc_row_coldata(TDSCOLUMN * bcpcol)
+{
+	BCPCOLDATA *coldata;
+	TDS_SERVER_TYPE desttype = tds_get_conversion_type(bcpcol->column_type, bcpcol->column_size);
+
+	if (is_numeric_type(bcpcol->column_type)) {
+		coldata = tds_alloc_bcp_column_data(sizeof(TDS_NUMERIC));
+		if (coldata)
+			memcpy(coldata->data, bcpcol->bcp_column_data->data, sizeof(TDS_NUMERIC));
+		return coldata;
+	}
+
+	/* variable data are allocated during conversion */
+	if (is_variable_type(desttype))
+		return tds_alloc_bcp_column_data(1);
+	return tds_alloc_bcp_column_data(TDS_MAX(bcpcol->column_size, bcpcol->on_server.column_size));
+}
+
+static void
+_bcp_free_pipeline(BCP_PIPELINE * pipeline)
+{
+	int i, n;
+
+	for (i = 0; i < BCP_PIPELINE_BATCHES; ++i) {
+		BCPCOLDATA **rows = pipeline->batches[i].rows;
+
+		free(pipeline->batches[i].errors.errors);
+		if (!rows)
 			continue;
+		for (n = 0; n < BCP_PIPELINE_ROWS * pipeline->num_cols; ++n)
+			tds_free_bcp_column_data(rows[n]);
+		free(rows);
+	}
+	tds_free_socket(pipeline->tds);
+	tds_cond_destroy(&pipeline->cond);
+	tds_mutex_free(&pipeline->mtx);
+	free(pipeline);
+}
+
+/**
+ * \ingroup dblib_bcp_internal
+ * \brief Error handler of the reader thread, errors are recorded in the batch being read.
+ */
+static int
+_bcp_pipeline_err_handler(const TDSCONTEXT * tds_ctx, TDSSOCKET * tds TDS_UNUSED, TDSMESSAGE * msg)
+{
+	BCP_PIPELINE *pipeline = (BCP_PIPELINE *) tds_ctx->parent;
+
+	_bcp_host_error(pipeline->dbproc, pipeline->reader, msg->msgno, msg->oserr);
+	return TDS_INT_CANCEL;
+}
+
+static BCP_PIPELINE *
+_bcp_alloc_pipeline(DBPROCESS * dbproc, BCP_HOSTREADER * reader)
+{
+	BCP_PIPELINE *pipeline;
+	TDSRESULTINFO *bindinfo = dbproc->bcpinfo->bindinfo;
+	int i, n;
+
+	pipeline = tds_new0(BCP_PIPELINE, 1);
+	if (!pipeline)
+		return NULL;
+	if (tds_mutex_init(&pipeline->mtx)) {
+		free(pipeline);
+		return NULL;
+	}
+	if (tds_cond_init(&pipeline->cond)) {
+		tds_mutex_free(&pipeline->mtx);
+		free(pipeline);
+		return NULL;
+	}
+	pipeline->dbproc = dbproc;
+	pipeline->reader = reader;
+	pipeline->num_cols = bindinfo->num_cols;
+	pipeline->ret = FAIL;
+
+	/* same locale and settings, errors go to the batch */
+	pipeline->tds_ctx = *reader->tds_ctx;
+	pipeline->tds_ctx.parent = pipeline;
+	pipeline->tds_ctx.msg_handler = NULL;
+	pipeline->tds_ctx.err_handler = _bcp_pipeline_err_handler;
+	pipeline->tds_ctx.int_handler = NULL;
+	if (!(pipeline->tds = tds_alloc_socket(&pipeline->tds_ctx, 512)))
+		goto error;
+
+	for (i = 0; i < BCP_PIPELINE_BATCHES; ++i) {
+		BCPCOLDATA **rows = tds_new0(BCPCOLDATA *, BCP_PIPELINE_ROWS * pipeline->num_cols);
+
+		pipeline->batches[i].rows = rows;
+		if (!rows)
+			goto error;
+		for (n = 0; n < BCP_PIPELINE_ROWS * pipeline->num_cols; ++n)
+			if ((rows[n] = _bcp_alloc_row_coldata(bindinfo->columns[n % pipeline->num_cols])) == NULL)
+				goto error;
+	}
+	return pipeline;
+
+error:
+	_bcp_free_pipeline(pipeline);
+	return NULL;
+}
+
+/**
+ * \ingroup dblib_bcp_internal
+ * \brief Thread reading batches of rows from the data file.
+ */
+static TDS_THREAD_PROC_DECLARE(_bcp_pipeline_reader, arg)
+{
+	BCP_PIPELINE *pipeline = (BCP_PIPELINE *) arg;
+	BCP_HOSTREADER *reader = pipeline->reader;
+	STATUS ret = MORE_ROWS;
+
+	/* do not use the socket of the sending thread */
+	reader->tds_ctx = &pipeline->tds_ctx;
+	reader->tds = pipeline->tds;
+
+	while (ret == MORE_ROWS) {
+		BCP_PIPELINE_BATCH *batch;
+
+		/* wait a free batch */
+		tds_mutex_lock(&pipeline->mtx);
+		while (pipeline->produced - pipeline->consumed >= BCP_PIPELINE_BATCHES && !pipeline->cancel)
+			tds_cond_wait(&pipeline->cond, &pipeline->mtx);
+		if (pipeline->cancel) {
+			tds_mutex_unlock(&pipeline->mtx);
+			break;
+		}
+		tds_mutex_unlock(&pipeline->mtx);
+
+		batch = &pipeline->batches[pipeline->produced % BCP_PIPELINE_BATCHES];
+		batch->errors.num_errors = 0;
+		reader->errors = &batch->errors;
+		for (batch->num_rows = 0; batch->num_rows < BCP_PIPELINE_ROWS; ++batch->num_rows) {
+			ret = _bcp_next_row(pipeline->dbproc, reader,
+					    batch->rows + batch->num_rows * pipeline->num_cols,
+					    &batch->pos[batch->num_rows]);
+			if (ret != MORE_ROWS)
+				break;
 		}
 
-		if (skip)
-			continue;
+		tds_mutex_lock(&pipeline->mtx);
+		pipeline->produced++;
+		if (ret != MORE_ROWS) {
+			pipeline->ret = ret;
+			pipeline->done = true;
+		}
+		tds_cond_signal(&pipeline->cond);
+		tds_mutex_unlock(&pipeline->mtx);
+	}
+	return TDS_THREAD_RESULT(0);
+}
 
-		if (TDS_SUCCEED(tds_bcp_send_record(dbproc->tds_socket, dbproc->bcpinfo,
-						    _bcp_no_get_col_data, _bcp_null_error, 0))) {
+/**
+ * \ingroup dblib_bcp_internal
+ * \brief Raise errors recorded by the reader thread up to a row of the data file.
+ *
+ * \param dbproc contains all information needed by db-lib to manage communications with the server.
+ * \param errors errors recorded
+ * \param next first error not raised yet
+ * \param row last row of the data file read
+ *
+ * \return first error not raised yet.
+ */
+static int
+_bcp_raise_host_errors(DBPROCESS * dbproc, const BCP_HOSTERRORS * errors, int next, int row)
+{
+	for (; next < errors->num_errors && errors->errors[next].row <= row; ++next) {
+		const BCP_HOSTERROR *err = &errors->errors[next];
 
-			rows_written_so_far++;
+		tdsdump_log(TDS_DBG_INFO1, "bcp: error %d reading row %d column %d\n", err->msgno, err->row, err->column);
+		dbperror(dbproc, err->msgno, err->oserr);
+	}
+	return next;
+}
 
-			if (dbproc->hostfileinfo->batch > 0 && rows_written_so_far == dbproc->hostfileinfo->batch) {
-				if (TDS_FAILED(tds_bcp_done(tds, &rows_written_so_far))) {
-					if (errfile)
-						fclose(errfile);
-					fclose(hostfile);
-					return FAIL;
-				}
+/**
+ * \ingroup dblib_bcp_internal
+ * \brief Send rows read by another thread.
+ *
+ * \param dbproc contains all information needed by db-lib to manage communications with the server.
+ * \param pipeline pipeline with reader thread
+ * \param coldata original data of columns, restored at the end
+ * \param rows_written_so_far rows sent in current batch
+ * \param rows_copied rows committed
+ *
+ * \return SUCCEED or FAIL if a batch cannot be committed.
+ */
+static RETCODE
+_bcp_pipeline_send(DBPROCESS * dbproc, BCP_PIPELINE * pipeline, BCPCOLDATA ** coldata,
+		   int *rows_written_so_far, DBINT * rows_copied)
+{
+	TDSRESULTINFO *bindinfo = dbproc->bcpinfo->bindinfo;
+	RETCODE rc = SUCCEED;
+	bool finished = false;
+	int i, col, next_error;
+
+	while (!finished) {
+		BCP_PIPELINE_BATCH *batch;
+
+		/* wait rows to send */
+		tds_mutex_lock(&pipeline->mtx);
+		while (pipeline->consumed == pipeline->produced)
+			tds_cond_wait(&pipeline->cond, &pipeline->mtx);
+		tds_mutex_unlock(&pipeline->mtx);
+
+		batch = &pipeline->batches[pipeline->consumed % BCP_PIPELINE_BATCHES];
+		next_error = 0;
+		for (i = 0; i < batch->num_rows && rc == SUCCEED; ++i) {
+			BCPCOLDATA **row = batch->rows + i * pipeline->num_cols;
+
+			/* errors found reading up to this row, as if read by this thread */
+			next_error = _bcp_raise_host_errors(dbproc, &batch->errors, next_error, batch->pos[i].row);
+			for (col = 0; col < pipeline->num_cols; ++col)
+				bindinfo->columns[col]->bcp_column_data = row[col];
+			rc = _bcp_send_hostrow(dbproc, pipeline->reader, &batch->pos[i],
+					       rows_written_so_far, rows_copied);
+		}
+		if (rc == SUCCEED)
+			_bcp_raise_host_errors(dbproc, &batch->errors, next_error, 0x7FFFFFFF);
 
-				*rows_copied += rows_written_so_far;
-				rows_written_so_far = 0;
+		tds_mutex_lock(&pipeline->mtx);
+		pipeline->consumed++;
+		if (rc == FAIL)
+			pipeline->cancel = true;
+		finished = pipeline->cancel || (pipeline->done && pipeline->consumed == pipeline->produced);
+		tds_cond_signal(&pipeline->cond);
+		tds_mutex_unlock(&pipeline->mtx);
+	}
 
-				dbperror(dbproc, SYBEBBCI, 0); /* batch copied to server */
+	for (col = 0; col < pipeline->num_cols; ++col)
+		bindinfo->columns[col]->bcp_column_data = coldata[col];
+	return rc;
+}
+#endif
 
-				tds_bcp_start(tds, dbproc->bcpinfo);
-			}
+/** 
+ * \ingroup dblib_bcp_internal
+ * \brief 
+ *
+ * \param dbproc contains all information needed by db-lib to manage communications with the server.
+ * \param rows_copied 
+ * 
+ * \return SUCCEED or FAIL.
+ * \sa 	BCP_SETL(), bcp_batch(), bcp_bind(), bcp_colfmt(), bcp_colfmt_ps(), bcp_collen(), bcp_colptr(), bcp_columns(), bcp_control(), bcp_done(), bcp_exec(), bcp_getl(), bcp_init(), bcp_moretext(), bcp_options(), bcp_readfmt(), bcp_sendrow()
+ */
+static RETCODE
+_bcp_exec_in(DBPROCESS * dbproc, DBINT * rows_copied)
+{
+	FILE *file;
+	TDSSOCKET *tds = dbproc->tds_socket;
+	TDSRESULTINFO *bindinfo;
+	BCP_HOSTREADER reader;
+	BCPCOLDATA **coldata;
+	STATUS ret = FAIL;
+	RETCODE rc = SUCCEED;
+	int i, rows_written_so_far;
+	bool pipelined = false, compressed;
+	
+	tdsdump_log(TDS_DBG_FUNC, "_bcp_exec_in(%p, %p)\n", dbproc, rows_copied);
+	assert(dbproc);
+	assert(rows_copied);
+
+	*rows_copied = 0;
+	memset(&reader, 0, sizeof(reader));
+	reader.tds_ctx = tds_get_ctx(tds);
+	reader.tds = tds;
+	
+	compressed = _bcp_hostfile_compressed(dbproc);
+	if (!(file = fopen(dbproc->hostfileinfo->hostfile, compressed ? "rb" : "r"))) {
+		dbperror(dbproc, SYBEBCUO, 0);
+		return FAIL;
+	}
+
+	if (compressed)
+		reader.hostfile = tds_bcp_hostfile_open_compressed(file);
+	else
+		reader.hostfile = tds_bcp_hostfile_open(file);
+	if (!reader.hostfile) {
+		fclose(file);
+		dbperror(dbproc, SYBEMEM, errno);
+		return FAIL;
+	}
+
+	if (dbproc->hostfileinfo->checkpoint && _bcp_open_checkpoint(dbproc, &reader) == FAIL) {
+		if (reader.checkpoint)
+			fclose(reader.checkpoint);
+		tds_bcp_hostfile_close(reader.hostfile);
+		return FAIL;
+	}
+
+	if (reader.checkpoint && reader.sent.offset >= 0) {
+		/* resume after last batch committed, never send again rows already committed */
+		tdsdump_log(TDS_DBG_INFO1, "bcp_exec resuming after row %d at offset %" PRId64 "\n",
+			    reader.sent.row, reader.sent.offset);
+		reader.row_of_hostfile = reader.sent.row;
+		if (TDS_FAILED(tds_bcp_hostfile_seek(reader.hostfile, reader.sent.offset))) {
+			dbperror(dbproc, SYBEBCKPT, errno, dbproc->hostfileinfo->checkpoint);
+			fclose(reader.checkpoint);
+			tds_bcp_hostfile_close(reader.hostfile);
+			return FAIL;
+		}
+	} else if (dbproc->hostfileinfo->start_offset > 0) {
+		if (TDS_FAILED(tds_bcp_hostfile_seek(reader.hostfile, dbproc->hostfileinfo->start_offset))) {
+			dbperror(dbproc, SYBEBCRE, errno);
+			if (reader.checkpoint)
+				fclose(reader.checkpoint);
+			tds_bcp_hostfile_close(reader.hostfile);
+			return FAIL;
 		}
 	}
+
+	if (TDS_FAILED(tds_bcp_start_copy_in(tds, dbproc->bcpinfo))) {
+		if (reader.checkpoint)
+			fclose(reader.checkpoint);
+		tds_bcp_hostfile_close(reader.hostfile);
+		return FAIL;
+	}
+
+	/* data of columns, rows are read here if not pipelined */
+	bindinfo = dbproc->bcpinfo->bindinfo;
+	if (!(coldata = tds_new(BCPCOLDATA *, TDS_MAX(bindinfo->num_cols, 1)))) {
+		if (reader.checkpoint)
+			fclose(reader.checkpoint);
+		tds_bcp_hostfile_close(reader.hostfile);
+		dbperror(dbproc, SYBEMEM, errno);
+		return FAIL;
+	}
+	for (i = 0; i < bindinfo->num_cols; i++)
+		coldata[i] = bindinfo->columns[i]->bcp_column_data;
+
+	rows_written_so_far = 0;
+
+	dbproc->bcpinfo->parent = dbproc;
+
+#ifdef TDS_HAVE_MUTEX
+	if (dbproc->hostfileinfo->pipeline) {
+		BCP_PIPELINE *pipeline = _bcp_alloc_pipeline(dbproc, &reader);
+		tds_thread th;
+
+		if (pipeline && tds_thread_create(&th, _bcp_pipeline_reader, pipeline) == 0) {
+			tdsdump_log(TDS_DBG_INFO1, "bcp_exec reading data file in a separate thread\n");
+			pipelined = true;
+			rc = _bcp_pipeline_send(dbproc, pipeline, coldata, &rows_written_so_far, rows_copied);
+			tds_thread_join(th, NULL);
+			ret = pipeline->ret;
+		}
+		if (pipeline)
+			_bcp_free_pipeline(pipeline);
+	}
+#endif
+
+	while (!pipelined) {
+		BCP_HOSTPOS pos;
+
+		ret = _bcp_next_row(dbproc, &reader, coldata, &pos);
+		if (ret != MORE_ROWS)
+			break;
+
+		if ((rc = _bcp_send_hostrow(dbproc, &reader, &pos, &rows_written_so_far, rows_copied)) == FAIL)
+			break;
+	}
+	free(coldata);
+
+	if (rc == FAIL) {
+		if (reader.checkpoint)
+			fclose(reader.checkpoint);
+		if (reader.errfile)
+			fclose(reader.errfile);
+		tds_bcp_hostfile_close(reader.hostfile);
+		return FAIL;
+	}
 	
-	if (row_error_count == 0 && row_of_hostfile < dbproc->hostfileinfo->firstrow) {
+	if (reader.row_error_count == 0 && reader.row_of_hostfile < dbproc->hostfileinfo->firstrow) {
 		/* "The BCP hostfile '%1!' contains only %2! rows.  */
-		dbperror(dbproc, SYBEBCSA, 0, dbproc->hostfileinfo->hostfile, row_of_hostfile); 
+		dbperror(dbproc, SYBEBCSA, 0, dbproc->hostfileinfo->hostfile, reader.row_of_hostfile); 
 	}
 
-	if (errfile &&  0 != fclose(errfile) ) {
+	if (reader.errfile &&  0 != fclose(reader.errfile) ) {
 		dbperror(dbproc, SYBEBUCE, 0);
 	}
 
-	if (fclose(hostfile) != 0) {
+	if (tds_bcp_hostfile_close(reader.hostfile) != 0) {
 		dbperror(dbproc, SYBEBCUC, 0);
 		ret = FAIL;
 	}
 
-	tds_bcp_done(tds, &rows_written_so_far);
+	if (TDS_SUCCEED(tds_bcp_done(tds, &rows_written_so_far)) && rows_written_so_far > 0
+	    && _bcp_write_checkpoint(dbproc, &reader) == FAIL)
+		ret = FAIL;
 	*rows_copied += rows_written_so_far;
 
+	if (reader.checkpoint)
+		fclose(reader.checkpoint);
+
 	return ret == NO_MORE_ROWS? SUCCEED : FAIL;	/* (ret is returned from _bcp_read_hostfile) */
 }
 
@@ -1611,7 +2519,7 @@ _bcp_exec_in(DBPROCESS * dbproc, DBINT * rows_copied)
  *
  * \return SUCCEED or FAIL.
  * \sa 	bcp_batch(), bcp_bind(), bcp_colfmt(), bcp_collen(), bcp_colptr(), bcp_columns(),
- *	bcp_control(), bcp_done(), bcp_init(), bcp_sendrow()
+ *	bcp_checkpoint(), bcp_control(), bcp_done(), bcp_init(), bcp_sendrow()
  */
 RETCODE
 bcp_exec(DBPROCESS * dbproc, DBINT *rows_copied)
@@ -2189,7 +3097,7 @@ _bcp_get_col_data(TDSBCPINFO *bcpinfo, TDSCOLUMN *bindcol, int offset TDS_UNUSED
 	int bytes_read;
 	BYTE *dataptr;
 	DBPROCESS *dbproc = (DBPROCESS *) bcpinfo->parent;
-	TDSRET rc;
+	TDS_INT len;
 
 	tdsdump_log(TDS_DBG_FUNC, "_bcp_get_col_data(%p, %p)\n", bcpinfo, bindcol);
 	CHECK_CONN(TDS_FAIL);
@@ -2255,11 +3163,13 @@ _bcp_get_col_data(TDSBCPINFO *bcpinfo, TDSCOLUMN *bindcol, int offset TDS_UNUSED
 	if (collen < 0)
 		collen = (int) strlen((char *) dataptr);
 
-	rc = _bcp_convert_in(dbproc, coltype, (const TDS_CHAR*) dataptr, collen,
-					    desttype, bindcol->bcp_column_data);
-	if (TDS_FAILED(rc))
-		return rc;
-	rtrim_bcpcol(bindcol);
+	len = _bcp_convert_in(tds_get_ctx(dbproc->tds_socket), coltype, (const TDS_CHAR*) dataptr, collen,
+			      desttype, bindcol->bcp_column_data);
+	if (len < 0) {
+		_dblib_convert_err(dbproc, len);
+		return TDS_FAIL;
+	}
+	rtrim_bcpcol(bindcol, bindcol->bcp_column_data);
 
 	return TDS_SUCCESS;
 
@@ -2383,6 +3293,7 @@ _bcp_free_storage(DBPROCESS * dbproc)
 	if (dbproc->hostfileinfo) {
 		TDS_ZERO_FREE(dbproc->hostfileinfo->hostfile);
 		TDS_ZERO_FREE(dbproc->hostfileinfo->errorfile);
+		TDS_ZERO_FREE(dbproc->hostfileinfo->checkpoint);
 		_bcp_free_columns(dbproc);
 		TDS_ZERO_FREE(dbproc->hostfileinfo);
 	}
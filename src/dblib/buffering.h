@@ -7,8 +7,32 @@ typedef struct dblib_buffer_row {
 	DBINT row;
 	/** save old sizes */
 	TDS_INT *sizes;
+	/** sizes and row_data are stored in DBPROC_ROWBUF::arena */
+	bool in_arena;
 } DBLIB_BUFFER_ROW;
 
+/** How values of a bound column are copied to host variables */
+typedef enum {
+	BIND_PLAN_GENERIC,	/**< use copy_data_to_host_var() */
+	BIND_PLAN_COPY,		/**< same fixed type, copy the value */
+	BIND_PLAN_CONVERT,	/**< fixed type, convert with a resolved converter */
+	BIND_PLAN_NTBSTRING,	/**< characters to NTBSTRINGBIND */
+} DBLIB_BIND_KIND;
+
+/** Bind of a column of regular rows, resolved once per result */
+typedef struct dblib_bind_plan {
+	TDSCOLUMN *col;
+	TDS_SERVER_TYPE srctype;
+	DBLIB_BIND_KIND kind;
+	/** data is a TDSBLOB */
+	bool blob;
+	/** bytes of value for BIND_PLAN_COPY */
+	TDS_INT size;
+	/** NULL value for fixed types */
+	const NULLREP *nullrep;
+	TDS_CONVERTER conv;
+} DBLIB_BIND_PLAN;
+
 static void buffer_struct_print(const DBPROC_ROWBUF *buf);
 static RETCODE buffer_save_row(DBPROCESS *dbproc);
 static DBLIB_BUFFER_ROW* buffer_row_address(const DBPROC_ROWBUF * buf, int idx);
@@ -19,6 +43,7 @@ static void buffer_check_row_empty(DBLIB_BUFFER_ROW *row)
 	assert(row->resinfo == NULL);
 	assert(row->row_data == NULL);
 	assert(row->sizes == NULL);
+	assert(!row->in_arena);
 	assert(row->row == 0);
 }
 
@@ -103,6 +128,12 @@ static void buffer_check(const DBPROC_ROWBUF *buf)
  *
  * Whether or not buffering is active is governed by  
  * dbproc->dbopts[DBBUFFER].optactive.  
+ *
+ * Sizes and data of rows are copied in DBPROC_ROWBUF::arena, a slot
+ * for each element of the ring, so buffering rows does not allocate
+ * memory.  Only blob data is allocated separately.  The arena grows
+ * up to capacity slots while the ring is filled the first time.
+ * Rows larger than a slot (like compute rows) are allocated apart.
  */
 
 /** 
@@ -149,9 +180,35 @@ buffer_index_valid(const DBPROC_ROWBUF *buf, int idx)
 }
 #endif
 
+/**
+ * Free blob data of a row saved in the arena.
+ */
+static void
+buffer_free_blobs(const TDSRESULTINFO *resinfo, unsigned char *row_data)
+{
+	int i;
+
+	for (i = 0; i < resinfo->num_cols; ++i) {
+		const TDSCOLUMN *col = resinfo->columns[i];
+
+		if (is_blob_col(col)) {
+			TDSBLOB *blob = (TDSBLOB *) &row_data[col->column_data - resinfo->current_row];
+
+			TDS_ZERO_FREE(blob->textvalue);
+		}
+	}
+}
+
 static void
 buffer_free_row(DBLIB_BUFFER_ROW *row)
 {
+	if (row->in_arena) {
+		if (row->row_data)
+			buffer_free_blobs(row->resinfo, row->row_data);
+		row->row_data = NULL;
+		row->sizes = NULL;
+		row->in_arena = false;
+	}
 	if (row->sizes)
 		TDS_ZERO_FREE(row->sizes);
 	if (row->row_data) {
@@ -183,9 +240,69 @@ buffer_free(DBPROC_ROWBUF *buf)
 			buffer_free_row(&buf->rows[i]);
 		TDS_ZERO_FREE(buf->rows);
 	}
+	TDS_ZERO_FREE(buf->arena);
+	buf->slot_size = 0;
+	buf->arena_slots = 0;
+	TDS_ZERO_FREE(buf->plans);
+	buf->num_plans = 0;
+	buf->plans_res = NULL;
 	BUFFER_CHECK(buf);
 }
 
+/**
+ * Bytes used by sizes at the start of an arena slot, row data follows aligned.
+ */
+static size_t
+buffer_sizes_len(const TDSRESULTINFO *resinfo)
+{
+	size_t len = resinfo->num_cols * sizeof(TDS_INT);
+
+	return (len + TDS_ALIGN_SIZE - 1) / TDS_ALIGN_SIZE * TDS_ALIGN_SIZE;
+}
+
+/**
+ * Return the arena slot to store a row, NULL if the row does not fit.
+ * The slot size is set by the first row stored.
+ */
+static unsigned char *
+buffer_arena_slot(DBPROC_ROWBUF *buf, int idx, const TDSRESULTINFO *resinfo)
+{
+	size_t len = buffer_sizes_len(resinfo) + resinfo->row_size;
+
+	if (!buf->arena_slots) {
+		len = (len + TDS_ALIGN_SIZE - 1) / TDS_ALIGN_SIZE * TDS_ALIGN_SIZE;
+		buf->slot_size = TDS_MAX(len, TDS_ALIGN_SIZE);
+	}
+	if (len > buf->slot_size)
+		return NULL;
+
+	if (idx >= buf->arena_slots) {
+		int i, slots = TDS_MIN(TDS_MAX(idx + 1, buf->arena_slots * 2), buf->capacity);
+		unsigned char *arena;
+
+		slots = TDS_MAX(slots, TDS_MIN(buf->capacity, 16));
+		if ((size_t) slots > ((size_t) -1) / buf->slot_size)
+			return NULL;
+		arena = (unsigned char *) realloc(buf->arena, slots * buf->slot_size);
+		if (!arena)
+			return NULL;
+
+		/* rows moved with the arena */
+		for (i = 0; i < buf->arena_slots; ++i) {
+			DBLIB_BUFFER_ROW *row = &buf->rows[i];
+
+			if (!row->in_arena)
+				continue;
+			row->sizes = (TDS_INT *) (arena + i * buf->slot_size);
+			if (row->row_data)
+				row->row_data = arena + i * buf->slot_size + buffer_sizes_len(row->resinfo);
+		}
+		buf->arena = arena;
+		buf->arena_slots = slots;
+	}
+	return buf->arena + idx * buf->slot_size;
+}
+
 /*
  * When no rows are currently buffered (and the buffer is allocated)
  * set the indices to their initial positions.
@@ -301,22 +418,210 @@ buffer_delete_rows(DBPROC_ROWBUF * buf,	int count)
 }
 
 /**
- * Transfer data from buffer/tds back to client
+ * Size of a value copied as is to a host variable, 0 if the
+ * type is not fixed or needs more handling.
+ */
+static TDS_INT
+buffer_fixed_size(TDS_SERVER_TYPE type)
+{
+	switch (type) {
+	case SYBINT1:
+	case SYBINT2:
+	case SYBINT4:
+	case SYBINT8:
+	case SYBFLT8:
+	case SYBREAL:
+	case SYBBIT:
+	case SYBMONEY:
+	case SYBMONEY4:
+	case SYBDATETIME:
+	case SYBDATETIME4:
+	case SYBDATE:
+	case SYBTIME:
+	case SYB5BIGDATETIME:
+	case SYB5BIGTIME:
+	case SYBUNIQUE:
+		return tds_get_size_by_type(type);
+	case SYBMSDATE:
+	case SYBMSTIME:
+	case SYBMSDATETIME2:
+	case SYBMSDATETIMEOFFSET:
+		return sizeof(TDS_DATETIMEALL);
+	default:
+		break;
+	}
+	return 0;
+}
+
+/**
+ * Resolve how bound columns of resinfo are copied, so rows don't have
+ * to look at types, null values and conversions again.
+ * Plans are built again after dbbind() or dbnullbind().
+ */
+static bool
+buffer_build_plans(DBPROCESS *dbproc, TDSRESULTINFO *resinfo)
+{
+	DBPROC_ROWBUF *buf = &dbproc->row_buf;
+	DBLIB_BIND_PLAN *plan;
+	int i;
+
+	TDS_ZERO_FREE(buf->plans);
+	buf->num_plans = 0;
+	buf->plans_res = NULL;
+
+	buf->plans = tds_new(DBLIB_BIND_PLAN, TDS_MAX(resinfo->num_cols, 1));
+	if (!buf->plans)
+		return false;
+
+	for (i = 0; i < resinfo->num_cols; ++i) {
+		TDSCOLUMN *curcol = resinfo->columns[i];
+		TDS_SERVER_TYPE desttype;
+		TDS_INT size;
+
+		if (!curcol->column_varaddr && !curcol->column_nullbind)
+			continue;
+
+		plan = &buf->plans[buf->num_plans++];
+		plan->col = curcol;
+		plan->srctype = tds_get_conversion_type(curcol->column_type, curcol->column_size);
+		plan->kind = BIND_PLAN_GENERIC;
+		plan->blob = is_blob_col(curcol);
+		plan->size = 0;
+		plan->nullrep = NULL;
+		if (!curcol->column_varaddr)
+			continue;
+
+		desttype = dblib_bound_type(curcol->column_bindtype);
+		if (curcol->column_bindtype == NTBSTRINGBIND && is_similar_type(plan->srctype, desttype)) {
+			plan->kind = BIND_PLAN_NTBSTRING;
+			continue;
+		}
+		size = buffer_fixed_size(desttype);
+		if (!size)
+			continue;
+
+		plan->nullrep = &dbproc->nullreps[curcol->column_bindtype];
+		if (plan->srctype == desttype) {
+			plan->kind = BIND_PLAN_COPY;
+			plan->size = size;
+		} else {
+			plan->kind = BIND_PLAN_CONVERT;
+			tds_convert_resolve(&plan->conv, plan->srctype, desttype);
+		}
+	}
+	buf->plans_res = resinfo;
+	return true;
+}
+
+/**
+ * Transfer a regular row to host variables using plans.
+ */
+static void
+buffer_transfer_planned(DBPROC_ROWBUF *buf, DBPROCESS * dbproc, const DBLIB_BUFFER_ROW *row, int elem)
+{
+	const DBLIB_BIND_PLAN *plan, *end = buf->plans + buf->num_plans;
+
+	for (plan = buf->plans; plan != end; ++plan) {
+		TDSCOLUMN *curcol = plan->col;
+		DBINT srclen = curcol->column_cur_size;
+		BYTE *src, *dest = (BYTE *) curcol->column_varaddr;
+		DBINT *indicator = (DBINT *) curcol->column_nullbind;
+
+		if (curcol->column_bindstride) {
+			if (dest)
+				dest += (size_t) elem * curcol->column_bindstride;
+			if (indicator)
+				indicator += elem;
+		}
+
+		if (indicator)
+			*indicator = srclen < 0 ? -1 : 0;
+		if (!dest)
+			continue;
+
+		if (srclen <= 0) {
+			if (srclen != 0 && indicator)
+				continue;
+			if (plan->nullrep)
+				memcpy(dest, plan->nullrep->bindval, plan->nullrep->len);
+			else
+				dbgetnull(dbproc, curcol->column_bindtype, curcol->column_bindlen, dest);
+			continue;
+		}
+
+		if (row->row_data)
+			src = &row->row_data[curcol->column_data - row->resinfo->current_row];
+		else
+			src = curcol->column_data;
+		if (plan->blob)
+			src = (BYTE *) ((TDSBLOB *) src)->textvalue;
+
+		switch (plan->kind) {
+		case BIND_PLAN_COPY:
+			memcpy(dest, src, plan->size);
+			break;
+		case BIND_PLAN_CONVERT: {
+			CONV_RESULT cr;
+			TDS_INT len = plan->conv.convert(g_dblib_ctx.tds_ctx, &plan->conv, src, srclen, &cr);
+
+			if (len < 0)
+				_dblib_convert_err(dbproc, len);
+			else
+				memcpy(dest, &cr, len);
+			}
+			break;
+		case BIND_PLAN_NTBSTRING:
+			/* strip trailing blanks, null term */
+			while (srclen && src[srclen - 1] == ' ')
+				--srclen;
+			if (curcol->column_bindlen > 0 && srclen + 1 > curcol->column_bindlen) {
+				dbperror(dbproc, SYBECOFL, 0);
+				if (indicator)
+					*indicator = srclen + 1;
+				srclen = curcol->column_bindlen - 1;
+			}
+			memcpy(dest, src, srclen);
+			dest[srclen] = '\0';
+			break;
+		default:
+			copy_data_to_host_var(dbproc, plan->srctype, src, srclen, dest, curcol->column_bindlen,
+					      curcol->column_bindtype, indicator);
+			break;
+		}
+	}
+}
+
+/**
+ * Transfer data from buffer/tds back to client.
+ * Columns bound to arrays with dbbind_array() receive the data in
+ * element \a elem.
  */
 static void
-buffer_transfer_bound_data(DBPROC_ROWBUF *buf, TDS_INT res_type, TDS_INT compute_id, DBPROCESS * dbproc, int idx)
+buffer_transfer_bound_data(DBPROC_ROWBUF *buf, TDS_INT res_type, TDS_INT compute_id, DBPROCESS * dbproc, int idx, int elem)
 {
 	int i;
-	BYTE *src;
+	BYTE *src, *dest;
+	DBINT *indicator;
 	const DBLIB_BUFFER_ROW *row;
 
-	tdsdump_log(TDS_DBG_FUNC, "buffer_transfer_bound_data(%p %d %d %p %d)\n", buf, res_type, compute_id, dbproc, idx);
+	tdsdump_log(TDS_DBG_FUNC, "buffer_transfer_bound_data(%p %d %d %p %d %d)\n", buf, res_type, compute_id, dbproc, idx, elem);
 	BUFFER_CHECK(buf);
 	assert(buffer_index_valid(buf, idx));
 
 	row = buffer_row_address(buf, idx);
 	assert(row->resinfo);
 
+	/* regular rows use plans, compute rows are rare */
+	if (row->resinfo == dbproc->tds_socket->res_info
+	    && (buf->plans_res == row->resinfo || buffer_build_plans(dbproc, row->resinfo))) {
+		if (row->sizes) {
+			for (i = 0; i < row->resinfo->num_cols; i++)
+				row->resinfo->columns[i]->column_cur_size = row->sizes[i];
+		}
+		buffer_transfer_planned(buf, dbproc, row, elem);
+		goto done;
+	}
+
 	for (i = 0; i < row->resinfo->num_cols; i++) {
 		TDS_SERVER_TYPE srctype;
 		DBINT srclen;
@@ -327,20 +632,28 @@ buffer_transfer_bound_data(DBPROC_ROWBUF *buf, TDS_INT res_type, TDS_INT compute
 
 		srclen = curcol->column_cur_size;
 
-		if (curcol->column_nullbind) {
+		dest = (BYTE *) curcol->column_varaddr;
+		indicator = (DBINT *) curcol->column_nullbind;
+		if (curcol->column_bindstride) {
+			if (dest)
+				dest += (size_t) elem * curcol->column_bindstride;
+			if (indicator)
+				indicator += elem;
+		}
+
+		if (indicator) {
 			if (srclen < 0) {
-				*(DBINT *)(curcol->column_nullbind) = -1;
+				*indicator = -1;
 			} else {
-				*(DBINT *)(curcol->column_nullbind) = 0;
+				*indicator = 0;
 			}
 		}
-		if (!curcol->column_varaddr)
+		if (!dest)
 			continue;
 
 		if (srclen <= 0) {
-			if (srclen == 0 || !curcol->column_nullbind)
-				dbgetnull(dbproc, curcol->column_bindtype, curcol->column_bindlen,
-						(BYTE *) curcol->column_varaddr);
+			if (srclen == 0 || !indicator)
+				dbgetnull(dbproc, curcol->column_bindtype, curcol->column_bindlen, dest);
 			continue;
 		}
 
@@ -353,11 +666,11 @@ buffer_transfer_bound_data(DBPROC_ROWBUF *buf, TDS_INT res_type, TDS_INT compute
 		if (is_blob_col(curcol))
 			src = (BYTE *) ((TDSBLOB *) src)->textvalue;
 
-		copy_data_to_host_var(dbproc, srctype, src, srclen,
-					(BYTE *) curcol->column_varaddr,  curcol->column_bindlen,
-						 curcol->column_bindtype, (DBINT*) curcol->column_nullbind);
+		copy_data_to_host_var(dbproc, srctype, src, srclen, dest, curcol->column_bindlen,
+				      curcol->column_bindtype, indicator);
 	}
 
+done:
 	/*
 	 * This function always bumps current.  Usually, it's called 
 	 * by dbnextrow(), so bumping current is a pretty obvious choice.  
@@ -488,6 +801,7 @@ buffer_add_row(DBPROCESS *dbproc, TDSRESULTINFO *resinfo)
 {
 	DBPROC_ROWBUF *buf = &dbproc->row_buf;
 	DBLIB_BUFFER_ROW *row;
+	unsigned char *slot;
 	int i;
 
 	assert(buf->capacity >= 0);
@@ -498,18 +812,19 @@ buffer_add_row(DBPROCESS *dbproc, TDSRESULTINFO *resinfo)
 	row = buffer_row_address(buf, buf->head);
 
 	/* bump the row number, write it, and move the data to head */
-	if (row->resinfo) {
-		tds_free_row(row->resinfo, row->row_data);
-		tds_free_results(row->resinfo);
-	}
+	if (row->resinfo)
+		buffer_free_row(row);
 	row->row = ++buf->received;
 	++resinfo->ref_count;
 	row->resinfo = resinfo;
 	row->row_data = NULL;
-	if (row->sizes)
-		free(row->sizes);
-	row->sizes = tds_new0(TDS_INT, resinfo->num_cols);
-	for (i = 0; i < resinfo->num_cols; ++i)
+	if ((slot = buffer_arena_slot(buf, buf->head, resinfo)) != NULL) {
+		row->sizes = (TDS_INT *) slot;
+		row->in_arena = true;
+	} else {
+		row->sizes = tds_new0(TDS_INT, resinfo->num_cols);
+	}
+	for (i = 0; row->sizes && i < resinfo->num_cols; ++i)
 		row->sizes[i] = resinfo->columns[i]->column_cur_size;
 
 	/* initial condition is head == 0 and tail == capacity */
@@ -544,7 +859,20 @@ buffer_save_row(DBPROCESS *dbproc)
 	if (idx >= 0 && idx < buf->capacity) {
 		row = &buf->rows[idx];
 
-		if (row->resinfo && !row->row_data) {
+		if (row->resinfo && row->in_arena && !row->row_data) {
+			TDSRESULTINFO *resinfo = row->resinfo;
+			int i;
+
+			/* copy data in the arena, blobs are moved */
+			row->row_data = (unsigned char *) row->sizes + buffer_sizes_len(resinfo);
+			memcpy(row->row_data, resinfo->current_row, resinfo->row_size);
+			for (i = 0; i < resinfo->num_cols; ++i) {
+				TDSCOLUMN *col = resinfo->columns[i];
+
+				if (is_blob_col(col))
+					((TDSBLOB *) col->column_data)->textvalue = NULL;
+			}
+		} else if (row->resinfo && !row->row_data) {
 			row->row_data = row->resinfo->current_row;
 			tds_alloc_row(row->resinfo);
 		}
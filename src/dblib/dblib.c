@@ -66,6 +66,7 @@ static int _get_printable_size(TDSCOLUMN * colinfo);
 static char *_dbprdate(char *timestr);
 static int _dbnullable(DBPROCESS * dbproc, int column);
 static const char *tds_prdatatype(int datatype_token);
+static TDS_SERVER_TYPE dblib_bound_type(int bindtype);
 
 static int default_err_handler(DBPROCESS * dbproc, int severity, int dberr, int oserr, char *dberrstr, char *oserrstr);
 
@@ -265,6 +266,7 @@ dblib_get_tds_ctx(void)
 			/* set default in case there's no locale file */
 			static const char datetime_format[] = "%b %e %Y %l:%M:%S:%z%p";
 			g_dblib_ctx.tds_ctx->locale->datetime_fmt = strdup(datetime_format);
+			tds_locale_compile_date_plans(g_dblib_ctx.tds_ctx->locale);
 		}
 	}
 	tds_mutex_unlock(&dblib_mutex);
@@ -1954,7 +1956,7 @@ dbgetrow(DBPROCESS * dbproc, DBINT row)
 		return NO_MORE_ROWS;
 
 	dbproc->row_buf.current = idx;
-	buffer_transfer_bound_data(&dbproc->row_buf, TDS_ROW_RESULT, 0, dbproc, idx);
+	buffer_transfer_bound_data(&dbproc->row_buf, TDS_ROW_RESULT, 0, dbproc, idx, 0);
 	result = REG_ROW;
 
 	return result;
@@ -2074,19 +2076,14 @@ dbsetrow(DBPROCESS * dbproc, DBINT row)
 }
 
 /**
- * \ingroup dblib_core
- * \brief Read result row into the row buffer and into any bound host variables.
- * 
- * \param dbproc contains all information needed by db-lib to manage communications with the server.
- * \retval REG_ROW regular row has been read.
- * \returns computeid when a compute row is read. 
- * \retval BUF_FULL reading next row would cause the buffer to be exceeded (and buffering is turned on).
- * No row was read from the server
- * \sa dbaltbind(), dbbind(), dbcanquery(), dbclrbuf(), dbgetrow(), dbprrow(), dbsetrow().
+ * \internal
+ * \ingroup dblib_internal
+ * \brief Read next row, regular rows are stored in element \a elem of array bindings.
+ * \sa dbnextrow(), dbnextrows().
  */
 struct pivot_t;
-STATUS
-dbnextrow(DBPROCESS * dbproc)
+static STATUS
+_dbnextrow(DBPROCESS * dbproc, int elem)
 {
 	TDSRESULTINFO *resinfo;
 	TDSSOCKET *tds;
@@ -2096,9 +2093,6 @@ dbnextrow(DBPROCESS * dbproc)
 	int idx; /* row buffer index.  Unless DBUFFER is on, idx will always be 0. */
 	struct pivot_t *pivot;
 
-	tdsdump_log(TDS_DBG_FUNC, "dbnextrow(%p)\n", dbproc);
-	CHECK_CONN(FAIL);
-
 	tds = dbproc->tds_socket;
 	resinfo = tds->res_info;
 
@@ -2183,7 +2177,8 @@ again:
 		/*
 		 * Transfer the data from the row buffer to the bound variables.  
 		 */
-		buffer_transfer_bound_data(&dbproc->row_buf, res_type, computeid, dbproc, idx);
+		buffer_transfer_bound_data(&dbproc->row_buf, res_type, computeid, dbproc, idx,
+					   res_type == TDS_ROW_RESULT ? elem : 0);
 	}
 	
 	if (res_type == TDS_COMPUTE_RESULT) {
@@ -2192,7 +2187,82 @@ again:
 		tdsdump_log(TDS_DBG_FUNC, "leaving dbnextrow() returning %d (%s)\n", result, prdbretcode(result));
 	}
 	return result;
-} /* dbnextrow()  */
+} /* _dbnextrow()  */
+
+/**
+ * \ingroup dblib_core
+ * \brief Read result row into the row buffer and into any bound host variables.
+ * 
+ * \param dbproc contains all information needed by db-lib to manage communications with the server.
+ * \retval REG_ROW regular row has been read.
+ * \returns computeid when a compute row is read. 
+ * \retval BUF_FULL reading next row would cause the buffer to be exceeded (and buffering is turned on).
+ * No row was read from the server
+ * \sa dbaltbind(), dbbind(), dbcanquery(), dbclrbuf(), dbgetrow(), dbnextrows(), dbprrow(), dbsetrow().
+ */
+STATUS
+dbnextrow(DBPROCESS * dbproc)
+{
+	tdsdump_log(TDS_DBG_FUNC, "dbnextrow(%p)\n", dbproc);
+	CHECK_CONN(FAIL);
+
+	return _dbnextrow(dbproc, 0);
+}
+
+/**
+ * \ingroup dblib_core
+ * \brief Read many result rows into arrays bound with dbbind_array(), FreeTDS only.
+ *
+ * \param dbproc contains all information needed by db-lib to manage communications with the server.
+ * \param num_rows maximum number of rows to read, elements of the arrays.
+ * \param rows_read where to store the number of regular rows read, can be NULL.
+ *
+ * \remarks Regular row N is stored in the Nth element of every array, columns
+ *	bound with dbbind() receive the last row read. Rows are also added to the
+ *	row buffer like dbnextrow() does. Reading stops early at the end of the
+ *	results, when the row buffer is full or after a compute row, which is
+ *	stored in the variables bound with dbaltbind(). Pivoted results are read
+ *	one row at a time.
+ * \retval REG_ROW at least a regular row was read, the last read row was a regular row.
+ * \returns computeid when the last row read is a compute row.
+ * \retval NO_MORE_ROWS no more rows.
+ * \retval BUF_FULL row buffer is full, no row was read.
+ * \retval FAIL an error occurred, \a rows_read rows were read before.
+ * \sa dbbind_array(), dbnextrow().
+ */
+STATUS
+dbnextrows(DBPROCESS * dbproc, DBINT num_rows, DBINT * rows_read)
+{
+	STATUS result = NO_MORE_ROWS;
+	DBINT n = 0;
+
+	tdsdump_log(TDS_DBG_FUNC, "dbnextrows(%p, %d, %p)\n", dbproc, num_rows, rows_read);
+	CHECK_CONN(FAIL);
+
+	if (rows_read)
+		*rows_read = 0;
+	if (num_rows <= 0)
+		return FAIL;
+
+	if (dbrows_pivoted(dbproc))
+		num_rows = 1;
+
+	while (n < num_rows) {
+		result = _dbnextrow(dbproc, n);
+		if (result != REG_ROW)
+			break;
+		++n;
+	}
+	if (rows_read)
+		*rows_read = n;
+
+	/* report the rows read, next call will return the condition that stopped us */
+	if (n > 0 && (result == NO_MORE_ROWS || result == BUF_FULL))
+		result = REG_ROW;
+
+	tdsdump_log(TDS_DBG_FUNC, "leaving dbnextrows() returning %d after %d rows\n", result, n);
+	return result;
+}
 
 static TDS_SERVER_TYPE
 dblib_bound_type(int bindtype)
@@ -2710,10 +2780,70 @@ dbbind(DBPROCESS * dbproc, int column, int vartype, DBINT varlen, BYTE * varaddr
 	colinfo->column_varaddr = (char *) varaddr;
 	colinfo->column_bindtype = vartype;
 	colinfo->column_bindlen = varlen;
+	colinfo->column_bindstride = 0;
+	dbproc->row_buf.plans_res = NULL;
 
 	return SUCCEED;
 }				/* dbbind()  */
 
+/**
+ * \ingroup dblib_core
+ * \brief Tie an array of host variables to a resultset column, FreeTDS only.
+ *
+ * \param dbproc contains all information needed by db-lib to manage communications with the server.
+ * \param column Nth column, starting at 1.
+ * \param vartype datatype of the host variables that will receive the data
+ * \param varlen size of every host variable, must be positive for \c CHARBIND,
+ *	\c STRINGBIND, \c NTBSTRINGBIND and \c BINARYBIND.
+ * \param varaddr address of first host variable
+ * \param stride distance in bytes between host variables, 0 for packed variables.
+ * \param indicators array of null indicators, like the ones of dbnullbind(), can be NULL.
+ *
+ * \remarks dbnextrows() stores the Nth row read in the Nth element of the arrays,
+ *	dbnextrow() and dbgetrow() use the first element.
+ * \retval SUCCEED everything worked.
+ * \retval FAIL no such \a column or no such conversion possible, or bad sizes.
+ * \sa dbbind(), dbnextrows(), dbnullbind().
+ */
+RETCODE
+dbbind_array(DBPROCESS * dbproc, int column, int vartype, DBINT varlen, BYTE * varaddr, DBINT stride, DBINT * indicators)
+{
+	TDSCOLUMN *colinfo;
+	DBINT size;
+
+	tdsdump_log(TDS_DBG_FUNC, "dbbind_array(%p, %d, %d, %d, %p, %d, %p)\n",
+		    dbproc, column, vartype, varlen, varaddr, stride, indicators);
+	CHECK_CONN(FAIL);
+
+	switch (vartype) {
+	case CHARBIND:
+	case STRINGBIND:
+	case NTBSTRINGBIND:
+	case BINARYBIND:
+		size = varlen;
+		break;
+	default:
+		size = vartype >= 0 && vartype < MAXBINDTYPES ? (DBINT) default_null_representations[vartype].len : 0;
+		break;
+	}
+	if (stride == 0)
+		stride = size;
+	if (size <= 0 || stride < size) {
+		dbperror(dbproc, SYBEBCVLEN, 0);
+		return FAIL;
+	}
+
+	if (dbbind(dbproc, column, vartype, varlen, varaddr) != SUCCEED)
+		return FAIL;
+
+	colinfo = dbproc->tds_socket->res_info->columns[column - 1];
+	colinfo->column_bindstride = stride;
+	colinfo->column_nullbind = (TDS_SMALLINT *) indicators;
+	dbproc->row_buf.plans_res = NULL;
+
+	return SUCCEED;
+}
+
 /**
  * \ingroup dblib_core
  * \brief set name and location of the \c interfaces file FreeTDS should use to look up a servername.
@@ -2746,6 +2876,7 @@ dbsetifile(char *filename)
  * -  0 \a column bound successfully
  * - -1 \a column is NULL.
  * - >0 true length of data, had \a column not been truncated due to insufficient space in the columns bound host variable .  
+ * \remarks Columns bound with dbbind_array() take their indicators from dbbind_array() and are rejected.
  * \sa dbanullbind(), dbbind(), dbdata(), dbdatlen(), dbnextrow().
  */
 RETCODE
@@ -2759,7 +2890,14 @@ dbnullbind(DBPROCESS * dbproc, int column, DBINT * indicator)
 	if (!colinfo)
 		return FAIL; /* dbcolptr sent SYBECNOR, Column number out of range */
 
+	/* a single indicator would be written past its end by dbnextrows */
+	if (colinfo->column_bindstride) {
+		dbperror(dbproc, SYBEBNDARR, 0);
+		return FAIL;
+	}
+
 	colinfo->column_nullbind = (TDS_SMALLINT *)indicator;
+	dbproc->row_buf.plans_res = NULL;
 	return SUCCEED;
 }
 
@@ -7259,11 +7397,10 @@ dblastrow(DBPROCESS * dbproc)
 
 	tdsdump_log(TDS_DBG_FUNC, "dblastrow(%p)\n", dbproc);
 	CHECK_PARAMETER(dbproc, SYBENULL, 0);
+	/* head is the next slot to fill; when the buffer is full it equals tail */
 	idx = dbproc->row_buf.head;
-	if (dbproc->row_buf.head != dbproc->row_buf.tail) {
-		if (--idx < 0) 
-			idx = dbproc->row_buf.capacity - 1;
-	}
+	if (--idx < 0)
+		idx = dbproc->row_buf.capacity - 1;
 	assert(idx >= 0);
 	return buffer_idx2row(&dbproc->row_buf, idx);
 }
@@ -7848,6 +7985,7 @@ static const DBLIB_ERROR_MESSAGE dblib_error_messages[] =
 						"SYBBINARY, SYBTEXT, or SYBIMAGE\0" }
 	, { SYBEBCITBLEN,       EXPROGRAM,	"bcp_init: tblname parameter is too long\0" }
 	, { SYBEBCITBNM,        EXPROGRAM,	"bcp_init: tblname parameter cannot be NULL\0" }
+	, { SYBEBCKPT,         EXRESOURCE,	"I/O error on bcp checkpoint file '%1!'\0%s" }
 	, { SYBEBCMTXT,         EXPROGRAM,	"bcp_moretext may be used only when there is at least one text or image column in "
 						"the server table\0" }
 	, { SYBEBCNL,          EXNONFATAL,	"Negative length-prefix found in BCP data-file\0" }
@@ -7886,6 +8024,8 @@ static const DBLIB_ERROR_MESSAGE dblib_error_messages[] =
 	, { SYBEBIVI,           EXPROGRAM,	"bcp_columns, bcp_colfmt and bcp_colfmt_ps may be used only after bcp_init has been "
 						"passed a valid input file\0" }
 	, { SYBEBNCR,           EXPROGRAM,	"Attempt to bind user variable to a non-existent compute row\0" }
+	, { SYBEBNDARR,         EXPROGRAM,	"Null indicator of a column bound with dbbind_array must be passed "
+						"to dbbind_array\0" }
 	, { SYBEBNUM,           EXPROGRAM,	"Bad numbytes parameter passed to dbstrcpy\0" }
 	, { SYBEBPKS,           EXPROGRAM,	"In DBSETLPACKET, the packet size parameter must be between 0 and 999999\0" }
 	, { SYBEBPREC,          EXPROGRAM,	"Illegal precision specified\0" }
@@ -8039,6 +8179,7 @@ static const DBLIB_ERROR_MESSAGE dblib_error_messages[] =
 						"the login record's remote password field\0" }
 	, { SYBEPOLL,              EXINFO,	"There is already an active dbpoll\0" }
 	, { SYBEPRTF,              EXINFO,	"dbtracestring may only be called from a printfunc\0" }
+	, { SYBEPVTCOLS,        EXPROGRAM,	"dbpivot result would have more than 65535 columns\0" }
 	, { SYBEPWD,               EXUSER,	"Login incorrect\0" }
 	, { SYBERDCN,        EXCONVERSION,	"Requested data conversion does not exist\0" }
 	, { SYBERDNR,           EXPROGRAM,	"Attempt to retrieve data from a non-existent row\0" }
@@ -89,6 +89,7 @@ struct col_t
 };
 
 static TDS_SERVER_TYPE infer_col_type(int sybtype);
+static bool col_null(const struct col_t *pcol);
 
 static struct col_t *
 col_init(struct col_t *pcol, int sybtype, size_t collen)
@@ -136,6 +137,9 @@ col_equal(const struct col_t *pc1, const struct col_t *pc2)
 	assert( pc1 && pc2 );
 	assert( pc1->type == pc2->type );
 	
+	if (col_null(pc1) || col_null(pc2))
+		return col_null(pc1) && col_null(pc2);
+
 	switch (pc1->type) {
 	
 	case SYBCHAR:
@@ -555,7 +559,10 @@ key_equal(const KEY_T *a, const KEY_T *b)
 static void
 key_free(KEY_T *p)
 {
-	col_free(p->keys);
+	int i;
+
+	for (i = 0; i < p->nkeys; i++)
+		col_free(p->keys + i);
 	free(p->keys);
 	memset(p, 0, sizeof(*p));
 }
@@ -611,105 +618,276 @@ make_col_name(DBPROCESS *dbproc, const KEY_T *k)
 }
 	
 
-typedef struct agg_t
+/*
+ * Hashing.  dbpivot() sees every input row once, so finding the row key,
+ * the column key and the aggregate of a row must not depend on how many
+ * distinct values were seen so far.  Keys are kept in arrays in order of
+ * arrival (that is the order of the output rows and columns) and indexed
+ * by open addressing tables holding 1 + the array index, 0 marking a free slot.
+ */
+
+static unsigned int
+hash_bytes(unsigned int h, const void *p, size_t len)
 {
-	KEY_T row_key, col_key;
-	struct col_t value;
-} AGG_T;
+	const unsigned char *s = (const unsigned char *) p;
 
-#if 0
-static bool
-agg_key_equal(const void *a, const void *b)
+	/* FNV-1a */
+	while (len--)
+		h = (h ^ *s++) * 16777619u;
+	return h;
+}
+
+static unsigned int
+col_hash(const struct col_t *pcol, unsigned int h)
 {
-	int i;
-	const AGG_T *p1 = a, *p2 = b;
-	
-	assert(p1 && p2);
-	assert(p1->row_key.keys  && p2->row_key.keys);
-	assert(p1->row_key.nkeys == p2->row_key.nkeys);
-	
-	for( i=0; i < p1->row_key.nkeys; i++ ) {
-		if (! col_equal(p1->row_key.keys+i, p2->row_key.keys+i))
-			return false;
+	DBFLT8 f;
+	DBREAL r;
+	const char *end;
+
+	if (col_null(pcol))
+		return hash_bytes(h, "\xff", 1);
+
+	switch (pcol->type) {
+	case SYBCHAR:
+	case SYBVARCHAR:
+		/* compare like strncmp() */
+		end = (const char *) memchr(pcol->s, 0, pcol->len);
+		return hash_bytes(h, pcol->s, end ? end - pcol->s : pcol->len);
+	case SYBINT1:
+	case SYBUINT1:
+	case SYBSINT1:
+		return hash_bytes(h, &pcol->data.ti, sizeof(pcol->data.ti));
+	case SYBINT2:
+	case SYBUINT2:
+		return hash_bytes(h, &pcol->data.si, sizeof(pcol->data.si));
+	case SYBINT4:
+	case SYBUINT4:
+		return hash_bytes(h, &pcol->data.i, sizeof(pcol->data.i));
+	case SYBFLT8:
+		/* 0.0 and -0.0 compare equal, so they must hash alike */
+		f = pcol->data.f == 0 ? 0 : pcol->data.f;
+		return hash_bytes(h, &f, sizeof(f));
+	case SYBREAL:
+		r = pcol->data.r == 0 ? 0 : pcol->data.r;
+		return hash_bytes(h, &r, sizeof(r));
+	default:
+		break;
 	}
+	return h;
+}
 
-	return true;
+static unsigned int
+key_hash(const KEY_T *k)
+{
+	unsigned int h = 2166136261u;
+	int i;
+
+	for (i = 0; i < k->nkeys; i++)
+		h = col_hash(k->keys + i, h);
+	return h;
+}
+
+/** distinct keys, in order of arrival */
+typedef struct key_set_t
+{
+	KEY_T *keys;
+	unsigned int *hashes;
+	size_t nkeys, size;
+	size_t *slots;
+	size_t mask;
+} KEY_SET;
+
+static void
+key_set_free(KEY_SET *set)
+{
+	size_t i;
+
+	for (i = 0; i < set->nkeys; i++)
+		key_free(set->keys + i);
+	free(set->keys);
+	free(set->hashes);
+	free(set->slots);
+	memset(set, 0, sizeof(*set));
 }
-#endif
 
 static bool
-agg_next(const AGG_T *p1, const AGG_T *p2)
+key_set_grow(KEY_SET *set)
 {
-	int i;
+	size_t i, nslots = set->slots ? 2 * (set->mask + 1) : 64;
+	size_t *slots = tds_new0(size_t, nslots);
 
-	assert(p1 && p2);
-	
-	if (p1->row_key.keys == NULL || p2->row_key.keys == NULL)
+	if (!slots)
 		return false;
-	
-	assert(p1->row_key.keys  && p2->row_key.keys);
-	assert(p1->row_key.nkeys == p2->row_key.nkeys);
-	
-	assert(p1->col_key.keys  && p2->col_key.keys);
-	assert(p1->col_key.nkeys == p2->col_key.nkeys);
-	
-	for( i=0; i < p1->row_key.nkeys; i++ ) {
-		assert(p1->row_key.keys[i].type);
-		assert(p2->row_key.keys[i].type);
-		if (p1->row_key.keys[i].type != p2->row_key.keys[i].type)
-			return false;
-	}
+	for (i = 0; i < set->nkeys; i++) {
+		size_t n = set->hashes[i] & (nslots - 1);
 
-	for( i=0; i < p1->row_key.nkeys; i++ ) {
-		if (! col_equal(p1->row_key.keys+i, p2->row_key.keys+i))
-			return false;
+		while (slots[n])
+			n = (n + 1) & (nslots - 1);
+		slots[n] = i + 1;
 	}
+	free(set->slots);
+	set->slots = slots;
+	set->mask = nslots - 1;
+	return true;
+}
 
-	for( i=0; i < p1->col_key.nkeys; i++ ) {
-		if (p1->col_key.keys[i].type != p2->col_key.keys[i].type)
-			return false;
+/**
+ * Find @key in @set, adding a copy of it if not present.
+ * Stores in @pidx the index of the key.
+ */
+static bool
+key_set_add(KEY_SET *set, const KEY_T *key, size_t *pidx)
+{
+	unsigned int h = key_hash(key);
+	size_t n;
+
+	/* keep load factor under 1/2 */
+	if (2 * (set->nkeys + 1) > (set->slots ? set->mask + 1 : 0) && !key_set_grow(set))
+		return false;
+
+	for (n = h & set->mask; set->slots[n]; n = (n + 1) & set->mask) {
+		size_t i = set->slots[n] - 1;
+
+		if (set->hashes[i] == h && key_equal(set->keys + i, key)) {
+			*pidx = i;
+			return true;
+		}
 	}
 
-	for( i=0; i < p1->col_key.nkeys; i++ ) {
-		if (! col_equal(p1->col_key.keys+i, p2->col_key.keys+i))
+	if (set->nkeys >= set->size) {
+		size_t size = set->size ? 2 * set->size : 64;
+
+		if (!TDS_RESIZE(set->keys, size) || !TDS_RESIZE(set->hashes, size))
 			return false;
+		set->size = size;
 	}
-
+	if (!key_cpy(set->keys + set->nkeys, key))
+		return false;
+	set->hashes[set->nkeys] = h;
+	set->slots[n] = ++set->nkeys;
+	*pidx = set->nkeys - 1;
 	return true;
 }
 
+/** aggregate of the input rows sharing a row key and a column key */
+typedef struct agg_t
+{
+	size_t row, col;
+	struct col_t value;
+} AGG_T;
+
+/* aggregates are allocated in blocks, never moved once created */
+#define AGG_BLOCK 4096
+
+typedef struct agg_set_t
+{
+	AGG_T **blocks;
+	size_t naggs, nblocks;
+	size_t *slots;
+	size_t mask;
+} AGG_SET;
+
+static AGG_T *
+agg_get(const AGG_SET *set, size_t n)
+{
+	return &set->blocks[n / AGG_BLOCK][n % AGG_BLOCK];
+}
+
+static size_t
+agg_hash(size_t row, size_t col)
+{
+	size_t h = row * 0x9E3779B1u ^ col * 0x85EBCA77u;
+
+	return h ^ (h >> 15);
+}
+
 static void
-agg_free(AGG_T *p)
+agg_set_free(AGG_SET *set)
 {
-	key_free(&p->row_key);
-	key_free(&p->col_key);
-	col_free(&p->value);
+	size_t i;
+
+	for (i = 0; i < set->nblocks; i++)
+		free(set->blocks[i]);
+	free(set->blocks);
+	free(set->slots);
+	memset(set, 0, sizeof(*set));
 }
 
 static bool
-agg_equal(const AGG_T *p1, const AGG_T *p2)
+agg_set_grow(AGG_SET *set)
 {
-	int i;
-	
-	assert(p1 && p2);
-	assert(p1->row_key.keys && p1->col_key.keys);
-	assert(p2->row_key.keys && p2->col_key.keys);
+	size_t i, nslots = set->slots ? 2 * (set->mask + 1) : 1024;
+	size_t *slots = tds_new0(size_t, nslots);
 
-	assert(p1->row_key.nkeys == p2->row_key.nkeys);
-	assert(p1->col_key.nkeys == p2->col_key.nkeys);
-	
-	/* todo: use key_equal */
-	for( i=0; i < p1->row_key.nkeys; i++ ) {
-		if (! col_equal(p1->row_key.keys+i, p2->row_key.keys+i))
-			return false;
-	}
-	for( i=0; i < p1->col_key.nkeys; i++ ) {
-		if (! col_equal(p1->col_key.keys+i, p2->col_key.keys+i))
-			return false;
+	if (!slots)
+		return false;
+	for (i = 0; i < set->naggs; i++) {
+		const AGG_T *agg = agg_get(set, i);
+		size_t n = agg_hash(agg->row, agg->col) & (nslots - 1);
+
+		while (slots[n])
+			n = (n + 1) & (nslots - 1);
+		slots[n] = i + 1;
 	}
+	free(set->slots);
+	set->slots = slots;
+	set->mask = nslots - 1;
 	return true;
 }
 
+static AGG_T *
+agg_find(const AGG_SET *set, size_t row, size_t col)
+{
+	size_t n;
+
+	if (!set->slots)
+		return NULL;
+	for (n = agg_hash(row, col) & set->mask; set->slots[n]; n = (n + 1) & set->mask) {
+		AGG_T *agg = agg_get(set, set->slots[n] - 1);
+
+		if (agg->row == row && agg->col == col)
+			return agg;
+	}
+	return NULL;
+}
+
+/**
+ * Find the aggregate for (@row, @col), creating an empty one
+ * of the type of @value if not present.
+ */
+static AGG_T *
+agg_set_add(AGG_SET *set, size_t row, size_t col, const struct col_t *value)
+{
+	AGG_T *agg;
+	size_t n;
+
+	if (2 * (set->naggs + 1) > (set->slots ? set->mask + 1 : 0) && !agg_set_grow(set))
+		return NULL;
+
+	for (n = agg_hash(row, col) & set->mask; set->slots[n]; n = (n + 1) & set->mask) {
+		agg = agg_get(set, set->slots[n] - 1);
+		if (agg->row == row && agg->col == col)
+			return agg;
+	}
+
+	if (set->naggs == set->nblocks * AGG_BLOCK) {
+		if (!TDS_RESIZE(set->blocks, set->nblocks + 1))
+			return NULL;
+		if ((set->blocks[set->nblocks] = tds_new(AGG_T, AGG_BLOCK)) == NULL)
+			return NULL;
+		++set->nblocks;
+	}
+	agg = agg_get(set, set->naggs);
+	memset(agg, 0, sizeof(*agg));
+	agg->row = row;
+	agg->col = col;
+	/* aggregates only hold numbers, never a string buffer */
+	agg->value.type = value->type;
+	agg->value.len = value->len;
+	set->slots[n] = ++set->naggs;
+	return agg;
+}
+
 #undef TEST_MALLOC
 #define TEST_MALLOC(dest,type) \
 	{if (!(dest = (type*)calloc(1, sizeof(type)))) goto Cleanup;}
@@ -780,7 +958,7 @@ set_result_column(TDSSOCKET * tds, TDSCOLUMN * curcol, const char name[], const
 	return TDS_SUCCESS;
 }
 
-struct metadata_t { KEY_T *pacross; char *name; struct col_t col; };
+struct metadata_t { char *name; struct col_t col; };
 
 
 static bool
@@ -813,7 +991,6 @@ reinit_results(TDSSOCKET * tds, TDS_USMALLINT num_cols, const struct metadata_t
 	
 	for (i = 0; i < num_cols; i++) {
 		set_result_column(tds, info->columns[i], meta[i].name, &meta[i].col);
-		info->columns[i]->bcp_terminator = (char*) meta[i].pacross;	/* overload available pointer */
 	}
 		
 	if (num_cols > 0) {
@@ -844,12 +1021,20 @@ typedef struct pivot_t
 	STATUS status;
 	DB_RESULT_STATE dbresults_state;
 	
-	AGG_T *output;
-	KEY_T *across;
-	size_t nout;
-	TDS_USMALLINT nacross;
+	KEY_SET rows;		/* distinct row keys (down) */
+	KEY_SET across;		/* distinct column keys (across) */
+	AGG_SET output;
+	size_t next_row;	/* next row returned by dbnextrow_pivoted() */
 } PIVOT_T;
 
+static void
+pivot_free(PIVOT_T *pp)
+{
+	key_set_free(&pp->rows);
+	key_set_free(&pp->across);
+	agg_set_free(&pp->output);
+}
+
 static bool
 pivot_key_equal(const PIVOT_T *a, const PIVOT_T *b)
 {
@@ -875,26 +1060,26 @@ dbrows_pivoted(DBPROCESS *dbproc)
 STATUS
 dbnextrow_pivoted(DBPROCESS *dbproc, PIVOT_T *pp)
 {
-	int i;
-	AGG_T candidate, *pout;
+	int i, nkeys;
+	size_t row;
 
 	assert(pp);
 	assert(dbproc && dbproc->tds_socket);
 	assert(dbproc->tds_socket->res_info);
 	assert(dbproc->tds_socket->res_info->columns || 0 == dbproc->tds_socket->res_info->num_cols);
 	
-	for (pout = pp->output; pout < pp->output + pp->nout; pout++) {
-		if (pout->row_key.keys != NULL)
-			break;
-	}
-
-	if (pout == pp->output + pp->nout) {
+	if (pp->next_row >= pp->rows.nkeys) {
+		/*
+		 * Stop treating the results as pivoted, the next result set comes from the server.
+		 * The storage is kept until the slot is reused, the result columns still point to it.
+		 */
+		pp->dbproc = NULL;
 		dbproc->dbresults_state = _DB_RES_NEXT_RESULT;
 		return NO_MORE_ROWS;
 	}
 
-	memset(&candidate, 0, sizeof(candidate));
-	key_cpy(&candidate.row_key, &pout->row_key);
+	row = pp->next_row++;
+	nkeys = pp->rows.keys[row].nkeys;
 	
 	/* "buffer_transfer_bound_data" */
 	for (i = 0; i < dbproc->tds_socket->res_info->num_cols; i++) {
@@ -902,40 +1087,33 @@ dbnextrow_pivoted(DBPROCESS *dbproc, PIVOT_T *pp)
 		TDSCOLUMN *pcol = dbproc->tds_socket->res_info->columns[i];
 		assert(pcol);
 		
-		if (pcol->column_nullbind) {
-			if (pcol->column_cur_size < 0) {
-				*(DBINT *)(pcol->column_nullbind) = -1;
-			} else {
-				*(DBINT *)(pcol->column_nullbind) = 0;
-			}
-		}
-		if (!pcol->column_varaddr) {
+		if (!pcol->column_varaddr && !pcol->column_nullbind) {
 			tdsdump_log(TDS_DBG_ERROR, "no pcol->column_varaddr in col %d\n", i);
 			continue;
 		}
 
 		/* find column in output */
-		if (pcol->bcp_terminator == NULL) { /* not a cross-tab column */
-			pval = &candidate.row_key.keys[i];
+		if (i < nkeys) { /* not a cross-tab column */
+			pval = &pp->rows.keys[row].keys[i];
 		} else {
-			AGG_T *pcan;
-			key_cpy(&candidate.col_key, (KEY_T *) pcol->bcp_terminator);
-			pcan = (AGG_T *) tds_find(&candidate, pout, pp->output + pp->nout - pout,
-						  sizeof(*pp->output), (compare_func) agg_next);
-			if (pcan != NULL) {
-				/* flag this output as used */
-				pout->row_key.keys = NULL;
-				pval = &pcan->value;
-			}
+			AGG_T *agg = agg_find(&pp->output, row, i - nkeys);
+
+			if (agg != NULL)
+				pval = &agg->value;
 		}
 		
+		if (pcol->column_nullbind)
+			*(DBINT *)(pcol->column_nullbind) = (!pval || col_null(pval)) ? -1 : 0;
+		if (!pcol->column_varaddr) {
+			tdsdump_log(TDS_DBG_ERROR, "no pcol->column_varaddr in col %d\n", i);
+			continue;
+		}
+
 		if (!pval || col_null(pval)) {  /* nothing in output for this x,y location */
 			dbgetnull(dbproc, pcol->column_bindtype, pcol->column_bindlen, (BYTE *) pcol->column_varaddr);
 			continue;
 		}
 		
-		assert(pval);
-		
 		pcol->column_size = pval->len;
 		pcol->column_data = (unsigned char *) col_buffer(pval);
 		
@@ -953,6 +1131,36 @@ dbnextrow_pivoted(DBPROCESS *dbproc, PIVOT_T *pp)
 	return REG_ROW;
 }
 
+/* bind a pivot input column to @pcol */
+static bool
+bind_key(DBPROCESS *dbproc, int column, struct col_t *pcol)
+{
+	int type = dbcoltype(dbproc, column);
+	int len = dbcollen(dbproc, column);
+
+	assert(type && len);
+
+	if (!col_init(pcol, type, len))
+		return false;
+	/* strings are null terminated, col_init() reserves the room */
+	if (FAIL == dbbind(dbproc, column, bind_type(type), (DBINT) (pcol->s ? pcol->len + 1 : pcol->len),
+			   (BYTE *) col_buffer(pcol)))
+		return false;
+	return dbnullbind(dbproc, column, &pcol->null_indicator) != FAIL;
+}
+
+static void
+metadata_free(struct metadata_t *metadata, TDS_USMALLINT nmeta)
+{
+	TDS_USMALLINT i;
+
+	for (i = 0; i < nmeta; i++) {
+		free(metadata[i].name);
+		col_free(&metadata[i].col);
+	}
+	free(metadata);
+}
+
 /** 
  * Pivot the rows, creating a new resultset
  *
@@ -961,6 +1169,10 @@ dbnextrow_pivoted(DBPROCESS *dbproc, PIVOT_T *pp)
  * dbpivot() modifies the metadata such that DB-Library can be used tranparently: 
  * retrieve the rows as usual with dbnumcols(), dbnextrow(), etc. 
  *
+ * Row keys, column keys and aggregates are kept in hash tables,
+ * so every input row costs the same regardless of the size of the report.
+ * Output rows and columns follow the order in which their keys first appeared.
+ *
  * @dbproc, our old friend
  * @nkeys the number of left-edge columns to group by
  * @keys  an array of left-edge columns to group by
@@ -977,10 +1189,12 @@ dbpivot(DBPROCESS *dbproc, int nkeys, int *keys, int ncols, int *cols, DBPIVOT_F
 {
 	enum { logalot = 1 };
 	PIVOT_T P, *pp;
-	AGG_T input, *pout = NULL;
+	KEY_T row_key, col_key;
+	struct col_t value;
 	struct metadata_t *metadata, *pmeta;
 	int i;
 	TDS_USMALLINT nmeta = 0;
+	RETCODE erc = FAIL;
 
 	tdsdump_log(TDS_DBG_FUNC, "dbpivot(%p, %d,%p, %d,%p, %p, %d)\n", dbproc, nkeys, keys, ncols, cols, func, val);
 	if (logalot) {
@@ -1002,145 +1216,113 @@ dbpivot(DBPROCESS *dbproc, int nkeys, int *keys, int ncols, int *cols, DBPIVOT_F
 		tdsdump_log(TDS_DBG_FUNC, "%s\n", buffer);
 	}
 	
-	memset(&input,  0, sizeof(input));
-	
+	memset(&row_key, 0, sizeof(row_key));
+	memset(&col_key, 0, sizeof(col_key));
+	memset(&value, 0, sizeof(value));
+
+	/* reuse the slot of this process or of an exhausted pivot */
 	P.dbproc = dbproc;
 	pp = (PIVOT_T *) tds_find(&P, pivots, npivots, sizeof(*pivots),
 				  (compare_func) pivot_key_equal);
+	if (pp == NULL) {
+		P.dbproc = NULL;
+		pp = (PIVOT_T *) tds_find(&P, pivots, npivots, sizeof(*pivots),
+					  (compare_func) pivot_key_equal);
+	}
 	if (pp == NULL) {
 		pp = (PIVOT_T *) TDS_RESIZE(pivots, 1 + npivots);
 		if (!pp)
 			return FAIL;
 		pp += npivots++;
 	} else {
-		agg_free(pp->output);
-		key_free(pp->across);		
+		pivot_free(pp);
 	}
 	memset(pp, 0, sizeof(*pp));
 
-	if ((input.row_key.keys = tds_new0(struct col_t, nkeys)) == NULL)
-		return FAIL;
-	input.row_key.nkeys = nkeys;
+	if ((row_key.keys = tds_new0(struct col_t, nkeys)) == NULL)
+		goto Cleanup;
+	row_key.nkeys = nkeys;
 	for (i=0; i < nkeys; i++) {
-		int type = dbcoltype(dbproc, keys[i]);
-		int len = dbcollen(dbproc, keys[i]);
-		assert(type && len);
-		
-		if (!col_init(input.row_key.keys+i, type, len))
-			return FAIL;
-		if (FAIL == dbbind(dbproc, keys[i], bind_type(type), (DBINT) input.row_key.keys[i].len,
-				   (BYTE *) col_buffer(input.row_key.keys+i)))
-			return FAIL;
-		if (FAIL == dbnullbind(dbproc, keys[i], &input.row_key.keys[i].null_indicator))
-			return FAIL;
+		if (!bind_key(dbproc, keys[i], row_key.keys+i))
+			goto Cleanup;
 	}
 	
-	if ((input.col_key.keys = tds_new0(struct col_t, ncols)) == NULL)
-		return FAIL;
-	input.col_key.nkeys = ncols;
+	if ((col_key.keys = tds_new0(struct col_t, ncols)) == NULL)
+		goto Cleanup;
+	col_key.nkeys = ncols;
 	for (i=0; i < ncols; i++) {
-		int type = dbcoltype(dbproc, cols[i]);
-		int len = dbcollen(dbproc, cols[i]);
-		assert(type && len);
-		
-		if (!col_init(input.col_key.keys+i, type, len))
-			return FAIL;
-		if (FAIL == dbbind(dbproc, cols[i], bind_type(type), (DBINT) input.col_key.keys[i].len,
-				   (BYTE *) col_buffer(input.col_key.keys+i)))
-			return FAIL;
-		if (FAIL == dbnullbind(dbproc, cols[i], &input.col_key.keys[i].null_indicator))
-			return FAIL;
+		if (!bind_key(dbproc, cols[i], col_key.keys+i))
+			goto Cleanup;
 	}
 	
-	/* value */ {
-		int type = dbcoltype(dbproc, val);
-		int len = dbcollen(dbproc, val);
-		assert(type && len);
-		
-		if (!col_init(&input.value, type, len))
-			return FAIL;
-		if (FAIL == dbbind(dbproc, val, bind_type(type), input.value.len,
-				   (BYTE *) col_buffer(&input.value)))
-			return FAIL;
-		if (FAIL == dbnullbind(dbproc, val, &input.value.null_indicator))
-			return FAIL;
-	}
+	if (!bind_key(dbproc, val, &value))
+		goto Cleanup;
 	
 	while ((pp->status = dbnextrow(dbproc)) == REG_ROW) {
-		/* add to unique list of crosstab columns */
-		if (tds_find(&input.col_key, pp->across, pp->nacross, sizeof(*pp->across),
-			     (compare_func) key_equal) == NULL) {
-			if (!TDS_RESIZE(pp->across, 1 + pp->nacross))
-				return FAIL;
-			key_cpy(pp->across + pp->nacross, &input.col_key);
-		}
-		assert(pp->across);
+		size_t row, col;
+		AGG_T *agg;
+
+		/* add to unique lists of crosstab rows and columns */
+		if (!key_set_add(&pp->rows, &row_key, &row) || !key_set_add(&pp->across, &col_key, &col))
+			goto Cleanup;
 		
-		if ((pout = tds_find(&input, pp->output, pp->nout, sizeof(*pp->output), (compare_func) agg_equal)) == NULL ) {
-			if (!TDS_RESIZE(pp->output, 1 + pp->nout))
-				return FAIL;
-			pout = pp->output + pp->nout++;
-
-			
-			if ((pout->row_key.keys = tds_new0(struct col_t, input.row_key.nkeys)) == NULL)
-				return FAIL;
-			key_cpy(&pout->row_key, &input.row_key);
-
-			if ((pout->col_key.keys = tds_new0(struct col_t, input.col_key.nkeys)) == NULL)
-				return FAIL;
-			key_cpy(&pout->col_key, &input.col_key);
-
-			if (!col_init(&pout->value, input.value.type, input.value.len))
-				return FAIL;
-		}
+		if ((agg = agg_set_add(&pp->output, row, col, &value)) == NULL)
+			goto Cleanup;
 		
-		func(&pout->value, &input.value);
-
+		func(&agg->value, &value);
 	}
 
-	/* Mark this proc as pivoted, so that dbnextrow() sees it when the application calls it */
-	pp->dbproc = dbproc;
-	pp->dbresults_state = dbproc->dbresults_state;
-	dbproc->dbresults_state = pp->output < pout? _DB_RES_RESULTSET_ROWS : _DB_RES_RESULTSET_EMPTY;
-	
 	/*
 	 * Initialize new metadata
 	 */
-	nmeta = input.row_key.nkeys + pp->nacross;	
+	/* columns of a result are counted in 16 bits */
+	if (row_key.nkeys + pp->across.nkeys > 0xFFFFu) {
+		dbperror(dbproc, SYBEPVTCOLS, 0);
+		goto Cleanup;
+	}
+	nmeta = (TDS_USMALLINT) (row_key.nkeys + pp->across.nkeys);
 	metadata = tds_new0(struct metadata_t, nmeta);
 	if (!metadata) {
 		dbperror(dbproc, SYBEMEM, errno);
-		return FAIL;
+		goto Cleanup;
 	}
-	assert(pp->across || pp->nacross == 0);
 	
 	/* key columns are passed through as-is, verbatim */
-	for (i=0; i < input.row_key.nkeys; i++) {
+	for (i=0; i < row_key.nkeys; i++) {
 		assert(i < nkeys);
 		metadata[i].name = strdup(dbcolname(dbproc, keys[i]));
-		metadata[i].pacross = NULL;
-		col_cpy(&metadata[i].col, input.row_key.keys+i);
+		if (!metadata[i].name || !col_cpy(&metadata[i].col, row_key.keys+i)) {
+			metadata_free(metadata, nmeta);
+			goto Cleanup;
+		}
 	}
 
 	/* pivoted columms are found in the "across" data */
-	for (i=0, pmeta = metadata + input.row_key.nkeys; i < pp->nacross; i++) {
+	for (i=0, pmeta = metadata + row_key.nkeys; i < pp->across.nkeys; i++) {
 		struct col_t col;
 		if (!col_init(&col, SYBFLT8, sizeof(double)))
-			return FAIL;
+			break;
 		assert(pmeta + i < metadata + nmeta);
-		pmeta[i].name = make_col_name(dbproc, pp->across+i);
+		pmeta[i].name = make_col_name(dbproc, pp->across.keys+i);
 		if (!pmeta[i].name)
-			return FAIL;
-		assert(pp->across);
-		pmeta[i].pacross = pp->across + i;
-		col_cpy(&pmeta[i].col, pp->nout? &pp->output[0].value : &col);
+			break;
+		col_cpy(&pmeta[i].col, pp->output.naggs? &agg_get(&pp->output, 0)->value : &col);
 	}
 
-	if (!reinit_results(dbproc->tds_socket, nmeta, metadata)) {
-		return FAIL;
+	if (i == pp->across.nkeys && reinit_results(dbproc->tds_socket, nmeta, metadata)) {
+		/* Mark this proc as pivoted, so that dbnextrow() sees it when the application calls it */
+		pp->dbproc = dbproc;
+		pp->dbresults_state = dbproc->dbresults_state;
+		dbproc->dbresults_state = pp->rows.nkeys? _DB_RES_RESULTSET_ROWS : _DB_RES_RESULTSET_EMPTY;
+		erc = SUCCEED;
 	}
-	
-	return SUCCEED;
+	metadata_free(metadata, nmeta);
+
+Cleanup:
+	key_free(&row_key);
+	key_free(&col_key);
+	col_free(&value);
+	return erc;
 }
 
 /* 
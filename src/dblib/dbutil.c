@@ -238,26 +238,36 @@ _dblib_setTDS_version(TDSLOGIN * tds_login, DBINT version)
 	}
 }
 
-void
-_dblib_convert_err(DBPROCESS * dbproc, TDS_INT len)
+/**
+ * \ingroup dblib_internal
+ * \brief Error to raise for a tds_convert() failure.
+ *
+ * \param len negative value returned by tds_convert()
+ * \return db-lib error number.
+ */
+int
+_dblib_convert_msgno(TDS_INT len)
 {
 	switch (len) {
 	case TDS_CONVERT_NOAVAIL:
-		dbperror(dbproc, SYBERDCN, 0);
-		break;
+		return SYBERDCN;
 	case TDS_CONVERT_SYNTAX:
-		dbperror(dbproc, SYBECSYN, 0);
-		break;
+		return SYBECSYN;
 	case TDS_CONVERT_NOMEM:
-		dbperror(dbproc, SYBEMEM, ENOMEM);
-		break;
+		return SYBEMEM;
 	case TDS_CONVERT_OVERFLOW:
-		dbperror(dbproc, SYBECOFL, 0);
-		break;
+		return SYBECOFL;
 	default:
 	case TDS_CONVERT_FAIL:
-		dbperror(dbproc, SYBECINTERNAL, 0);
-		break;
+		return SYBECINTERNAL;
 	}
 }
 
+void
+_dblib_convert_err(DBPROCESS * dbproc, TDS_INT len)
+{
+	int msgno = _dblib_convert_msgno(len);
+
+	dbperror(dbproc, msgno, msgno == SYBEMEM ? ENOMEM : 0);
+}
+
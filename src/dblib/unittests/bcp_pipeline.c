@@ -0,0 +1,569 @@
+/* FreeTDS - Library of routines accessing Sybase and Microsoft databases
+ * Copyright (C) 2026  Frediano Ziglio
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Purpose: test bcp_exec reading the data file in a separate thread.
+ * A fake server records bulk data, data sent and rows written to the
+ * error file must be the same with and without BCPPIPELINE and
+ * reading a compressed data file.
+ * A load interrupted by a failed batch and resumed using bcp_checkpoint
+ * must send the same data as a single load.
+ * To test performance, call this program with a number of rows.
+ */
+#include <freetds/utils/test_base.h>
+
+/* server functions use libTDS definitions */
+#include <freetds/tds.h>
+
+#include "common.h"
+#include "../../tds/unittests/fakeserver.h"
+
+#include <freetds/server.h>
+#include <freetds/bytes.h>
+#include <freetds/thread.h>
+#include <freetds/replacements.h>
+#include <freetds/time.h>
+
+#if HAVE_ZLIB
+#include <zlib.h>
+#endif /* HAVE_ZLIB */
+
+#ifdef TDS_HAVE_MUTEX
+
+#define NUM_ROWS 3000
+
+static const char data_file[] = "bcp_pipeline.in";
+static const char error_file[] = "bcp_pipeline.err";
+static const char compressed_file[] = "bcp_pipeline.gz";
+static const char checkpoint_file[] = "bcp_pipeline.ckp";
+static const char *in_file = data_file;
+static const char *checkpoint;
+
+/* bulk batches accepted before failing one, -1 to never fail */
+static int fail_bulk = -1;
+
+/* bulk data received by the fake server */
+static unsigned char *bulk_data;
+static size_t bulk_len, bulk_size;
+
+static void
+add_bulk(const unsigned char *data, size_t len)
+{
+	if (bulk_len + len > bulk_size) {
+		bulk_size = (bulk_len + len) * 2;
+		bulk_data = (unsigned char *) realloc(bulk_data, bulk_size);
+		assert(bulk_data);
+	}
+	memcpy(bulk_data + bulk_len, data, len);
+	bulk_len += len;
+}
+
+/* count rows in a bulk message, only types used by this test are handled */
+static int
+count_rows(const unsigned char *p, const unsigned char *end)
+{
+	unsigned char types[8];
+	int num_cols, i, rows = 0;
+
+	assert(*p++ == TDS7_RESULT_TOKEN);
+	num_cols = TDS_GET_UA2LE(p);
+	p += 2;
+	assert(num_cols <= (int) sizeof(types));
+	for (i = 0; i < num_cols; ++i) {
+		p += 6;
+		types[i] = *p++;
+		switch (types[i]) {
+		case SYBINTN:
+		case SYBFLTN:
+			p += 1;
+			break;
+		case XSYBVARCHAR:
+			p += 2 + 5;
+			break;
+		default:
+			assert(!"unexpected type");
+		}
+		p += 1 + 2 * p[0];
+	}
+
+	while (p < end && *p == TDS_ROW_TOKEN) {
+		++p;
+		for (i = 0; i < num_cols; ++i) {
+			unsigned len;
+
+			if (types[i] != XSYBVARCHAR) {
+				p += 1 + p[0];
+				continue;
+			}
+			len = TDS_GET_UA2LE(p);
+			p += 2;
+			if (len != 0xffff)
+				p += len;
+		}
+		++rows;
+	}
+	assert(p == end || *p == TDS_DONE_TOKEN);
+	return rows;
+}
+
+static void
+send_columns(TDSSOCKET *tds)
+{
+	TDSRESULTINFO *resinfo;
+	TDSCOLUMN *col;
+	int i;
+
+	resinfo = tds_alloc_results(3);
+	assert(resinfo);
+	for (i = 0; i < 3; ++i) {
+		col = resinfo->columns[i];
+		tds_set_column_type(tds->conn, col, i == 0 ? SYBINTN : i == 1 ? XSYBVARCHAR : SYBFLTN);
+		col->column_size = col->on_server.column_size = i == 0 ? 4 : i == 1 ? 50 : 8;
+		col->column_flags = 1;	/* nullable */
+		memcpy(col->column_collation, tds->conn->collation, 5);
+		assert(tds_dstr_copy(&col->column_name, i == 0 ? "id" : i == 1 ? "name" : "value"));
+	}
+	tds_send_table_header(tds, resinfo);
+	tds_free_results(resinfo);
+	tds_send_done_token(tds, TDS_DONE_FINAL, 0);
+}
+
+static void
+handle_bulk(TDSSOCKET *tds, const unsigned char *data, size_t len)
+{
+	if (fail_bulk == 0) {
+		tds_send_done(tds, TDS_DONE_TOKEN, TDS_DONE_ERROR, 0);
+		return;
+	}
+	if (fail_bulk > 0)
+		--fail_bulk;
+	add_bulk(data, len);
+	tds_send_done(tds, TDS_DONE_TOKEN, TDS_DONE_COUNT, count_rows(data, data + len));
+}
+
+static int errors;
+static bool read_error, checkpoint_error;
+/* sequence of errors, batches included */
+static unsigned int error_sequence;
+static tds_thread_id main_thread;
+
+static int
+err_handler(DBPROCESS *dbproc TDS_UNUSED, int severity TDS_UNUSED, int dberr, int oserr TDS_UNUSED,
+	    char *dberrstr TDS_UNUSED, char *oserrstr TDS_UNUSED)
+{
+	/* errors of reader thread are raised by the thread using the connection */
+	assert(tds_thread_is_current(main_thread));
+
+	error_sequence = error_sequence * 31u + (unsigned int) dberr;
+	/* batch copied */
+	if (dberr != SYBEBBCI) {
+		++errors;
+		if (dberr == SYBEBCRE)
+			read_error = true;
+		if (dberr == SYBEBCKPT)
+			checkpoint_error = true;
+	}
+	return INT_CANCEL;
+}
+
+/* write data file, some rows contain conversion errors */
+static int
+write_data(int num_rows)
+{
+	FILE *f;
+	int n, good = 0;
+
+	f = fopen(data_file, "w");
+	assert(f);
+	for (n = 0; n < num_rows; ++n) {
+		if ((n % 37) == 5) {
+			fprintf(f, "x%d\tbad row %d\t%d\n", n, n, n);
+			continue;
+		}
+		++good;
+		if ((n % 11) == 3)
+			fprintf(f, "%d\t\t\n", n);
+		else
+			fprintf(f, "%d\tsome text for row %d\t%d.%d\n", n, n, n * 3, n % 10);
+	}
+	fclose(f);
+	return good;
+}
+
+static char *
+read_file(const char *name)
+{
+	FILE *f;
+	long len;
+	char *buf;
+
+	f = fopen(name, "rb");
+	if (!f)
+		return strdup("");
+	assert(fseek(f, 0, SEEK_END) == 0);
+	len = ftell(f);
+	rewind(f);
+	buf = tds_new(char, len + 1);
+	assert(buf);
+	assert(fread(buf, 1, len, f) == (size_t) len);
+	buf[len] = 0;
+	fclose(f);
+	return buf;
+}
+
+typedef struct
+{
+	RETCODE ret;
+	DBINT rows;
+	int errors;
+	unsigned int error_sequence;
+	unsigned char *data;
+	size_t len;
+	char *error_rows;
+} RESULT;
+
+static void
+copy_in(DBPROCESS *dbproc, bool pipeline, int batch, int first, int last, int maxerrs, RESULT *res)
+{
+	int i;
+
+	/* resumed loads keep rows rejected before */
+	if (!checkpoint)
+		unlink(error_file);
+	assert(bcp_init(dbproc, "bcp_pipeline", in_file, error_file, DB_IN) == SUCCEED);
+	assert(bcp_columns(dbproc, 3) == SUCCEED);
+	for (i = 1; i <= 3; ++i)
+		assert(bcp_colfmt(dbproc, i, SYBCHAR, 0, -1, (BYTE *) (i == 3 ? "\n" : "\t"), 1, i) == SUCCEED);
+	assert(bcp_control(dbproc, BCPPIPELINE, pipeline) == SUCCEED);
+	assert(bcp_control(dbproc, BCPMAXERRS, maxerrs) == SUCCEED);
+	if (batch)
+		assert(bcp_control(dbproc, BCPBATCH, batch) == SUCCEED);
+	if (first)
+		assert(bcp_control(dbproc, BCPFIRST, first) == SUCCEED);
+	if (last)
+		assert(bcp_control(dbproc, BCPLAST, last) == SUCCEED);
+	if (checkpoint)
+		assert(bcp_checkpoint(dbproc, checkpoint) == SUCCEED);
+
+	bulk_len = 0;
+	errors = 0;
+	read_error = checkpoint_error = false;
+	error_sequence = 0;
+	res->rows = -1;
+	res->ret = bcp_exec(dbproc, &res->rows);
+	res->errors = errors;
+	res->error_sequence = error_sequence;
+	res->data = (unsigned char *) malloc(bulk_len + 1);
+	assert(res->data);
+	memcpy(res->data, bulk_data, bulk_len);
+	res->len = bulk_len;
+	res->error_rows = read_file(error_file);
+}
+
+static void
+free_result(RESULT *res)
+{
+	free(res->data);
+	free(res->error_rows);
+}
+
+static void
+test_same(DBPROCESS *dbproc, int batch, int first, int last, int maxerrs, RETCODE expected_ret, int expected_rows)
+{
+	RESULT serial, pipelined;
+
+	printf("Testing batch %d first %d last %d maxerrs %d\n", batch, first, last, maxerrs);
+	copy_in(dbproc, false, batch, first, last, maxerrs, &serial);
+	copy_in(dbproc, true, batch, first, last, maxerrs, &pipelined);
+
+	assert(serial.ret == expected_ret);
+	if (expected_rows >= 0)
+		assert(serial.rows == expected_rows);
+	assert(pipelined.ret == serial.ret);
+	assert(pipelined.rows == serial.rows);
+	assert(pipelined.errors == serial.errors);
+	assert(pipelined.error_sequence == serial.error_sequence);
+	assert(pipelined.len == serial.len);
+	assert(memcmp(pipelined.data, serial.data, serial.len) == 0);
+	assert(strcmp(pipelined.error_rows, serial.error_rows) == 0);
+
+	free_result(&serial);
+	free_result(&pipelined);
+}
+
+#if HAVE_ZLIB
+static void
+write_compressed(void)
+{
+	char *content;
+	gzFile gz;
+
+	content = read_file(data_file);
+	gz = gzopen(compressed_file, "wb");
+	assert(gz);
+	assert(gzwrite(gz, content, (unsigned) strlen(content)) == (int) strlen(content));
+	assert(gzclose(gz) == Z_OK);
+	free(content);
+}
+
+/* compressed data file must give the same results */
+static void
+test_compressed(DBPROCESS *dbproc, int batch, int first, int last, int maxerrs)
+{
+	RESULT plain, compressed;
+
+	printf("Testing compressed batch %d first %d last %d maxerrs %d\n", batch, first, last, maxerrs);
+	write_compressed();
+
+	copy_in(dbproc, false, batch, first, last, maxerrs, &plain);
+	in_file = compressed_file;
+	copy_in(dbproc, false, batch, first, last, maxerrs, &compressed);
+	in_file = data_file;
+
+	assert(compressed.ret == plain.ret);
+	assert(compressed.rows == plain.rows);
+	assert(compressed.errors == plain.errors);
+	assert(compressed.len == plain.len);
+	assert(memcmp(compressed.data, plain.data, plain.len) == 0);
+	assert(strcmp(compressed.error_rows, plain.error_rows) == 0);
+
+	free_result(&plain);
+	free_result(&compressed);
+	unlink(compressed_file);
+}
+
+/* a truncated compressed file is a read error, not an end of file */
+static void
+test_truncated(DBPROCESS *dbproc)
+{
+	RESULT truncated, pipelined;
+	FILE *f;
+	char *content;
+	long len;
+
+	printf("Testing truncated compressed file\n");
+	write_compressed();
+
+	f = fopen(compressed_file, "rb");
+	assert(f);
+	assert(fseek(f, 0, SEEK_END) == 0);
+	len = ftell(f);
+	rewind(f);
+	content = tds_new(char, len);
+	assert(content);
+	assert(fread(content, 1, len, f) == (size_t) len);
+	fclose(f);
+	f = fopen(compressed_file, "wb");
+	assert(f);
+	assert(fwrite(content, 1, len / 2, f) == (size_t) (len / 2));
+	fclose(f);
+	free(content);
+
+	in_file = compressed_file;
+	copy_in(dbproc, false, 0, 0, 0, NUM_ROWS, &truncated);
+	assert(read_error);
+	copy_in(dbproc, true, 0, 0, 0, NUM_ROWS, &pipelined);
+	assert(read_error);
+	in_file = data_file;
+
+	assert(truncated.ret == FAIL);
+	assert(truncated.errors > 0);
+	assert(pipelined.ret == FAIL);
+	assert(pipelined.errors == truncated.errors);
+	assert(pipelined.error_sequence == truncated.error_sequence);
+
+	free_result(&truncated);
+	free_result(&pipelined);
+	unlink(compressed_file);
+}
+#endif
+
+/* load failing after some batches and resumed must send same data */
+static void
+test_resume(DBPROCESS *dbproc, bool pipeline, int batch, int first, int last, int fail_after)
+{
+	RESULT whole, failed, resumed, again;
+	size_t error_len;
+
+	printf("Testing resume %s%s batch %d first %d last %d fail after %d\n", in_file,
+	       pipeline ? " pipelined" : "", batch, first, last, fail_after);
+	copy_in(dbproc, pipeline, batch, first, last, NUM_ROWS, &whole);
+
+	unlink(checkpoint_file);
+	unlink(error_file);
+	checkpoint = checkpoint_file;
+	fail_bulk = fail_after;
+	copy_in(dbproc, pipeline, batch, first, last, NUM_ROWS, &failed);
+	fail_bulk = -1;
+	copy_in(dbproc, pipeline, batch, first, last, NUM_ROWS, &resumed);
+	/* all rows already loaded */
+	copy_in(dbproc, pipeline, batch, first, last, NUM_ROWS, &again);
+	checkpoint = NULL;
+
+	assert(whole.ret == SUCCEED);
+	assert(failed.ret == FAIL);
+	assert(failed.rows == batch * fail_after);
+	assert(resumed.ret == SUCCEED);
+	assert(failed.rows + resumed.rows == whole.rows);
+	assert(failed.len + resumed.len == whole.len);
+	assert(memcmp(failed.data, whole.data, failed.len) == 0);
+	assert(memcmp(resumed.data, whole.data + failed.len, resumed.len) == 0);
+	/* rows rejected before are kept, rows with errors after the checkpoint are written again */
+	error_len = strlen(failed.error_rows);
+	assert(strncmp(resumed.error_rows, failed.error_rows, error_len) == 0);
+	error_len = strlen(resumed.error_rows) - error_len;
+	assert(error_len <= strlen(whole.error_rows));
+	assert(strcmp(resumed.error_rows + strlen(failed.error_rows),
+		      whole.error_rows + strlen(whole.error_rows) - error_len) == 0);
+	assert(again.ret == SUCCEED);
+	assert(again.rows == 0);
+	assert(strcmp(again.error_rows, resumed.error_rows) == 0);
+
+	free_result(&whole);
+	free_result(&failed);
+	free_result(&resumed);
+	free_result(&again);
+	unlink(checkpoint_file);
+}
+
+/* a checkpoint past the end of the data file must not load the file again */
+static void
+test_bad_checkpoint(DBPROCESS *dbproc, bool pipeline)
+{
+	RESULT res;
+	FILE *f;
+
+	printf("Testing checkpoint past end of file%s\n", pipeline ? " pipelined" : "");
+	f = fopen(checkpoint_file, "w");
+	assert(f);
+	fprintf(f, "FreeTDS bcp checkpoint 1\n100 1000000000\n");
+	fclose(f);
+
+	checkpoint = checkpoint_file;
+	copy_in(dbproc, pipeline, 100, 0, 0, NUM_ROWS, &res);
+	checkpoint = NULL;
+
+	assert(res.ret == FAIL);
+	assert(checkpoint_error);
+	assert(res.len == 0);
+
+	free_result(&res);
+	unlink(checkpoint_file);
+}
+
+static void
+benchmark(DBPROCESS *dbproc, int num_rows)
+{
+	struct timeval start;
+	RESULT res;
+	int i;
+
+	write_data(num_rows);
+	for (i = 0; i < 2; ++i) {
+		gettimeofday(&start, NULL);
+		copy_in(dbproc, i != 0, 0, 0, 0, num_rows, &res);
+		print_rate(&start, res.rows, "rows/second copied in (%s)", i ? "pipelined" : "serial");
+		assert(res.ret == SUCCEED);
+		free_result(&res);
+	}
+}
+
+static const FAKE_SERVER fake_server = { "FMTONLY", send_columns, handle_bulk };
+
+TEST_MAIN()
+{
+	LOGINREC *login;
+	DBPROCESS *dbproc;
+	tds_thread th;
+	char server[64];
+	int port, good;
+
+	setbuf(stdout, NULL);
+	setbuf(stderr, NULL);
+
+	unsetenv("TDSHOST");
+	unsetenv("TDSPORT");
+	unsetenv("TDSVER");
+
+	port = fake_server_start(&th, &fake_server);
+	sprintf(server, "127.0.0.1:%d", port);
+
+	main_thread = tds_thread_get_current_id();
+	dbinit();
+	dberrhandle(err_handler);
+
+	login = dblogin();
+	DBSETLUSER(login, "guest");
+	DBSETLPWD(login, "sybase");
+	DBSETLAPP(login, "bcp_pipeline");
+	DBSETLVERSION(login, DBVERSION_74);
+	BCP_SETL(login, TRUE);
+	dbproc = dbopen(login, server);
+	assert(dbproc);
+	dbloginfree(login);
+
+	good = write_data(NUM_ROWS);
+
+	/* whole file, rows with errors are written to error file */
+	test_same(dbproc, 0, 0, 0, NUM_ROWS, SUCCEED, good);
+	/* multiple batches */
+	test_same(dbproc, 100, 0, 0, NUM_ROWS, SUCCEED, good);
+	/* part of the file */
+	test_same(dbproc, 0, 700, 1500, NUM_ROWS, SUCCEED, -1);
+	/* too many errors */
+	test_same(dbproc, 0, 0, 0, 10, FAIL, -1);
+	test_same(dbproc, 64, 0, 0, 30, FAIL, -1);
+#if HAVE_ZLIB
+	test_compressed(dbproc, 0, 0, 0, NUM_ROWS);
+	test_compressed(dbproc, 0, 700, 1500, NUM_ROWS);
+	test_truncated(dbproc);
+#endif
+	/* interrupted loads */
+	test_resume(dbproc, false, 100, 0, 0, 3);
+	test_resume(dbproc, true, 100, 0, 0, 7);
+	test_resume(dbproc, false, 64, 700, 1500, 2);
+	test_resume(dbproc, true, 1000, 0, 0, 0);
+	test_bad_checkpoint(dbproc, false);
+	test_bad_checkpoint(dbproc, true);
+#if HAVE_ZLIB
+	write_compressed();
+	in_file = compressed_file;
+	test_resume(dbproc, true, 100, 0, 0, 5);
+	in_file = data_file;
+	unlink(compressed_file);
+#endif
+
+	if (argc > 1)
+		benchmark(dbproc, atoi(argv[1]));
+
+	dbclose(dbproc);
+	dbexit();
+	tds_thread_join(th, NULL);
+
+	unlink(data_file);
+	unlink(error_file);
+	free(bulk_data);
+	return 0;
+}
+#else
+TEST_MAIN()
+{
+	return 0;
+}
+#endif
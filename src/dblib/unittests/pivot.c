@@ -0,0 +1,331 @@
+/* FreeTDS - Library of routines accessing Sybase and Microsoft databases
+ * Copyright (C) 2026  Frediano Ziglio
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Purpose: test dbpivot.
+ * A fake server sends rows with a row key, a column key and a value,
+ * NULL keys and values included; the cross-tab read back with dbnextrow
+ * is checked against sums and counts computed here.
+ * To test performance, call this program with a number of rows,
+ * pivoted on 1000 row keys and 1000 column keys.
+ */
+#include <freetds/utils/test_base.h>
+
+/* server functions use libTDS definitions */
+#include <freetds/tds.h>
+
+#include "common.h"
+#include "../../tds/unittests/fakeserver.h"
+
+#include <freetds/server.h>
+#include <freetds/thread.h>
+#include <freetds/replacements.h>
+#include <freetds/time.h>
+
+#ifdef TDS_HAVE_MUTEX
+
+#define MAX_KEYS 1000
+
+/* shape of the rows sent by the fake server for next query */
+static int num_rows = 1000, num_regions = 5, num_products = 7;
+
+/* values of a row, -1 for NULL */
+static void
+row_values(int row, int *region, int *product, int *qty)
+{
+	*region = row % num_regions;
+	*product = (row / num_regions) % num_products;
+	if (row % 37 == 36)
+		*product = -1;
+	/* leave a hole in the cross-tab */
+	if (*region == 1 && *product == 2)
+		*product = 3;
+	*qty = row % 11 == 10 ? -1 : row % 10;
+}
+
+static void
+send_rows(TDSSOCKET *tds)
+{
+	TDSRESULTINFO *resinfo;
+	TDSCOLUMN *col;
+	int i, row, region, product, qty;
+
+	resinfo = tds_alloc_results(3);
+	assert(resinfo);
+	for (i = 0; i < 3; ++i) {
+		col = resinfo->columns[i];
+		tds_set_column_type(tds->conn, col, i == 0 ? SYBINTN : i == 1 ? XSYBVARCHAR : SYBFLTN);
+		col->column_size = col->on_server.column_size = i == 0 ? 4 : i == 1 ? 20 : 8;
+		col->column_flags = 1;	/* nullable */
+		memcpy(col->column_collation, tds->conn->collation, 5);
+		assert(tds_dstr_copy(&col->column_name, i == 0 ? "region" : i == 1 ? "product" : "qty"));
+	}
+	assert(TDS_SUCCEED(tds_alloc_row(resinfo)));
+	tds_send_table_header(tds, resinfo);
+
+	for (row = 0; row < num_rows; ++row) {
+		row_values(row, &region, &product, &qty);
+
+		*(TDS_INT *) resinfo->columns[0]->column_data = region;
+		resinfo->columns[0]->column_cur_size = 4;
+
+		col = resinfo->columns[1];
+		col->column_cur_size = product < 0 ? -1 : sprintf((char *) col->column_data, "p%d", product);
+
+		col = resinfo->columns[2];
+		*(TDS_FLOAT *) col->column_data = qty;
+		col->column_cur_size = qty < 0 ? -1 : 8;
+
+		tds_send_row(tds, resinfo);
+	}
+	tds_free_results(resinfo);
+	tds_send_done_token(tds, TDS_DONE_FINAL | TDS_DONE_COUNT, num_rows);
+}
+
+/* expected cross-tab, rows and columns in order of appearance */
+static int regions[MAX_KEYS], products[MAX_KEYS + 1];
+static int nregions, nproducts;
+static double sums[MAX_KEYS][MAX_KEYS + 1];
+static int counts[MAX_KEYS][MAX_KEYS + 1];
+static bool present[MAX_KEYS][MAX_KEYS + 1];
+
+static int
+key_index(int *list, int *n, int key)
+{
+	int i;
+
+	for (i = 0; i < *n; ++i)
+		if (list[i] == key)
+			return i;
+	list[(*n)++] = key;
+	return i;
+}
+
+static void
+compute_expected(void)
+{
+	int row, region, product, qty, r, c;
+
+	nregions = nproducts = 0;
+	memset(sums, 0, sizeof(sums));
+	memset(counts, 0, sizeof(counts));
+	memset(present, 0, sizeof(present));
+	for (row = 0; row < num_rows; ++row) {
+		row_values(row, &region, &product, &qty);
+		r = key_index(regions, &nregions, region);
+		c = key_index(products, &nproducts, product);
+		present[r][c] = true;
+		if (qty >= 0) {
+			sums[r][c] += qty;
+			++counts[r][c];
+		}
+	}
+}
+
+static void
+query(DBPROCESS *dbproc, DBPIVOT_FUNC func)
+{
+	int key = 1, col = 2;
+
+	assert(dbcmd(dbproc, "select region, product, qty from sales") == SUCCEED);
+	assert(dbsqlexec(dbproc) == SUCCEED);
+	assert(dbresults(dbproc) == SUCCEED);
+	assert(dbpivot(dbproc, 1, &key, 1, &col, func, 3) == SUCCEED);
+}
+
+static void
+test_pivot(DBPROCESS *dbproc, DBPIVOT_FUNC func)
+{
+	static double values[MAX_KEYS + 1];
+	static DBINT ints[MAX_KEYS + 1], inds[MAX_KEYS + 1];
+	DBINT region;
+	int r, c;
+	bool sum = func == dbpivot_sum;
+
+	printf("Testing %s of %d rows, %d regions, %d products\n", sum ? "sum" : "count",
+	       num_rows, num_regions, num_products);
+	compute_expected();
+	query(dbproc, func);
+
+	assert(dbnumcols(dbproc) == 1 + nproducts);
+	assert(strcmp(dbcolname(dbproc, 1), "region") == 0);
+	assert(dbbind(dbproc, 1, INTBIND, 0, (BYTE *) &region) == SUCCEED);
+	for (c = 0; c < nproducts; ++c) {
+		char name[16];
+
+		if (products[c] >= 0) {
+			sprintf(name, "p%d", products[c]);
+			assert(strcmp(dbcolname(dbproc, c + 2), name) == 0);
+		}
+		if (sum)
+			assert(dbbind(dbproc, c + 2, FLT8BIND, 0, (BYTE *) &values[c]) == SUCCEED);
+		else
+			assert(dbbind(dbproc, c + 2, INTBIND, 0, (BYTE *) &ints[c]) == SUCCEED);
+		assert(dbnullbind(dbproc, c + 2, &inds[c]) == SUCCEED);
+	}
+
+	for (r = 0; dbnextrow(dbproc) == REG_ROW; ++r) {
+		assert(r < nregions);
+		assert(region == regions[r]);
+		for (c = 0; c < nproducts; ++c) {
+			if (!present[r][c]) {
+				assert(inds[c] == -1);
+				continue;
+			}
+			assert(inds[c] == 0);
+			if (sum)
+				assert(values[c] == sums[r][c]);
+			else
+				assert(ints[c] == counts[r][c]);
+		}
+	}
+	assert(r == nregions);
+	assert(dbresults(dbproc) == NO_MORE_RESULTS);
+}
+
+/* results following a pivot come from the server again */
+static void
+test_after_pivot(DBPROCESS *dbproc)
+{
+	DBINT region;
+	int n = 0;
+
+	assert(dbcmd(dbproc, "select region, product, qty from sales") == SUCCEED);
+	assert(dbsqlexec(dbproc) == SUCCEED);
+	assert(dbresults(dbproc) == SUCCEED);
+	assert(dbnumcols(dbproc) == 3);
+	assert(dbbind(dbproc, 1, INTBIND, 0, (BYTE *) &region) == SUCCEED);
+	while (dbnextrow(dbproc) == REG_ROW)
+		assert(region == n++ % num_regions);
+	assert(n == num_rows);
+	assert(dbresults(dbproc) == NO_MORE_RESULTS);
+}
+
+static int pivot_errors;
+
+static int
+err_handler(DBPROCESS *dbproc TDS_UNUSED, int severity TDS_UNUSED, int dberr, int oserr TDS_UNUSED,
+	    char *dberrstr TDS_UNUSED, char *oserrstr TDS_UNUSED)
+{
+	if (dberr == SYBEPVTCOLS)
+		++pivot_errors;
+	return INT_CANCEL;
+}
+
+/* more column keys than a result can hold fail, they are not truncated */
+static void
+test_too_many_columns(DBPROCESS *dbproc)
+{
+	int key = 1, col = 2;
+	EHANDLEFUNC old_handler;
+
+	num_rows = 70000;
+	num_regions = 1;
+	num_products = 70000;
+	printf("Testing %d products\n", num_products);
+
+	old_handler = dberrhandle(err_handler);
+	pivot_errors = 0;
+	assert(dbcmd(dbproc, "select region, product, qty from sales") == SUCCEED);
+	assert(dbsqlexec(dbproc) == SUCCEED);
+	assert(dbresults(dbproc) == SUCCEED);
+	assert(dbpivot(dbproc, 1, &key, 1, &col, dbpivot_sum, 3) == FAIL);
+	assert(pivot_errors == 1);
+	dberrhandle(old_handler);
+	while (dbresults(dbproc) != NO_MORE_RESULTS)
+		continue;
+}
+
+static void
+benchmark(DBPROCESS *dbproc, int rows)
+{
+	struct timeval start;
+	DBFLT8 value;
+	int n;
+
+	num_rows = rows;
+	num_regions = num_products = MAX_KEYS;
+
+	gettimeofday(&start, NULL);
+	query(dbproc, dbpivot_sum);
+	assert(dbbind(dbproc, 2, FLT8BIND, 0, (BYTE *) &value) == SUCCEED);
+	for (n = 0; dbnextrow(dbproc) == REG_ROW; ++n)
+		continue;
+	while (dbresults(dbproc) != NO_MORE_RESULTS)
+		continue;
+	print_rate(&start, rows, "rows/second pivoted into %d rows", n);
+}
+
+static const FAKE_SERVER fake_server = { "sales", send_rows, NULL };
+
+TEST_MAIN()
+{
+	LOGINREC *login;
+	DBPROCESS *dbproc;
+	tds_thread th;
+	char server[64];
+	int port;
+
+	setbuf(stdout, NULL);
+	setbuf(stderr, NULL);
+
+	unsetenv("TDSHOST");
+	unsetenv("TDSPORT");
+	unsetenv("TDSVER");
+
+	port = fake_server_start(&th, &fake_server);
+	sprintf(server, "127.0.0.1:%d", port);
+
+	dbinit();
+
+	login = dblogin();
+	DBSETLUSER(login, "guest");
+	DBSETLPWD(login, "sybase");
+	DBSETLAPP(login, "pivot");
+	DBSETLVERSION(login, DBVERSION_74);
+	dbproc = dbopen(login, server);
+	assert(dbproc);
+	dbloginfree(login);
+
+	test_pivot(dbproc, dbpivot_sum);
+	test_pivot(dbproc, dbpivot_count);
+	test_after_pivot(dbproc);
+
+	/* enough keys to grow the hash tables */
+	num_rows = 20000;
+	num_regions = 300;
+	num_products = 150;
+	test_pivot(dbproc, dbpivot_sum);
+
+	test_too_many_columns(dbproc);
+
+	if (argc > 1)
+		benchmark(dbproc, atoi(argv[1]));
+
+	dbclose(dbproc);
+	dbexit();
+	tds_thread_join(th, NULL);
+	return 0;
+}
+#else
+TEST_MAIN()
+{
+	return 0;
+}
+#endif
@@ -0,0 +1,434 @@
+/* FreeTDS - Library of routines accessing Sybase and Microsoft databases
+ * Copyright (C) 2026  Frediano Ziglio
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Purpose: test rows kept by DBBUFFER and rows read with dbnextrows.
+ * A fake server sends rows with NULLs and varchar(max) data, rows are
+ * read again with dbgetrow while the buffer fills, wraps and is cleared.
+ * Rows are also read in arrays bound with dbbind_array.
+ * To test performance, call this program with a number of rows.
+ */
+#include <freetds/utils/test_base.h>
+
+/* server functions use libTDS definitions */
+#include <freetds/tds.h>
+
+#include "common.h"
+#include "../../tds/unittests/fakeserver.h"
+
+#include <freetds/server.h>
+#include <freetds/thread.h>
+#include <freetds/replacements.h>
+#include <freetds/time.h>
+
+#ifdef TDS_HAVE_MUTEX
+
+#define NUM_ROWS 1000
+
+/* rows sent by the fake server for next query */
+static int num_rows = NUM_ROWS;
+
+/* text of a column, NULL for NULL values */
+static const char *
+row_text(int row, int col, char *buf)
+{
+	if (col == 1) {
+		if (row % 5 == 0)
+			return NULL;
+		sprintf(buf, "name %d", row);
+		return buf;
+	}
+	if (row % 3 == 0)
+		return NULL;
+	sprintf(buf, "%0*d notes", row % 97 + 1, row);
+	return buf;
+}
+
+static void
+send_rows(TDSSOCKET *tds)
+{
+	TDSRESULTINFO *resinfo;
+	TDSCOLUMN *col;
+	TDSBLOB *blob;
+	char buf[256];
+	const char *s;
+	int i, row;
+
+	resinfo = tds_alloc_results(3);
+	assert(resinfo);
+	for (i = 0; i < 3; ++i) {
+		col = resinfo->columns[i];
+		tds_set_column_type(tds->conn, col, i == 0 ? SYBINTN : XSYBVARCHAR);
+		col->column_size = col->on_server.column_size = i == 0 ? 4 : 40;
+		/* varchar(max) */
+		if (i == 2) {
+			col->column_varint_size = 8;
+			col->column_size = col->on_server.column_size = 0x3fffffff;
+		}
+		col->column_flags = 1;	/* nullable */
+		memcpy(col->column_collation, tds->conn->collation, 5);
+		assert(tds_dstr_copy(&col->column_name, i == 0 ? "id" : i == 1 ? "name" : "notes"));
+	}
+	assert(TDS_SUCCEED(tds_alloc_row(resinfo)));
+	tds_send_table_header(tds, resinfo);
+
+	blob = (TDSBLOB *) resinfo->columns[2]->column_data;
+	for (row = 1; row <= num_rows; ++row) {
+		*(TDS_INT *) resinfo->columns[0]->column_data = row;
+		resinfo->columns[0]->column_cur_size = 4;
+
+		col = resinfo->columns[1];
+		s = row_text(row, 1, buf);
+		col->column_cur_size = s ? (TDS_INT) strlen(s) : -1;
+		if (s)
+			memcpy(col->column_data, s, strlen(s));
+
+		col = resinfo->columns[2];
+		s = row_text(row, 2, buf);
+		col->column_cur_size = s ? (TDS_INT) strlen(s) : -1;
+		blob->textvalue = (TDS_CHAR *) s;
+
+		tds_send_row(tds, resinfo);
+	}
+	blob->textvalue = NULL;
+	tds_free_results(resinfo);
+	tds_send_done_token(tds, TDS_DONE_FINAL | TDS_DONE_COUNT, num_rows);
+}
+
+static DBINT id, name_ind, notes_ind;
+static char name[64], notes[256];
+
+static void
+bind_columns(DBPROCESS *dbproc)
+{
+	assert(dbbind(dbproc, 1, INTBIND, 0, (BYTE *) &id) == SUCCEED);
+	assert(dbbind(dbproc, 2, NTBSTRINGBIND, sizeof(name), (BYTE *) name) == SUCCEED);
+	assert(dbnullbind(dbproc, 2, &name_ind) == SUCCEED);
+	assert(dbbind(dbproc, 3, NTBSTRINGBIND, sizeof(notes), (BYTE *) notes) == SUCCEED);
+	assert(dbnullbind(dbproc, 3, &notes_ind) == SUCCEED);
+}
+
+/* values must be the ones of row */
+static void
+check_values(int row, DBINT id_value, const char *name_value, DBINT name_null, const char *notes_value, DBINT notes_null)
+{
+	char buf[256];
+	const char *s;
+
+	assert(id_value == row);
+	s = row_text(row, 1, buf);
+	assert(s ? (name_null == 0 && strcmp(name_value, s) == 0) : name_null == -1);
+	s = row_text(row, 2, buf);
+	assert(s ? (notes_null == 0 && strcmp(notes_value, s) == 0) : notes_null == -1);
+}
+
+/* bound variables must contain row */
+static void
+check_row(int row)
+{
+	check_values(row, id, name, name_ind, notes, notes_ind);
+}
+
+#define ARRAY_ROWS 64
+
+/* id and name interleaved, notes packed */
+static struct {
+	DBINT id;
+	char name[41];
+} array_rows[ARRAY_ROWS];
+static DBINT name_inds[ARRAY_ROWS], notes_inds[ARRAY_ROWS];
+static char notes_array[ARRAY_ROWS][256];
+
+static void
+bind_arrays(DBPROCESS *dbproc)
+{
+	/* strings must have a size and stride must hold a value */
+	assert(dbbind_array(dbproc, 2, NTBSTRINGBIND, 0, (BYTE *) array_rows[0].name, sizeof(array_rows[0]), name_inds) == FAIL);
+	assert(dbbind_array(dbproc, 1, INTBIND, 0, (BYTE *) &array_rows[0].id, 2, NULL) == FAIL);
+
+	assert(dbbind_array(dbproc, 1, INTBIND, 0, (BYTE *) &array_rows[0].id, sizeof(array_rows[0]), NULL) == SUCCEED);
+	assert(dbbind_array(dbproc, 2, NTBSTRINGBIND, sizeof(array_rows[0].name), (BYTE *) array_rows[0].name,
+			    sizeof(array_rows[0]), name_inds) == SUCCEED);
+	assert(dbbind_array(dbproc, 3, NTBSTRINGBIND, sizeof(notes_array[0]), (BYTE *) notes_array, 0, notes_inds) == SUCCEED);
+
+	/* a single indicator can't replace the array of indicators */
+	assert(dbnullbind(dbproc, 2, &name_ind) == FAIL);
+}
+
+static void
+query_nobind(DBPROCESS *dbproc)
+{
+	assert(dbcmd(dbproc, "select * from rowbuffer") == SUCCEED);
+	assert(dbsqlexec(dbproc) == SUCCEED);
+	assert(dbresults(dbproc) == SUCCEED);
+}
+
+static void
+query(DBPROCESS *dbproc)
+{
+	query_nobind(dbproc);
+	bind_columns(dbproc);
+}
+
+static void
+set_buffer(DBPROCESS *dbproc, int capacity)
+{
+	char buf[16];
+
+	sprintf(buf, "%d", capacity);
+	if (capacity > 1)
+		assert(dbsetopt(dbproc, DBBUFFER, buf, 0) == SUCCEED);
+	else
+		assert(dbclropt(dbproc, DBBUFFER, "") == SUCCEED);
+}
+
+/* read all rows, reading buffered rows again when buffer is full */
+static void
+test_buffer(DBPROCESS *dbproc, int capacity)
+{
+	int row = 0, ret;
+
+	printf("Testing buffer of %d rows\n", capacity);
+	set_buffer(dbproc, capacity);
+
+	query(dbproc);
+	while ((ret = dbnextrow(dbproc)) != NO_MORE_ROWS) {
+		int first, last, n;
+
+		if (ret == REG_ROW) {
+			check_row(++row);
+			continue;
+		}
+		assert(ret == BUF_FULL);
+		first = dbfirstrow(dbproc);
+		last = dblastrow(dbproc);
+		assert(last == row);
+		assert(last - first + 1 == capacity);
+
+		for (n = last; n >= first; n -= 7) {
+			assert(dbgetrow(dbproc, n) == REG_ROW);
+			check_row(n);
+		}
+		/* next dbnextrow reads from server */
+		assert(dbgetrow(dbproc, last) == REG_ROW);
+		check_row(last);
+
+		/* free different parts of the buffer, so it wraps */
+		dbclrbuf(dbproc, (row / capacity) % 2 ? capacity / 3 + 1 : capacity - 1);
+	}
+	assert(row == num_rows);
+	assert(dbresults(dbproc) == NO_MORE_RESULTS);
+}
+
+/* bind with conversions, truncation and NULL values without indicators */
+static void
+test_conversions(DBPROCESS *dbproc)
+{
+	DBFLT8 flt = 0;
+	DBBIGINT big = 0;
+	char short_name[8], buf[256];
+	const char *s;
+	int row = 0;
+
+	printf("Testing conversions\n");
+	set_buffer(dbproc, 1);
+	assert(dbsetnull(dbproc, NTBSTRINGBIND, 5, (BYTE *) "NULL") == SUCCEED);
+
+	query_nobind(dbproc);
+	assert(dbbind(dbproc, 1, FLT8BIND, 0, (BYTE *) &flt) == SUCCEED);
+	assert(dbbind(dbproc, 2, NTBSTRINGBIND, sizeof(short_name), (BYTE *) short_name) == SUCCEED);
+	while (dbnextrow(dbproc) == REG_ROW) {
+		++row;
+		assert(row <= 100 ? flt == row : big == row);
+		s = row_text(row, 1, buf);
+		if (!s)
+			s = "NULL";
+		assert(strncmp(short_name, s, sizeof(short_name) - 1) == 0);
+		assert(strlen(short_name) == TDS_MIN(strlen(s), sizeof(short_name) - 1));
+
+		/* binding again during results */
+		if (row == 100)
+			assert(dbbind(dbproc, 1, BIGINTBIND, 0, (BYTE *) &big) == SUCCEED);
+	}
+	assert(row == num_rows);
+	assert(dbresults(dbproc) == NO_MORE_RESULTS);
+	assert(dbsetnull(dbproc, NTBSTRINGBIND, 1, (BYTE *) "") == SUCCEED);
+}
+
+/* read all rows in arrays */
+static void
+test_arrays(DBPROCESS *dbproc, int capacity)
+{
+	int row = 0, ret, i;
+	DBINT got;
+
+	printf("Testing arrays with buffer of %d rows\n", capacity);
+	set_buffer(dbproc, capacity);
+
+	query(dbproc);
+	bind_arrays(dbproc);
+	while ((ret = dbnextrows(dbproc, ARRAY_ROWS, &got)) != NO_MORE_ROWS) {
+		if (ret == BUF_FULL) {
+			assert(got == 0);
+			/* last row is still in the first elements */
+			assert(dbgetrow(dbproc, row) == REG_ROW);
+			check_values(row, array_rows[0].id, array_rows[0].name, name_inds[0], notes_array[0], notes_inds[0]);
+			dbclrbuf(dbproc, capacity);
+			continue;
+		}
+		assert(ret == REG_ROW);
+		assert(got > 0 && got <= ARRAY_ROWS);
+		for (i = 0; i < got; ++i)
+			check_values(++row, array_rows[i].id, array_rows[i].name, name_inds[i], notes_array[i], notes_inds[i]);
+	}
+	assert(got == 0);
+	assert(row == num_rows);
+	assert(dbresults(dbproc) == NO_MORE_RESULTS);
+}
+
+static void
+benchmark(DBPROCESS *dbproc, int rows)
+{
+	struct timeval start;
+	int ret, read;
+	DBINT got;
+
+	num_rows = rows;
+	assert(dbsetopt(dbproc, DBBUFFER, "1000", 0) == SUCCEED);
+
+	gettimeofday(&start, NULL);
+	query(dbproc);
+	read = 0;
+	while ((ret = dbnextrow(dbproc)) != NO_MORE_ROWS) {
+		if (ret == BUF_FULL) {
+			/* scroll back the buffer */
+			int n, last = dblastrow(dbproc);
+
+			for (n = dbfirstrow(dbproc); n <= last; ++n)
+				assert(dbgetrow(dbproc, n) == REG_ROW);
+			dbclrbuf(dbproc, last);
+			continue;
+		}
+		++read;
+	}
+	while (dbresults(dbproc) != NO_MORE_RESULTS)
+		continue;
+	print_rate(&start, read, "rows/second buffered");
+
+	/* unbuffered, a row at a time */
+	set_buffer(dbproc, 1);
+	gettimeofday(&start, NULL);
+	query(dbproc);
+	read = 0;
+	while (dbnextrow(dbproc) == REG_ROW)
+		++read;
+	while (dbresults(dbproc) != NO_MORE_RESULTS)
+		continue;
+	print_rate(&start, read, "rows/second with dbnextrow");
+
+	/* unbuffered, in arrays */
+	gettimeofday(&start, NULL);
+	query(dbproc);
+	bind_arrays(dbproc);
+	read = 0;
+	while (dbnextrows(dbproc, ARRAY_ROWS, &got) == REG_ROW)
+		read += got;
+	while (dbresults(dbproc) != NO_MORE_RESULTS)
+		continue;
+	print_rate(&start, read, "rows/second with dbnextrows");
+
+	/* only copy to bound variables, reading buffered rows again */
+	num_rows = 16;
+	assert(dbsetopt(dbproc, DBBUFFER, "16", 0) == SUCCEED);
+	query(dbproc);
+	while (dbnextrow(dbproc) == REG_ROW)
+		continue;
+	gettimeofday(&start, NULL);
+	for (read = 0; read < rows; )
+		for (ret = 1; ret <= num_rows; ++ret, ++read)
+			dbgetrow(dbproc, ret);
+	print_rate(&start, read, "rows/second with dbgetrow");
+	dbclrbuf(dbproc, num_rows);
+	while (dbnextrow(dbproc) != NO_MORE_ROWS)
+		continue;
+	while (dbresults(dbproc) != NO_MORE_RESULTS)
+		continue;
+
+	num_rows = NUM_ROWS;
+}
+
+static const FAKE_SERVER fake_server = { "rowbuffer", send_rows, NULL };
+
+TEST_MAIN()
+{
+	LOGINREC *login;
+	DBPROCESS *dbproc;
+	tds_thread th;
+	char server[64];
+	int port;
+
+	setbuf(stdout, NULL);
+	setbuf(stderr, NULL);
+
+	unsetenv("TDSHOST");
+	unsetenv("TDSPORT");
+	unsetenv("TDSVER");
+
+	port = fake_server_start(&th, &fake_server);
+	sprintf(server, "127.0.0.1:%d", port);
+
+	dbinit();
+
+	login = dblogin();
+	DBSETLUSER(login, "guest");
+	DBSETLPWD(login, "sybase");
+	DBSETLAPP(login, "rowbuffer");
+	DBSETLVERSION(login, DBVERSION_74);
+	dbproc = dbopen(login, server);
+	assert(dbproc);
+	dbloginfree(login);
+
+	test_buffer(dbproc, 1);
+	test_buffer(dbproc, 100);
+	test_buffer(dbproc, 7);
+	test_buffer(dbproc, 333);
+	/* buffer larger than result */
+	test_buffer(dbproc, 5000);
+
+	test_conversions(dbproc);
+
+	test_arrays(dbproc, 1);
+	/* arrays are filled partially when buffer gets full */
+	test_arrays(dbproc, 100);
+	test_arrays(dbproc, 5000);
+
+	if (argc > 1)
+		benchmark(dbproc, atoi(argv[1]));
+
+	dbclose(dbproc);
+	dbexit();
+	tds_thread_join(th, NULL);
+	return 0;
+}
+#else
+TEST_MAIN()
+{
+	return 0;
+}
+#endif
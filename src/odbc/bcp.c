@@ -418,6 +418,91 @@ odbc_bcp_bind(TDS_DBC *dbc, const void * varaddr, int prefixlen, int varlen,
 	}
 }
 
+/**
+ * \ingroup odbc_bcp
+ * \brief Bind an array of program variables to a table column.
+ *
+ * \param dbc ODBC database connection object
+ * \param varaddr address of first value, NULL to remove the binding
+ * \param stride distance in bytes between values, 0 for packed fixed size values
+ * \param lengths length of every value, negative for default length, can be NULL
+ * \param indicators NULL indicators, -1 for NULL, can be NULL
+ * \param vartype datatype of the values, 0 for the type of the column
+ * \param table_column Nth column, starting at 1, in the table.
+ *
+ * \remarks Use odbc_bcp_sendrows() to send many rows from the arrays in a single call.
+ * \sa 	odbc_bcp_bind(), odbc_bcp_sendrows()
+ */
+void
+odbc_bcp_bind_array(TDS_DBC *dbc, const void * varaddr, int stride, const int * lengths, const short * indicators,
+		    int vartype, int table_column)
+{
+	TDSCOLUMN *colinfo;
+
+	tdsdump_log(TDS_DBG_FUNC, "bcp_bind_array(%p, %p, %d, %p, %p, %d, %d)\n",
+						dbc, varaddr, stride, lengths, indicators, vartype, table_column);
+	if (!dbc->bcpinfo)
+		ODBCBCP_ERROR_RETURN("HY010");
+
+	if (dbc->bcpinfo->direction != BCP_DIRECTION_IN)
+		ODBCBCP_ERROR_RETURN("HY010");
+
+	if (vartype != 0 && !is_tds_type_valid(vartype))
+		ODBCBCP_ERROR_RETURN("HY004");
+
+	if (table_column <= 0 ||  table_column > dbc->bcpinfo->bindinfo->num_cols)
+		ODBCBCP_ERROR_RETURN("HY009");
+
+	colinfo = dbc->bcpinfo->bindinfo->columns[table_column - 1];
+	if (vartype == 0)
+		vartype = tds_get_conversion_type(colinfo->column_type, colinfo->column_size);
+
+	if (stride < 0 || (stride == 0 && !is_fixed_type(vartype)))
+		ODBCBCP_ERROR_RETURN("HY009");
+
+	if (TDS_FAILED(tds_bcp_bind_array(dbc->tds_socket, dbc->bcpinfo, table_column - 1, (TDS_SERVER_TYPE) vartype,
+					  varaddr, stride, (const TDS_INT *) lengths, (const TDS_SMALLINT *) indicators)))
+		ODBCBCP_ERROR_RETURN("07006");
+}
+
+/**
+ * \ingroup odbc_bcp
+ * \brief Write many rows to the table from arrays bound with odbc_bcp_bind_array().
+ *
+ * \param dbc ODBC database connection object
+ * \param num_rows number of rows to send
+ *
+ * \remarks Sending stops at the first row that fails.
+ * \return Count of rows sent, or -1 on error before sending.
+ * \sa 	odbc_bcp_bind_array(), odbc_bcp_batch(), odbc_bcp_done(), odbc_bcp_sendrow()
+ */
+int
+odbc_bcp_sendrows(TDS_DBC *dbc, int num_rows)
+{
+	TDSSOCKET *tds;
+	int rows_sent = 0;
+
+	tdsdump_log(TDS_DBG_FUNC, "bcp_sendrows(%p, %d)\n", dbc, num_rows);
+	if (dbc->bcpinfo == NULL)
+		ODBCBCP_ERROR_DBINT("HY010");
+
+	tds = dbc->tds_socket;
+
+	if (dbc->bcpinfo->direction != BCP_DIRECTION_IN)
+		ODBCBCP_ERROR_DBINT("HY010");
+
+	if (!dbc->bcpinfo->xfer_init) {
+		if (TDS_FAILED(tds_bcp_start_copy_in(tds, dbc->bcpinfo)))
+			ODBCBCP_ERROR_DBINT("HY000");
+		dbc->bcpinfo->xfer_init = true;
+	}
+
+	dbc->bcpinfo->parent = dbc;
+	if (TDS_FAILED(tds_bcp_send_rows(tds, dbc->bcpinfo, 0, num_rows, NULL, &rows_sent)))
+		odbc_errs_add(&dbc->errs, "HY000", NULL);
+	return rows_sent;
+}
+
 static SQLLEN
 _bcp_iconv_helper(const TDS_DBC *dbc, const TDSCOLUMN *bindcol, const TDS_CHAR * src, size_t srclen, char * dest, size_t destlen)
 {
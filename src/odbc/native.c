@@ -86,6 +86,10 @@ to_native(struct _hdbc *dbc, struct _hstmt *stmt, DSTR *str)
 
 	assert(dbc);
 
+	/* no escape sequences, query is already native */
+	if (!strchr(buf, '{'))
+		return SQL_SUCCESS;
+
 	server_scalar = TDS_IS_MSSQL(dbc->tds_socket) && dbc->tds_socket->conn->product_version >= TDS_MS_VER(7, 0, 0);
 
 	/*
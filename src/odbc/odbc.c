@@ -75,6 +75,7 @@ static void odbc_upper_column_names(TDS_STMT * stmt);
 static void odbc_col_setname(TDS_STMT * stmt, int colpos, const char *name);
 static SQLRETURN odbc_stat_execute(TDS_STMT * stmt _WIDE, const char *begin, int nparams, ...);
 static SQLRETURN odbc_free_dynamic(TDS_STMT * stmt);
+static bool odbc_reuse_cached_dynamic(TDS_STMT * stmt);
 static SQLRETURN odbc_free_cursor(TDS_STMT * stmt);
 static SQLRETURN odbc_update_ird(TDS_STMT *stmt, TDS_ERRS *errs);
 static SQLRETURN odbc_prepare(TDS_STMT *stmt);
@@ -1812,6 +1813,7 @@ odbc_SQLAllocEnv(SQLHENV FAR * phenv, SQLINTEGER odbc_version)
 	ctx->locale->date_fmt = strdup("%Y-%m-%d");
 	free(ctx->locale->time_fmt);
 	ctx->locale->time_fmt = strdup("%H:%M:%S.%z");
+	tds_locale_compile_date_plans(ctx->locale);
 
 	tds_mutex_init(&env->mtx);
 	*phenv = (SQLHENV) env;
@@ -3514,8 +3516,7 @@ odbc_SQLExecute(TDS_STMT * stmt)
 
 	stmt->row_count = TDS_NO_COUNT;
 
-	if (stmt->prepared_query_is_rpc) {
-		/* TODO support stmt->apd->header.sql_desc_array_size for RPC */
+	if (stmt->prepared_query_is_rpc && (stmt->num_param_rows <= 1 || !IS_TDS7_PLUS(tds->conn))) {
 		/* get rpc name */
 		/* TODO change method */
 		/* TODO cursor change way of calling */
@@ -3529,6 +3530,35 @@ odbc_SQLExecute(TDS_STMT * stmt)
 		*end = 0;
 		ret = tds_submit_rpc(tds, name, stmt->params, odbc_init_headers(stmt, &head));
 		*end = tmp;
+	} else if (stmt->prepared_query_is_rpc) {
+		/* pack all parameter sets in a single request */
+		TDSMULTIPLE multiple;
+		const char *query = tds_dstr_cstr(&stmt->query);
+		size_t name_len = odbc_skip_rpc_name(query) - query;
+		char *name;
+
+		stmt->prepared_pos = name_len;
+		/* query is parsed again for every parameter set, use a copy */
+		name = tds_strndup(query, name_len);
+		if (!name) {
+			odbc_errs_add(&stmt->errs, "HY001", NULL);
+			return SQL_ERROR;
+		}
+
+		ret = tds_multiple_init(tds, &multiple, TDS_MULTIPLE_RPC, odbc_init_headers(stmt, &head));
+		for (stmt->curr_param_row = 0; TDS_SUCCEED(ret); ) {
+			ret = tds_multiple_rpc(tds, &multiple, name, stmt->params);
+			if (++stmt->curr_param_row >= stmt->num_param_rows)
+				break;
+			/* than process others parameters, parsing restarts after the name */
+			stmt->prepared_pos = name_len;
+			if (start_parse_prepared_query(stmt, true) != SQL_SUCCESS)
+				break;
+		}
+		if (TDS_SUCCEED(ret))
+			ret = tds_multiple_done(tds, &multiple);
+		stmt->prepared_pos = name_len;
+		free(name);
 	} else if (stmt->attr.cursor_type != SQL_CURSOR_FORWARD_ONLY || stmt->attr.concurrency != SQL_CONCUR_READ_ONLY) {
 		ret = odbc_cursor_execute(stmt);
 	} else if (!stmt->is_prepared_query) {
@@ -3562,7 +3592,8 @@ odbc_SQLExecute(TDS_STMT * stmt)
 				ret = tds_multiple_done(tds, &multiple);
 		}
 	} else if (stmt->num_param_rows <= 1 && IS_TDS71_PLUS(tds->conn)
-		   && (!stmt->dyn || stmt->need_reprepare || !stmt->dyn->num_id)) {
+		   && (!stmt->dyn || stmt->need_reprepare || !stmt->dyn->num_id)
+		   && !odbc_reuse_cached_dynamic(stmt)) {
 		if (stmt->dyn) {
 			tdsdump_log(TDS_DBG_INFO1, "Re-prepare dynamic statement (num_id was %d)\n", stmt->dyn->num_id);
 			if (odbc_free_dynamic(stmt) != SQL_SUCCESS)
@@ -3576,7 +3607,8 @@ odbc_SQLExecute(TDS_STMT * stmt)
 		TDSDYNAMIC *dyn;
 
 		/* prepare dynamic query (only for first SQLExecute call) */
-		if (!stmt->dyn || (stmt->need_reprepare && !stmt->dyn->emulated && IS_TDS7_PLUS(tds->conn))) {
+		if ((!stmt->dyn || (stmt->need_reprepare && !stmt->dyn->emulated && IS_TDS7_PLUS(tds->conn)))
+		    && !odbc_reuse_cached_dynamic(stmt)) {
 
 			/* free previous prepared statement */
 			if (stmt->dyn) {
@@ -6658,6 +6690,24 @@ ODBC_FUNC(SQLSetConnectAttr, (P(SQLHDBC,hdbc), P(SQLINTEGER,Attribute), P(SQLPOI
 				      params->terminator, params->termlen, params->vartype, params->table_column);
 		}
 		break;
+	case SQL_COPT_TDSODBC_IMPL_BCP_BIND_ARRAY:
+		if (!ValuePtr)
+			odbc_errs_add(&dbc->errs, "HY009", NULL);
+		else {
+			const struct tdsodbc_impl_bcp_bind_array_params *params =
+				(const struct tdsodbc_impl_bcp_bind_array_params*)ValuePtr;
+			odbc_bcp_bind_array(dbc, params->varaddr, params->stride, params->lengths,
+					    params->indicators, params->vartype, params->table_column);
+		}
+		break;
+	case SQL_COPT_TDSODBC_IMPL_BCP_SENDROWS:
+		if (!ValuePtr)
+			odbc_errs_add(&dbc->errs, "HY009", NULL);
+		else {
+			struct tdsodbc_impl_bcp_sendrows_params *params = (struct tdsodbc_impl_bcp_sendrows_params*)ValuePtr;
+			params->rows_sent = odbc_bcp_sendrows(dbc, params->num_rows);
+		}
+		break;
 	default:
 		odbc_errs_add(&dbc->errs, "HY092", NULL);
 		break;
@@ -7686,7 +7736,8 @@ odbc_free_dynamic(TDS_STMT * stmt)
 		return TDS_SUCCESS;
 
 	tds = stmt->dbc->tds_socket;
-	if (!tds_needs_unprepare(tds->conn, stmt->dyn)) {
+	if (!tds_needs_unprepare(tds->conn, stmt->dyn)
+	    || tds_dynamic_cache_put(tds->conn, stmt->dyn)) {
 		tds_release_dynamic(&stmt->dyn);
 		return SQL_SUCCESS;
 	}
@@ -7709,6 +7760,31 @@ odbc_free_dynamic(TDS_STMT * stmt)
 	return SQL_ERROR;
 }
 
+/**
+ * Replace statement dynamic with a prepared one from connection cache.
+ * \return true if a prepared dynamic was found
+ */
+static bool
+odbc_reuse_cached_dynamic(TDS_STMT * stmt)
+{
+	TDSDYNAMIC *dyn;
+
+	dyn = tds_dynamic_cache_get(stmt->tds, tds_dstr_cstr(&stmt->query), stmt->params);
+	if (!dyn)
+		return false;
+
+	if (odbc_free_dynamic(stmt) != SQL_SUCCESS) {
+		tds_deferred_unprepare(stmt->tds->conn, dyn);
+		tds_release_dynamic(&dyn);
+		return false;
+	}
+
+	tdsdump_log(TDS_DBG_INFO1, "Reusing prepared statement %s\n", dyn->id);
+	stmt->dyn = dyn;
+	stmt->need_reprepare = 0;
+	return true;
+}
+
 /**
  * Close server cursors
  */
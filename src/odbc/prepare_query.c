@@ -241,11 +241,18 @@ int
 start_parse_prepared_query(struct _hstmt *stmt, bool compute_row)
 {
 	/* TODO should be NULL already ?? */
-	tds_free_param_results(stmt->params);
+	TDSPARAMINFO *old_params = stmt->params;
+	int res;
+
 	stmt->params = NULL;
 
 	stmt->param_num = stmt->prepared_query_is_func ? 2 : 1;
-	return parse_prepared_query(stmt, compute_row);
+	res = parse_prepared_query(stmt, compute_row);
+
+	/* parameters are built again, keep query caches */
+	tds_move_param_caches(stmt->params, old_params);
+	tds_free_param_results(old_params);
+	return res;
 }
 
 static ptrdiff_t
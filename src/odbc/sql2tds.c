@@ -171,13 +171,54 @@ _odbc_blob_free(TDSCOLUMN *col)
         TDS_ZERO_FREE(col->column_data);
 }
 
+/**
+ * Convert next row of a TVP while the parameter is sent.
+ * Rows are read from application buffers one at a time, reusing
+ * the same row so memory does not depend on the number of rows.
+ * Errors are recorded in the statement diagnostics.
+ */
+static TDSRET
+odbc_tvp_fetch(TDSSOCKET *tds TDS_UNUSED, TDS_TVP *table)
+{
+	SQLTVP *src = (SQLTVP *) table->fetch_param;
+	TDS_STMT *stmt = src->stmt;
+	TDS_DESC *apd = src->apd, *ipd = src->ipd;
+	TDSPARAMINFO *params, *new_params;
+	SQLRETURN ret;
+	int j;
+
+	if (table->num_fetched >= src->num_rows)
+		return TDS_NO_MORE_RESULTS;
+
+	params = table->fetch_row;
+	if (!params) {
+		for (j = 0; j < ipd->header.sql_desc_count; j++) {
+			if (!(new_params = tds_alloc_param_result(params))) {
+				tds_free_param_results(params);
+				odbc_errs_add(&stmt->errs, "HY001", NULL);
+				return TDS_FAIL;
+			}
+			params = new_params;
+		}
+		table->fetch_row = params;
+	}
+
+	for (j = 0; j < ipd->header.sql_desc_count; j++) {
+		ret = odbc_sql2tds(stmt, &ipd->records[j], &apd->records[j], params->columns[j], true, apd,
+				   (SQLSETPOSIROW) table->num_fetched);
+		/* data cannot be requested while the table is being sent */
+		if (ret == SQL_NEED_DATA)
+			odbc_errs_add(&stmt->errs, "HYC00", "Data at execution are not supported for TVP columns");
+		if (!SQL_SUCCEEDED(ret))
+			return TDS_FAIL;
+	}
+	return TDS_SUCCESS;
+}
+
 static SQLRETURN
 odbc_convert_table(TDS_STMT *stmt, SQLTVP *src, TDS_TVP *dest, SQLLEN num_rows)
 {
-	SQLLEN i;
 	int j;
-	TDS_TVP_ROW *row;
-	TDS_TVP_ROW **prow;
 	TDSPARAMINFO *params, *new_params;
 	TDS_DESC *apd = src->apd, *ipd = src->ipd;
 	SQLRETURN ret;
@@ -232,28 +273,11 @@ odbc_convert_table(TDS_STMT *stmt, SQLTVP *src, TDS_TVP *dest, SQLLEN num_rows)
 	}
 	dest->metadata = params;
 
-	for (i = 0, prow = &dest->row; i < num_rows; prow = &(*prow)->next, i++) {
-		if ((row = tds_new0(TDS_TVP_ROW, 1)) == NULL)
-			goto Memory_Error;
-
-		*prow = row;
-
-		params = NULL;
-		for (j = 0; j < ipd->header.sql_desc_count; j++) {
-			if (!(new_params = tds_alloc_param_result(params))) {
-				tds_free_param_results(params);
-				goto Memory_Error;
-			}
-			params = new_params;
-
-			ret = odbc_sql2tds(stmt, &ipd->records[j], &apd->records[j], new_params->columns[j], true, apd, i);
-			if (!SQL_SUCCEEDED(ret)) {
-				tds_free_param_results(params);
-				return ret;
-			}
-		}
-		row->params = params;
-	}
+	/* rows are converted while sending, not all kept in memory */
+	src->stmt = stmt;
+	src->num_rows = num_rows;
+	dest->fetch = odbc_tvp_fetch;
+	dest->fetch_param = src;
 
 	return SQL_SUCCESS;
 
@@ -190,6 +190,18 @@ TEST_MAIN()
 		query_test(FLAG_NO_STAT, SQL_ERROR, "??????????");
 		query_test(FLAG_NO_STAT | FLAG_PREPARE, SQL_ERROR, "??????????");
 
+		/* RPC, all parameter sets are sent in a single request */
+		odbc_command("create proc #array_ins @id int, @value varchar(20) as "
+			     "insert into #tmp1(id, value) values(@id, @value)");
+		test_query = T("{call #array_ins(?, ?)}");
+		multiply = 1;
+		query_test(0, SQL_SUCCESS, "VVVVVVVVVV");
+		query_test(0, SQL_SUCCESS_WITH_INFO, "VV!!!!!!!!");
+		multiply = 1;
+		query_test(FLAG_PREPARE, SQL_SUCCESS, "VVVVVVVVVV");
+		query_test(FLAG_PREPARE, SQL_SUCCESS_WITH_INFO, "VV!!!!!!!!");
+		odbc_command("drop proc #array_ins");
+
 #ifdef ENABLE_DEVELOPING
 		/* with result, see how SQLMoreResult work */
 		test_query = T("INSERT INTO #tmp1 (id) VALUES (?) SELECT * FROM #tmp1 UPDATE #tmp1 SET value = ?");
@@ -36,6 +36,30 @@
 #include <stdlib.h>
 #endif /* HAVE_STDLIB_H */
 
+#if HAVE_SYS_TYPES_H
+#include <sys/types.h>
+#endif /* HAVE_SYS_TYPES_H */
+
+#if HAVE_SYS_STAT_H
+#include <sys/stat.h>
+#endif /* HAVE_SYS_STAT_H */
+
+#if HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif /* HAVE_SYS_MMAN_H */
+
+#if HAVE_UNISTD_H
+#include <unistd.h>
+#endif /* HAVE_UNISTD_H */
+
+#ifdef _WIN32
+#include <io.h>
+#endif
+
+#if HAVE_ZLIB
+#include <zlib.h>
+#endif /* HAVE_ZLIB */
+
 #include <assert.h>
 
 #include <freetds/tds.h>
@@ -48,6 +72,28 @@
 #include <freetds/replacements.h>
 #include <freetds/enum_cap.h>
 
+#ifdef HAVE_FSEEKO
+typedef off_t offset_type;
+#elif defined(_WIN32) || defined(_WIN64)
+/* win32 version */
+typedef __int64 offset_type;
+# if defined(HAVE__FSEEKI64) && defined(HAVE__FTELLI64)
+#  define fseeko(f,o,w) _fseeki64((f),o,w)
+#  define ftello(f) _ftelli64((f))
+# else
+#  define fseeko(f,o,w) (_lseeki64(fileno(f),o,w) == -1 ? -1 : 0)
+#  define ftello(f) _telli64(fileno(f))
+# endif
+#else
+/* use old version */
+#define fseeko(f,o,w) fseek(f,o,w)
+#define ftello(f) ftell(f)
+typedef long offset_type;
+#endif
+
+/** size of chunks of decompressed data read from compressed files */
+#define TDS_HOSTFILE_CHUNK 0x20000
+
 /**
  * Holds clause buffer
  */
@@ -437,6 +483,43 @@ tds_bcp_start_insert_stmt(TDSSOCKET * tds, TDSBCPINFO * bcpinfo)
 	return TDS_SUCCESS;
 }
 
+/**
+ * Send a column value of a row, TDS 7+ only
+ * \tds
+ * \param bindcol column to send
+ * \param data    data to send, already converted to column type
+ * \param datalen length of data
+ * \param is_null true to send a NULL value
+ */
+static TDSRET
+tds7_put_bcp_column(TDSSOCKET *tds, TDSCOLUMN *bindcol, const TDS_UCHAR *data, TDS_INT datalen, bool is_null)
+{
+	TDS_INT save_size;
+	unsigned char *save_data;
+	TDSBLOB blob;
+	TDSRET rc;
+
+	save_size = bindcol->column_cur_size;
+	save_data = bindcol->column_data;
+	assert(bindcol->column_data == NULL);
+	if (is_null) {
+		bindcol->column_cur_size = -1;
+	} else if (is_blob_col(bindcol)) {
+		bindcol->column_cur_size = datalen;
+		memset(&blob, 0, sizeof(blob));
+		blob.textvalue = (TDS_CHAR *) data;
+		bindcol->column_data = (unsigned char *) &blob;
+	} else {
+		bindcol->column_cur_size = datalen;
+		bindcol->column_data = (unsigned char *) data;
+	}
+	rc = bindcol->funcs->put_data(tds, bindcol, 1);
+	bindcol->column_cur_size = save_size;
+	bindcol->column_data = save_data;
+
+	return rc;
+}
+
 static TDSRET
 tds7_send_record(TDSSOCKET *tds, TDSBCPINFO *bcpinfo,
 		 tds_bcp_get_col_data get_col_data, tds_bcp_null_error null_error, int offset)
@@ -446,9 +529,6 @@ tds7_send_record(TDSSOCKET *tds, TDSBCPINFO *bcpinfo,
 	tds_put_byte(tds, TDS_ROW_TOKEN);   /* 0xd1 */
 	for (i = 0; i < bcpinfo->bindinfo->num_cols; i++) {
 
-		TDS_INT save_size;
-		unsigned char *save_data;
-		TDSBLOB blob;
 		TDSCOLUMN  *bindcol;
 		TDSRET rc;
 
@@ -473,30 +553,14 @@ tds7_send_record(TDSSOCKET *tds, TDSBCPINFO *bcpinfo,
 		tdsdump_log(TDS_DBG_INFO1, "gotten column %d length %d null %d\n",
 				i + 1, bindcol->bcp_column_data->datalen, bindcol->bcp_column_data->is_null);
 
-		save_size = bindcol->column_cur_size;
-		save_data = bindcol->column_data;
-		assert(bindcol->column_data == NULL);
-		if (bindcol->bcp_column_data->is_null) {
-			if (!bindcol->column_nullable && !is_nullable_type(bindcol->on_server.column_type)) {
-				if (null_error)
-					null_error(bcpinfo, i, offset);
-				return TDS_FAIL;
-			}
-			bindcol->column_cur_size = -1;
-		} else if (is_blob_col(bindcol)) {
-			bindcol->column_cur_size = bindcol->bcp_column_data->datalen;
-			memset(&blob, 0, sizeof(blob));
-			blob.textvalue = (TDS_CHAR *) bindcol->bcp_column_data->data;
-			bindcol->column_data = (unsigned char *) &blob;
-		} else {
-			bindcol->column_cur_size = bindcol->bcp_column_data->datalen;
-			bindcol->column_data = bindcol->bcp_column_data->data;
+		if (bindcol->bcp_column_data->is_null
+		    && !bindcol->column_nullable && !is_nullable_type(bindcol->on_server.column_type)) {
+			if (null_error)
+				null_error(bcpinfo, i, offset);
+			return TDS_FAIL;
 		}
-		rc = bindcol->funcs->put_data(tds, bindcol, 1);
-		bindcol->column_cur_size = save_size;
-		bindcol->column_data = save_data;
-
-		TDS_PROPAGATE(rc);
+		TDS_PROPAGATE(tds7_put_bcp_column(tds, bindcol, bindcol->bcp_column_data->data,
+						  bindcol->bcp_column_data->datalen, bindcol->bcp_column_data->is_null));
 	}
 	return TDS_SUCCESS;
 }
@@ -605,6 +669,431 @@ tds_bcp_send_record(TDSSOCKET *tds, TDSBCPINFO *bcpinfo,
 	return rc;
 }
 
+/** Column array bound with tds_bcp_bind_array or result column bound with tds_bcp_bind_column */
+struct tds_bcp_array
+{
+	const TDSCONTEXT *ctx;
+	/** first value */
+	const TDS_UCHAR *data;
+	/** distance in bytes between values */
+	TDS_INT stride;
+	/** length of values, NULL to use default lengths */
+	const TDS_INT *lengths;
+	/** NULL indicators (-1 for NULL), can be NULL */
+	const TDS_SMALLINT *indicators;
+	/** result column bound with tds_bcp_bind_column, values are taken from current row */
+	const TDSCOLUMN *column;
+	/** length of fixed type values, 0 for variable types */
+	TDS_INT fixed_size;
+	/** values are characters, default length stops at first NUL */
+	bool is_char;
+	/** values can be sent without conversion */
+	bool direct;
+	/** conversion to column type */
+	TDS_CONVERTER conv;
+};
+
+/**
+ * Setup the array of a column to send values of a given type.
+ * \return array or NULL if conversion is not possible.
+ */
+static struct tds_bcp_array *
+tds_bcp_alloc_array(TDSSOCKET *tds, TDSCOLUMN *bindcol, TDS_SERVER_TYPE type)
+{
+	struct tds_bcp_array *array;
+	TDS_SERVER_TYPE desttype;
+
+	desttype = tds_get_conversion_type(bindcol->column_type, bindcol->column_size);
+	if (!is_tds_type_valid(type) || !tds_willconvert(type, desttype))
+		return NULL;
+
+	array = bindcol->bcp_column_data->array;
+	if (!array) {
+		array = tds_new0(struct tds_bcp_array, 1);
+		if (!array)
+			return NULL;
+		bindcol->bcp_column_data->array = array;
+	}
+	memset(array, 0, sizeof(*array));
+
+	array->ctx = tds_get_ctx(tds);
+	array->fixed_size = is_fixed_type(type) ? tds_get_size_by_type(type) : 0;
+	array->is_char = is_ascii_type(type);
+
+	/* same representation, data can be sent as is */
+	array->direct = (type == desttype && is_fixed_type(type) && !is_numeric_type(type))
+		|| (is_ascii_type(type) && is_ascii_type(desttype))
+		|| (is_binary_type(type) && is_binary_type(desttype));
+	tds_convert_resolve(&array->conv, type, desttype);
+	array->conv.precision = bindcol->column_prec;
+	array->conv.scale = bindcol->column_scale;
+
+	return array;
+}
+
+/**
+ * Bind an array of values to a column for tds_bcp_send_rows.
+ * Types and conversions are resolved here, not for every row.
+ * A length in \a lengths (or all lengths if \a lengths is NULL) lower
+ * than zero means the default length, that is the size of the type for
+ * fixed types, the string length up to \a stride for characters
+ * and \a stride for binaries.
+ * \tds
+ * \param bcpinfo BCP information, columns already initialized
+ * \param column column index (0 based)
+ * \param type type of values in the array
+ * \param data first value, NULL to remove binding
+ * \param stride distance in bytes between values, 0 for packed fixed size values
+ * \param lengths length of every value, can be NULL
+ * \param indicators NULL indicators, -1 for NULL, can be NULL
+ * \return TDS_SUCCESS or TDS_FAIL.
+ */
+TDSRET
+tds_bcp_bind_array(TDSSOCKET *tds, TDSBCPINFO *bcpinfo, int column, TDS_SERVER_TYPE type, const void *data,
+		   TDS_INT stride, const TDS_INT *lengths, const TDS_SMALLINT *indicators)
+{
+	TDSCOLUMN *bindcol;
+	struct tds_bcp_array *array;
+
+	tdsdump_log(TDS_DBG_FUNC, "tds_bcp_bind_array(%p, %p, %d, %d, %p, %d, %p, %p)\n",
+		    tds, bcpinfo, column, type, data, stride, lengths, indicators);
+
+	if (!bcpinfo->bindinfo || column < 0 || column >= bcpinfo->bindinfo->num_cols)
+		return TDS_FAIL;
+	bindcol = bcpinfo->bindinfo->columns[column];
+	if (!bindcol->bcp_column_data)
+		return TDS_FAIL;
+
+	if (!data) {
+		TDS_ZERO_FREE(bindcol->bcp_column_data->array);
+		return TDS_SUCCESS;
+	}
+
+	if (stride <= 0) {
+		if (!is_fixed_type(type))
+			return TDS_FAIL;
+		stride = tds_get_size_by_type(type);
+	}
+
+	array = tds_bcp_alloc_array(tds, bindcol, type);
+	if (!array)
+		return TDS_FAIL;
+
+	array->data = (const TDS_UCHAR *) data;
+	array->stride = stride;
+	array->lengths = lengths;
+	array->indicators = indicators;
+
+	return TDS_SUCCESS;
+}
+
+/**
+ * Bind a column of a result set to a column for tds_bcp_send_rows.
+ * Every row sent takes the value of the current row of the result
+ * so rows read from a connection can be copied to another.
+ * Values of the same type are sent as they are, without conversion.
+ * \tds
+ * \param bcpinfo BCP information, columns already initialized
+ * \param column column index (0 based)
+ * \param src result column, NULL to remove binding
+ * \return TDS_SUCCESS or TDS_FAIL.
+ */
+TDSRET
+tds_bcp_bind_column(TDSSOCKET *tds, TDSBCPINFO *bcpinfo, int column, const TDSCOLUMN *src)
+{
+	TDSCOLUMN *bindcol;
+	struct tds_bcp_array *array;
+
+	tdsdump_log(TDS_DBG_FUNC, "tds_bcp_bind_column(%p, %p, %d, %p)\n", tds, bcpinfo, column, src);
+
+	if (!bcpinfo->bindinfo || column < 0 || column >= bcpinfo->bindinfo->num_cols)
+		return TDS_FAIL;
+	bindcol = bcpinfo->bindinfo->columns[column];
+	if (!bindcol->bcp_column_data)
+		return TDS_FAIL;
+
+	if (!src) {
+		TDS_ZERO_FREE(bindcol->bcp_column_data->array);
+		return TDS_SUCCESS;
+	}
+
+	array = tds_bcp_alloc_array(tds, bindcol, tds_get_conversion_type(src->column_type, src->column_size));
+	if (!array)
+		return TDS_FAIL;
+
+	array->column = src;
+
+	return TDS_SUCCESS;
+}
+
+/**
+ * Get a value from a column array.
+ * \return length of the value, -1 for NULL.
+ */
+static TDS_INT
+tds_bcp_array_value(const struct tds_bcp_array *array, int row, const TDS_UCHAR **pdata)
+{
+	const TDS_UCHAR *data;
+	const TDS_UCHAR *end;
+	TDS_INT len;
+
+	if (!array || (array->indicators && array->indicators[row] == -1))
+		return -1;
+
+	if (array->column) {
+		const TDSCOLUMN *col = array->column;
+
+		if (col->column_cur_size < 0)
+			return -1;
+		if (is_blob_col(col))
+			*pdata = (const TDS_UCHAR *) ((const TDSBLOB *) col->column_data)->textvalue;
+		else
+			*pdata = col->column_data;
+		return col->column_cur_size;
+	}
+
+	data = array->data + (size_t) row * array->stride;
+	*pdata = data;
+	if (array->fixed_size)
+		return array->fixed_size;
+	len = array->lengths ? array->lengths[row] : -1;
+	if (len >= 0)
+		return len;
+	if (array->is_char && (end = (const TDS_UCHAR *) memchr(data, 0, array->stride)) != NULL)
+		return (TDS_INT) (end - data);
+	return array->stride;
+}
+
+/**
+ * Convert a value from a column array.
+ * \return length of converted value, < 0 on error.
+ */
+static TDS_INT
+tds_bcp_array_convert(const struct tds_bcp_array *array, const TDSCOLUMN *bindcol, const TDS_UCHAR *src, TDS_INT srclen,
+		      CONV_RESULT *cr)
+{
+	TDS_INT len;
+
+	if (is_numeric_type(array->conv.desttype)) {
+		cr->n.precision = bindcol->column_prec;
+		cr->n.scale = bindcol->column_scale;
+	}
+	len = array->conv.convert(array->ctx, &array->conv, src, srclen, cr);
+	if (len < 0)
+		tdsdump_log(TDS_DBG_ERROR, "conversion of column %s failed (%d)\n",
+			    tds_dstr_cstr(&bindcol->column_name), len);
+	return len;
+}
+
+/**
+ * Fill bcp_column_data from column array.
+ * Used as get_col_data for TDS 5.0.
+ */
+static TDSRET
+tds_bcp_get_array_data(TDSBCPINFO *bcpinfo TDS_UNUSED, TDSCOLUMN *bindcol, int offset)
+{
+	BCPCOLDATA *coldata = bindcol->bcp_column_data;
+	const struct tds_bcp_array *array = coldata->array;
+	const TDS_UCHAR *src = NULL;
+	CONV_RESULT cr, *p_cr;
+	bool variable;
+	TDS_INT len;
+
+	len = tds_bcp_array_value(array, offset, &src);
+	if (len < 0) {
+		coldata->datalen = 0;
+		coldata->is_null = true;
+		return TDS_SUCCESS;
+	}
+	coldata->is_null = false;
+
+	variable = is_variable_type(array->conv.desttype);
+	p_cr = variable ? &cr : (CONV_RESULT *) coldata->data;
+	len = tds_bcp_array_convert(array, bindcol, src, len, p_cr);
+	if (len < 0)
+		return TDS_FAIL;
+
+	coldata->datalen = len;
+	if (variable) {
+		free(coldata->data);
+		coldata->data = (TDS_UCHAR *) cr.c;
+	}
+	return TDS_SUCCESS;
+}
+
+static bool
+tds7_bcp_column_skipped(const TDSBCPINFO *bcpinfo, const TDSCOLUMN *bindcol)
+{
+	return (!bcpinfo->identity_insert_on && bindcol->column_identity) ||
+		bindcol->column_timestamp || bindcol->column_computed;
+}
+
+/**
+ * Free values converted by tds7_convert_row for the first num_cols columns.
+ */
+static void
+tds7_free_converted_row(TDSBCPINFO *bcpinfo, int num_cols, CONV_RESULT *converted, const TDS_INT *lens)
+{
+	int i;
+
+	for (i = 0; i < num_cols; i++) {
+		TDSCOLUMN *bindcol = bcpinfo->bindinfo->columns[i];
+		const struct tds_bcp_array *array = bindcol->bcp_column_data->array;
+
+		if (tds7_bcp_column_skipped(bcpinfo, bindcol) || lens[i] < 0 || array->direct)
+			continue;
+		if (is_variable_type(array->conv.desttype))
+			TDS_ZERO_FREE(converted[i].c);
+	}
+}
+
+/**
+ * Check and convert all values of a row before sending it, so a
+ * failure does not leave a partial row on the wire.
+ * lens[i] is set to -1 for NULL values; values needing a conversion
+ * are stored in converted[i].
+ */
+static TDSRET
+tds7_convert_row(TDSBCPINFO *bcpinfo, int row, tds_bcp_null_error null_error, CONV_RESULT *converted, TDS_INT *lens)
+{
+	TDSRESULTINFO *bindinfo = bcpinfo->bindinfo;
+	int i;
+
+	for (i = 0; i < bindinfo->num_cols; i++) {
+		TDSCOLUMN *bindcol = bindinfo->columns[i];
+		const struct tds_bcp_array *array = bindcol->bcp_column_data->array;
+		const TDS_UCHAR *src = NULL;
+		TDS_INT len;
+
+		lens[i] = -1;
+		if (tds7_bcp_column_skipped(bcpinfo, bindcol))
+			continue;
+
+		len = tds_bcp_array_value(array, row, &src);
+		if (len < 0) {
+			if (!bindcol->column_nullable && !is_nullable_type(bindcol->on_server.column_type)) {
+				if (null_error)
+					null_error(bcpinfo, i, row);
+				break;
+			}
+		} else if (!array->direct) {
+			len = tds_bcp_array_convert(array, bindcol, src, len, &converted[i]);
+			if (len < 0)
+				break;
+		}
+		lens[i] = len;
+	}
+	if (i < bindinfo->num_cols) {
+		tds7_free_converted_row(bcpinfo, i, converted, lens);
+		return TDS_FAIL;
+	}
+	return TDS_SUCCESS;
+}
+
+/**
+ * Send rows from column arrays, TDS 7+ only.
+ * Values not requiring conversion are sent directly from arrays.
+ */
+static TDSRET
+tds7_send_rows(TDSSOCKET *tds, TDSBCPINFO *bcpinfo, int offset, int num_rows,
+	       tds_bcp_null_error null_error, int *rows_sent)
+{
+	TDSRESULTINFO *bindinfo = bcpinfo->bindinfo;
+	CONV_RESULT *converted;
+	TDS_INT *lens;
+	TDSRET rc = TDS_SUCCESS;
+	int row, i;
+
+	converted = tds_new(CONV_RESULT, bindinfo->num_cols);
+	lens = tds_new(TDS_INT, bindinfo->num_cols);
+	if (!converted || !lens) {
+		free(converted);
+		free(lens);
+		return TDS_FAIL;
+	}
+
+	for (row = offset; TDS_SUCCEED(rc) && row < offset + num_rows; ++row) {
+		rc = tds7_convert_row(bcpinfo, row, null_error, converted, lens);
+		if (TDS_FAILED(rc))
+			break;
+
+		tds_put_byte(tds, TDS_ROW_TOKEN);
+		for (i = 0; TDS_SUCCEED(rc) && i < bindinfo->num_cols; i++) {
+			TDSCOLUMN *bindcol = bindinfo->columns[i];
+			const struct tds_bcp_array *array = bindcol->bcp_column_data->array;
+			const TDS_UCHAR *src = NULL;
+
+			if (tds7_bcp_column_skipped(bcpinfo, bindcol))
+				continue;
+
+			if (lens[i] < 0) {
+				rc = tds7_put_bcp_column(tds, bindcol, NULL, 0, true);
+			} else if (array->direct) {
+				tds_bcp_array_value(array, row, &src);
+				rc = tds7_put_bcp_column(tds, bindcol, src, lens[i], false);
+			} else if (is_variable_type(array->conv.desttype)) {
+				rc = tds7_put_bcp_column(tds, bindcol, (TDS_UCHAR *) converted[i].c, lens[i], false);
+			} else {
+				rc = tds7_put_bcp_column(tds, bindcol, (TDS_UCHAR *) &converted[i], lens[i], false);
+			}
+		}
+		tds7_free_converted_row(bcpinfo, bindinfo->num_cols, converted, lens);
+		if (TDS_SUCCEED(rc))
+			++*rows_sent;
+	}
+
+	free(converted);
+	free(lens);
+	return rc;
+}
+
+/**
+ * Send rows of data to server from column arrays bound with tds_bcp_bind_array.
+ * Columns without an array bound are sent as NULL.
+ * Sending stops at the first row which can't be sent.
+ * \tds
+ * \param bcpinfo BCP information
+ * \param offset first row of the arrays to send
+ * \param num_rows number of rows to send
+ * \param null_error function to call if we try to send NULL if not allowed, can be NULL
+ * \param rows_sent where to store number of rows sent, can be NULL
+ * \return TDS_SUCCESS or TDS_FAIL.
+ */
+TDSRET
+tds_bcp_send_rows(TDSSOCKET *tds, TDSBCPINFO *bcpinfo, int offset, int num_rows,
+		  tds_bcp_null_error null_error, int *rows_sent)
+{
+	TDSRET rc = TDS_SUCCESS;
+	int sent = 0;
+
+	tdsdump_log(TDS_DBG_FUNC, "tds_bcp_send_rows(%p, %p, %d, %d, %p, %p)\n",
+		    tds, bcpinfo, offset, num_rows, null_error, rows_sent);
+
+	if (rows_sent)
+		*rows_sent = 0;
+
+	if (offset < 0 || num_rows < 0)
+		return TDS_FAIL;
+
+	if (tds->out_flag != TDS_BULK || tds_set_state(tds, TDS_WRITING) != TDS_WRITING)
+		return TDS_FAIL;
+
+	if (IS_TDS7_PLUS(tds->conn)) {
+		rc = tds7_send_rows(tds, bcpinfo, offset, num_rows, null_error, &sent);
+	} else {
+		for (; sent < num_rows; ++sent) {
+			rc = tds5_send_record(tds, bcpinfo, tds_bcp_get_array_data, null_error, offset + sent);
+			if (TDS_FAILED(rc))
+				break;
+		}
+	}
+
+	tds_set_state(tds, TDS_SENDING);
+	if (rows_sent)
+		*rows_sent = sent;
+	return rc;
+}
+
 static inline void
 tds5_swap_data(const TDSCOLUMN *col TDS_UNUSED, void *p TDS_UNUSED)
 {
@@ -1353,13 +1842,12 @@ tds_file_stream_read(TDSINSTREAM *stream, void *ptr, size_t len)
 }
 
 /**
- * Read a data file, passing the data through iconv().
- * \retval TDS_SUCCESS  success
- * \retval TDS_FAIL     error reading the column
- * \retval TDS_NO_MORE_RESULTS end of file detected
+ * Read a terminated field from a file, passing the data through iconv().
+ * \param allocated bytes allocated for *outbuf, updated, allows to reuse the buffer
  */
-TDSRET
-tds_bcp_fread(TDSSOCKET * tds, TDSICONV * char_conv, FILE * stream, const char *terminator, size_t term_len, char **outbuf, size_t * outbytes)
+static TDSRET
+tds_bcp_fread_buf(TDSSOCKET * tds, TDSICONV * char_conv, FILE * stream, const char *terminator, size_t term_len,
+		  char **outbuf, size_t * allocated, size_t * outbytes)
 {
 	TDSRET res;
 	TDSFILESTREAM r;
@@ -1388,9 +1876,10 @@ tds_bcp_fread(TDSSOCKET * tds, TDSICONV * char_conv, FILE * stream, const char *
 		return TDS_FAIL;
 	}
 
-	res = tds_dynamic_stream_init(&w, (void**) outbuf, 0);
+	res = tds_dynamic_stream_init(&w, (void**) outbuf, *allocated);
 	if (TDS_FAILED(res)) {
 		free(r.left);
+		*allocated = 0;
 		return res;
 	}
 
@@ -1402,6 +1891,7 @@ tds_bcp_fread(TDSSOCKET * tds, TDSICONV * char_conv, FILE * stream, const char *
 		res = tds_convert_stream(tds, char_conv, to_server, &r.stream, &w.stream);
 	funlockfile(stream);
 	free(r.left);
+	*allocated = w.allocated;
 
 	TDS_PROPAGATE(res);
 
@@ -1413,10 +1903,353 @@ tds_bcp_fread(TDSSOCKET * tds, TDSICONV * char_conv, FILE * stream, const char *
 
 	((char *) w.stream.buffer)[0] = 0;
 	w.stream.write(&w.stream, 1);
+	*allocated = w.allocated;
 
 	return res;
 }
 
+/**
+ * Read a data file, passing the data through iconv().
+ * \retval TDS_SUCCESS  success
+ * \retval TDS_FAIL     error reading the column
+ * \retval TDS_NO_MORE_RESULTS end of file detected
+ */
+TDSRET
+tds_bcp_fread(TDSSOCKET * tds, TDSICONV * char_conv, FILE * stream, const char *terminator, size_t term_len, char **outbuf, size_t * outbytes)
+{
+	size_t allocated = 0;
+
+	return tds_bcp_fread_buf(tds, char_conv, stream, terminator, term_len, outbuf, &allocated, outbytes);
+}
+
+/**
+ * Prepare a data file for reading.
+ * Regular files are mapped in memory so fields can be returned without
+ * copying them, other files (like pipes) are read using stdio.
+ * \param f file to read, owned by the returned object
+ * \return new object or NULL on error (file is not closed in this case).
+ */
+TDSBCPHOSTFILE *
+tds_bcp_hostfile_open(FILE *f)
+{
+	TDSBCPHOSTFILE *hf;
+
+	hf = tds_new0(TDSBCPHOSTFILE, 1);
+	if (!hf)
+		return NULL;
+	hf->f = f;
+
+#if HAVE_SYS_MMAN_H && defined(S_ISREG)
+	{
+		struct stat st;
+		off_t pos = ftello(f);
+
+		/* map the file from the beginning, skip what was already read */
+		if (pos >= 0 && fstat(fileno(f), &st) == 0 && S_ISREG(st.st_mode)
+		    && st.st_size > pos && (off_t) (size_t) st.st_size == st.st_size) {
+			void *map = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fileno(f), 0);
+
+			if (map != MAP_FAILED) {
+#ifdef MADV_SEQUENTIAL
+				madvise(map, (size_t) st.st_size, MADV_SEQUENTIAL);
+#endif
+				hf->map = (const char *) map;
+				hf->map_size = (size_t) st.st_size;
+				hf->pos = (size_t) pos;
+			}
+		}
+	}
+#endif
+	tdsdump_log(TDS_DBG_INFO1, "bcp host file %s\n", hf->map ? "mapped" : "read using stdio");
+	return hf;
+}
+
+/**
+ * Prepare a gzip compressed data file for reading.
+ * Data are decompressed in chunks, files not compressed are read as they are.
+ * \param f file to read, owned by the returned object
+ * \return new object or NULL on error or if compression is not supported
+ *         (file is not closed in this case).
+ */
+TDSBCPHOSTFILE *
+tds_bcp_hostfile_open_compressed(FILE *f)
+{
+#if HAVE_ZLIB
+	TDSBCPHOSTFILE *hf;
+	int fd;
+
+	hf = tds_new0(TDSBCPHOSTFILE, 1);
+	if (!hf)
+		return NULL;
+	hf->f = f;
+	hf->zbuf_size = TDS_HOSTFILE_CHUNK;
+	hf->zbuf = tds_new(char, hf->zbuf_size);
+	hf->map = hf->zbuf;
+
+	/* zlib closes the descriptor it reads from, f is closed separately */
+	fd = dup(fileno(f));
+	if (!hf->zbuf || fd < 0 || (hf->gz = gzdopen(fd, "rb")) == NULL) {
+		if (fd >= 0)
+			close(fd);
+		free(hf->zbuf);
+		free(hf);
+		return NULL;
+	}
+
+	tdsdump_log(TDS_DBG_INFO1, "bcp host file read using zlib\n");
+	return hf;
+#else
+	tdsdump_log(TDS_DBG_ERROR, "compressed bcp host file not supported\n");
+	return NULL;
+#endif
+}
+
+/**
+ * Close a data file opened with tds_bcp_hostfile_open.
+ * \return 0 on success, EOF on error closing the file
+ */
+int
+tds_bcp_hostfile_close(TDSBCPHOSTFILE *hf)
+{
+	int res;
+
+	if (!hf)
+		return 0;
+
+#if HAVE_SYS_MMAN_H
+	if (hf->map && !hf->zbuf)
+		munmap((void *) hf->map, hf->map_size);
+#endif
+	res = 0;
+#if HAVE_ZLIB
+	if (hf->gz && gzclose(hf->gz) != Z_OK)
+		res = EOF;
+#endif
+	if (fclose(hf->f) != 0)
+		res = EOF;
+	free(hf->zbuf);
+	free(hf->buf);
+	free(hf);
+	return res;
+}
+
+/**
+ * Check if end of data file was reached by a read.
+ */
+bool
+tds_bcp_hostfile_eof(TDSBCPHOSTFILE *hf)
+{
+	if (hf->map)
+		return hf->eof && !hf->error;
+	return feof(hf->f) != 0;
+}
+
+/**
+ * Get current position in a data file.
+ * For compressed files this is the position in decompressed data.
+ */
+TDS_INT8
+tds_bcp_hostfile_tell(TDSBCPHOSTFILE *hf)
+{
+	if (hf->map)
+		return hf->map_offset + (TDS_INT8) hf->pos;
+	return (TDS_INT8) ftello(hf->f);
+}
+
+/**
+ * Set current position in a data file.
+ * For compressed files this is the position in decompressed data,
+ * going back before data still in memory requires to decompress
+ * again from the beginning.
+ * Positions outside a mapped file fail.
+ */
+TDSRET
+tds_bcp_hostfile_seek(TDSBCPHOSTFILE *hf, TDS_INT8 pos)
+{
+	hf->eof = false;
+	if (!hf->map)
+		return fseeko(hf->f, (offset_type) pos, SEEK_SET) == 0 ? TDS_SUCCESS : TDS_FAIL;
+
+	if (pos >= hf->map_offset && (TDS_UINT8) (pos - hf->map_offset) <= hf->map_size) {
+		hf->pos = (size_t) (pos - hf->map_offset);
+		return TDS_SUCCESS;
+	}
+#if HAVE_ZLIB
+	if (hf->gz) {
+		/* z_off_t can be 32 bit, do not truncate offset */
+		if ((TDS_INT8) (z_off_t) pos != pos || gzseek(hf->gz, (z_off_t) pos, SEEK_SET) < 0)
+			return TDS_FAIL;
+		hf->map_offset = pos;
+		hf->map_size = hf->pos = 0;
+		return TDS_SUCCESS;
+	}
+#endif
+	/* past end of mapped file, or before part of file mapped */
+	return TDS_FAIL;
+}
+
+/**
+ * Make sure some bytes are available in memory, decompressing more data if needed.
+ * \return true if \a len bytes are available from current position
+ */
+static bool
+tds_bcp_hostfile_need(TDSBCPHOSTFILE *hf, size_t len)
+{
+#if HAVE_ZLIB
+	while (hf->gz && hf->map_size - hf->pos < len) {
+		size_t left = hf->map_size - hf->pos;
+		int got;
+
+		/* discard data already read and make room for more */
+		memmove(hf->zbuf, hf->zbuf + hf->pos, left);
+		hf->map_offset += hf->pos;
+		hf->pos = 0;
+		hf->map_size = left;
+		if (hf->zbuf_size - left < TDS_HOSTFILE_CHUNK) {
+			if (!TDS_RESIZE(hf->zbuf, left + TDS_HOSTFILE_CHUNK))
+				return false;
+			hf->zbuf_size = left + TDS_HOSTFILE_CHUNK;
+			hf->map = hf->zbuf;
+		}
+		got = gzread(hf->gz, hf->zbuf + left, (unsigned) (hf->zbuf_size - left));
+		if (got <= 0) {
+			int errnum;
+			const char *msg = gzerror(hf->gz, &errnum);
+
+			/* Z_BUF_ERROR at end means the file is truncated */
+			if (got < 0 || errnum != Z_OK) {
+				tdsdump_log(TDS_DBG_ERROR, "error decompressing bcp host file: %s\n", msg);
+				hf->error = true;
+			}
+			return false;
+		}
+		hf->map_size += got;
+	}
+#endif
+	return hf->map_size - hf->pos >= len;
+}
+
+/**
+ * Read some bytes from a data file.
+ * \param len bytes to read
+ * \param data where to store pointer to data read, valid till next read
+ * \return TDS_SUCCESS or TDS_FAIL if not all data were read.
+ */
+TDSRET
+tds_bcp_hostfile_read(TDSBCPHOSTFILE *hf, size_t len, const char **data)
+{
+	if (hf->map) {
+		if (!tds_bcp_hostfile_need(hf, len)) {
+			hf->pos = hf->map_size;
+			hf->eof = true;
+			return TDS_FAIL;
+		}
+		*data = hf->map + hf->pos;
+		hf->pos += len;
+		return TDS_SUCCESS;
+	}
+
+	if (len >= hf->buf_size) {
+		if (!TDS_RESIZE(hf->buf, len + 1)) {
+			hf->buf_size = 0;
+			return TDS_FAIL;
+		}
+		hf->buf_size = len + 1;
+	}
+	*data = hf->buf;
+	if (len && fread(hf->buf, len, 1, hf->f) != 1)
+		return TDS_FAIL;
+	return TDS_SUCCESS;
+}
+
+/**
+ * Search a terminator in a buffer.
+ * \return start of terminator or NULL if not found
+ */
+static const char *
+tds_bcp_find_terminator(const char *p, const char *end, const char *terminator, size_t term_len)
+{
+	if ((size_t) (end - p) < term_len)
+		return NULL;
+
+	/* memchr is usually optimized (vectorized) by C library */
+	end -= term_len - 1;
+	while ((p = (const char *) memchr(p, terminator[0], end - p)) != NULL) {
+		if (memcmp(p, terminator, term_len) == 0)
+			return p;
+		++p;
+	}
+	return NULL;
+}
+
+/**
+ * Read a terminated field from a data file, passing the data through iconv().
+ * If no conversion is needed, mapped data are returned without copying them.
+ * \param data where to store pointer to field data, valid till next read
+ * \param len where to store length of field data
+ * \retval TDS_SUCCESS  success
+ * \retval TDS_FAIL     error reading the column
+ * \retval TDS_NO_MORE_RESULTS end of file detected
+ */
+TDSRET
+tds_bcp_hostfile_read_field(TDSSOCKET *tds, TDSICONV *char_conv, TDSBCPHOSTFILE *hf,
+			    const char *terminator, size_t term_len, const char **data, size_t *len)
+{
+	TDSSTATICINSTREAM r;
+	TDSDYNAMICSTREAM w;
+	const char *start, *found;
+	size_t scanned = 0;
+	TDSRET res;
+
+	if (!hf->map) {
+		res = tds_bcp_fread_buf(tds, char_conv, hf->f, terminator, term_len, &hf->buf, &hf->buf_size, len);
+		*data = hf->buf;
+		return res;
+	}
+
+	if (!tds_bcp_hostfile_need(hf, 1)) {
+		hf->eof = true;
+		return TDS_NO_MORE_RESULTS;
+	}
+
+	/* search terminator, decompressing more data if needed */
+	while (!(found = tds_bcp_find_terminator(hf->map + hf->pos + scanned, hf->map + hf->map_size,
+						 terminator, term_len))) {
+		size_t avail = hf->map_size - hf->pos;
+
+		/* terminator can start in the last bytes */
+		scanned = avail >= term_len ? avail - term_len + 1 : 0;
+		if (!tds_bcp_hostfile_need(hf, avail + 1)) {
+			hf->pos = hf->map_size;
+			hf->eof = true;
+			return TDS_FAIL;
+		}
+	}
+	start = hf->map + hf->pos;
+	hf->pos = found - hf->map + term_len;
+
+	if (char_conv == NULL || (char_conv->flags & TDS_ENCODING_MEMCPY) != 0) {
+		*data = start;
+		*len = found - start;
+		return TDS_SUCCESS;
+	}
+
+	/* convert to buffer */
+	tds_staticin_stream_init(&r, start, found - start);
+	res = tds_dynamic_stream_init(&w, (void **) &hf->buf, hf->buf_size);
+	if (TDS_FAILED(res)) {
+		hf->buf_size = 0;
+		return res;
+	}
+	res = tds_convert_stream(tds, char_conv, to_server, &r.stream, &w.stream);
+	hf->buf_size = w.allocated;
+	TDS_PROPAGATE(res);
+
+	*data = hf->buf;
+	*len = w.size;
+	return TDS_SUCCESS;
+}
+
 /**
  * Start writing writetext request.
  * This request start a bulk session.
@@ -246,6 +246,7 @@ tds_read_config_info(TDSSOCKET * tds, TDSLOGIN * login, TDSLOCALE * locale)
 		tdsdump_log(TDS_DBG_INFO1, "\t%20s = %" tdsPRIdir "\n", "dump_file", connection->dump_file);
 		tdsdump_log(TDS_DBG_INFO1, "\t%20s = %x\n", "debug_flags", connection->debug_flags);
 		tdsdump_log(TDS_DBG_INFO1, "\t%20s = %d\n", "text_size", connection->text_size);
+		tdsdump_log(TDS_DBG_INFO1, "\t%20s = %d\n", "dyn_cache_size", connection->dyn_cache_size);
 		tdsdump_log(TDS_DBG_INFO1, "\t%20s = %s\n", "server_realm_name", tds_dstr_cstr(&connection->server_realm_name));
 		tdsdump_log(TDS_DBG_INFO1, "\t%20s = %s\n", "server_spn", tds_dstr_cstr(&connection->server_spn));
 		tdsdump_log(TDS_DBG_INFO1, "\t%20s = %s\n", "cafile", tds_dstr_cstr(&connection->cafile));
@@ -662,6 +663,9 @@ tds_parse_conf_section(const char *option, const char *value, void *param)
 	} else if (!strcmp(option, TDS_STR_TEXTSZ)) {
 		if (atoi(value) > 0)
 			login->text_size = atoi(value);
+	} else if (!strcmp(option, TDS_STR_DYNCACHE)) {
+		if (atoi(value) >= 0)
+			login->dyn_cache_size = atoi(value);
 	} else if (!strcmp(option, TDS_STR_CHARSET)) {
 		s = tds_dstr_copy(&login->server_charset, value);
 		tdsdump_log(TDS_DBG_INFO1, "%s is %s.\n", option, tds_dstr_cstr(&login->server_charset));
@@ -804,6 +808,9 @@ tds_config_login(TDSLOGIN * connection, TDSLOGIN * login)
 	if (login->query_timeout)
 		connection->query_timeout = login->query_timeout;
 
+	if (login->dyn_cache_size)
+		connection->dyn_cache_size = login->dyn_cache_size;
+
 	if (!login->check_ssl_hostname)
 		connection->check_ssl_hostname = login->check_ssl_hostname;
 
@@ -27,6 +27,7 @@
 
 #include <assert.h>
 #include <ctype.h>
+#include <float.h>
 
 #if HAVE_ERRNO_H
 #include <errno.h>
@@ -49,6 +50,7 @@
 #include <freetds/bytes.h>
 #include <freetds/replacements.h>
 #include <freetds/utils.h>
+#include <freetds/thread.h>
 
 typedef unsigned short utf16_t;
 
@@ -66,6 +68,9 @@ struct tds_time
 static TDS_INT tds_convert_int(TDS_INT num, int desttype, CONV_RESULT * cr);
 static TDS_INT tds_convert_uint8(const TDS_UINT8 * src, int desttype, CONV_RESULT * cr);
 static int string_to_datetime(const char *datestr, TDS_UINT len, int desttype, CONV_RESULT * cr);
+static int tds_time_to_result(const struct tds_time *t, int desttype, CONV_RESULT * cr);
+static size_t tds_locale_strftime(const struct tds_date_plan *plan, char *buf, size_t maxsize, const char *format,
+				  const TDSDATEREC * dr, int prec);
 static bool is_dd_mon_yyyy(char *t);
 static int store_dd_mon_yyy_date(char *datestr, struct tds_time *t);
 static const char *parse_numeric(const char *buf, const char *pend,
@@ -186,6 +191,290 @@ string_to_result(int desttype, const char *s, CONV_RESULT * cr)
 	return (TDS_INT)len;
 }
 
+static const char two_digits[201] =
+	"00010203040506070809"
+	"10111213141516171819"
+	"20212223242526272829"
+	"30313233343536373839"
+	"40414243444546474849"
+	"50515253545556575859"
+	"60616263646566676869"
+	"70717273747576777879"
+	"80818283848586878889"
+	"90919293949596979899";
+
+/**
+ * Write decimal digits of an unsigned number backward.
+ * @param end pointer past last character to write
+ * @return pointer to first digit written
+ */
+static char *
+format_uint8(char *end, TDS_UINT8 num)
+{
+	TDS_UINT n32;
+
+	while (num > 0xffffffffu) {
+		n32 = (TDS_UINT) (num % 100u);
+		num /= 100u;
+		end -= 2;
+		memcpy(end, two_digits + n32 * 2, 2);
+	}
+	/* finish with faster 32 bit operations */
+	n32 = (TDS_UINT) num;
+	while (n32 >= 100) {
+		TDS_UINT rem = n32 % 100u;
+		n32 /= 100u;
+		end -= 2;
+		memcpy(end, two_digits + rem * 2, 2);
+	}
+	if (n32 >= 10) {
+		end -= 2;
+		memcpy(end, two_digits + n32 * 2, 2);
+	} else {
+		*--end = (char) ('0' + n32);
+	}
+	return end;
+}
+
+/**
+ * Format an integer number to result, same as sprintf "%d" would do.
+ * @param negative true if number is negative, num contains absolute value
+ */
+static TDS_INT
+uint8_to_result(int desttype, TDS_UINT8 num, bool negative, CONV_RESULT * cr)
+{
+	char tmp_str[24], *p;
+
+	p = tmp_str + sizeof(tmp_str) - 1;
+	*p = 0;
+	p = format_uint8(p, num);
+	if (negative)
+		*--p = '-';
+	return string_to_result(desttype, p, cr);
+}
+
+#undef FORMAT_FLOAT_BITS
+#if defined(__GNUC__) && SIZEOF___INT128 > 0
+typedef unsigned __int128 float_frac_t;
+#define FORMAT_FLOAT_BITS 128
+#else
+typedef TDS_UINT8 float_frac_t;
+#define FORMAT_FLOAT_BITS 64
+#endif
+
+/**
+ * Format a floating point number exactly as sprintf "%.<prec>g" would do.
+ * Numbers which would be written without exponent are computed
+ * directly from the binary representation (exact, rounding half to even
+ * like the C library); all other cases are delegated to sprintf.
+ * @param out   output buffer, at least 32 bytes
+ * @param value number to format
+ * @param prec  number of significant digits (max 17)
+ */
+static void
+format_float(char *out, double value, int prec)
+{
+	static const TDS_UINT8 limits[] = {
+		UINT64_C(1), UINT64_C(10), UINT64_C(100), UINT64_C(1000), UINT64_C(10000),
+		UINT64_C(100000), UINT64_C(1000000), UINT64_C(10000000), UINT64_C(100000000),
+		UINT64_C(1000000000), UINT64_C(10000000000), UINT64_C(100000000000),
+		UINT64_C(1000000000000), UINT64_C(10000000000000), UINT64_C(100000000000000),
+		UINT64_C(1000000000000000), UINT64_C(10000000000000000),
+		UINT64_C(100000000000000000),
+	};
+	TDS_UINT8 bits, mant, ip;
+	float_frac_t frac, mask;
+	int exp, fbits, x, ndigits, last, i;
+	bool negative;
+	char digits[24], *p;
+
+	assert(prec > 0 && prec <= 17);
+
+	memcpy(&bits, &value, sizeof(bits));
+	negative = (bits >> 63) != 0;
+	exp = (int) ((bits >> 52) & 0x7ff);
+	mant = bits & ((UINT64_C(1) << 52) - 1);
+
+	/* infinite, NaN and denormals */
+	if (exp == 0x7ff || (exp == 0 && mant != 0))
+		goto slow;
+
+	p = out;
+	if (negative)
+		*p++ = '-';
+	if (exp == 0) {
+		strcpy(p, "0");
+		return;
+	}
+
+	/* value = mant * 2^exp */
+	mant |= UINT64_C(1) << 52;
+	exp -= 1075;
+	while ((mant & 0xff) == 0 && exp <= -8) {
+		mant >>= 8;
+		exp += 8;
+	}
+	while ((mant & 1) == 0 && exp < 0) {
+		mant >>= 1;
+		++exp;
+	}
+
+	if (exp >= 0) {
+		if (exp >= 64 || (mant >> (63 - exp)) != 0)
+			goto slow;
+		ip = mant << exp;
+		fbits = 0;
+		frac = 0;
+	} else {
+		fbits = -exp;
+		/* we need 4 bits more to multiply by 10 */
+		if (fbits > FORMAT_FLOAT_BITS - 4)
+			goto slow;
+		ip = fbits >= 53 ? 0 : mant >> fbits;
+		frac = mant;
+	}
+	mask = (((float_frac_t) 1) << fbits) - 1;
+	frac &= mask;
+
+	/* would be formatted using exponent */
+	if (ip >= limits[prec])
+		goto slow;
+
+	/* compute significant digits */
+	if (ip) {
+		p = format_uint8(digits + sizeof(digits), ip);
+		ndigits = (int) (digits + sizeof(digits) - p);
+		memmove(digits, p, ndigits);
+		x = ndigits - 1;
+	} else {
+		/* skip zeroes after the point */
+		x = -1;
+		for (;;) {
+			frac *= 10u;
+			digits[0] = (char) ('0' + (int) (frac >> fbits));
+			frac &= mask;
+			if (digits[0] != '0')
+				break;
+			/* would be formatted using exponent */
+			if (--x < -4)
+				goto slow;
+		}
+		ndigits = 1;
+	}
+	for (; ndigits < prec; ++ndigits) {
+		frac *= 10u;
+		digits[ndigits] = (char) ('0' + (int) (frac >> fbits));
+		frac &= mask;
+	}
+
+	/* round half to even */
+	if (fbits) {
+		float_frac_t half = ((float_frac_t) 1) << (fbits - 1);
+
+		if (frac > half || (frac == half && (digits[ndigits - 1] & 1) != 0)) {
+			for (i = ndigits - 1; i >= 0 && digits[i] == '9'; --i)
+				digits[i] = '0';
+			/* exponent changed, rare, let library handle it */
+			if (i < 0)
+				goto slow;
+			++digits[i];
+		}
+	}
+
+	/* remove trailing zeroes */
+	last = ndigits;
+	while (last > x + 1 && last > 1 && digits[last - 1] == '0')
+		--last;
+
+	p = out;
+	if (negative)
+		*p++ = '-';
+	if (x >= 0) {
+		memcpy(p, digits, x + 1);
+		p += x + 1;
+		if (last > x + 1) {
+			*p++ = '.';
+			memcpy(p, digits + x + 1, last - x - 1);
+			p += last - x - 1;
+		}
+	} else {
+		*p++ = '0';
+		*p++ = '.';
+		for (i = x + 1; i < 0; ++i)
+			*p++ = '0';
+		memcpy(p, digits, last);
+		p += last;
+	}
+	*p = 0;
+	return;
+
+slow:
+	sprintf(out, "%.*g", prec, value);
+}
+
+/**
+ * Load 8 characters as a little endian number.
+ * First character is in the lower byte.
+ */
+static inline TDS_UINT8
+load8_le(const char *p)
+{
+	return TDS_GET_UA4LE(p) | (((TDS_UINT8) TDS_GET_UA4LE(p + 4)) << 32);
+}
+
+/**
+ * Check 8 characters (loaded with load8_le) are all decimal digits.
+ * Each byte must be in the 0x30-0x39 range, so both high nibble and
+ * high nibble after adding 6 must be 3.
+ */
+#define ALL_DIGITS8(v) \
+	((((v) & UINT64_C(0xF0F0F0F0F0F0F0F0)) \
+	  | ((((v) + UINT64_C(0x0606060606060606)) & UINT64_C(0xF0F0F0F0F0F0F0F0)) >> 4)) \
+	 == UINT64_C(0x3333333333333333))
+
+/**
+ * Convert 8 decimal digits (loaded with load8_le) to a number.
+ * Digits are combined in pairs, then in groups of 4, then 8.
+ */
+static inline TDS_UINT
+parse_digits8(TDS_UINT8 v)
+{
+	v = ((v & UINT64_C(0x0F0F0F0F0F0F0F0F)) * 2561u) >> 8;
+	v = ((v & UINT64_C(0x00FF00FF00FF00FF)) * 6553601u) >> 16;
+	return (TDS_UINT) (((v & UINT64_C(0x0000FFFF0000FFFF)) * UINT64_C(42949672960001)) >> 32);
+}
+
+/**
+ * Skip decimal digits, 8 at a time if possible.
+ * @return pointer to first not digit character or pend
+ */
+static const char *
+skip_digits(const char *p, const char *pend)
+{
+	while (pend - p >= 8 && ALL_DIGITS8(load8_le(p)))
+		p += 8;
+	while (p != pend && TDS_ISDIGIT(*p))
+		++p;
+	return p;
+}
+
+/**
+ * Accumulate decimal digits to a number.
+ * Caller must check digits are valid and result cannot overflow.
+ * @param num  initial value
+ * @param p    digits to add
+ * @param n    number of digits
+ */
+static TDS_UINT8
+accumulate_digits(TDS_UINT8 num, const char *p, size_t n)
+{
+	for (; n >= 8; n -= 8, p += 8)
+		num = num * 100000000u + parse_digits8(load8_le(p));
+	for (; n; --n)
+		num = num * 10u + (*p++ - '0');
+	return num;
+}
+
 /**
  * Copy binary data to to result and return len or TDS_CONVERT_NOMEM
  */
@@ -645,13 +934,12 @@ tds_convert_int8_numeric(unsigned char scale,
 static TDS_INT
 tds_convert_int(TDS_INT num, int desttype, CONV_RESULT * cr)
 {
-	TDS_CHAR tmp_str[16];
-
 	switch (desttype) {
 	case TDS_CONVERT_CHAR:
 	case CASE_ALL_CHAR:
-		sprintf(tmp_str, "%d", num);
-		return string_to_result(desttype, tmp_str, cr);
+		if (num < 0)
+			return uint8_to_result(desttype, 0u - (TDS_UINT) num, true, cr);
+		return uint8_to_result(desttype, (TDS_UINT) num, false, cr);
 		break;
 	case SYBSINT1:
 		if (!IS_SINT1(num))
@@ -745,7 +1033,6 @@ static TDS_INT
 tds_convert_int8(const TDS_INT8 *src, int desttype, CONV_RESULT * cr)
 {
 	TDS_INT8 buf;
-	TDS_CHAR tmp_str[24];
 
 	memcpy(&buf, src, sizeof(buf));
 	if (INT_IS_INT(buf))
@@ -754,8 +1041,9 @@ tds_convert_int8(const TDS_INT8 *src, int desttype, CONV_RESULT * cr)
 	switch (desttype) {
 	case TDS_CONVERT_CHAR:
 	case CASE_ALL_CHAR:
-		sprintf(tmp_str, "%" PRId64, buf);
-		return string_to_result(desttype, tmp_str, cr);
+		if (buf < 0)
+			return uint8_to_result(desttype, 0u - (TDS_UINT8) buf, true, cr);
+		return uint8_to_result(desttype, (TDS_UINT8) buf, false, cr);
 		break;
 	case SYBINT1:
 	case SYBSINT1:
@@ -823,7 +1111,6 @@ static TDS_INT
 tds_convert_uint8(const TDS_UINT8 *src, int desttype, CONV_RESULT * cr)
 {
 	TDS_UINT8 buf;
-	TDS_CHAR tmp_str[24];
 
 	memcpy(&buf, src, sizeof(buf));
 	/* INT_IS_INT does not work here due to unsigned/signed conversions */
@@ -833,8 +1120,7 @@ tds_convert_uint8(const TDS_UINT8 *src, int desttype, CONV_RESULT * cr)
 	switch (desttype) {
 	case TDS_CONVERT_CHAR:
 	case CASE_ALL_CHAR:
-		sprintf(tmp_str, "%" PRIu64, buf);
-		return string_to_result(desttype, tmp_str, cr);
+		return uint8_to_result(desttype, buf, false, cr);
 		break;
 	case SYBINT1:
 	case SYBSINT1:
@@ -896,6 +1182,37 @@ tds_convert_uint8(const TDS_UINT8 *src, int desttype, CONV_RESULT * cr)
 	return TDS_CONVERT_NOAVAIL;
 }
 
+/**
+ * Convert a numeric to double if the result can be computed exactly
+ * with a single division, giving the same result as atof.
+ * @return false if the number is too big or has too many decimals
+ */
+static bool
+numeric_to_double_fast(const TDS_NUMERIC * src, double *res)
+{
+	static const double pow10[] = {
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+	};
+	TDS_UINT8 num = 0;
+	int i, bytes;
+
+	if (src->precision < 1 || src->precision > MAXPRECISION || src->scale > src->precision
+	    || src->scale >= TDS_VECTOR_SIZE(pow10))
+		return false;
+
+	bytes = tds_numeric_bytes_per_prec[src->precision];
+	for (i = 1; i < bytes; ++i) {
+		num = (num << 8) | src->array[i];
+		if (num >> 53)
+			return false;
+	}
+	*res = (double) num / pow10[src->scale];
+	if (src->array[0] == 1)
+		*res = -*res;
+	return true;
+}
+
 static TDS_INT
 tds_convert_numeric(const TDS_NUMERIC * src, int desttype, CONV_RESULT * cr)
 {
@@ -903,6 +1220,7 @@ tds_convert_numeric(const TDS_NUMERIC * src, int desttype, CONV_RESULT * cr)
 	TDS_INT i, ret;
 	TDS_UINT ui;
 	TDS_INT8 bi;
+	double flt;
 
 	switch (desttype) {
 	case TDS_CONVERT_CHAR:
@@ -1067,15 +1385,20 @@ tds_convert_numeric(const TDS_NUMERIC * src, int desttype, CONV_RESULT * cr)
 		}
 		break;
 	case SYBFLT8:
-		if (tds_numeric_to_string(src, tmpstr) < 0)
-			return TDS_CONVERT_FAIL;
-		cr->f = atof(tmpstr);
+		if (!numeric_to_double_fast(src, &cr->f)) {
+			if (tds_numeric_to_string(src, tmpstr) < 0)
+				return TDS_CONVERT_FAIL;
+			cr->f = atof(tmpstr);
+		}
 		return 8;
 		break;
 	case SYBREAL:
-		if (tds_numeric_to_string(src, tmpstr) < 0)
-			return TDS_CONVERT_FAIL;
-		cr->r = (TDS_REAL) atof(tmpstr);
+		if (!numeric_to_double_fast(src, &flt)) {
+			if (tds_numeric_to_string(src, tmpstr) < 0)
+				return TDS_CONVERT_FAIL;
+			flt = atof(tmpstr);
+		}
+		cr->r = (TDS_REAL) flt;
 		return 4;
 		break;
 		/* conversions not allowed */
@@ -1328,6 +1651,7 @@ tds_convert_datetimeall(const TDSCONTEXT * tds_ctx, int srctype, const TDS_DATET
 {
 	char whole_date_string[64];
 	const char *datetime_fmt;
+	const struct tds_date_plan *plan;
 	TDSDATEREC when;
 
 	switch (desttype) {
@@ -1335,12 +1659,17 @@ tds_convert_datetimeall(const TDSCONTEXT * tds_ctx, int srctype, const TDS_DATET
 	case CASE_ALL_CHAR:
 		tds_datecrack(srctype, dta, &when);
 		datetime_fmt = tds_ctx->locale->datetime_fmt;
-		if (srctype == SYBMSDATE && tds_ctx->locale->date_fmt)
+		plan = tds_ctx->locale->datetime_plan;
+		if (srctype == SYBMSDATE && tds_ctx->locale->date_fmt) {
 			datetime_fmt = tds_ctx->locale->date_fmt;
-		if (srctype == SYBMSTIME && tds_ctx->locale->time_fmt)
+			plan = tds_ctx->locale->date_plan;
+		}
+		if (srctype == SYBMSTIME && tds_ctx->locale->time_fmt) {
 			datetime_fmt = tds_ctx->locale->time_fmt;
-		tds_strftime(whole_date_string, sizeof(whole_date_string), datetime_fmt, &when,
-		             dta->time_prec);
+			plan = tds_ctx->locale->time_plan;
+		}
+		tds_locale_strftime(plan, whole_date_string, sizeof(whole_date_string), datetime_fmt, &when,
+				    dta->time_prec);
 
 		return string_to_result(desttype, whole_date_string, cr);
 	case SYBDATETIME:
@@ -1405,7 +1734,8 @@ tds_convert_datetime(const TDSCONTEXT * tds_ctx, const TDS_DATETIME * dt, int de
 	case TDS_CONVERT_CHAR:
 	case CASE_ALL_CHAR:
 		tds_datecrack(SYBDATETIME, dt, &when);
-		tds_strftime(whole_date_string, sizeof(whole_date_string), tds_ctx->locale->datetime_fmt, &when, 3);
+		tds_locale_strftime(tds_ctx->locale->datetime_plan, whole_date_string, sizeof(whole_date_string),
+				    tds_ctx->locale->datetime_fmt, &when, 3);
 
 		return string_to_result(desttype, whole_date_string, cr);
 	case SYBDATETIME:
@@ -1580,7 +1910,7 @@ tds_convert_real(const TDS_REAL* src, int desttype, CONV_RESULT * cr)
 	switch (desttype) {
 	case TDS_CONVERT_CHAR:
 	case CASE_ALL_CHAR:
-		sprintf(tmp_str, "%.9g", the_value);
+		format_float(tmp_str, the_value, 9);
 		return string_to_result(desttype, tmp_str, cr);
 		break;
 	case SYBSINT1:
@@ -1689,13 +2019,13 @@ static TDS_INT
 tds_convert_flt8(const TDS_FLOAT* src, int desttype, CONV_RESULT * cr)
 {
 	TDS_FLOAT the_value;
-	char tmp_str[25];
+	char tmp_str[32];
 
 	memcpy(&the_value, src, 8);
 	switch (desttype) {
 	case TDS_CONVERT_CHAR:
 	case CASE_ALL_CHAR:
-		sprintf(tmp_str, "%.17g", the_value);
+		format_float(tmp_str, the_value, 17);
 		return string_to_result(desttype, tmp_str, cr);
 		break;
 	case SYBSINT1:
@@ -2084,6 +2414,280 @@ tds_convert(const TDSCONTEXT *tds_ctx, int srctype, const void *src, TDS_UINT sr
 	return length;
 }
 
+/* converter using tds_convert for all cases we don't specialize */
+static TDS_INT
+tds_converter_generic(const TDSCONTEXT *tds_ctx, const TDS_CONVERTER *conv, const void *src, TDS_UINT srclen,
+		      CONV_RESULT *cr)
+{
+	return tds_convert(tds_ctx, conv->srctype, src, srclen, conv->desttype, cr);
+}
+
+/*
+ * Define a converter for a conversion that can't fail, like copying
+ * a value of same type or enlarging an integer.
+ * Source can be unaligned (arrays with odd strides) so copy it first.
+ */
+#define CONVERTER(name, src_type, field, dest_type) \
+static TDS_INT \
+tds_converter_ ## name(const TDSCONTEXT *tds_ctx TDS_UNUSED, const TDS_CONVERTER *conv TDS_UNUSED, \
+		       const void *src, TDS_UINT srclen TDS_UNUSED, CONV_RESULT *cr) \
+{ \
+	src_type value; \
+	memcpy(&value, src, sizeof(value)); \
+	cr->field = (dest_type) value; \
+	return sizeof(dest_type); \
+}
+
+CONVERTER(uint1_uint1, TDS_TINYINT, ti, TDS_TINYINT)
+CONVERTER(uint1_int2, TDS_TINYINT, si, TDS_SMALLINT)
+CONVERTER(uint1_int4, TDS_TINYINT, i, TDS_INT)
+CONVERTER(uint1_int8, TDS_TINYINT, bi, TDS_INT8)
+CONVERTER(uint1_flt8, TDS_TINYINT, f, TDS_FLOAT)
+CONVERTER(int2_int2, TDS_SMALLINT, si, TDS_SMALLINT)
+CONVERTER(int2_int4, TDS_SMALLINT, i, TDS_INT)
+CONVERTER(int2_int8, TDS_SMALLINT, bi, TDS_INT8)
+CONVERTER(int2_flt8, TDS_SMALLINT, f, TDS_FLOAT)
+CONVERTER(int4_int4, TDS_INT, i, TDS_INT)
+CONVERTER(int4_int8, TDS_INT, bi, TDS_INT8)
+CONVERTER(int4_flt8, TDS_INT, f, TDS_FLOAT)
+CONVERTER(int8_int8, TDS_INT8, bi, TDS_INT8)
+CONVERTER(real_real, TDS_REAL, r, TDS_REAL)
+CONVERTER(real_flt8, TDS_REAL, f, TDS_FLOAT)
+CONVERTER(flt8_flt8, TDS_FLOAT, f, TDS_FLOAT)
+CONVERTER(datetime_datetime, TDS_DATETIME, dt, TDS_DATETIME)
+CONVERTER(datetime4_datetime4, TDS_DATETIME4, dt4, TDS_DATETIME4)
+CONVERTER(date_date, TDS_DATE, date, TDS_DATE)
+CONVERTER(time_time, TDS_TIME, time, TDS_TIME)
+CONVERTER(unique_unique, TDS_UNIQUE, u, TDS_UNIQUE)
+
+#undef CONVERTER
+
+static const struct {
+	TDS_SERVER_TYPE srctype, desttype;
+	TDS_CONVERT_FUNC convert;
+} converters[] = {
+	{ SYBINT1, SYBINT1, tds_converter_uint1_uint1 },
+	{ SYBINT1, SYBINT2, tds_converter_uint1_int2 },
+	{ SYBINT1, SYBINT4, tds_converter_uint1_int4 },
+	{ SYBINT1, SYBINT8, tds_converter_uint1_int8 },
+	{ SYBINT1, SYBFLT8, tds_converter_uint1_flt8 },
+	{ SYBINT2, SYBINT2, tds_converter_int2_int2 },
+	{ SYBINT2, SYBINT4, tds_converter_int2_int4 },
+	{ SYBINT2, SYBINT8, tds_converter_int2_int8 },
+	{ SYBINT2, SYBFLT8, tds_converter_int2_flt8 },
+	{ SYBINT4, SYBINT4, tds_converter_int4_int4 },
+	{ SYBINT4, SYBINT8, tds_converter_int4_int8 },
+	{ SYBINT4, SYBFLT8, tds_converter_int4_flt8 },
+	{ SYBINT8, SYBINT8, tds_converter_int8_int8 },
+	{ SYBREAL, SYBREAL, tds_converter_real_real },
+	{ SYBREAL, SYBFLT8, tds_converter_real_flt8 },
+	{ SYBFLT8, SYBFLT8, tds_converter_flt8_flt8 },
+	{ SYBDATETIME, SYBDATETIME, tds_converter_datetime_datetime },
+	{ SYBDATETIME4, SYBDATETIME4, tds_converter_datetime4_datetime4 },
+	{ SYBDATE, SYBDATE, tds_converter_date_date },
+	{ SYBTIME, SYBTIME, tds_converter_time_time },
+	{ SYBUNIQUE, SYBUNIQUE, tds_converter_unique_unique },
+};
+
+/**
+ * Resolve the function to use to convert from a type to another.
+ * This should be called once (for instance when a column is bound),
+ * the converter can then be used for all values of the column,
+ * avoiding the dispatch done by tds_convert for every value.
+ * The converter gives the same results as tds_convert.
+ * @param conv     converter to initialize
+ * @param srctype  type of source
+ * @param desttype type of destination
+ * @return function to call to convert values
+ */
+TDS_CONVERT_FUNC
+tds_convert_resolve(TDS_CONVERTER *conv, int srctype, int desttype)
+{
+	unsigned int i;
+
+	conv->convert = tds_converter_generic;
+	conv->srctype = srctype;
+	conv->desttype = desttype;
+	conv->precision = 0;
+	conv->scale = 0;
+
+	for (i = 0; i < TDS_VECTOR_SIZE(converters); ++i) {
+		if (converters[i].srctype == srctype && converters[i].desttype == desttype) {
+			conv->convert = converters[i].convert;
+			break;
+		}
+	}
+	return conv->convert;
+}
+
+/**
+ * Convert an array of values using a converter.
+ * Source values are stored consecutively, each taking srclen bytes.
+ * Results are stored consecutively in dest, each taking destlen bytes.
+ * Destination can't be a type requiring allocation (like SYBVARCHAR),
+ * use TDS_CONVERT_CHAR or TDS_CONVERT_BINARY instead; for these types
+ * destlen is the size of the buffer for every value.
+ * For SYBNUMERIC and SYBDECIMAL destinations precision and scale are
+ * taken from the converter.
+ * @param tds_ctx  context
+ * @param conv     converter from tds_convert_resolve
+ * @param count    number of values to convert
+ * @param src      source values
+ * @param srclen   size of each source value
+ * @param srclens  length of every source value, NULL if all values take srclen bytes
+ * @param dest     where to store results
+ * @param destlen  size of each result
+ * @param lengths  where to store length of results or TDS_CONVERT_* failure codes, can be NULL
+ * @return 0 if all values were converted, TDS_CONVERT_* code of first failure otherwise.
+ */
+TDS_INT
+tds_convert_batch(const TDSCONTEXT *tds_ctx, const TDS_CONVERTER *conv, unsigned int count,
+		  const void *src, TDS_UINT srclen, const TDS_UINT *srclens,
+		  void *dest, TDS_UINT destlen, TDS_INT *lengths)
+{
+	const TDS_CHAR *psrc = (const TDS_CHAR *) src;
+	TDS_CHAR *pdest = (TDS_CHAR *) dest;
+	const TDS_CONVERT_FUNC convert = conv->convert;
+	bool sized = false;
+	TDS_INT res = 0, len;
+	CONV_RESULT cr;
+	unsigned int i;
+
+	switch (conv->desttype) {
+	case TDS_CONVERT_CHAR:
+		sized = true;
+		break;
+	case CASE_ALL_BINARY:
+		if (conv->desttype == TDS_CONVERT_BINARY) {
+			sized = true;
+			break;
+		}
+		/* fall through */
+	case CASE_ALL_CHAR:
+		/* results would be allocated */
+		for (i = 0; lengths && i < count; ++i)
+			lengths[i] = TDS_CONVERT_NOAVAIL;
+		return TDS_CONVERT_NOAVAIL;
+	}
+
+	for (i = 0; i < count; ++i, psrc += srclen, pdest += destlen) {
+		if (sized) {
+			/* cc and cb have the same layout */
+			cr.cc.c = pdest;
+			cr.cc.len = destlen;
+		} else if (is_numeric_type(conv->desttype)) {
+			cr.n.precision = conv->precision;
+			cr.n.scale = conv->scale;
+		}
+		len = convert(tds_ctx, conv, psrc, srclens ? srclens[i] : srclen, &cr);
+		if (len >= 0 && !sized) {
+			if ((TDS_UINT) len > destlen)
+				len = TDS_CONVERT_OVERFLOW;
+			else
+				memcpy(pdest, &cr, len);
+		}
+		if (len < 0 && !res)
+			res = len;
+		if (lengths)
+			lengths[i] = len;
+	}
+	return res;
+}
+
+/**
+ * Parse a date and time in ISO 8601 fixed layout.
+ *
+ * Accepted syntax is "YYYY-MM-DD[( |T)hh:mm[:ss[.fffffff]]]" or
+ * "hh:mm[:ss[.fffffff]]" with optional leading and trailing spaces.
+ * This covers the ODBC canonical format and most data files.
+ * Only values in range are accepted, anything else (including other
+ * formats) is left to the generic parser in string_to_datetime,
+ * so results are always the same.
+ * @param t where to store date and time, changed only on success
+ * @return true if string was parsed
+ */
+static bool
+parse_iso_datetime(const char *s, const char *pend, struct tds_time *t)
+{
+#define DIGIT(n) ((unsigned int) (s[n] - '0') < 10u)
+#define NUM2(n) ((unsigned int) ((s[n] - '0') * 10 + (s[(n) + 1] - '0')))
+	unsigned int year = 0, mon = 0, mday = 0, hour, min, sec = 0, ns = 0;
+	bool has_date = false;
+
+	while (s != pend && *s == ' ')
+		++s;
+	while (pend != s && pend[-1] == ' ')
+		--pend;
+
+	/* date part */
+	if (pend - s >= 10 && s[4] == '-' && s[7] == '-') {
+		if (!DIGIT(0) || !DIGIT(1) || !DIGIT(2) || !DIGIT(3)
+		    || !DIGIT(5) || !DIGIT(6) || !DIGIT(8) || !DIGIT(9))
+			return false;
+		year = NUM2(0) * 100u + NUM2(2);
+		mon = NUM2(5);
+		mday = NUM2(8);
+		/* same limits as store_year and store_numeric_date */
+		if (year < 1753 || mon < 1 || mon > 12 || mday < 1 || mday > 31)
+			return false;
+		has_date = true;
+		s += 10;
+		if (s == pend) {
+			hour = min = 0;
+			goto done;
+		}
+		if (*s != ' ' && *s != 'T')
+			return false;
+		++s;
+	}
+
+	/* time part */
+	if (pend - s < 5 || s[2] != ':' || !DIGIT(0) || !DIGIT(1) || !DIGIT(3) || !DIGIT(4))
+		return false;
+	hour = NUM2(0);
+	min = NUM2(3);
+	s += 5;
+	if (s != pend) {
+		if (pend - s < 3 || s[0] != ':' || !DIGIT(1) || !DIGIT(2))
+			return false;
+		sec = NUM2(1);
+		s += 3;
+		if (s != pend) {
+			unsigned int ns_digits = 0;
+
+			/* fractions, digits after the ninth are ignored */
+			if (*s != '.')
+				return false;
+			for (++s; s != pend; ++s) {
+				if (!TDS_ISDIGIT(*s))
+					return false;
+				if (ns_digits < 9) {
+					ns = ns * 10u + (*s - '0');
+					++ns_digits;
+				}
+			}
+			for (; ns_digits < 9; ++ns_digits)
+				ns *= 10u;
+		}
+	}
+	if (hour > 23 || min > 59 || sec > 59)
+		return false;
+
+done:
+	if (has_date) {
+		t->tm_year = year - 1900;
+		t->tm_mon = mon - 1;
+		t->tm_mday = mday;
+	}
+	t->tm_hour = hour;
+	t->tm_min = min;
+	t->tm_sec = sec;
+	t->tm_ns = ns;
+	return true;
+#undef DIGIT
+#undef NUM2
+}
+
 static int
 string_to_datetime(const char *instr, TDS_UINT len, int desttype, CONV_RESULT * cr)
 {
@@ -2103,15 +2707,15 @@ string_to_datetime(const char *instr, TDS_UINT len, int desttype, CONV_RESULT *
 
 	struct tds_time t;
 
-	unsigned int dt_time;
-	TDS_INT dt_days;
-	int i;
-
 	enum states current_state;
 
 	memset(&t, '\0', sizeof(t));
 	t.tm_mday = 1;
 
+	/* try common fixed formats first */
+	if (parse_iso_datetime(instr, instr + len, &t))
+		return tds_time_to_result(&t, desttype, cr);
+
 	in = tds_strndup(instr, len);
 	test_alloc(in);
 
@@ -2302,40 +2906,60 @@ string_to_datetime(const char *instr, TDS_UINT len, int desttype, CONV_RESULT *
 		tok = strtok_r(NULL, " ,", &lasts);
 	}
 
-	i = (t.tm_mon - 13) / 12;
-	dt_days = 1461 * (t.tm_year + 1900 + i) / 4 +
-		(367 * (t.tm_mon - 1 - 12 * i)) / 12 - (3 * ((t.tm_year + 2000 + i) / 100)) / 4 + t.tm_mday - 693932;
+	free(in);
+
+	return tds_time_to_result(&t, desttype, cr);
 
+string_garbled:
+	tdsdump_log(TDS_DBG_INFO1,
+		    "error_handler:  Attempt to convert data stopped by syntax error in source field \n");
 	free(in);
+	return TDS_CONVERT_SYNTAX;
+}
+
+/**
+ * Store a parsed date and time into result.
+ * @return size of result or TDS_CONVERT_* failure code on failure
+ */
+static int
+tds_time_to_result(const struct tds_time *t, int desttype, CONV_RESULT * cr)
+{
+	unsigned int dt_time;
+	TDS_INT dt_days;
+	int i;
+
+	i = (t->tm_mon - 13) / 12;
+	dt_days = 1461 * (t->tm_year + 1900 + i) / 4 +
+		(367 * (t->tm_mon - 1 - 12 * i)) / 12 - (3 * ((t->tm_year + 2000 + i) / 100)) / 4 + t->tm_mday - 693932;
 
 	if (desttype == SYBDATE) {
 		cr->date = dt_days;
 		return sizeof(TDS_DATE);
 	}
-	dt_time = t.tm_hour * 60 + t.tm_min;
+	dt_time = t->tm_hour * 60 + t->tm_min;
 	/* TODO check for overflow */
 	if (desttype == SYBDATETIME4) {
 		cr->dt4.days = dt_days;
 		cr->dt4.minutes = dt_time;
 		return sizeof(TDS_DATETIME4);
 	}
-	dt_time = dt_time * 60 + t.tm_sec;
+	dt_time = dt_time * 60 + t->tm_sec;
 	if (desttype == SYBDATETIME) {
 		cr->dt.dtdays = dt_days;
-		cr->dt.dttime = dt_time * 300 + (t.tm_ns / 1000000u * 300 + 150) / 1000;
+		cr->dt.dttime = dt_time * 300 + (t->tm_ns / 1000000u * 300 + 150) / 1000;
 		return sizeof(TDS_DATETIME);
 	}
 	if (desttype == SYBTIME) {
-		cr->time = dt_time * 300 + (t.tm_ns / 1000000u * 300 + 150) / 1000;
+		cr->time = dt_time * 300 + (t->tm_ns / 1000000u * 300 + 150) / 1000;
 		return sizeof(TDS_TIME);
 	}
 	if (desttype == SYB5BIGTIME) {
-		cr->bigtime = dt_time * UINT64_C(1000000) + t.tm_ns / 1000u;
+		cr->bigtime = dt_time * UINT64_C(1000000) + t->tm_ns / 1000u;
 		return sizeof(TDS_BIGTIME);
 	}
 	if (desttype == SYB5BIGDATETIME) {
 		cr->bigdatetime = (dt_days + BIGDATETIME_BIAS) * (UINT64_C(86400) * 1000000u)
-				  + dt_time * UINT64_C(1000000) + t.tm_ns / 1000u;
+				  + dt_time * UINT64_C(1000000) + t->tm_ns / 1000u;
 		return sizeof(TDS_BIGDATETIME);
 	}
 
@@ -2345,14 +2969,8 @@ string_to_datetime(const char *instr, TDS_UINT len, int desttype, CONV_RESULT *
 	cr->dta.date = dt_days;
 	cr->dta.has_time = 1;
 	cr->dta.time_prec = 7; /* TODO correct value */
-	cr->dta.time = dt_time * UINT64_C(10000000) + t.tm_ns / 100u;
+	cr->dta.time = dt_time * UINT64_C(10000000) + t->tm_ns / 100u;
 	return sizeof(TDS_DATETIMEALL);
-
-string_garbled:
-	tdsdump_log(TDS_DBG_INFO1,
-		    "error_handler:  Attempt to convert data stopped by syntax error in source field \n");
-	free(in);
-	return TDS_CONVERT_SYNTAX;
 }
 
 static int
@@ -2424,6 +3042,18 @@ string_to_numeric(const char *instr, const char *pend, CONV_RESULT * cr)
 	memset(ptr + decimals, '0', cr->n.scale - decimals);
 	ptr += cr->n.scale;
 
+	memset(cr->n.array + 1, 0, sizeof(cr->n.array) - 1);
+	bytes = tds_numeric_bytes_per_prec[cr->n.precision];
+
+	/* small numbers fit in a 64 bit integer, avoid packaging */
+	if (digits + cr->n.scale <= 19) {
+		TDS_UINT8 num = accumulate_digits(0, mynumber + 8, digits + cr->n.scale);
+
+		for (; num; num >>= 8)
+			cr->n.array[--bytes] = (TDS_UCHAR) num;
+		return sizeof(TDS_NUMERIC);
+	}
+
 	/*
 	 * Packaged number explanation: 
 	 * We package 8 decimal digits in one number.  
@@ -2435,17 +3065,10 @@ string_to_numeric(const char *instr, const char *pend, CONV_RESULT * cr)
 	j = -1;
 	ptr -= 8;
 	do {
-		TDS_UINT n = *ptr++;
-
-		for (i = 1; i < 8; ++i)
-			n = n * 10u + *ptr++;
-		/* fix packet number and store */
-		packed_num[++j] = n - ((TDS_UINT) '0' * 11111111lu);
-		ptr -= 16;
+		packed_num[++j] = parse_digits8(load8_le(ptr));
+		ptr -= 8;
 	} while (ptr > mynumber);
 
-	memset(cr->n.array + 1, 0, sizeof(cr->n.array) - 1);
-	bytes = tds_numeric_bytes_per_prec[cr->n.precision];
 	while (j > 0 && !packed_num[j])
 		--j;
 
@@ -3171,6 +3794,391 @@ tds_strftime(char *buf, size_t maxsize, const char *format, const TDSDATEREC * d
 	return length;
 }
 
+/** Operations of a compiled date format */
+typedef enum
+{
+	TDS_DP_LITERAL,		/**< copy text */
+	TDS_DP_YEAR,		/**< %Y */
+	TDS_DP_YEAR2,		/**< %y */
+	TDS_DP_MONTH,		/**< %m */
+	TDS_DP_DAY,		/**< %d */
+	TDS_DP_DAY_SPACE,	/**< %e */
+	TDS_DP_YDAY,		/**< %j */
+	TDS_DP_HOUR,		/**< %H */
+	TDS_DP_HOUR12,		/**< %I */
+	TDS_DP_HOUR12_SPACE,	/**< %l */
+	TDS_DP_MINUTE,		/**< %M */
+	TDS_DP_SECOND,		/**< %S */
+	TDS_DP_FRACTION,	/**< %z */
+	TDS_DP_DOT_FRACTION,	/**< .%z, dot is omitted if precision is 0 */
+	TDS_DP_NAME		/**< name from names table */
+} TDS_DATE_OP;
+
+/* indexes in names table */
+#define TDS_DP_MONTH_ABBR 0
+#define TDS_DP_MONTH_NAME 12
+#define TDS_DP_WDAY_ABBR 24
+#define TDS_DP_WDAY_NAME 31
+#define TDS_DP_AMPM 38
+#define TDS_DP_NUM_NAMES 40
+
+struct tds_date_op
+{
+	TDS_DATE_OP type;
+	/** length of literal or first index in names table */
+	unsigned int len;
+	const char *text;
+};
+
+/**
+ * A date format compiled by tds_date_plan_compile.
+ * Names (months, week days, AM/PM) are rendered using the C library
+ * when the format is compiled.
+ */
+struct tds_date_plan
+{
+	char *format;
+	/** false if format contains conversions we can't handle */
+	bool supported;
+	unsigned int num_ops;
+	struct tds_date_op *ops;
+	unsigned char name_lens[TDS_DP_NUM_NAMES];
+	char names[TDS_DP_NUM_NAMES][24];
+};
+
+static bool
+tds_date_plan_names(struct tds_date_plan *plan, unsigned int first, const char *format)
+{
+	struct tm tm;
+	unsigned int i, num = first == TDS_DP_AMPM ? 2 : (first < TDS_DP_WDAY_ABBR ? 12 : 7);
+
+	memset(&tm, 0, sizeof(tm));
+	tm.tm_year = 100;
+	tm.tm_mday = 1;
+	for (i = 0; i < num; ++i) {
+		size_t len;
+
+		tm.tm_mon = tm.tm_wday = (int) i;
+		tm.tm_hour = (int) i * 12;
+		len = strftime(plan->names[first + i], sizeof(plan->names[0]), format, &tm);
+		if (!len)
+			return false;
+		plan->name_lens[first + i] = (unsigned char) len;
+	}
+	return true;
+}
+
+static void
+tds_date_plan_free(struct tds_date_plan *plan)
+{
+	free(plan->format);
+	free(plan->ops);
+	free(plan);
+}
+
+/**
+ * Compile a format for tds_strftime.
+ * Only conversions producing numbers or names are handled, if the format
+ * contains anything else the returned plan is marked as not supported.
+ * @return plan or NULL on memory error
+ */
+static struct tds_date_plan *
+tds_date_plan_compile(const char *format)
+{
+	struct tds_date_plan *plan;
+	struct tds_date_op *op;
+	const char *p;
+	bool z_found = false;
+
+	plan = tds_new0(struct tds_date_plan, 1);
+	if (!plan)
+		return NULL;
+	plan->format = strdup(format);
+	plan->ops = tds_new(struct tds_date_op, strlen(format) + 1);
+	if (!plan->format || !plan->ops) {
+		tds_date_plan_free(plan);
+		return NULL;
+	}
+
+	op = plan->ops;
+	for (p = plan->format; *p; ) {
+		const char *start = p;
+
+		if (*p != '%') {
+			while (*p && *p != '%')
+				++p;
+			op->type = TDS_DP_LITERAL;
+			op->text = start;
+			op->len = (unsigned int) (p - start);
+			++op;
+			continue;
+		}
+
+		op->type = TDS_DP_NAME;
+		switch (p[1]) {
+		case 0:
+			/* not terminated, keep the percent */
+			op->type = TDS_DP_LITERAL;
+			op->text = p;
+			op->len = 1;
+			++op;
+			++p;
+			continue;
+		case '%':
+		case 'n':
+		case 't':
+			op->type = TDS_DP_LITERAL;
+			op->text = p[1] == 'n' ? "\n" : (p[1] == 't' ? "\t" : p + 1);
+			op->len = 1;
+			break;
+		case 'Y':
+			op->type = TDS_DP_YEAR;
+			break;
+		case 'y':
+			op->type = TDS_DP_YEAR2;
+			break;
+		case 'm':
+			op->type = TDS_DP_MONTH;
+			break;
+		case 'd':
+			op->type = TDS_DP_DAY;
+			break;
+		case 'e':
+			op->type = TDS_DP_DAY_SPACE;
+			break;
+		case 'j':
+			op->type = TDS_DP_YDAY;
+			break;
+		case 'H':
+			op->type = TDS_DP_HOUR;
+			break;
+		case 'I':
+			op->type = TDS_DP_HOUR12;
+			break;
+		case 'l':
+			op->type = TDS_DP_HOUR12_SPACE;
+			break;
+		case 'M':
+			op->type = TDS_DP_MINUTE;
+			break;
+		case 'S':
+			op->type = TDS_DP_SECOND;
+			break;
+		case 'z':
+			/* only first %z is replaced by tds_strftime */
+			if (z_found)
+				goto unsupported;
+			z_found = true;
+			op->type = TDS_DP_FRACTION;
+			/* take the dot from previous literal, see tds_strftime */
+			if (op > plan->ops && op[-1].type == TDS_DP_LITERAL && op[-1].text[op[-1].len - 1] == '.') {
+				op->type = TDS_DP_DOT_FRACTION;
+				if (--op[-1].len == 0) {
+					op[-1].type = TDS_DP_DOT_FRACTION;
+					--op;
+				}
+			}
+			break;
+		case 'b':
+		case 'h':
+			op->len = TDS_DP_MONTH_ABBR;
+			if (!plan->name_lens[op->len] && !tds_date_plan_names(plan, op->len, "%b"))
+				goto unsupported;
+			break;
+		case 'B':
+			op->len = TDS_DP_MONTH_NAME;
+			if (!plan->name_lens[op->len] && !tds_date_plan_names(plan, op->len, "%B"))
+				goto unsupported;
+			break;
+		case 'a':
+			op->len = TDS_DP_WDAY_ABBR;
+			if (!plan->name_lens[op->len] && !tds_date_plan_names(plan, op->len, "%a"))
+				goto unsupported;
+			break;
+		case 'A':
+			op->len = TDS_DP_WDAY_NAME;
+			if (!plan->name_lens[op->len] && !tds_date_plan_names(plan, op->len, "%A"))
+				goto unsupported;
+			break;
+		case 'p':
+			op->len = TDS_DP_AMPM;
+			if (!plan->name_lens[op->len] && !tds_date_plan_names(plan, op->len, "%p"))
+				goto unsupported;
+			break;
+		default:
+			goto unsupported;
+		}
+		++op;
+		p += 2;
+	}
+	plan->num_ops = (unsigned int) (op - plan->ops);
+	plan->supported = true;
+	return plan;
+
+unsupported:
+	TDS_ZERO_FREE(plan->ops);
+	return plan;
+}
+
+/**
+ * Format a date using a compiled plan.
+ * @return length of the string, 0 if buffer is too small or
+ *         (size_t) -1 if the date can't be handled by the plan
+ */
+static size_t
+tds_date_plan_format(const struct tds_date_plan *plan, char *buf, size_t maxsize, const TDSDATEREC * dr, int prec)
+{
+	const struct tds_date_op *op, *op_end;
+	char *out = buf, *out_end;
+	char digits[8];
+	const char *src;
+	unsigned int len, n;
+
+	/* strftime does not pad years and we use names by index */
+	if (dr->year < 1000 || dr->year > 9999 || (unsigned) dr->month > 11u || (unsigned) dr->weekday > 6u
+	    || (unsigned) dr->hour > 23u || (unsigned) dr->dayofyear > 998u
+	    || (unsigned) dr->decimicrosecond > 9999999u)
+		return (size_t) -1;
+	if (!maxsize)
+		return 0;
+	if (prec < 0 || prec > 7)
+		prec = 3;
+
+	out_end = buf + maxsize - 1;
+	op_end = plan->ops + plan->num_ops;
+	for (op = plan->ops; op != op_end; ++op) {
+		src = digits;
+		len = 2;
+		switch (op->type) {
+		case TDS_DP_LITERAL:
+			src = op->text;
+			len = op->len;
+			break;
+		case TDS_DP_YEAR:
+			memcpy(digits, two_digits + dr->year / 100 * 2, 2);
+			memcpy(digits + 2, two_digits + dr->year % 100 * 2, 2);
+			len = 4;
+			break;
+		case TDS_DP_YEAR2:
+			src = two_digits + dr->year % 100 * 2;
+			break;
+		case TDS_DP_MONTH:
+			src = two_digits + (dr->month + 1) * 2;
+			break;
+		case TDS_DP_DAY:
+			src = two_digits + (dr->day % 100u) * 2;
+			break;
+		case TDS_DP_DAY_SPACE:
+			two_digit(digits, dr->day);
+			break;
+		case TDS_DP_YDAY:
+			n = (unsigned) dr->dayofyear + 1u;
+			digits[0] = (char) ('0' + n / 100u);
+			memcpy(digits + 1, two_digits + n % 100u * 2, 2);
+			len = 3;
+			break;
+		case TDS_DP_HOUR:
+			src = two_digits + dr->hour * 2;
+			break;
+		case TDS_DP_HOUR12:
+			src = two_digits + ((dr->hour + 11u) % 12u + 1u) * 2;
+			break;
+		case TDS_DP_HOUR12_SPACE:
+			two_digit(digits, (int) ((dr->hour + 11u) % 12u + 1u));
+			break;
+		case TDS_DP_MINUTE:
+			src = two_digits + (dr->minute % 100u) * 2;
+			break;
+		case TDS_DP_SECOND:
+			src = two_digits + (dr->second % 100u) * 2;
+			break;
+		case TDS_DP_FRACTION:
+		case TDS_DP_DOT_FRACTION:
+			n = (unsigned) dr->decimicrosecond;
+			for (len = 7; len > 0; n /= 10u)
+				digits[len--] = (char) ('0' + n % 10u);
+			len = (unsigned) prec;
+			src = digits + 1;
+			if (op->type == TDS_DP_DOT_FRACTION && prec) {
+				digits[0] = '.';
+				src = digits;
+				++len;
+			}
+			break;
+		case TDS_DP_NAME:
+			n = op->len;
+			if (n == TDS_DP_AMPM)
+				n += dr->hour >= 12;
+			else if (n < TDS_DP_WDAY_ABBR)
+				n += dr->month;
+			else
+				n += dr->weekday;
+			src = plan->names[n];
+			len = plan->name_lens[n];
+			break;
+		}
+		if ((size_t) (out_end - out) < len) {
+			buf[0] = 0;
+			return 0;
+		}
+		memcpy(out, src, len);
+		out += len;
+	}
+	*out = 0;
+	return (size_t) (out - buf);
+}
+
+/**
+ * Same as tds_strftime but using a plan compiled by tds_locale_compile_date_plans.
+ * The plan is used only if it was compiled from format, formats changed
+ * without compiling them again are handled by tds_strftime.
+ */
+static size_t
+tds_locale_strftime(const struct tds_date_plan *plan, char *buf, size_t maxsize, const char *format,
+		    const TDSDATEREC * dr, int prec)
+{
+	if (plan && plan->supported && strcmp(plan->format, format) == 0) {
+		size_t length = tds_date_plan_format(plan, buf, maxsize, dr, prec);
+
+		if (length != (size_t) -1)
+			return length;
+	}
+	return tds_strftime(buf, maxsize, format, dr, prec);
+}
+
+static void
+tds_date_plan_replace(struct tds_date_plan **pplan, const char *format)
+{
+	if (*pplan)
+		tds_date_plan_free(*pplan);
+	*pplan = format ? tds_date_plan_compile(format) : NULL;
+}
+
+/**
+ * Compile the date formats of a locale, used by date to string conversions.
+ * Call it after changing datetime_fmt, date_fmt or time_fmt, before the
+ * locale is used by other threads; conversions never change the plans
+ * so they don't need any lock.
+ */
+void
+tds_locale_compile_date_plans(TDSLOCALE *locale)
+{
+	tds_date_plan_replace(&locale->datetime_plan, locale->datetime_fmt);
+	tds_date_plan_replace(&locale->date_plan, locale->date_fmt);
+	tds_date_plan_replace(&locale->time_plan, locale->time_fmt);
+}
+
+/**
+ * Free date format plans compiled in a locale.
+ */
+void
+tds_free_date_plans(TDSLOCALE *locale)
+{
+	tds_date_plan_replace(&locale->datetime_plan, NULL);
+	tds_date_plan_replace(&locale->date_plan, NULL);
+	tds_date_plan_replace(&locale->time_plan, NULL);
+}
+
 #if 0
 static TDS_UINT
 utf16len(const utf16_t * s)
@@ -3388,31 +4396,27 @@ static TDS_INT
 string_to_int(const char *buf, const char *pend, TDS_INT * res)
 {
 	bool negative;
-	unsigned int num;	/* we use unsigned here for best overflow check */
+	TDS_UINT8 num;	/* we use unsigned here for best overflow check */
 	size_t digits, decimals;
 
 	buf = parse_numeric(buf, pend, &negative, &digits, &decimals);
 	if (!buf)
 		return TDS_CONVERT_SYNTAX;
 
-	num = 0;
-	for (; digits; --digits, ++buf) {
-		/* add a digit to number and check for overflow */
-		/* NOTE I didn't forget a digit, I check overflow before multiply to prevent overflow */
-		if (num > 214748364u)
-			return TDS_CONVERT_OVERFLOW;
-		num = num * 10u + (*buf - '0');
-	}
+	/* leading zeroes are already stripped, 10 digits cannot overflow num */
+	if (digits > 10)
+		return TDS_CONVERT_OVERFLOW;
+	num = accumulate_digits(0, buf, digits);
 
 	/* check for overflow and convert unsigned to signed */
 	if (negative) {
 		if (num > 2147483648u)
 			return TDS_CONVERT_OVERFLOW;
-		*res = 0 - num;
+		*res = (TDS_INT) (0 - (TDS_UINT) num);
 	} else {
 		if (num >= 2147483648u)
 			return TDS_CONVERT_OVERFLOW;
-		*res = num;
+		*res = (TDS_INT) num;
 	}
 
 	return sizeof(TDS_INT);
@@ -3433,15 +4437,17 @@ parse_int8(const char *buf, const char *pend, TDS_UINT8 * res, bool * p_negative
 	if (!buf)
 		return TDS_CONVERT_SYNTAX;
 
-	num = 0;
-	for (; digits; --digits, ++buf) {
-		/* add a digit to number and check for overflow */
-		TDS_UINT8 prev = num;
-		if (num > (UINT64_C(1) << 63) / 5u)
-			return TDS_CONVERT_OVERFLOW;
-		num = num * 10u + (*buf - '0');
-		if (num < prev)
+	/* 2^64 has 20 digits, 19 digits always fit */
+	if (digits > 20)
+		return TDS_CONVERT_OVERFLOW;
+	num = accumulate_digits(0, buf, TDS_MIN(digits, 19));
+	if (digits == 20) {
+		unsigned int last = buf[19] - '0';
+
+		/* add last digit and check for overflow */
+		if (num > (UINT64_C(0xffffffffffffffff) - last) / 10u)
 			return TDS_CONVERT_OVERFLOW;
+		num = num * 10u + last;
 	}
 
 	*res = num;
@@ -3564,13 +4570,13 @@ parse_numeric(const char *buf, const char *pend, bool *p_negative, size_t *p_dig
 	SKIP_IF(*p == '0');
 
 	start = p;
-	SKIP_IF(TDS_ISDIGIT(*p));
+	p = skip_digits(p, pend);
 	*p_digits = p - start;
 
 	/* parse decimal part */
 	if (p != pend && *p == '.') {
 		const char *decimals_start = ++p;
-		SKIP_IF(TDS_ISDIGIT(*p));
+		p = skip_digits(p, pend);
 		*p_decimals = p - decimals_start;
 	}
 
@@ -3582,6 +4588,97 @@ parse_numeric(const char *buf, const char *pend, bool *p_negative, size_t *p_dig
 	return start;
 }
 
+/**
+ * Convert a decimal number to double without using strtod.
+ *
+ * Handles only numbers with at most 19 significant digits and a mantissa
+ * which can be represented exactly in a double, scaled by a power of 10
+ * which can be represented exactly too. In this case a single floating
+ * point operation gives a correctly rounded result, like strtod.
+ *
+ * @return false if the number cannot be handled this way (including
+ *         syntax errors), caller should use strtod
+ */
+static bool
+parse_float_fast(const char *p, const char *pend, double *res)
+{
+#if defined(FLT_EVAL_METHOD) && FLT_EVAL_METHOD == 0
+	static const double pow10[] = {
+		1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+	};
+	bool negative = false, exp_negative = false;
+	const char *int_start, *int_end, *frac_start, *frac_end;
+	TDS_UINT8 mant;
+	int exp10, exp;
+	double d;
+
+	if (p != pend && (*p == '-' || *p == '+'))
+		negative = (*p++ == '-');
+
+	int_start = p;
+	int_end = p = skip_digits(p, pend);
+	frac_start = frac_end = p;
+	if (p != pend && *p == '.') {
+		frac_start = ++p;
+		frac_end = p = skip_digits(p, pend);
+	}
+	/* at least a digit required */
+	if (int_start == int_end && frac_start == frac_end)
+		return false;
+
+	exp = 0;
+	if (p != pend && (*p == 'e' || *p == 'E')) {
+		++p;
+		if (p != pend && (*p == '-' || *p == '+'))
+			exp_negative = (*p++ == '-');
+		if (p == pend || !TDS_ISDIGIT(*p))
+			return false;
+		for (; p != pend && TDS_ISDIGIT(*p); ++p) {
+			exp = exp * 10 + (*p - '0');
+			if (exp > 1000)
+				return false;
+		}
+		if (exp_negative)
+			exp = -exp;
+	}
+	if (p != pend)
+		return false;
+
+	/* strip leading zeroes */
+	while (int_start != int_end && *int_start == '0')
+		++int_start;
+	exp10 = exp - (int) (frac_end - frac_start);
+	if (int_start == int_end) {
+		while (frac_start != frac_end && *frac_start == '0')
+			++frac_start;
+	}
+	if ((int_end - int_start) + (frac_end - frac_start) > 19)
+		return false;
+
+	mant = accumulate_digits(0, int_start, int_end - int_start);
+	mant = accumulate_digits(mant, frac_start, frac_end - frac_start);
+
+	if (mant == 0) {
+		*res = negative ? -0.0 : 0.0;
+		return true;
+	}
+	if (mant > (UINT64_C(1) << 53) || exp10 < -22 || exp10 > 22)
+		return false;
+
+	d = (double) mant;
+	if (exp10 < 0)
+		d /= pow10[-exp10];
+	else
+		d *= pow10[exp10];
+	*res = negative ? -d : d;
+	return true;
+#else
+	/* intermediate results could have extra precision leading to wrong rounding */
+	return false;
+#endif
+}
+
 static TDS_INT
 string_to_float(const TDS_CHAR * src, TDS_UINT srclen, int desttype, CONV_RESULT * cr)
 {
@@ -3600,15 +4697,17 @@ string_to_float(const TDS_CHAR * src, TDS_UINT srclen, int desttype, CONV_RESULT
 	if (srclen >= sizeof(tmpstr))
 		return TDS_CONVERT_OVERFLOW;
 
-	memcpy(tmpstr, src, srclen);
-	tmpstr[srclen] = 0;
+	if (!parse_float_fast(src, src + srclen, &res)) {
+		memcpy(tmpstr, src, srclen);
+		tmpstr[srclen] = 0;
 
-	errno = 0;
-	res = strtod(tmpstr, &end);
-	if (errno == ERANGE)
-		return TDS_CONVERT_OVERFLOW;
-	if (end != tmpstr + srclen)
-		return TDS_CONVERT_SYNTAX;
+		errno = 0;
+		res = strtod(tmpstr, &end);
+		if (errno == ERANGE)
+			return TDS_CONVERT_OVERFLOW;
+		if (end != tmpstr + srclen)
+			return TDS_CONVERT_SYNTAX;
+	}
 
 	if (desttype == SYBREAL) {
 		/* FIXME check overflows */
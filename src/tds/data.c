@@ -1508,6 +1508,22 @@ tds_mstabletype_put_info(TDSSOCKET *tds, TDSCOLUMN *col)
 	return TDS_SUCCESS;
 }
 
+static TDSRET
+tds_mstabletype_put_row(TDSSOCKET *tds, TDSPARAMINFO *params, TDS_USMALLINT num_cols)
+{
+	TDSCOLUMN *tds_col;
+	int i;
+
+	/* TVP_ROW_TOKEN */
+	tds_put_byte(tds, 0x01);
+
+	for (i = 0; i < num_cols; i++) {
+		tds_col = params->columns[i];
+		TDS_PROPAGATE(tds_col->funcs->put_data(tds, tds_col, 0));
+	}
+	return TDS_SUCCESS;
+}
+
 TDSRET
 tds_mstabletype_put(TDSSOCKET *tds, TDSCOLUMN *col, int bcp7 TDS_UNUSED)
 {
@@ -1516,6 +1532,7 @@ tds_mstabletype_put(TDSSOCKET *tds, TDSCOLUMN *col, int bcp7 TDS_UNUSED)
 	TDSCOLUMN *tds_col;
 	TDS_TVP_ROW *row;
 	int i;
+	TDSRET rc;
 	TDS_USMALLINT num_cols = table->metadata ? table->metadata->num_cols : 0;
 
 	/* COL_METADATA */
@@ -1545,13 +1562,27 @@ tds_mstabletype_put(TDSSOCKET *tds, TDSCOLUMN *col, int bcp7 TDS_UNUSED)
 	tds_put_byte(tds, 0x00);
 
 	for (row = table->row; row != NULL; row = row->next) {
-		/* TVP_ROW_TOKEN */
-		tds_put_byte(tds, 0x01);
+		rc = tds_mstabletype_put_row(tds, row->params, num_cols);
+		if (TDS_FAILED(rc))
+			goto cancel;
+	}
 
-		params = row->params;
-		for (i = 0; i < num_cols; i++) {
-			tds_col = params->columns[i];
-			TDS_PROPAGATE(tds_col->funcs->put_data(tds, tds_col, 0));
+	/* rows produced on demand are sent as they come */
+	if (table->fetch) {
+		table->num_fetched = 0;
+		for (;;) {
+			rc = table->fetch(tds, table);
+
+			if (rc == TDS_NO_MORE_RESULTS)
+				break;
+			if (TDS_SUCCEED(rc) && (!table->fetch_row || table->fetch_row->num_cols < num_cols))
+				rc = TDS_FAIL;
+			if (TDS_FAILED(rc))
+				goto cancel;
+			++table->num_fetched;
+			rc = tds_mstabletype_put_row(tds, table->fetch_row, num_cols);
+			if (TDS_FAILED(rc))
+				goto cancel;
 		}
 	}
 
@@ -1559,6 +1590,11 @@ tds_mstabletype_put(TDSSOCKET *tds, TDSCOLUMN *col, int bcp7 TDS_UNUSED)
 	tds_put_byte(tds, 0x00);
 
 	return TDS_SUCCESS;
+
+cancel:
+	/* rows could be already sent, do not leave the request half written */
+	tds_cancel_request(tds);
+	return rc;
 }
 
 TDSRET
@@ -104,6 +104,7 @@ tds_get_locale(void)
 
 		fclose(in);
 	}
+	tds_locale_compile_date_plans(locale);
 	return locale;
 }
 
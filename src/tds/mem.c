@@ -29,6 +29,7 @@
 #include <assert.h>
 
 #include <freetds/tds.h>
+#include <freetds/convert.h>
 #include <freetds/iconv.h>
 #include <freetds/tls.h>
 #include <freetds/checks.h>
@@ -147,6 +148,123 @@ tds_free_column(TDSCOLUMN *col)
 }
 
 
+static unsigned int
+tds_dynamic_id_hash(const char *id)
+{
+	/* FNV-1a */
+	unsigned int h = 2166136261u;
+
+	for (; *id; ++id)
+		h = (h ^ (unsigned char) *id) * 16777619u;
+	return h;
+}
+
+static void
+tds_dynamic_hash_insert(TDSCONNECTION * conn, TDSDYNAMIC * dyn)
+{
+	TDSDYNAMIC **bucket = &conn->dyns_hash[dyn->id_hash & (conn->dyns_hash_size - 1)];
+
+	dyn->hash_next = *bucket;
+	*bucket = dyn;
+}
+
+/**
+ * Add a dynamic to the connection list and hash index.
+ * Hash index is resized as needed, if memory is not available
+ * old index (or the list) is used.
+ */
+static void
+tds_dynamic_link(TDSCONNECTION * conn, TDSDYNAMIC * dyn)
+{
+	/* insert into list */
+	dyn->prev = NULL;
+	dyn->next = conn->dyns;
+	if (conn->dyns)
+		conn->dyns->prev = dyn;
+	conn->dyns = dyn;
+	++conn->num_dyns;
+
+	dyn->id_hash = tds_dynamic_id_hash(dyn->id);
+	if (conn->num_dyns > conn->dyns_hash_size) {
+		unsigned int new_size = conn->dyns_hash_size ? conn->dyns_hash_size * 2 : 64;
+		TDSDYNAMIC **new_hash = tds_new0(TDSDYNAMIC *, new_size);
+
+		if (new_hash) {
+			TDSDYNAMIC *curr;
+
+			free(conn->dyns_hash);
+			conn->dyns_hash = new_hash;
+			conn->dyns_hash_size = new_size;
+			for (curr = conn->dyns; curr; curr = curr->next)
+				tds_dynamic_hash_insert(conn, curr);
+			return;
+		}
+	}
+	if (conn->dyns_hash)
+		tds_dynamic_hash_insert(conn, dyn);
+}
+
+/**
+ * Remove a dynamic from the connection list and hash index.
+ * \return false if dynamic was not in the list
+ */
+static bool
+tds_dynamic_unlink(TDSCONNECTION * conn, TDSDYNAMIC * dyn)
+{
+	if (!dyn->prev && conn->dyns != dyn)
+		return false;
+
+	if (dyn->prev)
+		dyn->prev->next = dyn->next;
+	else
+		conn->dyns = dyn->next;
+	if (dyn->next)
+		dyn->next->prev = dyn->prev;
+	dyn->next = dyn->prev = NULL;
+	--conn->num_dyns;
+
+	if (conn->dyns_hash) {
+		TDSDYNAMIC **victim = &conn->dyns_hash[dyn->id_hash & (conn->dyns_hash_size - 1)];
+
+		while (*victim && *victim != dyn)
+			victim = &(*victim)->hash_next;
+		if (*victim)
+			*victim = dyn->hash_next;
+		dyn->hash_next = NULL;
+	}
+	return true;
+}
+
+/**
+ * Finds a dynamic given string id
+ * \return dynamic or NULL is not found
+ * \param conn state information for the socket and the TDS protocol
+ * \param id   dynamic id to search
+ */
+TDSDYNAMIC *
+tds_lookup_dynamic(TDSCONNECTION * conn, const char *id)
+{
+	TDSDYNAMIC *curr;
+	unsigned int hash;
+
+	CHECK_CONN_EXTRA(conn);
+
+	if (!conn->dyns_hash) {
+		for (curr = conn->dyns; curr != NULL; curr = curr->next) {
+			if (!strcmp(curr->id, id))
+				return curr;
+		}
+		return NULL;
+	}
+
+	hash = tds_dynamic_id_hash(id);
+	for (curr = conn->dyns_hash[hash & (conn->dyns_hash_size - 1)]; curr != NULL; curr = curr->hash_next) {
+		if (curr->id_hash == hash && !strcmp(curr->id, id))
+			return curr;
+	}
+	return NULL;
+}
+
 /**
  * \fn TDSDYNAMIC *tds_alloc_dynamic(TDSCONNECTION *conn, const char *id)
  * \brief Allocate a dynamic statement.
@@ -183,12 +301,10 @@ tds_alloc_dynamic(TDSCONNECTION * conn, const char *id)
 	/* take into account pointer in list */
 	dyn->ref_count = 2;
 
-	/* insert into list */
-	dyn->next = conn->dyns;
-	conn->dyns = dyn;
-
 	strlcpy(dyn->id, id, TDS_MAX_DYNID_LEN);
 
+	tds_dynamic_link(conn, dyn);
+
 	return dyn;
 
       Cleanup:
@@ -220,26 +336,21 @@ tds_free_input_params(TDSDYNAMIC * dyn)
 void
 tds_dynamic_deallocated(TDSCONNECTION *conn, TDSDYNAMIC *dyn)
 {
-	TDSDYNAMIC **victim;
-
 	tdsdump_log(TDS_DBG_FUNC, "tds_dynamic_deallocated() : freeing dynamic_id %s\n", dyn->id);
 
-	victim = &conn->dyns;
-	while (*victim != dyn) {
-		if (*victim == NULL) {
-			tdsdump_log(TDS_DBG_FUNC, "tds_dynamic_deallocated() : cannot find id %s\n", dyn->id);
-			return;
-		}
-		victim = &(*victim)->next;
-	}
-
 	/* remove from list */
-	*victim = dyn->next;
-	dyn->next = NULL;
+	if (!tds_dynamic_unlink(conn, dyn)) {
+		tdsdump_log(TDS_DBG_FUNC, "tds_dynamic_deallocated() : cannot find id %s\n", dyn->id);
+		return;
+	}
 
 	/* assure there is no id left */
 	dyn->num_id = 0;
 
+	/* cannot be reused anymore */
+	tds_dynamic_cache_remove(conn, dyn);
+	TDS_ZERO_FREE(dyn->cache_key);
+
 	tds_release_dynamic(&dyn);
 }
 
@@ -264,6 +375,7 @@ tds_release_dynamic(TDSDYNAMIC ** pdyn)
 	tds_free_results(dyn->res_info);
 	tds_free_input_params(dyn);
 	free(dyn->query);
+	free(dyn->cache_key);
 	free(dyn);
 }
 
@@ -583,6 +695,28 @@ tds_free_param_results(TDSPARAMINFO * param_info)
 	tds_free_results(param_info);
 }
 
+/**
+ * Move cached query information (declarations) from a
+ * parameters list to another one.
+ * Useful if parameters are built again for every execution of a query.
+ * \param dest destination parameters, if NULL caches are freed
+ * \param src  source parameters, can be NULL
+ */
+void
+tds_move_param_caches(TDSPARAMINFO * dest, TDSPARAMINFO * src)
+{
+	if (!src)
+		return;
+
+	if (dest) {
+		tds_free_param_decl(dest->param_decl);
+		dest->param_decl = src->param_decl;
+	} else {
+		tds_free_param_decl(src->param_decl);
+	}
+	src->param_decl = NULL;
+}
+
 static void
 tds_free_compute_result(TDSCOMPUTEINFO * comp_info)
 {
@@ -655,6 +789,7 @@ tds_free_results(TDSRESULTINFO * res_info)
 	}
 
 	free(res_info->bycolumns);
+	tds_free_param_decl(res_info->param_decl);
 
 	free(res_info);
 }
@@ -887,7 +1022,6 @@ TDSCURSOR *
 tds_alloc_cursor(TDSSOCKET *tds, const char *name, size_t namelen, const char *query, size_t querylen)
 {
 	TDSCURSOR *cursor;
-	TDSCURSOR *pcursor;
 
 	TEST_MALLOC(cursor, TDSCURSOR);
 	cursor->ref_count = 1;
@@ -901,13 +1035,13 @@ tds_alloc_cursor(TDSSOCKET *tds, const char *name, size_t namelen, const char *q
 	TEST_CALLOC(cursor->query, char, querylen + 1);
 	memcpy(cursor->query, query, querylen);
 
-	if (tds->conn->cursors == NULL) {
+	/* append to list, keeping allocation order */
+	cursor->prev = tds->conn->cursors_tail;
+	if (cursor->prev)
+		cursor->prev->next = cursor;
+	else
 		tds->conn->cursors = cursor;
-	} else {
-		for (pcursor = tds->conn->cursors; pcursor->next; pcursor = pcursor->next)
-			continue;
-		pcursor->next = cursor;
-	}
+	tds->conn->cursors_tail = cursor;
 	/* take into account reference in connection list */
 	++cursor->ref_count;
 
@@ -924,22 +1058,23 @@ tds_alloc_cursor(TDSSOCKET *tds, const char *name, size_t namelen, const char *q
 void
 tds_cursor_deallocated(TDSCONNECTION *conn, TDSCURSOR *cursor)
 {
-	TDSCURSOR **victim;
-
 	tdsdump_log(TDS_DBG_FUNC, "tds_cursor_deallocated() : freeing cursor_id %d\n", cursor->cursor_id);
 
-	victim = &conn->cursors;
-	while (*victim != cursor) {
-		if (*victim == NULL) {
-			tdsdump_log(TDS_DBG_FUNC, "tds_cursor_deallocated() : cannot find cursor_id %d\n", cursor->cursor_id);
-			return;
-		}
-		victim = &(*victim)->next;
+	if (!cursor->prev && conn->cursors != cursor) {
+		tdsdump_log(TDS_DBG_FUNC, "tds_cursor_deallocated() : cannot find cursor_id %d\n", cursor->cursor_id);
+		return;
 	}
 
 	/* remove from list */
-	*victim = cursor->next;
-	cursor->next = NULL;
+	if (cursor->prev)
+		cursor->prev->next = cursor->next;
+	else
+		conn->cursors = cursor->next;
+	if (cursor->next)
+		cursor->next->prev = cursor->prev;
+	else
+		conn->cursors_tail = cursor->prev;
+	cursor->next = cursor->prev = NULL;
 
 	tds_release_cursor(&cursor);
 }
@@ -1122,6 +1257,8 @@ tds_deinit_connection(TDSCONNECTION *conn)
 		tds_dynamic_deallocated(conn, conn->dyns);
 	while (conn->cursors)
 		tds_cursor_deallocated(conn, conn->cursors);
+	TDS_ZERO_FREE(conn->dyns_hash);
+	TDS_ZERO_FREE(conn->dyn_cache_hash);
 	tds_ssl_deinit(conn);
 	/* close connection and free inactive sockets */
 	tds_connection_close(conn);
@@ -1466,6 +1603,7 @@ tds_free_locale(TDSLOCALE * locale)
 	free(locale->datetime_fmt);
 	free(locale->date_fmt);
 	free(locale->time_fmt);
+	tds_free_date_plans(locale);
 	free(locale);
 }
 
@@ -1846,6 +1984,7 @@ tds_free_bcp_column_data(BCPCOLDATA * coldata)
 	if (!coldata)
 		return;
 
+	free(coldata->array);
 	free(coldata->data);
 	free(coldata);
 }
@@ -1931,6 +2070,11 @@ tds_deinit_tvp(TDS_TVP *table)
 		free(tvp_row);
 	}
 	table->row = NULL;
+	tds_free_param_results(table->fetch_row);
+	table->fetch_row = NULL;
+	table->fetch = NULL;
+	table->fetch_param = NULL;
+	table->num_fetched = 0;
 }
 
 /** @} */
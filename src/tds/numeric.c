@@ -58,6 +58,72 @@ const uint8_t tds_numeric_bytes_per_prec[] = {
 TDS_COMPILE_CHECK(maxprecision,
 	MAXPRECISION < TDS_VECTOR_SIZE(tds_numeric_bytes_per_prec) );
 
+#undef USE_UINT128
+#if defined(__GNUC__) && SIZEOF___INT128 > 0
+#define USE_UINT128 1
+typedef unsigned __int128 tds_uint128;
+
+/* maximum precision handled using 128 bit integers */
+#define UINT128_MAXPRECISION 38
+
+#define UINT64_10E19 UINT64_C(10000000000000000000)
+
+/**
+ * Compute 10 ** n (** is power), n must be <= 38.
+ */
+static tds_uint128
+tds_uint128_pow10(unsigned int n)
+{
+	static const uint64_t pow10[] = {
+		UINT64_C(1), UINT64_C(10), UINT64_C(100), UINT64_C(1000), UINT64_C(10000),
+		UINT64_C(100000), UINT64_C(1000000), UINT64_C(10000000), UINT64_C(100000000),
+		UINT64_C(1000000000), UINT64_C(10000000000), UINT64_C(100000000000),
+		UINT64_C(1000000000000), UINT64_C(10000000000000), UINT64_C(100000000000000),
+		UINT64_C(1000000000000000), UINT64_C(10000000000000000), UINT64_C(100000000000000000),
+		UINT64_C(1000000000000000000), UINT64_10E19
+	};
+
+	if (n < TDS_VECTOR_SIZE(pow10))
+		return pow10[n];
+	return (tds_uint128) pow10[n - 19] * UINT64_10E19;
+}
+
+/**
+ * Get absolute value of a numeric, precision must be <= 38.
+ */
+static tds_uint128
+tds_numeric_get_uint128(const TDS_NUMERIC * numeric)
+{
+	const unsigned char *p = numeric->array + 1;
+	const unsigned char *const end = numeric->array + tds_numeric_bytes_per_prec[numeric->precision];
+	tds_uint128 n = 0;
+
+	for (; end - p >= 4; p += 4)
+		n = (n << 32) | TDS_GET_UA4BE(p);
+	for (; p != end; ++p)
+		n = (n << 8) | *p;
+	return n;
+}
+
+/**
+ * Set absolute value of a numeric, precision must be <= 38.
+ */
+static void
+tds_numeric_put_uint128(TDS_NUMERIC * numeric, tds_uint128 n)
+{
+	unsigned char *p = numeric->array + tds_numeric_bytes_per_prec[numeric->precision];
+
+	for (; p - numeric->array >= 5; n >>= 32) {
+		p -= 4;
+		TDS_PUT_UA4BE(p, (uint32_t) n);
+	}
+	while (--p != numeric->array) {
+		*p = (unsigned char) n;
+		n >>= 8;
+	}
+}
+#endif
+
 /*
  * money is a special case of numeric really...that why its here
  */
@@ -120,6 +186,46 @@ tds_numeric_to_string(const TDS_NUMERIC * numeric, char *s)
 	if (numeric->array[0] == 1)
 		*s++ = '-';
 
+#ifdef USE_UINT128
+	if (numeric->precision <= UINT128_MAXPRECISION) {
+		char digits[40];
+		char *pd = digits + sizeof(digits);
+		tds_uint128 num = tds_numeric_get_uint128(numeric);
+		uint64_t low;
+
+		/* convert to decimal, using 64 bit operations for 19 digits at a time */
+		while ((num >> 64) != 0) {
+			low = (uint64_t) (num % UINT64_10E19);
+			num /= UINT64_10E19;
+			for (i = 0; i < 19; ++i, low /= 10u)
+				*--pd = (char) ('0' + low % 10u);
+		}
+		low = (uint64_t) num;
+		do
+			*--pd = (char) ('0' + low % 10u);
+		while ((low /= 10u) != 0);
+
+		/* output with decimal point */
+		i = (unsigned int) (digits + sizeof(digits) - pd);
+		if (i <= numeric->scale) {
+			*s++ = '0';
+			*s++ = '.';
+			memset(s, '0', numeric->scale - i);
+			s += numeric->scale - i;
+		} else {
+			memcpy(s, pd, i - numeric->scale);
+			s += i - numeric->scale;
+			pd += i - numeric->scale;
+			i = numeric->scale;
+			if (i)
+				*s++ = '.';
+		}
+		memcpy(s, pd, i);
+		s[i] = 0;
+		return 1;
+	}
+#endif
+
 	/* put number in a 16bit array */
 	number = numeric->array;
 	num_bytes = tds_numeric_bytes_per_prec[numeric->precision];
@@ -328,6 +434,28 @@ tds_numeric_change_prec_scale(TDS_NUMERIC * numeric, unsigned char new_prec, uns
 		return sizeof(TDS_NUMERIC);
 	}
 
+#ifdef USE_UINT128
+	/* all numbers up to 38 digits fit in 128 bit */
+	if (scale_diff != 0 && numeric->precision <= UINT128_MAXPRECISION && new_prec <= UINT128_MAXPRECISION) {
+		tds_uint128 num = tds_numeric_get_uint128(numeric);
+
+		if (scale_diff > 0) {
+			if (num >= tds_uint128_pow10(new_prec - scale_diff))
+				return TDS_CONVERT_OVERFLOW;
+			num *= tds_uint128_pow10(scale_diff);
+		} else {
+			if (new_prec - scale_diff < numeric->precision
+			    && num >= tds_uint128_pow10(new_prec - scale_diff))
+				return TDS_CONVERT_OVERFLOW;
+			num /= tds_uint128_pow10(-scale_diff);
+		}
+		numeric->precision = new_prec;
+		numeric->scale = new_scale;
+		tds_numeric_put_uint128(numeric, num);
+		return sizeof(TDS_NUMERIC);
+	}
+#endif
+
 	/* package number */
 	bytes = tds_numeric_bytes_per_prec[numeric->precision] - 1;
 	i = 0;
@@ -57,6 +57,8 @@ static TDSRET tds7_write_param_def_from_params(TDSSOCKET * tds, const char* quer
 static TDSRET tds_put_param_as_string(TDSSOCKET * tds, TDSPARAMINFO * params, int n);
 static TDSRET tds_send_emulated_execute(TDSSOCKET * tds, const char *query, TDSPARAMINFO * params);
 static int tds_count_placeholders_ucs2le(const char *query, const char *query_end);
+static char *tds_dynamic_cache_key(TDSSOCKET * tds, const char *query, TDSPARAMINFO * params,
+				   size_t *key_len, unsigned int *hash);
 
 #define TDS_PUT_DATA_USE_NAME 1
 #define TDS_PUT_DATA_PREFIX_NAME 2
@@ -491,14 +493,15 @@ tds_skip_comment(const char *s)
 	const char *p = s;
 
 	if (*p == '-' && p[1] == '-') {
-		for (;*++p != '\0';)
-			if (*p == '\n')
-				return p + 1;
+		p = strchr(p + 2, '\n');
+		if (p)
+			return p + 1;
+		p = s + strlen(s);
 	} else if (*p == '/' && p[1] == '*') {
-		++p;
-		for(;*++p != '\0';)
-			if (*p == '*' && p[1] == '/')
-				return p + 2;
+		p = strstr(p + 2, "*/");
+		if (p)
+			return p + 2;
+		p = s + strlen(s);
 	} else
 		++p;
 
@@ -513,16 +516,16 @@ tds_skip_comment(const char *s)
 const char *
 tds_skip_quoted(const char *s)
 {
-	const char *p = s;
+	const char *p = s + 1;
 	char quote = (*s == '[') ? ']' : *s;
 
-	for (; *++p;) {
-		if (*p == quote) {
-			if (*++p != quote)
-				return p;
-		}
+	/* quote is doubled to be escaped */
+	while ((p = strchr(p, quote)) != NULL) {
+		if (*++p != quote)
+			return p;
+		++p;
 	}
-	return p;
+	return s + strlen(s);
 }
 
 /**
@@ -539,6 +542,8 @@ tds_next_placeholder(const char *start)
 		return NULL;
 
 	for (;;) {
+		/* skip quickly characters not starting any token */
+		p += strcspn(p, "?'\"[-/");
 		switch (*p) {
 		case '\0':
 			return NULL;
@@ -590,9 +595,10 @@ tds_skip_comment_ucs2le(const char *s, const char *end)
 	const char *p = s;
 
 	if (p+4 <= end && memcmp(p, "-\0-", 4) == 0) {
-		for (;(p+=2) < end;)
-			if (p[0] == '\n' && p[1] == 0)
+		for (p += 4; p < end && (p = (const char *) memchr(p, '\n', end - p)) != NULL; ++p)
+			if (((p - s) & 1) == 0 && p + 1 < end && p[1] == 0)
 				return p + 2;
+		return end;
 	} else if (p+4 <= end && memcmp(p, "/\0*", 4) == 0) {
 		p += 2;
 		end -= 2;
@@ -621,12 +627,19 @@ tds_skip_quoted_ucs2le(const char *s, const char *end)
 
 	assert(s[1] == 0 && s < end && (end - s) % 2 == 0);
 
-	for (; (p += 2) != end;) {
-		if (p[0] == quote && !p[1]) {
-			p += 2;
-			if (p == end || p[0] != quote || p[1])
-				return p;
+	for (p += 2; p != end; ) {
+		/* search quote byte, should be aligned to a character */
+		p = (const char *) memchr(p, quote, end - p);
+		if (!p)
+			return end;
+		if (((p - s) & 1) != 0 || p[1]) {
+			p += 2 - ((p - s) & 1);
+			continue;
 		}
+		p += 2;
+		if (p == end || p[0] != quote || p[1])
+			return p;
+		p += 2;
 	}
 	return p;
 }
@@ -957,9 +970,141 @@ tds_get_column_declaration(TDSSOCKET * tds, TDSCOLUMN * curcol, char *out)
 	return TDS_FAIL;
 }
 
+/** Type information a parameter declaration depends on */
+struct tds_param_decl_col
+{
+	TDS_SERVER_TYPE type;
+	TDS_INT size;
+	TDS_INT column_size;
+	TDS_INT usertype;
+	TDS_TINYINT varint_size;
+	TDS_TINYINT prec;
+	TDS_TINYINT scale;
+};
+
+/**
+ * Parameters declaration already encoded in ucs2le.
+ * Stored in TDSPARAMINFO to avoid building it again for every
+ * execution, valid till parameters type or sizes does not change.
+ */
+struct tds_param_decl
+{
+	/** number of placeholders in the query */
+	int count;
+	/** number of columns used, minimum of count and parameters */
+	int num_cols;
+	struct tds_param_decl_col *cols;
+	unsigned char *ucs2;
+	size_t ucs2_len;
+};
+
+static void
+tds_param_decl_col_init(struct tds_param_decl_col *dcol, const TDSCOLUMN *curcol)
+{
+	memset(dcol, 0, sizeof(*dcol));
+	dcol->type = curcol->on_server.column_type;
+	dcol->size = curcol->on_server.column_size;
+	dcol->column_size = curcol->column_size;
+	dcol->usertype = curcol->column_usertype;
+	dcol->varint_size = curcol->column_varint_size;
+	dcol->prec = curcol->column_prec;
+	dcol->scale = curcol->column_scale;
+}
+
+void
+tds_free_param_decl(struct tds_param_decl *decl)
+{
+	if (!decl)
+		return;
+	free(decl->cols);
+	free(decl->ucs2);
+	free(decl);
+}
+
+/**
+ * Check if a cached declaration can be used for given parameters.
+ */
+static bool
+tds_param_decl_valid(const struct tds_param_decl *decl, int count, TDSPARAMINFO * params)
+{
+	struct tds_param_decl_col dcol;
+	int i;
+
+	if (decl->count != count || decl->num_cols != TDS_MIN(count, params->num_cols))
+		return false;
+
+	for (i = 0; i < decl->num_cols; ++i) {
+		tds_param_decl_col_init(&dcol, params->columns[i]);
+		if (memcmp(&dcol, &decl->cols[i], sizeof(dcol)) != 0)
+			return false;
+	}
+	return true;
+}
+
+/**
+ * Build parameters declaration like "@P1 INT, @P2 VARCHAR(100)" in ucs2le.
+ * \param tds     state information for the socket and the TDS protocol
+ * \param count   number of placeholders in the query
+ * \param params  parameters to build declaration, can be NULL
+ * \return new declaration or NULL on failure
+ */
+static struct tds_param_decl *
+tds7_build_param_decl(TDSSOCKET * tds, int count, TDSPARAMINFO * params)
+{
+	char declaration[128], *p;
+	struct tds_param_decl *decl;
+	unsigned char *out;
+	size_t len, alloc = 0;
+	int i;
+
+	decl = tds_new0(struct tds_param_decl, 1);
+	if (!decl)
+		return NULL;
+	decl->count = count;
+	decl->num_cols = params ? TDS_MIN(count, params->num_cols) : 0;
+	if (decl->num_cols && !TDS_RESIZE(decl->cols, decl->num_cols))
+		goto Cleanup;
+
+	for (i = 0; i < count; ++i) {
+		p = declaration;
+		if (i)
+			*p++ = ',';
+
+		/* get this parameter declaration */
+		p += sprintf(p, "@P%d ", i+1);
+		if (i >= decl->num_cols) {
+			strcpy(p, "varchar(4000)");
+		} else {
+			tds_param_decl_col_init(&decl->cols[i], params->columns[i]);
+			if (TDS_FAILED(tds_get_column_declaration(tds, params->columns[i], p)))
+				goto Cleanup;
+		}
+
+		/* declarations are plain ASCII, encoding in ucs2le is trivial */
+		len = strlen(declaration);
+		if (decl->ucs2_len + len * 2u > alloc) {
+			alloc = TDS_MAX(alloc * 2u, decl->ucs2_len + len * 2u + 256u);
+			if (!TDS_RESIZE(decl->ucs2, alloc))
+				goto Cleanup;
+		}
+		out = decl->ucs2 + decl->ucs2_len;
+		for (p = declaration; *p; ++p) {
+			*out++ = (unsigned char) *p;
+			*out++ = 0;
+		}
+		decl->ucs2_len += len * 2u;
+	}
+	return decl;
+
+      Cleanup:
+	tds_free_param_decl(decl);
+	return NULL;
+}
+
 /**
  * Write string with parameters definition, useful for TDS7+.
  * Looks like "@P1 INT, @P2 VARCHAR(100)"
+ * Declaration is cached in parameters and reused if types do not change.
  * \param tds     state information for the socket and the TDS protocol
  * \param converted_query     query to send to server in ucs2le encoding
  * \param converted_query_len query length in bytes
@@ -970,8 +1115,8 @@ tds_get_column_declaration(TDSSOCKET * tds, TDSCOLUMN * curcol, char *out)
 static TDSRET
 tds7_write_param_def_from_query(TDSSOCKET * tds, const char* converted_query, size_t converted_query_len, TDSPARAMINFO * params)
 {
-	char declaration[128], *p;
-	int i, count;
+	struct tds_param_decl *decl = NULL;
+	int count;
 	unsigned int written;
 	TDSFREEZE outer, inner;
 
@@ -983,6 +1128,21 @@ tds7_write_param_def_from_query(TDSSOCKET * tds, const char* converted_query, si
 
 	count = tds_count_placeholders_ucs2le(converted_query, converted_query + converted_query_len);
 
+	if (params && params->param_decl) {
+		if (tds_param_decl_valid(params->param_decl, count, params))
+			decl = params->param_decl;
+		else
+			tds_free_param_decl(params->param_decl);
+		params->param_decl = decl;
+	}
+	if (!decl) {
+		decl = tds7_build_param_decl(tds, count, params);
+		if (!decl)
+			return TDS_FAIL;
+		if (params)
+			params->param_decl = decl;
+	}
+
 	/* string with parameters types */
 	tds_put_byte(tds, 0);
 	tds_put_byte(tds, 0);
@@ -994,23 +1154,10 @@ tds7_write_param_def_from_query(TDSSOCKET * tds, const char* converted_query, si
 		tds_put_n(tds, tds->conn->collation, 5);
 	tds_freeze(tds, &inner, 4);
 
-	for (i = 0; i < count; ++i) {
-		p = declaration;
-		if (i)
-			*p++ = ',';
-
-		/* get this parameter declaration */
-		p += sprintf(p, "@P%d ", i+1);
-		if (!params || i >= params->num_cols) {
-			strcpy(p, "varchar(4000)");
-		} else if (TDS_FAILED(tds_get_column_declaration(tds, params->columns[i], p))) {
-			tds_freeze_abort(&inner);
-			tds_freeze_abort(&outer);
-			return TDS_FAIL;
-		}
-
-		tds_put_string(tds, declaration, -1);
-	}
+	if (decl->ucs2_len)
+		tds_put_n(tds, decl->ucs2, decl->ucs2_len);
+	if (!params)
+		tds_free_param_decl(decl);
 
 	written = tds_freeze_written(&inner) - 4;
 	tds_freeze_close_len(&inner, written ? written : -1);
@@ -1227,6 +1374,10 @@ tds_submit_prepare(TDSSOCKET * tds, const char *query, const char *id, TDSDYNAMI
 		return TDS_SUCCESS;
 	}
 
+	/* client chosen ids must not be kept after client release them */
+	if (!id && tds->conn->dyn_cache_size)
+		dyn->cache_key = tds_dynamic_cache_key(tds, query, params, &dyn->cache_key_len, &dyn->cache_hash);
+
 	query_len = (int)strlen(query);
 
 	tds_set_cur_dyn(tds, dyn);
@@ -1313,6 +1464,48 @@ failure:
 	return rc;
 }
 
+/**
+ * Write a sp_executesql call for TDS7+.
+ * \param tds     state information for the socket and the TDS protocol
+ * \param converted_query     query to send to server in ucs2le encoding
+ * \param converted_query_len query length in bytes
+ * \param params  parameters of the query, can be NULL
+ * \return result of write
+ */
+static TDSRET
+tds7_put_execdirect(TDSSOCKET * tds, const char *converted_query, size_t converted_query_len, TDSPARAMINFO * params)
+{
+	TDSCOLUMN *param;
+	TDSFREEZE outer;
+	TDSRET rc;
+	int i;
+
+	tds_freeze(tds, &outer, 0);
+	/* procedure name */
+	if (IS_TDS71_PLUS(tds->conn)) {
+		tds_put_smallint(tds, -1);
+		tds_put_smallint(tds, TDS_SP_EXECUTESQL);
+	} else {
+		TDS_PUT_N_AS_UCS2(tds, "sp_executesql");
+	}
+	tds_put_smallint(tds, 0);
+
+	tds7_put_query_params(tds, converted_query, converted_query_len);
+	rc = tds7_write_param_def_from_query(tds, converted_query, converted_query_len, params);
+	if (TDS_FAILED(rc)) {
+		tds_freeze_abort(&outer);
+		return rc;
+	}
+	tds_freeze_close(&outer);
+
+	for (i = 0; params && i < params->num_cols; i++) {
+		param = params->columns[i];
+		TDS_PROPAGATE(tds_put_data_info(tds, param, 0));
+		TDS_PROPAGATE(tds_put_data(tds, param));
+	}
+	return TDS_SUCCESS;
+}
+
 /**
  * Submit a prepared query with parameters
  * \param tds     state information for the socket and the TDS protocol
@@ -1324,7 +1517,6 @@ TDSRET
 tds_submit_execdirect(TDSSOCKET * tds, const char *query, TDSPARAMINFO * params, TDSHEADERS * head)
 {
 	size_t query_len;
-	TDSCOLUMN *param;
 	TDSDYNAMIC *dyn;
 	unsigned int id_len;
 	TDSFREEZE outer;
@@ -1337,7 +1529,6 @@ tds_submit_execdirect(TDSSOCKET * tds, const char *query, TDSPARAMINFO * params,
 	query_len = strlen(query);
 
 	if (IS_TDS7_PLUS(tds->conn)) {
-		int i;
 		size_t converted_query_len;
 		const char *converted_query;
 		TDSRET rc;
@@ -1355,30 +1546,9 @@ tds_submit_execdirect(TDSSOCKET * tds, const char *query, TDSPARAMINFO * params,
 			tds_convert_string_free(query, converted_query);
 			return TDS_FAIL;
 		}
-		tds_freeze(tds, &outer, 0);
-		/* procedure name */
-		if (IS_TDS71_PLUS(tds->conn)) {
-			tds_put_smallint(tds, -1);
-			tds_put_smallint(tds, TDS_SP_EXECUTESQL);
-		} else {
-			TDS_PUT_N_AS_UCS2(tds, "sp_executesql");
-		}
-		tds_put_smallint(tds, 0);
-
-		tds7_put_query_params(tds, converted_query, converted_query_len);
-		rc = tds7_write_param_def_from_query(tds, converted_query, converted_query_len, params);
+		rc = tds7_put_execdirect(tds, converted_query, converted_query_len, params);
 		tds_convert_string_free(query, converted_query);
-		if (TDS_FAILED(rc)) {
-			tds_freeze_abort(&outer);
-			return rc;
-		}
-		tds_freeze_close(&outer);
-
-		for (i = 0; i < params->num_cols; i++) {
-			param = params->columns[i];
-			TDS_PROPAGATE(tds_put_data_info(tds, param, 0));
-			TDS_PROPAGATE(tds_put_data(tds, param));
-		}
+		TDS_PROPAGATE(rc);
 
 		tds->current_op = TDS_OP_EXECUTESQL;
 		return tds_query_flush_packet(tds);
@@ -1494,6 +1664,9 @@ tds71_submit_prepexec(TDSSOCKET * tds, const char *query, const char *id, TDSDYN
 
 	tds_set_cur_dyn(tds, dyn);
 
+	if (!id && tds->conn->dyn_cache_size)
+		dyn->cache_key = tds_dynamic_cache_key(tds, query, params, &dyn->cache_key_len, &dyn->cache_hash);
+
 	query_len = (int)strlen(query);
 
 	converted_query = tds_convert_string(tds, tds->conn->char_convs[client2ucs2], query, query_len, &converted_query_len);
@@ -1845,12 +2018,272 @@ tds_deferred_unprepare(TDSCONNECTION * conn, TDSDYNAMIC * dyn)
 		return TDS_SUCCESS;
 	}
 
+	if (tds_dynamic_cache_put(conn, dyn))
+		return TDS_SUCCESS;
+
 	dyn->defer_close = true;
 	conn->pending_close = 1;
 
 	return TDS_SUCCESS;
 }
 
+/**
+ * Compute the key used to find a prepared query in the connection cache.
+ * The key is composed by the query followed by parameter declarations
+ * (only for TDS 7+ where declarations are part of the prepare),
+ * every part NUL terminated.
+ * \tds
+ * \param query   query to prepare
+ * \param params  parameters used to prepare the query, can be NULL
+ * \param key_len filled with key length
+ * \param hash    filled with hash of the key
+ * \return allocated key or NULL on failure
+ */
+static char *
+tds_dynamic_cache_key(TDSSOCKET * tds, const char *query, TDSPARAMINFO * params, size_t *key_len, unsigned int *hash)
+{
+	size_t len, alloc = strlen(query) + 1;
+	int i, num_params = 0;
+	unsigned int h;
+	char declaration[128], *key = NULL, *p;
+
+	if (params && IS_TDS7_PLUS(tds->conn))
+		num_params = params->num_cols;
+
+	if (!TDS_RESIZE(key, alloc))
+		return NULL;
+	memcpy(key, query, alloc);
+	*key_len = alloc;
+
+	for (i = 0; i < num_params; ++i) {
+		if (TDS_FAILED(tds_get_column_declaration(tds, params->columns[i], declaration)))
+			goto Cleanup;
+		len = strlen(declaration) + 1;
+		if (*key_len + len > alloc) {
+			alloc = TDS_MAX(alloc + alloc / 2u, *key_len + len);
+			if (!TDS_RESIZE(key, alloc))
+				goto Cleanup;
+		}
+		memcpy(key + *key_len, declaration, len);
+		*key_len += len;
+	}
+
+	/* FNV-1a */
+	h = 2166136261u;
+	for (p = key; p != key + *key_len; ++p)
+		h = (h ^ (unsigned char) *p) * 16777619u;
+	*hash = h;
+
+	return key;
+
+      Cleanup:
+	free(key);
+	return NULL;
+}
+
+static void
+tds_dynamic_cache_hash_insert(TDSCONNECTION * conn, TDSDYNAMIC * dyn)
+{
+	TDSDYNAMIC **bucket = &conn->dyn_cache_hash[dyn->cache_hash & (conn->dyn_cache_hash_size - 1)];
+
+	dyn->cache_hash_next = *bucket;
+	*bucket = dyn;
+}
+
+/**
+ * Find a dynamic in the connection cache given its key.
+ * \param conn    connection owning the cache
+ * \param key     cache key, see tds_dynamic_cache_key
+ * \param key_len key length
+ * \param hash    hash of the key
+ * \return dynamic found or NULL if not found
+ */
+static TDSDYNAMIC *
+tds_dynamic_cache_find(TDSCONNECTION * conn, const char *key, size_t key_len, unsigned int hash)
+{
+	TDSDYNAMIC *dyn;
+
+	if (!conn->dyn_cache_hash)
+		return NULL;
+
+	for (dyn = conn->dyn_cache_hash[hash & (conn->dyn_cache_hash_size - 1)]; dyn != NULL; dyn = dyn->cache_hash_next)
+		if (dyn->cache_hash == hash && dyn->cache_key_len == key_len
+		    && memcmp(dyn->cache_key, key, key_len) == 0)
+			return dyn;
+	return NULL;
+}
+
+/**
+ * Unlink a dynamic from the connection cache without releasing the
+ * cache reference.
+ * \param conn connection owning the dynamic
+ * \param dyn  cached dynamic to unlink
+ */
+static void
+tds_dynamic_cache_unlink(TDSCONNECTION * conn, TDSDYNAMIC * dyn)
+{
+	TDSDYNAMIC **victim = &conn->dyn_cache_hash[dyn->cache_hash & (conn->dyn_cache_hash_size - 1)];
+
+	while (*victim && *victim != dyn)
+		victim = &(*victim)->cache_hash_next;
+	if (*victim)
+		*victim = dyn->cache_hash_next;
+	dyn->cache_hash_next = NULL;
+
+	if (dyn->cache_prev)
+		dyn->cache_prev->cache_next = dyn->cache_next;
+	else
+		conn->dyn_cache = dyn->cache_next;
+	if (dyn->cache_next)
+		dyn->cache_next->cache_prev = dyn->cache_prev;
+	else
+		conn->dyn_cache_tail = dyn->cache_prev;
+	dyn->cache_next = dyn->cache_prev = NULL;
+	dyn->cached = false;
+	--conn->dyn_cache_count;
+}
+
+/**
+ * Get a prepared dynamic from the connection cache.
+ * The dynamic is removed from the cache and the reference owned by the
+ * cache is passed to the caller.
+ * \tds
+ * \param query   query to prepare
+ * \param params  parameters used to prepare the query, can be NULL
+ * \return dynamic found or NULL if not found
+ */
+TDSDYNAMIC *
+tds_dynamic_cache_get(TDSSOCKET * tds, const char *query, TDSPARAMINFO * params)
+{
+	TDSCONNECTION *conn = tds->conn;
+	TDSDYNAMIC *dyn;
+	size_t key_len;
+	unsigned int hash;
+	char *key;
+
+	CHECK_TDS_EXTRA(tds);
+
+	if (!conn->dyn_cache || !query)
+		return NULL;
+
+	key = tds_dynamic_cache_key(tds, query, params, &key_len, &hash);
+	if (!key)
+		return NULL;
+
+	dyn = tds_dynamic_cache_find(conn, key, key_len, hash);
+	if (dyn) {
+		tds_dynamic_cache_unlink(conn, dyn);
+		tdsdump_log(TDS_DBG_FUNC, "tds_dynamic_cache_get() reusing dynamic %s\n", dyn->id);
+	}
+	free(key);
+
+	return dyn;
+}
+
+/**
+ * Put a dynamic no longer used by the client into the connection cache.
+ * If the dynamic is accepted the cache takes its own reference so client
+ * should release its one as usual. If the cache becomes too big the
+ * least recently used dynamic is unprepared when connection is idle.
+ * \param conn connection owning the dynamic
+ * \param dyn  dynamic to keep
+ * \return true if dynamic was cached, false if client should unprepare it
+ */
+bool
+tds_dynamic_cache_put(TDSCONNECTION * conn, TDSDYNAMIC * dyn)
+{
+	TDSDYNAMIC *victim;
+
+	CHECK_CONN_EXTRA(conn);
+	CHECK_DYNAMIC_EXTRA(dyn);
+
+	if (!conn->dyn_cache_size || !dyn->cache_key || dyn->cached || dyn->defer_close
+	    || !tds_needs_unprepare(conn, dyn))
+		return false;
+
+	/* do not keep duplicates */
+	if (tds_dynamic_cache_find(conn, dyn->cache_key, dyn->cache_key_len, dyn->cache_hash))
+		return false;
+
+	/* resize hash index, the list is used only for eviction order */
+	if (conn->dyn_cache_count >= conn->dyn_cache_hash_size) {
+		unsigned int new_size = conn->dyn_cache_hash_size ? conn->dyn_cache_hash_size * 2 : 16;
+		TDSDYNAMIC **new_hash = tds_new0(TDSDYNAMIC *, new_size);
+
+		if (!new_hash)
+			return false;
+		free(conn->dyn_cache_hash);
+		conn->dyn_cache_hash = new_hash;
+		conn->dyn_cache_hash_size = new_size;
+		for (victim = conn->dyn_cache; victim; victim = victim->cache_next)
+			tds_dynamic_cache_hash_insert(conn, victim);
+	}
+
+	tds_free_input_params(dyn);
+	++dyn->ref_count;
+	dyn->cached = true;
+	dyn->cache_prev = NULL;
+	dyn->cache_next = conn->dyn_cache;
+	if (conn->dyn_cache)
+		conn->dyn_cache->cache_prev = dyn;
+	else
+		conn->dyn_cache_tail = dyn;
+	conn->dyn_cache = dyn;
+	++conn->dyn_cache_count;
+	tds_dynamic_cache_hash_insert(conn, dyn);
+
+	/* evict the least recently used, unprepare is deferred so more unprepares are sent together */
+	while (conn->dyn_cache_count > conn->dyn_cache_size) {
+		victim = conn->dyn_cache_tail;
+		victim->defer_close = true;
+		conn->pending_close = 1;
+		tds_dynamic_cache_remove(conn, victim);
+	}
+	return true;
+}
+
+/**
+ * Remove a dynamic from the connection cache releasing the cache reference.
+ * \param conn connection owning the dynamic
+ * \param dyn  dynamic to remove
+ */
+void
+tds_dynamic_cache_remove(TDSCONNECTION * conn, TDSDYNAMIC * dyn)
+{
+	if (!dyn->cached)
+		return;
+
+	tds_dynamic_cache_unlink(conn, dyn);
+	tds_release_dynamic(&dyn);
+}
+
+/**
+ * Send a sp_unprepare RPC, TDS7+ only.
+ * \tds
+ * \param dyn dynamic query
+ */
+static void
+tds7_send_unprepare(TDSSOCKET * tds, TDSDYNAMIC * dyn)
+{
+	/* procedure name */
+	if (IS_TDS71_PLUS(tds->conn)) {
+		/* save some byte for mssql2k */
+		tds_put_smallint(tds, -1);
+		tds_put_smallint(tds, TDS_SP_UNPREPARE);
+	} else {
+		TDS_PUT_N_AS_UCS2(tds, "sp_unprepare");
+	}
+	tds_put_smallint(tds, 0);	/* flags */
+
+	/* id of prepared statement */
+	tds_put_byte(tds, 0);
+	tds_put_byte(tds, 0);
+	tds_put_byte(tds, SYBINTN);
+	tds_put_byte(tds, 4);
+	tds_put_byte(tds, 4);
+	tds_put_int(tds, dyn->num_id);
+}
+
 /**
  * Send a unprepare request for a prepared query
  * \param tds state information for the socket and the TDS protocol
@@ -1878,23 +2311,7 @@ tds_submit_unprepare(TDSSOCKET * tds, TDSDYNAMIC * dyn)
 		/* RPC on sp_execute */
 		tds_start_query(tds, TDS_RPC);
 
-		/* procedure name */
-		if (IS_TDS71_PLUS(tds->conn)) {
-			/* save some byte for mssql2k */
-			tds_put_smallint(tds, -1);
-			tds_put_smallint(tds, TDS_SP_UNPREPARE);
-		} else {
-			TDS_PUT_N_AS_UCS2(tds, "sp_unprepare");
-		}
-		tds_put_smallint(tds, 0);	/* flags */
-
-		/* id of prepared statement */
-		tds_put_byte(tds, 0);
-		tds_put_byte(tds, 0);
-		tds_put_byte(tds, SYBINTN);
-		tds_put_byte(tds, 4);
-		tds_put_byte(tds, 4);
-		tds_put_int(tds, dyn->num_id);
+		tds7_send_unprepare(tds, dyn);
 
 		tds->current_op = TDS_OP_UNPREPARE;
 		return tds_query_flush_packet(tds);
@@ -1983,6 +2400,40 @@ tds4_send_emulated_rpc(TDSSOCKET * tds, const char *rpc_name, TDSPARAMINFO * par
 	return tds_query_flush_packet(tds);
 }
 
+/**
+ * Write a RPC call for TDS7+ (procedure name, flags and parameters).
+ * \param tds      state information for the socket and the TDS protocol
+ * \param rpc_name name of RPC
+ * \param params   parameters information. NULL for no parameters
+ */
+static TDSRET
+tds7_put_rpc(TDSSOCKET * tds, const char *rpc_name, TDSPARAMINFO * params)
+{
+	TDSCOLUMN *param;
+	int i;
+	int num_params = params ? params->num_cols : 0;
+
+	/* procedure name */
+	TDS_START_LEN_USMALLINT(tds) {
+		tds_put_string(tds, rpc_name, -1);
+	} TDS_END_LEN_STRING
+
+	/*
+	 * TODO support flags
+	 * bit 0 (1 as flag) in TDS7/TDS5 is "recompile"
+	 * bit 1 (2 as flag) in TDS7+ is "no metadata" bit 
+	 * (I don't know meaning of "no metadata")
+	 */
+	tds_put_smallint(tds, 0);
+
+	for (i = 0; i < num_params; i++) {
+		param = params->columns[i];
+		TDS_PROPAGATE(tds_put_data_info(tds, param, TDS_PUT_DATA_USE_NAME));
+		TDS_PROPAGATE(tds_put_data(tds, param));
+	}
+	return TDS_SUCCESS;
+}
+
 /**
  * Calls a RPC from server. Output parameters will be stored in tds->param_info.
  * \param tds      state information for the socket and the TDS protocol
@@ -1992,8 +2443,6 @@ tds4_send_emulated_rpc(TDSSOCKET * tds, const char *rpc_name, TDSPARAMINFO * par
 TDSRET
 tds_submit_rpc(TDSSOCKET * tds, const char *rpc_name, TDSPARAMINFO * params, TDSHEADERS * head)
 {
-	TDSCOLUMN *param;
-	int i;
 	int num_params = params ? params->num_cols : 0;
 
 	CHECK_TDS_EXTRA(tds);
@@ -2013,24 +2462,7 @@ tds_submit_rpc(TDSSOCKET * tds, const char *rpc_name, TDSPARAMINFO * params, TDS
 		if (tds_start_query_head(tds, TDS_RPC, head) != TDS_SUCCESS)
 			return TDS_FAIL;
 
-		/* procedure name */
-		TDS_START_LEN_USMALLINT(tds) {
-			tds_put_string(tds, rpc_name, -1);
-		} TDS_END_LEN_STRING
-
-		/*
-		 * TODO support flags
-		 * bit 0 (1 as flag) in TDS7/TDS5 is "recompile"
-		 * bit 1 (2 as flag) in TDS7+ is "no metadata" bit 
-		 * (I don't know meaning of "no metadata")
-		 */
-		tds_put_smallint(tds, 0);
-
-		for (i = 0; i < num_params; i++) {
-			param = params->columns[i];
-			TDS_PROPAGATE(tds_put_data_info(tds, param, TDS_PUT_DATA_USE_NAME));
-			TDS_PROPAGATE(tds_put_data(tds, param));
-		}
+		TDS_PROPAGATE(tds7_put_rpc(tds, rpc_name, params));
 
 		return tds_query_flush_packet(tds);
 	}
@@ -2173,6 +2605,34 @@ tds_send_cancel(TDSSOCKET * tds)
 #endif
 }
 
+/**
+ * Cancel a request while it is being written, for instance when data to
+ * send cannot be produced.
+ * The message is terminated with the ignore bit so the server discards it,
+ * then a cancel is sent and processed to synchronize with the server.
+ * \tds
+ * \return TDS_SUCCESS if the connection can be used for another request
+ */
+TDSRET
+tds_cancel_request(TDSSOCKET * tds)
+{
+	CHECK_TDS_EXTRA(tds);
+
+	if (tds->state != TDS_WRITING)
+		return TDS_SUCCESS;
+
+	tdsdump_log(TDS_DBG_FUNC, "tds_cancel_request: discarding partial request\n");
+	if (IS_TDSDEAD(tds))
+		return TDS_FAIL;
+	if (tds->out_pos > tds->out_buf_max)
+		TDS_PROPAGATE(tds_write_packet(tds, 0x00));
+	TDS_PROPAGATE(tds_write_packet(tds, TDS_STATUS_EOM | TDS_STATUS_IGNORE));
+	tds_set_state(tds, TDS_PENDING);
+
+	TDS_PROPAGATE(tds_send_cancel(tds));
+	return tds_process_cancel(tds);
+}
+
 /**
  * Quote a string properly. Output string is always NUL-terminated
  * \param buffer   output buffer. If NULL function will just return
@@ -3369,6 +3829,8 @@ tds_multiple_init(TDSSOCKET *tds, TDSMULTIPLE *multiple, TDS_MULTIPLE_TYPE type,
 	unsigned char packet_type;
 	multiple->type = type;
 	multiple->flags = 0;
+	multiple->count = 0;
+	multiple->current = 0;
 
 	if (tds_set_state(tds, TDS_WRITING) != TDS_WRITING)
 		return TDS_FAIL;
@@ -3405,6 +3867,7 @@ tds_multiple_query(TDSSOCKET *tds, TDSMULTIPLE *multiple, const char *query, TDS
 	if (multiple->flags & MUL_STARTED)
 		tds_put_string(tds, " ", 1);
 	multiple->flags |= MUL_STARTED;
+	++multiple->count;
 
 	return tds_send_emulated_execute(tds, query, params);
 }
@@ -3412,8 +3875,11 @@ tds_multiple_query(TDSSOCKET *tds, TDSMULTIPLE *multiple, const char *query, TDS
 TDSRET
 tds_multiple_execute(TDSSOCKET *tds, TDSMULTIPLE *multiple, TDSDYNAMIC * dyn)
 {
-	assert(multiple->type == TDS_MULTIPLE_EXECUTE);
+	/* executes can also be mixed with other RPCs */
+	assert(multiple->type == TDS_MULTIPLE_EXECUTE
+	       || (multiple->type == TDS_MULTIPLE_RPC && IS_TDS7_PLUS(tds->conn)));
 
+	++multiple->count;
 	if (IS_TDS7_PLUS(tds->conn)) {
 		if (multiple->flags & MUL_STARTED) {
 			/* TODO define constant */
@@ -3433,6 +3899,111 @@ tds_multiple_execute(TDSSOCKET *tds, TDSMULTIPLE *multiple, TDSDYNAMIC * dyn)
 	return tds_send_emulated_execute(tds, dyn->query, dyn->params);
 }
 
+/**
+ * Add a sp_unprepare RPC to a multiple request, TDS7+ only.
+ * Used to send deferred unprepares together in a single request.
+ * \tds
+ * \param multiple multiple request initialized with TDS_MULTIPLE_RPC
+ * \param dyn      dynamic query to unprepare
+ */
+TDSRET
+tds_multiple_unprepare(TDSSOCKET *tds, TDSMULTIPLE *multiple, TDSDYNAMIC * dyn)
+{
+	assert(multiple->type == TDS_MULTIPLE_RPC);
+	assert(IS_TDS7_PLUS(tds->conn));
+
+	if (multiple->flags & MUL_STARTED) {
+		/* TODO define constant */
+		tds_put_byte(tds, IS_TDS72_PLUS(tds->conn) ? 0xff : 0x80);
+	}
+	multiple->flags |= MUL_STARTED;
+	++multiple->count;
+
+	tds7_send_unprepare(tds, dyn);
+
+	return TDS_SUCCESS;
+}
+
+/**
+ * Add a RPC call to a multiple request.
+ * Every call returns its own DONEPROC, output parameters and
+ * return status. Only TDS7+ is supported.
+ * \param tds      state information for the socket and the TDS protocol
+ * \param multiple multiple request initialized with TDS_MULTIPLE_RPC
+ * \param rpc_name name of RPC
+ * \param params   parameters information. NULL for no parameters
+ */
+TDSRET
+tds_multiple_rpc(TDSSOCKET *tds, TDSMULTIPLE *multiple, const char *rpc_name, TDSPARAMINFO * params)
+{
+	assert(multiple->type == TDS_MULTIPLE_RPC);
+
+	if (!IS_TDS7_PLUS(tds->conn))
+		return TDS_FAIL;
+
+	if (params)
+		CHECK_PARAMINFO_EXTRA(params);
+
+	if (multiple->flags & MUL_STARTED) {
+		/* TODO define constant */
+		tds_put_byte(tds, IS_TDS72_PLUS(tds->conn) ? 0xff : 0x80);
+	} else {
+		/* distinguish from dynamic query  */
+		tds_release_cur_dyn(tds);
+	}
+	multiple->flags |= MUL_STARTED;
+	++multiple->count;
+	tds->current_op = TDS_OP_NONE;
+
+	return tds7_put_rpc(tds, rpc_name, params);
+}
+
+/**
+ * Add a query to a multiple request, query is executed with sp_executesql.
+ * Unlike tds_multiple_query every query returns its own DONEPROC so
+ * results can be attributed using tds_process_multiple_results.
+ * Only TDS7+ is supported.
+ * \param tds      state information for the socket and the TDS protocol
+ * \param multiple multiple request initialized with TDS_MULTIPLE_RPC
+ * \param query    query to execute, placeholders like ? are replaced by parameters
+ * \param params   parameters information. NULL for no parameters
+ */
+TDSRET
+tds_multiple_execdirect(TDSSOCKET *tds, TDSMULTIPLE *multiple, const char *query, TDSPARAMINFO * params)
+{
+	size_t converted_query_len;
+	const char *converted_query;
+	TDSRET rc;
+
+	assert(multiple->type == TDS_MULTIPLE_RPC);
+
+	if (!IS_TDS7_PLUS(tds->conn))
+		return TDS_FAIL;
+
+	if (params)
+		CHECK_PARAMINFO_EXTRA(params);
+
+	converted_query = tds_convert_string(tds, tds->conn->char_convs[client2ucs2], query, -1, &converted_query_len);
+	if (!converted_query)
+		return TDS_FAIL;
+
+	if (multiple->flags & MUL_STARTED) {
+		/* TODO define constant */
+		tds_put_byte(tds, IS_TDS72_PLUS(tds->conn) ? 0xff : 0x80);
+	} else {
+		/* distinguish from dynamic query  */
+		tds_release_cur_dyn(tds);
+	}
+	multiple->flags |= MUL_STARTED;
+	++multiple->count;
+	/* like tds_multiple_rpc, return status of every request is returned to caller */
+	tds->current_op = TDS_OP_NONE;
+
+	rc = tds7_put_execdirect(tds, converted_query, converted_query_len, params);
+	tds_convert_string_free(query, converted_query);
+	return rc;
+}
+
 /**
  * Send option commands to server.
  * Option commands are used to change server options.
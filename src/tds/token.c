@@ -910,6 +910,90 @@ tds_process_simple_query(TDSSOCKET * tds)
 	return ret;
 }
 
+/**
+ * Process results of a multiple request sent with TDS_MULTIPLE_RPC.
+ * Every request is terminated by a DONEPROC token, results are stored
+ * in the respective element of results. Rows are discarded.
+ * \param tds      state information for the socket and the TDS protocol
+ * \param multiple multiple request sent
+ * \param results  array of multiple->count elements to fill
+ * \return TDS_SUCCESS if all requests succeeded, TDS_FAIL if some failed
+ *         or other error codes on communication problems
+ */
+TDSRET
+tds_process_multiple_results(TDSSOCKET * tds, TDSMULTIPLE * multiple, TDSMULTIPLERESULT * results)
+{
+	TDS_INT res_type;
+	TDS_INT done_flags;
+	TDSRET rc;
+	TDSRET ret = TDS_SUCCESS;
+	TDS_INT8 inproc_rows = TDS_NO_COUNT;
+	TDSMULTIPLERESULT *res;
+	unsigned int i;
+
+	CHECK_TDS_EXTRA(tds);
+
+	for (i = 0; i < multiple->count; ++i) {
+		results[i].rows_affected = TDS_NO_COUNT;
+		results[i].ret_status = 0;
+		results[i].has_status = false;
+		results[i].failed = false;
+	}
+
+	multiple->current = 0;
+	while ((rc = tds_process_tokens(tds, &res_type, &done_flags, TDS_RETURN_DONE|TDS_RETURN_PROC)) == TDS_SUCCESS) {
+		/* server should not return more results than requests */
+		if (multiple->current >= multiple->count) {
+			if (res_type == TDS_DONE_RESULT && (done_flags & TDS_DONE_ERROR) != 0)
+				ret = TDS_FAIL;
+			continue;
+		}
+		res = &results[multiple->current];
+
+		switch (res_type) {
+		case TDS_STATUS_RESULT:
+			res->ret_status = tds->ret_status;
+			res->has_status = true;
+			break;
+
+		case TDS_DONE_RESULT:
+		case TDS_DONEINPROC_RESULT:
+			if ((done_flags & TDS_DONE_ERROR) != 0)
+				res->failed = true;
+			if ((done_flags & TDS_DONE_COUNT) != 0) {
+				if (inproc_rows == TDS_NO_COUNT)
+					inproc_rows = 0;
+				inproc_rows += tds->rows_affected;
+			}
+			break;
+
+		case TDS_DONEPROC_RESULT:
+			if ((done_flags & TDS_DONE_ERROR) != 0)
+				res->failed = true;
+			/* count of procedure is not used, sum statement counts */
+			res->rows_affected = inproc_rows;
+			inproc_rows = TDS_NO_COUNT;
+			if (res->failed)
+				ret = TDS_FAIL;
+			++multiple->current;
+			break;
+
+		default:
+			break;
+		}
+	}
+
+	/* requests without results were not executed */
+	for (i = multiple->current; i < multiple->count; ++i) {
+		results[i].failed = true;
+		ret = TDS_FAIL;
+	}
+	if (TDS_FAILED(rc))
+		ret = rc;
+
+	return ret;
+}
+
 /**
  * Holds list of names
  */
@@ -2013,6 +2097,64 @@ tds_process_featureextack(TDSSOCKET * tds)
 	return TDS_SUCCESS;
 }
 
+/**
+ * Unprepare all deferred dynamics sending a single batch of RPCs, TDS7+ only.
+ * Dynamics are considered closed once the server answered, server fails
+ * only if the handle is already invalid.
+ * \tds
+ * \return TDS_FAIL if the batch could not be sent or answers were not read
+ */
+static TDSRET
+tds7_process_pending_unprepares(TDSSOCKET *tds)
+{
+	TDSDYNAMIC *dyn, **dyns;
+	TDSMULTIPLE multiple;
+	unsigned int num_dyns = 0, n;
+	TDSRET rc;
+
+	for (dyn = tds->conn->dyns; dyn; dyn = dyn->next)
+		if (dyn->defer_close)
+			++num_dyns;
+	if (!num_dyns)
+		return TDS_SUCCESS;
+
+	dyns = tds_new(TDSDYNAMIC *, num_dyns);
+	if (!dyns)
+		return TDS_FAIL;
+	n = 0;
+	for (dyn = tds->conn->dyns; dyn && n < num_dyns; dyn = dyn->next) {
+		if (dyn->defer_close) {
+			++dyn->ref_count;
+			dyns[n++] = dyn;
+		}
+	}
+
+	rc = tds_multiple_init(tds, &multiple, TDS_MULTIPLE_RPC, NULL);
+	if (TDS_SUCCEED(rc)) {
+		tds_release_cur_dyn(tds);
+		tds->current_op = TDS_OP_NONE;
+		for (n = 0; n < num_dyns; ++n)
+			tds_multiple_unprepare(tds, &multiple, dyns[n]);
+		rc = tds_multiple_done(tds, &multiple);
+	}
+	if (TDS_SUCCEED(rc)) {
+		rc = tds_process_simple_query(tds);
+		/* a failed unprepare means handle was already invalid, only a broken connection is an error */
+		if (TDS_FAILED(rc) && !IS_TDSDEAD(tds))
+			rc = TDS_SUCCESS;
+	}
+
+	for (n = 0; n < num_dyns; ++n) {
+		if (TDS_SUCCEED(rc)) {
+			dyns[n]->defer_close = false;
+			tds_dynamic_deallocated(tds->conn, dyns[n]);
+		}
+		tds_release_dynamic(&dyns[n]);
+	}
+	free(dyns);
+	return rc;
+}
+
 /**
  * Attempt to close all deferred closes (dynamics and cursors).
  * \tds
@@ -2050,9 +2192,15 @@ tds_process_pending_closes(TDSSOCKET *tds)
 	}
 
 	/* scan all dynamic to close */
-	dyn = tds->conn->dyns;
-	if (dyn)
-		++dyn->ref_count;
+	if (IS_TDS7_PLUS(tds->conn)) {
+		if (TDS_FAILED(tds7_process_pending_unprepares(tds)))
+			all_closed = 0;
+		dyn = NULL;
+	} else {
+		dyn = tds->conn->dyns;
+		if (dyn)
+			++dyn->ref_count;
+	}
 	for (; dyn; dyn = next_dyn) {
 		next_dyn = dyn->next;
 		if (next_dyn)
@@ -2580,26 +2728,6 @@ tds_process_cancel(TDSSOCKET * tds)
 	}
 }
 
-/**
- * Finds a dynamic given string id
- * \return dynamic or NULL is not found
- * \param conn state information for the socket and the TDS protocol
- * \param id   dynamic id to search
- */
-TDSDYNAMIC *
-tds_lookup_dynamic(TDSCONNECTION * conn, const char *id)
-{
-	TDSDYNAMIC *curr;
-
-	CHECK_CONN_EXTRA(conn);
-	
-	for (curr = conn->dyns; curr != NULL; curr = curr->next) {
-		if (!strcmp(curr->id, id))
-			return curr;
-	}
-	return NULL;
-}
-
 /**
  * tds_process_dynamic()
  * finds the element of the dyns array for the id
@@ -0,0 +1,545 @@
+/* FreeTDS - Library of routines accessing Sybase and Microsoft databases
+ * Copyright (C) 2026  Frediano Ziglio
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Purpose: test bulk copy of rows from column arrays and result columns.
+ * Rows sent from arrays or from the current row of a result must be
+ * encoded like rows sent one at a time.
+ * To test performance, call this program with a number of rows.
+ */
+#include "common.h"
+#include <assert.h>
+#include <freetds/bytes.h>
+
+#if HAVE_UNISTD_H
+#undef getpid
+#include <unistd.h>
+#endif /* HAVE_UNISTD_H */
+
+#include <freetds/replacements.h>
+#include <freetds/utils.h>
+#include <freetds/thread.h>
+#include <freetds/time.h>
+#include <freetds/convert.h>
+
+#define NUM_ROWS 200
+#define NUM_COLS 5
+#define STR_LEN 16
+
+static TDSSOCKET *tds;
+static TDS_SYS_SOCKET server_socket = INVALID_SOCKET;
+
+typedef struct
+{
+	unsigned char *buf;
+	size_t len;
+	bool keep;
+	tds_thread th;
+} REQUEST;
+
+/* data for every column */
+typedef struct
+{
+	TDS_INT *ints;
+	char (*int_strs)[STR_LEN];
+	char (*strs)[STR_LEN];
+	double *floats;
+	char (*dates)[STR_LEN * 2];
+	TDS_SMALLINT *indicators[NUM_COLS];
+	TDS_INT *lengths;
+} ARRAYS;
+
+static ARRAYS arrays;
+static int null_error_index, null_error_offset;
+
+static void
+read_all(TDS_SYS_SOCKET s, void *buf, size_t len)
+{
+	char *p = (char *) buf;
+
+	while (len) {
+		int got = READSOCKET(s, p, len);
+		assert(got > 0);
+		p += got;
+		len -= got;
+	}
+}
+
+/* thread reading a full request, removing packet headers */
+static TDS_THREAD_PROC_DECLARE(read_request_proc, arg)
+{
+	REQUEST *req = (REQUEST *) arg;
+	unsigned char header[8], data[4096];
+	size_t len, capacity = 0;
+
+	req->buf = NULL;
+	req->len = 0;
+	do {
+		read_all(server_socket, header, 8);
+		assert(header[0] == TDS_BULK);
+		len = TDS_GET_UA2BE(header + 2) - 8;
+		assert(len <= sizeof(data));
+		read_all(server_socket, data, len);
+		if (req->keep) {
+			if (req->len + len > capacity) {
+				capacity = (req->len + len) * 2;
+				req->buf = (unsigned char *) realloc(req->buf, capacity);
+				assert(req->buf);
+			}
+			memcpy(req->buf + req->len, data, len);
+		}
+		req->len += len;
+	} while ((header[1] & 1) == 0);
+
+	return TDS_THREAD_RESULT(0);
+}
+
+static void
+start_request(REQUEST *req, bool keep)
+{
+	req->keep = keep;
+	assert(tds_thread_create(&req->th, read_request_proc, req) == 0);
+	tds->out_flag = TDS_BULK;
+}
+
+static void
+end_request(REQUEST *req)
+{
+	tds_flush_packet(tds);
+	tds_thread_join(req->th, NULL);
+
+	/* we do not send any reply, just allows another request */
+	tds->state = TDS_IDLE;
+}
+
+static void
+alloc_arrays(int num_rows)
+{
+	int i, n;
+
+	arrays.ints = tds_new(TDS_INT, num_rows);
+	arrays.int_strs = (char (*)[STR_LEN]) malloc(STR_LEN * num_rows);
+	arrays.strs = (char (*)[STR_LEN]) malloc(STR_LEN * num_rows);
+	arrays.floats = tds_new(double, num_rows);
+	arrays.dates = (char (*)[STR_LEN * 2]) malloc(STR_LEN * 2 * num_rows);
+	arrays.lengths = tds_new(TDS_INT, num_rows);
+	assert(arrays.ints && arrays.int_strs && arrays.strs && arrays.floats && arrays.dates && arrays.lengths);
+	for (i = 0; i < NUM_COLS; ++i) {
+		arrays.indicators[i] = tds_new0(TDS_SMALLINT, num_rows);
+		assert(arrays.indicators[i]);
+	}
+
+	for (n = 0; n < num_rows; ++n) {
+		arrays.ints[n] = n * 12345;
+		sprintf(arrays.int_strs[n], "%d", n * 3 - 100);
+		/* strings are terminated or fill the entire element */
+		memset(arrays.strs[n], 'x', STR_LEN);
+		if (n % 3)
+			sprintf(arrays.strs[n], "str %d", n);
+		arrays.floats[n] = n * 1.25 - 7;
+		sprintf(arrays.dates[n], "2024-%02d-%02d 10:%02d:%02d", n % 12 + 1, n % 28 + 1, n % 60, (n * 7) % 60);
+		arrays.lengths[n] = (n % 4) == 1 ? 3 : -1;
+		for (i = 1; i < NUM_COLS; ++i)
+			arrays.indicators[i][n] = (n % (i + 4)) == 2 ? -1 : 0;
+	}
+}
+
+static void
+free_arrays(void)
+{
+	int i;
+
+	free(arrays.ints);
+	free(arrays.int_strs);
+	free(arrays.strs);
+	free(arrays.floats);
+	free(arrays.dates);
+	free(arrays.lengths);
+	for (i = 0; i < NUM_COLS; ++i)
+		free(arrays.indicators[i]);
+}
+
+static void
+set_column(TDSCOLUMN *col, TDS_SERVER_TYPE type, int size, bool nullable)
+{
+	tds_set_column_type(tds->conn, col, type);
+	if (size)
+		col->column_size = col->on_server.column_size = size;
+	col->column_nullable = nullable;
+	if (is_numeric_type(col->column_type)) {
+		col->column_prec = 10;
+		col->column_scale = 2;
+		col->bcp_column_data = tds_alloc_bcp_column_data(sizeof(TDS_NUMERIC));
+		assert(col->bcp_column_data);
+		((TDS_NUMERIC *) col->bcp_column_data->data)->precision = col->column_prec;
+		((TDS_NUMERIC *) col->bcp_column_data->data)->scale = col->column_scale;
+	} else {
+		col->bcp_column_data = tds_alloc_bcp_column_data(col->column_size);
+		assert(col->bcp_column_data);
+	}
+}
+
+static TDSBCPINFO *
+create_bcpinfo(void)
+{
+	TDSBCPINFO *bcpinfo;
+	TDSRESULTINFO *bindinfo;
+	int i;
+
+	bcpinfo = tds_alloc_bcpinfo();
+	assert(bcpinfo);
+	bindinfo = tds_alloc_results(NUM_COLS);
+	assert(bindinfo);
+	bcpinfo->bindinfo = bindinfo;
+
+	set_column(bindinfo->columns[0], SYBINT4, 0, false);
+	set_column(bindinfo->columns[1], SYBINTN, 4, true);
+	set_column(bindinfo->columns[2], IS_TDS7_PLUS(tds->conn) ? XSYBVARCHAR : SYBVARCHAR, 30, true);
+	set_column(bindinfo->columns[3], SYBNUMERIC, 6, true);
+	set_column(bindinfo->columns[4], SYBDATETIMN, 8, true);
+
+	if (!IS_TDS7_PLUS(tds->conn)) {
+		bindinfo->row_size = 512;
+		bindinfo->current_row = tds_new(unsigned char, bindinfo->row_size);
+		assert(bindinfo->current_row);
+		bindinfo->row_free = NULL;
+	}
+
+	for (i = 0; i < NUM_COLS; ++i)
+		tds_dstr_copy(&bindinfo->columns[i]->column_name, "col");
+
+	return bcpinfo;
+}
+
+static void
+free_bcpinfo(TDSBCPINFO *bcpinfo)
+{
+	free(bcpinfo->bindinfo->current_row);
+	bcpinfo->bindinfo->current_row = NULL;
+	tds_free_bcpinfo(bcpinfo);
+}
+
+static void
+bind_arrays(TDSBCPINFO *bcpinfo)
+{
+	TDSRET rc;
+
+	rc = tds_bcp_bind_array(tds, bcpinfo, 0, SYBINT4, arrays.ints, 0, NULL, arrays.indicators[0]);
+	assert(rc == TDS_SUCCESS);
+	rc = tds_bcp_bind_array(tds, bcpinfo, 1, SYBCHAR, arrays.int_strs, STR_LEN, NULL, arrays.indicators[1]);
+	assert(rc == TDS_SUCCESS);
+	rc = tds_bcp_bind_array(tds, bcpinfo, 2, SYBCHAR, arrays.strs, STR_LEN, arrays.lengths, arrays.indicators[2]);
+	assert(rc == TDS_SUCCESS);
+	rc = tds_bcp_bind_array(tds, bcpinfo, 3, SYBFLT8, arrays.floats, sizeof(double), NULL, arrays.indicators[3]);
+	assert(rc == TDS_SUCCESS);
+	rc = tds_bcp_bind_array(tds, bcpinfo, 4, SYBCHAR, arrays.dates, STR_LEN * 2, NULL, arrays.indicators[4]);
+	assert(rc == TDS_SUCCESS);
+}
+
+/* convert a value like dblib does */
+static TDSRET
+ref_convert(TDSCOLUMN *col, TDS_SERVER_TYPE srctype, const void *src, TDS_UINT srclen)
+{
+	BCPCOLDATA *coldata = col->bcp_column_data;
+	TDS_SERVER_TYPE desttype = tds_get_conversion_type(col->column_type, col->column_size);
+	CONV_RESULT cr, *p_cr = is_variable_type(desttype) ? &cr : (CONV_RESULT *) coldata->data;
+	TDS_INT len;
+
+	len = tds_convert(tds_get_ctx(tds), srctype, src, srclen, desttype, p_cr);
+	if (len < 0)
+		return TDS_FAIL;
+	coldata->datalen = len;
+	if (p_cr == &cr) {
+		free(coldata->data);
+		coldata->data = (TDS_UCHAR *) cr.c;
+	}
+	return TDS_SUCCESS;
+}
+
+static TDSRET
+ref_get_col_data(TDSBCPINFO *bcpinfo, TDSCOLUMN *col, int offset)
+{
+	int i;
+	const char *s;
+
+	for (i = 0; bcpinfo->bindinfo->columns[i] != col; ++i)
+		continue;
+
+	col->bcp_column_data->is_null = arrays.indicators[i][offset] == -1;
+	if (col->bcp_column_data->is_null) {
+		col->bcp_column_data->datalen = 0;
+		return TDS_SUCCESS;
+	}
+
+	switch (i) {
+	case 0:
+		return ref_convert(col, SYBINT4, &arrays.ints[offset], 4);
+	case 1:
+		return ref_convert(col, SYBCHAR, arrays.int_strs[offset], strlen(arrays.int_strs[offset]));
+	case 2:
+		s = arrays.strs[offset];
+		if (arrays.lengths[offset] >= 0)
+			return ref_convert(col, SYBCHAR, s, arrays.lengths[offset]);
+		return ref_convert(col, SYBCHAR, s, memchr(s, 0, STR_LEN) ? strlen(s) : STR_LEN);
+	case 3:
+		return ref_convert(col, SYBFLT8, &arrays.floats[offset], 8);
+	}
+	return ref_convert(col, SYBCHAR, arrays.dates[offset], strlen(arrays.dates[offset]));
+}
+
+/* result with the same values of the arrays */
+static TDSRESULTINFO *
+create_source(void)
+{
+	TDSRESULTINFO *resinfo;
+
+	resinfo = tds_alloc_results(NUM_COLS);
+	assert(resinfo);
+	tds_set_column_type(tds->conn, resinfo->columns[0], SYBINT4);
+	tds_set_column_type(tds->conn, resinfo->columns[1], SYBVARCHAR);
+	resinfo->columns[1]->column_size = STR_LEN;
+	tds_set_column_type(tds->conn, resinfo->columns[2], SYBTEXT);
+	tds_set_column_type(tds->conn, resinfo->columns[3], SYBFLT8);
+	tds_set_column_type(tds->conn, resinfo->columns[4], SYBVARCHAR);
+	resinfo->columns[4]->column_size = STR_LEN * 2;
+	assert(tds_alloc_row(resinfo) == TDS_SUCCESS);
+	return resinfo;
+}
+
+static void
+fill_source(TDSRESULTINFO *resinfo, int n)
+{
+	TDSCOLUMN **cols = resinfo->columns;
+	TDSBLOB *blob = (TDSBLOB *) cols[2]->column_data;
+	const char *s = arrays.strs[n];
+	int i;
+
+	memcpy(cols[0]->column_data, &arrays.ints[n], 4);
+	cols[0]->column_cur_size = 4;
+	cols[1]->column_cur_size = (TDS_INT) strlen(strcpy((char *) cols[1]->column_data, arrays.int_strs[n]));
+	blob->textvalue = (TDS_CHAR *) s;
+	if (arrays.lengths[n] >= 0)
+		cols[2]->column_cur_size = arrays.lengths[n];
+	else
+		cols[2]->column_cur_size = (TDS_INT) (memchr(s, 0, STR_LEN) ? strlen(s) : STR_LEN);
+	memcpy(cols[3]->column_data, &arrays.floats[n], 8);
+	cols[3]->column_cur_size = 8;
+	cols[4]->column_cur_size = (TDS_INT) strlen(strcpy((char *) cols[4]->column_data, arrays.dates[n]));
+
+	for (i = 0; i < NUM_COLS; ++i)
+		if (arrays.indicators[i][n] == -1)
+			cols[i]->column_cur_size = -1;
+}
+
+static void
+free_source(TDSRESULTINFO *resinfo)
+{
+	/* text is not owned */
+	((TDSBLOB *) resinfo->columns[2]->column_data)->textvalue = NULL;
+	tds_free_results(resinfo);
+}
+
+static void
+null_error(TDSBCPINFO *bcpinfo TDS_UNUSED, int index, int offset)
+{
+	null_error_index = index;
+	null_error_offset = offset;
+}
+
+static void
+test_version(TDS_USMALLINT version)
+{
+	TDSBCPINFO *bcpinfo;
+	TDSRESULTINFO *source;
+	REQUEST ref_req, req;
+	TDSRET rc;
+	int n, sent;
+
+	tds->conn->tds_version = version;
+	bcpinfo = create_bcpinfo();
+	bind_arrays(bcpinfo);
+
+	/* rows sent one at a time */
+	start_request(&ref_req, true);
+	for (n = 0; n < NUM_ROWS; ++n) {
+		rc = tds_bcp_send_record(tds, bcpinfo, ref_get_col_data, null_error, n);
+		assert(rc == TDS_SUCCESS);
+	}
+	end_request(&ref_req);
+
+	/* rows sent from arrays */
+	start_request(&req, true);
+	rc = tds_bcp_send_rows(tds, bcpinfo, 0, NUM_ROWS, null_error, &sent);
+	assert(rc == TDS_SUCCESS && sent == NUM_ROWS);
+	end_request(&req);
+	assert(req.len == ref_req.len);
+	assert(memcmp(req.buf, ref_req.buf, req.len) == 0);
+	free(req.buf);
+
+	/* rows can be sent in more calls */
+	start_request(&req, true);
+	rc = tds_bcp_send_rows(tds, bcpinfo, 0, 17, null_error, &sent);
+	assert(rc == TDS_SUCCESS && sent == 17);
+	rc = tds_bcp_send_rows(tds, bcpinfo, 17, NUM_ROWS - 17, null_error, &sent);
+	assert(rc == TDS_SUCCESS && sent == NUM_ROWS - 17);
+	end_request(&req);
+	assert(req.len == ref_req.len);
+	assert(memcmp(req.buf, ref_req.buf, req.len) == 0);
+	free(req.buf);
+
+	/* rows sent from current row of a result */
+	source = create_source();
+	for (n = 0; n < NUM_COLS; ++n)
+		assert(tds_bcp_bind_column(tds, bcpinfo, n, source->columns[n]) == TDS_SUCCESS);
+	start_request(&req, true);
+	for (n = 0; n < NUM_ROWS; ++n) {
+		fill_source(source, n);
+		rc = tds_bcp_send_rows(tds, bcpinfo, 0, 1, null_error, &sent);
+		assert(rc == TDS_SUCCESS && sent == 1);
+	}
+	end_request(&req);
+	assert(req.len == ref_req.len);
+	assert(memcmp(req.buf, ref_req.buf, req.len) == 0);
+	free(req.buf);
+	free(ref_req.buf);
+	bind_arrays(bcpinfo);
+	free_source(source);
+
+	/* NULL in a not nullable column stops sending */
+	arrays.indicators[0][23] = -1;
+	null_error_index = null_error_offset = -1;
+	start_request(&req, false);
+	rc = tds_bcp_send_rows(tds, bcpinfo, 0, NUM_ROWS, null_error, &sent);
+	assert(TDS_FAILED(rc) && sent == 23);
+	assert(null_error_index == 0 && null_error_offset == 23);
+	end_request(&req);
+	arrays.indicators[0][23] = 0;
+
+	/* a conversion error in the last column stops before sending any part of the row */
+	start_request(&ref_req, true);
+	for (n = 0; n < 30; ++n) {
+		rc = tds_bcp_send_record(tds, bcpinfo, ref_get_col_data, null_error, n);
+		assert(rc == TDS_SUCCESS);
+	}
+	end_request(&ref_req);
+	strcpy(arrays.dates[30], "not a date");
+	arrays.indicators[4][30] = 0;
+	start_request(&req, true);
+	rc = tds_bcp_send_rows(tds, bcpinfo, 0, NUM_ROWS, null_error, &sent);
+	assert(TDS_FAILED(rc) && sent == 30);
+	end_request(&req);
+	assert(req.len == ref_req.len);
+	assert(memcmp(req.buf, ref_req.buf, req.len) == 0);
+	free(req.buf);
+	free(ref_req.buf);
+	strcpy(arrays.dates[30], "2024-01-01 10:00:00");
+
+	/* invalid conversions are detected binding */
+	rc = tds_bcp_bind_array(tds, bcpinfo, 4, SYBINT4, arrays.ints, 0, NULL, NULL);
+	assert(TDS_FAILED(rc));
+	rc = tds_bcp_bind_array(tds, bcpinfo, NUM_COLS, SYBINT4, arrays.ints, 0, NULL, NULL);
+	assert(TDS_FAILED(rc));
+
+	/* unbound columns are sent as NULL */
+	rc = tds_bcp_bind_array(tds, bcpinfo, 0, SYBINT4, NULL, 0, NULL, NULL);
+	assert(rc == TDS_SUCCESS);
+	null_error_index = -1;
+	start_request(&req, false);
+	rc = tds_bcp_send_rows(tds, bcpinfo, 0, NUM_ROWS, null_error, &sent);
+	assert(TDS_FAILED(rc) && sent == 0 && null_error_index == 0);
+	end_request(&req);
+
+	free_bcpinfo(bcpinfo);
+}
+
+static void
+benchmark(int num_rows)
+{
+	struct timeval start, end;
+	double elapsed;
+	TDSBCPINFO *bcpinfo;
+	REQUEST req;
+	int i, n, sent;
+
+	free_arrays();
+	alloc_arrays(num_rows);
+
+	tds->conn->tds_version = 0x704;
+	bcpinfo = create_bcpinfo();
+	bind_arrays(bcpinfo);
+
+	for (i = 0; i < 2; ++i) {
+		gettimeofday(&start, NULL);
+		start_request(&req, false);
+		if (i) {
+			assert(tds_bcp_send_rows(tds, bcpinfo, 0, num_rows, null_error, &sent) == TDS_SUCCESS);
+		} else {
+			for (n = 0; n < num_rows; ++n)
+				assert(tds_bcp_send_record(tds, bcpinfo, ref_get_col_data, null_error, n) == TDS_SUCCESS);
+		}
+		end_request(&req);
+		gettimeofday(&end, NULL);
+		elapsed = (end.tv_sec - start.tv_sec) + (end.tv_usec - start.tv_usec) * 0.000001;
+		if (elapsed > 0)
+			printf("%9.0f rows/second %s, %.1f MB sent\n", num_rows / elapsed,
+			       i ? "from arrays" : "one at a time", req.len / 1e6);
+	}
+
+	free_bcpinfo(bcpinfo);
+}
+
+TEST_MAIN()
+{
+	TDSCONTEXT *ctx;
+	TDS_SYS_SOCKET sockets[2];
+
+	setbuf(stdout, NULL);
+	setbuf(stderr, NULL);
+
+	ctx = tds_alloc_context(NULL);
+	assert(ctx);
+	tds = tds_alloc_socket(ctx, 512);
+	assert(tds);
+	tds->conn->tds_version = 0x704;
+	tds_iconv_open(tds->conn, "ISO-8859-1", 0);
+
+	/* requests are read back from the other end of the pair */
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) < 0) {
+		perror("socketpair");
+		exit(1);
+	}
+	tds_socket_set_nosigpipe(sockets[0], 1);
+	tds->state = TDS_IDLE;
+	tds_set_s(tds, sockets[0]);
+	server_socket = sockets[1];
+
+	alloc_arrays(NUM_ROWS);
+
+	test_version(0x704);
+	test_version(0x500);
+
+	if (argc > 1)
+		benchmark(atoi(argv[1]));
+
+	free_arrays();
+	tds_free_socket(tds);
+	tds_free_context(ctx);
+	CLOSESOCKET(server_socket);
+	return 0;
+}
@@ -139,3 +139,15 @@ run_query(TDSSOCKET * tds, const char *query)
 
 	return TDS_SUCCESS;
 }
+
+/* xorshift64, reproducible sequence for randomized tests */
+uint64_t
+next_rand(void)
+{
+	static uint64_t seed = UINT64_C(0x9e3779b97f4a7c15);
+
+	seed ^= seed << 13;
+	seed ^= seed >> 7;
+	seed ^= seed << 17;
+	return seed;
+}
@@ -36,4 +36,6 @@ char *to_utf8(const char *src, char *dest);
 typedef void tds_any_type_t(TDSSOCKET *tds, TDSCOLUMN *col);
 void tds_all_types(TDSSOCKET *tds, tds_any_type_t *func);
 
+uint64_t next_rand(void);
+
 #endif
@@ -0,0 +1,228 @@
+/* FreeTDS - Library of routines accessing Sybase and Microsoft databases
+ * Copyright (C) 2026  Frediano Ziglio
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Purpose: test string to date/time conversions.
+ * ISO 8601 strings are parsed by a specialized parser, check results
+ * are the same as the generic one.
+ * The generic parser is forced adding a comma in front of the string,
+ * the comma is ignored by it but not accepted by the ISO one.
+ * To test performance, call this program with an iteration count.
+ */
+#include "common.h"
+#include <assert.h>
+#include <freetds/convert.h>
+
+#include <freetds/time.h>
+
+static TDSCONTEXT *ctx;
+static unsigned int num_checks = 0;
+
+static const int date_types[] = {
+	SYBDATETIME, SYBDATETIME4, SYBDATE, SYBTIME, SYBMSDATE, SYBMSTIME,
+	SYBMSDATETIME2, SYB5BIGDATETIME, SYB5BIGTIME
+};
+
+static TDS_INT
+convert(const char *s, int desttype, CONV_RESULT *cr)
+{
+	memset(cr, 0, sizeof(*cr));
+	return tds_convert(ctx, SYBVARCHAR, s, (TDS_UINT) strlen(s), desttype, cr);
+}
+
+/* compare conversion of fast string with the generic one */
+static void
+compare(const char *fast, const char *generic)
+{
+	unsigned int i;
+
+	for (i = 0; i < TDS_VECTOR_SIZE(date_types); ++i) {
+		CONV_RESULT cr1, cr2;
+		TDS_INT res1, res2;
+
+		res1 = convert(fast, date_types[i], &cr1);
+		res2 = convert(generic, date_types[i], &cr2);
+		if (res1 != res2 || (res1 > 0 && memcmp(&cr1, &cr2, res1) != 0)) {
+			fprintf(stderr, "Different result converting '%s' and '%s' to %s (%d %d)\n",
+				fast, generic, tds_prtype(date_types[i]), res1, res2);
+			exit(1);
+		}
+		++num_checks;
+	}
+}
+
+static void
+check(const char *s)
+{
+	char generic[128];
+
+	sprintf(generic, ",%s", s);
+	compare(s, generic);
+}
+
+static void
+test_dates(void)
+{
+	int year, mon, mday;
+	char buf[64];
+
+	/* all days of some years, some days of all years */
+	for (year = 1753; year <= 9999; ++year) {
+		bool all = year < 1810 || (year >= 1990 && year < 2040) || year > 9990;
+
+		for (mon = 1; mon <= 12; ++mon) {
+			for (mday = 1; mday <= 31; ++mday) {
+				if (!all && mday != 1 && mday < 28)
+					continue;
+				sprintf(buf, "%04d-%02d-%02d", year, mon, mday);
+				check(buf);
+			}
+		}
+	}
+
+	/* values out of range */
+	for (mon = 0; mon < 100; ++mon)
+		for (mday = 0; mday < 100; ++mday) {
+			sprintf(buf, "2020-%02d-%02d", mon, mday);
+			check(buf);
+		}
+	for (year = 0; year < 1800; ++year) {
+		sprintf(buf, "%04d-05-17", year);
+		check(buf);
+	}
+}
+
+static void
+test_times(void)
+{
+	int hour, min, sec;
+	char buf[64];
+
+	for (hour = 0; hour < 100; ++hour)
+		for (min = 0; min < 100; ++min) {
+			sprintf(buf, "%02d:%02d", hour, min);
+			check(buf);
+			sprintf(buf, "2020-02-29 %02d:%02d:%02d", hour, min, (hour * 7 + min) % 100);
+			check(buf);
+		}
+	for (sec = 0; sec < 100; ++sec) {
+		sprintf(buf, "13:14:%02d.%03d", sec, sec * 7);
+		check(buf);
+	}
+}
+
+static void
+test_fractions(void)
+{
+	static const char *const fractions[] = {
+		"", ".", ".0", ".5", ".05", ".123", ".1234", ".999", ".9999999", ".1234567",
+		".12345678", ".123456789", ".1234567891", ".99999999999999", ".000000001",
+		".0000000001", NULL
+	};
+	int i;
+	char buf[64], generic[64];
+
+	for (i = 0; fractions[i]; ++i) {
+		sprintf(buf, "2015-09-12 21:48:12%s", fractions[i]);
+		check(buf);
+		sprintf(buf, "21:48:59%s", fractions[i]);
+		check(buf);
+
+		/* T separator is not supported by generic parser, compare with space */
+		sprintf(buf, "2015-09-12T21:48:12%s", fractions[i]);
+		sprintf(generic, ",2015-09-12 21:48:12%s", fractions[i]);
+		compare(buf, generic);
+	}
+}
+
+static void
+test_mutations(void)
+{
+	static const char alphabet[] = "0123456789-:. ,aZ";
+	static const char *const bases[] = {
+		"2015-09-12 21:48:12.638161", "1999-12-31 23:59:59", "  2000-01-01  ",
+		"2001-02-03", "10:11:12.5", "12:00", NULL
+	};
+	int i, n;
+	char buf[64];
+
+	for (i = 0; bases[i]; ++i) {
+		for (n = 0; n < 10000; ++n) {
+			size_t len = strlen(bases[i]);
+			uint64_t r = next_rand();
+
+			strcpy(buf, bases[i]);
+			buf[r % len] = alphabet[(r >> 8) % (sizeof(alphabet) - 1)];
+			if (r & 0x10000)
+				buf[(r >> 20) % len] = alphabet[(r >> 28) % (sizeof(alphabet) - 1)];
+			if (r & 0x20000)
+				buf[(r >> 36) % len] = 0;
+			check(buf);
+		}
+	}
+}
+
+static void
+benchmark(int iterations)
+{
+	static const char *const values[] = {
+		"2015-09-12 21:48:12.638161", "1999-12-31 23:59:59", "2001-02-03", "2020-02-29 00:00:00.000"
+	};
+	struct timeval start, end;
+	double elapsed;
+	unsigned int i, generic;
+	int j;
+	CONV_RESULT cr;
+	char buf[64];
+
+	for (generic = 0; generic < 2; ++generic) {
+		gettimeofday(&start, NULL);
+		for (j = 0; j < iterations; ++j)
+			for (i = 0; i < TDS_VECTOR_SIZE(values); ++i) {
+				sprintf(buf, "%s%s", generic ? "," : "", values[i]);
+				convert(buf, SYBMSDATETIME2, &cr);
+			}
+		gettimeofday(&end, NULL);
+		elapsed = (end.tv_sec - start.tv_sec) + (end.tv_usec - start.tv_usec) * 0.000001;
+		if (elapsed > 0)
+			printf("%9.0f conversions/second converting dates (%s parser)\n",
+			       iterations * TDS_VECTOR_SIZE(values) / elapsed, generic ? "generic" : "ISO");
+	}
+}
+
+TEST_MAIN()
+{
+	setbuf(stdout, NULL);
+	setbuf(stderr, NULL);
+
+	ctx = tds_alloc_context(NULL);
+	assert(ctx);
+
+	test_dates();
+	test_times();
+	test_fractions();
+	test_mutations();
+	printf("%u conversions checked\n", num_checks);
+
+	if (argc > 1)
+		benchmark(atoi(argv[1]));
+
+	tds_free_context(ctx);
+	return 0;
+}
@@ -0,0 +1,265 @@
+/* FreeTDS - Library of routines accessing Sybase and Microsoft databases
+ * Copyright (C) 2026  Frediano Ziglio
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Purpose: test formatting of integers and floating points to strings.
+ * Result must match what the C library produces with sprintf.
+ * To test performance, call this program with an iteration count.
+ */
+#include "common.h"
+#include <assert.h>
+#include <freetds/convert.h>
+
+#include <freetds/time.h>
+
+static TDSCONTEXT *ctx;
+static unsigned int num_checks = 0;
+
+static void
+check(int srctype, const void *src, TDS_UINT srclen, const char *expected)
+{
+	CONV_RESULT cr;
+	TDS_INT res;
+	char buf[64];
+
+	res = tds_convert(ctx, srctype, src, srclen, SYBVARCHAR, &cr);
+	if (res < 0) {
+		fprintf(stderr, "Error converting %s (%s)\n", tds_prtype(srctype), expected);
+		exit(1);
+	}
+	if (strcmp(cr.c, expected) != 0 || res != (TDS_INT) strlen(expected)) {
+		fprintf(stderr, "Wrong conversion from %s, got '%s' expected '%s'\n",
+			tds_prtype(srctype), cr.c, expected);
+		exit(1);
+	}
+	free(cr.c);
+
+	/* fixed size output must give same result */
+	memset(buf, 'x', sizeof(buf));
+	cr.cc.c = buf;
+	cr.cc.len = sizeof(buf);
+	res = tds_convert(ctx, srctype, src, srclen, TDS_CONVERT_CHAR, &cr);
+	assert(res == (TDS_INT) strlen(expected));
+	assert(memcmp(buf, expected, res) == 0);
+	++num_checks;
+}
+
+static void
+check_int8(TDS_INT8 n)
+{
+	char expected[64];
+
+	sprintf(expected, "%" PRId64, n);
+	check(SYBINT8, &n, sizeof(n), expected);
+	if (n >= -2147483647 - 1 && n <= 2147483647) {
+		TDS_INT i = (TDS_INT) n;
+
+		check(SYBINT4, &i, sizeof(i), expected);
+	}
+}
+
+static void
+check_uint8(TDS_UINT8 n)
+{
+	char expected[64];
+
+	sprintf(expected, "%" PRIu64, n);
+	check(SYBUINT8, &n, sizeof(n), expected);
+}
+
+static void
+check_flt8(double d)
+{
+	char expected[64];
+
+	sprintf(expected, "%.17g", d);
+	check(SYBFLT8, &d, sizeof(d), expected);
+}
+
+static void
+check_real(float f)
+{
+	char expected[64];
+
+	sprintf(expected, "%.9g", f);
+	check(SYBREAL, &f, sizeof(f), expected);
+}
+
+static double
+bits_to_double(uint64_t bits)
+{
+	double d;
+
+	memcpy(&d, &bits, sizeof(d));
+	return d;
+}
+
+static uint64_t
+double_to_bits(double d)
+{
+	uint64_t bits;
+
+	memcpy(&bits, &d, sizeof(bits));
+	return bits;
+}
+
+static float
+bits_to_float(uint32_t bits)
+{
+	float f;
+
+	memcpy(&f, &bits, sizeof(f));
+	return f;
+}
+
+static void
+test_ints(void)
+{
+	static const TDS_INT8 values[] = {
+		0, 1, -1, 9, 10, 99, 100, 101, 999, 1000, 32767, -32768, 65535,
+		2147483647, -2147483647, INT64_C(2147483648), INT64_C(4294967295),
+		INT64_C(4294967296), INT64_C(99999999999), INT64_C(100000000000),
+		INT64_C(9223372036854775807), -INT64_C(9223372036854775807),
+		-INT64_C(9223372036854775807) - 1,
+	};
+	unsigned int i;
+	TDS_INT8 p10;
+
+	for (i = 0; i < TDS_VECTOR_SIZE(values); ++i) {
+		check_int8(values[i]);
+		check_uint8((TDS_UINT8) values[i]);
+	}
+	for (p10 = 1; p10 < INT64_C(1000000000000000000); p10 *= 10) {
+		check_int8(p10 - 1);
+		check_int8(p10);
+		check_int8(-p10);
+		check_int8(-p10 + 1);
+	}
+	for (i = 0; i < 100000; ++i) {
+		uint64_t r = next_rand();
+
+		check_int8((TDS_INT8) (r >> (r & 63)));
+		check_uint8(r >> (r & 63));
+	}
+}
+
+static void
+test_floats(void)
+{
+	static const double values[] = {
+		0.0, 1.0, 0.1, 0.5, 1.5, 2.5, 0.0001, 0.00011, 0.000099999,
+		0.00009999999999999999, 0.00999999999999999999, 3.14159, 1999.25,
+		1234.56, 9999999999999999.0, 99999999999999999.0, 1e16, 1e17, 1e18,
+		123456789012345678.0, 1e-5, 1e300, 1e-300, 5e-324, 4503599627370495.5,
+		9007199254740993.0, 0.3, 2.0 / 3.0, 123456789.0, 999999999.5,
+		1e9, 99999.5, 0.000123456789,
+	};
+	unsigned int i;
+	double d;
+
+	for (i = 0; i < TDS_VECTOR_SIZE(values); ++i) {
+		check_flt8(values[i]);
+		check_flt8(-values[i]);
+		check_real((float) values[i]);
+		check_real((float) -values[i]);
+	}
+
+	/* powers of ten and their neighbours */
+	for (d = 1e-6; d < 1e20; d *= 10) {
+		check_flt8(d);
+		check_flt8(bits_to_double(double_to_bits(d) + 1));
+		check_flt8(bits_to_double(double_to_bits(d) - 1));
+		check_real((float) d);
+	}
+
+	for (i = 0; i < 100000; ++i) {
+		uint64_t r = next_rand();
+		int digits = (int) (r % 12u);
+		uint64_t scale = 1;
+
+		/* random bit patterns */
+		d = bits_to_double(r);
+		if (d == d)
+			check_flt8(d);
+		if (bits_to_float((uint32_t) r) == bits_to_float((uint32_t) r))
+			check_real(bits_to_float((uint32_t) r));
+
+		/* random values in common ranges */
+		while (digits--)
+			scale *= 10u;
+		d = (double) (int64_t) (next_rand() % UINT64_C(100000000000000)) / (double) scale;
+		check_flt8(d);
+		check_real((float) d);
+	}
+}
+
+static void
+benchmark(int iterations)
+{
+	static const TDS_INT8 int_values[] = { 0, 7, -123, 45678, 2147483647, INT64_C(1234567890123) };
+	static const double flt_values[] = { 0.0, 1.0, 3.14159, 1999.25, -123456.789, 1e10 };
+	struct timeval start, end;
+	double elapsed;
+	unsigned int i;
+	int j;
+	CONV_RESULT cr;
+	char buf[64];
+
+	cr.cc.c = buf;
+	cr.cc.len = sizeof(buf);
+
+	gettimeofday(&start, NULL);
+	for (j = 0; j < iterations; ++j)
+		for (i = 0; i < TDS_VECTOR_SIZE(int_values); ++i)
+			tds_convert(ctx, SYBINT8, &int_values[i], sizeof(int_values[i]), TDS_CONVERT_CHAR, &cr);
+	gettimeofday(&end, NULL);
+	elapsed = (end.tv_sec - start.tv_sec) + (end.tv_usec - start.tv_usec) * 0.000001;
+	if (elapsed > 0)
+		printf("%9.0f conversions/second converting integers\n",
+		       iterations * TDS_VECTOR_SIZE(int_values) / elapsed);
+
+	gettimeofday(&start, NULL);
+	for (j = 0; j < iterations; ++j)
+		for (i = 0; i < TDS_VECTOR_SIZE(flt_values); ++i)
+			tds_convert(ctx, SYBFLT8, &flt_values[i], sizeof(flt_values[i]), TDS_CONVERT_CHAR, &cr);
+	gettimeofday(&end, NULL);
+	elapsed = (end.tv_sec - start.tv_sec) + (end.tv_usec - start.tv_usec) * 0.000001;
+	if (elapsed > 0)
+		printf("%9.0f conversions/second converting floats\n",
+		       iterations * TDS_VECTOR_SIZE(flt_values) / elapsed);
+}
+
+TEST_MAIN()
+{
+	setbuf(stdout, NULL);
+	setbuf(stderr, NULL);
+
+	ctx = tds_alloc_context(NULL);
+	assert(ctx);
+
+	test_ints();
+	test_floats();
+	printf("%u conversions checked\n", num_checks);
+
+	if (argc > 1)
+		benchmark(atoi(argv[1]));
+
+	tds_free_context(ctx);
+	return 0;
+}
@@ -0,0 +1,317 @@
+/* FreeTDS - Library of routines accessing Sybase and Microsoft databases
+ * Copyright (C) 2026  Frediano Ziglio
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Purpose: test parsing of strings to integers, numerics and floating points.
+ * To test performance, call this program with an iteration count.
+ */
+#include "common.h"
+#include <assert.h>
+#include <errno.h>
+#include <freetds/convert.h>
+
+#include <freetds/time.h>
+
+static TDSCONTEXT *ctx;
+
+static TDS_INT
+convert(const char *s, int desttype, CONV_RESULT *cr)
+{
+	return tds_convert(ctx, SYBVARCHAR, s, (TDS_UINT) strlen(s), desttype, cr);
+}
+
+/* check conversion to all integer types, expected value is in num/negative */
+static void
+check_int(const char *s, TDS_UINT8 num, bool negative, TDS_INT expected_res)
+{
+	CONV_RESULT cr;
+	TDS_INT res;
+	bool fit;
+
+	/* INT4 */
+	res = convert(s, SYBINT4, &cr);
+	fit = expected_res >= 0 && (negative ? num <= UINT64_C(2147483648) : num < UINT64_C(2147483648));
+	if (expected_res < 0 ? res != expected_res : fit != (res >= 0)) {
+		fprintf(stderr, "Wrong result %d converting '%s' to INT4\n", res, s);
+		exit(1);
+	}
+	if (res >= 0 && (TDS_UINT) cr.i != (negative ? 0u - (TDS_UINT) num : (TDS_UINT) num)) {
+		fprintf(stderr, "Wrong value %d converting '%s' to INT4\n", cr.i, s);
+		exit(1);
+	}
+
+	/* INT8 */
+	res = convert(s, SYBINT8, &cr);
+	fit = expected_res >= 0 && (negative ? num <= (UINT64_C(1) << 63) : num < (UINT64_C(1) << 63));
+	if (expected_res < 0 ? res != expected_res : fit != (res >= 0)) {
+		fprintf(stderr, "Wrong result %d converting '%s' to INT8\n", res, s);
+		exit(1);
+	}
+	if (res >= 0 && (TDS_UINT8) cr.bi != (negative ? 0u - num : num)) {
+		fprintf(stderr, "Wrong value converting '%s' to INT8\n", s);
+		exit(1);
+	}
+
+	/* UINT8 */
+	res = convert(s, SYBUINT8, &cr);
+	fit = expected_res >= 0 && (!negative || num == 0);
+	if (expected_res < 0 ? res != expected_res : fit != (res >= 0)) {
+		fprintf(stderr, "Wrong result %d converting '%s' to UINT8\n", res, s);
+		exit(1);
+	}
+	if (res >= 0 && cr.ubi != num) {
+		fprintf(stderr, "Wrong value converting '%s' to UINT8\n", s);
+		exit(1);
+	}
+}
+
+static void
+test_ints(void)
+{
+	static const struct {
+		const char *s;
+		TDS_INT res;
+	} errors[] = {
+		{ "-", TDS_CONVERT_SYNTAX },
+		{ "12a", TDS_CONVERT_SYNTAX },
+		{ "1 2", TDS_CONVERT_SYNTAX },
+		{ "1..2", TDS_CONVERT_SYNTAX },
+		{ "--1", TDS_CONVERT_SYNTAX },
+		{ "0x12", TDS_CONVERT_SYNTAX },
+		{ "123456789012345678:", TDS_CONVERT_SYNTAX },
+		{ "1234567/", TDS_CONVERT_SYNTAX },
+		{ "123456789012345678901", TDS_CONVERT_OVERFLOW },
+		{ "18446744073709551616", TDS_CONVERT_OVERFLOW },
+		{ "99999999999999999999", TDS_CONVERT_OVERFLOW },
+		{ NULL, 0 }
+	};
+	int i;
+	char buf[64];
+
+	for (i = 0; errors[i].s; ++i)
+		check_int(errors[i].s, 0, false, errors[i].res);
+
+	check_int("", 0, false, 0);
+	check_int("  -  12  ", 12, true, 0);
+	check_int("000000000000000000000000000000000012.999", 12, false, 0);
+	check_int("2147483647", 2147483647u, false, 0);
+	check_int("-2147483648", 2147483648u, true, 0);
+	check_int("2147483648", 2147483648u, false, 0);
+	check_int("18446744073709551615", UINT64_C(18446744073709551615), false, 0);
+	check_int("9223372036854775808", UINT64_C(9223372036854775808), false, 0);
+	check_int("-9223372036854775808", UINT64_C(9223372036854775808), true, 0);
+	check_int("-0", 0, true, 0);
+
+	for (i = 0; i < 200000; ++i) {
+		uint64_t r = next_rand();
+		TDS_UINT8 num = r >> (next_rand() & 63);
+		bool negative = (r & 1) != 0;
+
+		sprintf(buf, "%s%s%" PRIu64 "%s", negative ? "-" : "", (r & 2) ? "000" : "", num, (r & 4) ? ".5 " : "");
+		check_int(buf, num, negative, 0);
+	}
+}
+
+static void
+check_float(const char *s)
+{
+	CONV_RESULT cr;
+	TDS_INT res;
+	char *end;
+	double expected;
+
+	errno = 0;
+	expected = strtod(s, &end);
+	res = convert(s, SYBFLT8, &cr);
+	if (*end || errno == ERANGE) {
+		if (res >= 0) {
+			fprintf(stderr, "Converting '%s' to FLT8 should fail\n", s);
+			exit(1);
+		}
+		return;
+	}
+	/* compare bits, NaN is not equal to itself */
+	if (res < 0 || memcmp(&cr.f, &expected, sizeof(expected)) != 0) {
+		fprintf(stderr, "Wrong result converting '%s' to FLT8\n", s);
+		exit(1);
+	}
+	res = convert(s, SYBREAL, &cr);
+	if (res < 0 || (cr.r != (TDS_REAL) expected && expected == expected)) {
+		fprintf(stderr, "Wrong result converting '%s' to REAL\n", s);
+		exit(1);
+	}
+}
+
+static void
+test_floats(void)
+{
+	static const char *const values[] = {
+		"0", "-0", "1", "-1", "1.5", ".5", "5.", "1e5", "1E-5", "1e+22", "1e23",
+		"9007199254740993", "9007199254740992", "123456789012345678901234567890",
+		"0.000000000000000000000000000001", "1e400", "1e-400", "4.9e-324",
+		"inf", "nan", "0x10", "1e", "e5", ".", "-", "+", "1.2.3", "12a", "1e5.5",
+		"3.14159265358979323846", "1999.25", "0.1", "-1234.5678e-3", "00000000001.5",
+		NULL
+	};
+	int i;
+	char buf[64];
+
+	for (i = 0; values[i]; ++i)
+		check_float(values[i]);
+
+	for (i = 0; i < 200000; ++i) {
+		uint64_t r = next_rand();
+		int exp = (int) (next_rand() % 61u) - 30;
+		unsigned int point = (unsigned int) (next_rand() % 20u);
+		char digits[32];
+		size_t len;
+
+		sprintf(digits, "%" PRIu64, r >> (next_rand() & 63));
+		len = strlen(digits);
+		if (point > len)
+			point = (unsigned int) len;
+		sprintf(buf, "%s%.*s.%s", (r & 1) ? "-" : "", (int) point, digits, digits + point);
+		if (r & 2)
+			sprintf(strchr(buf, 0), "e%d", exp);
+		check_float(buf);
+	}
+}
+
+static void
+check_numeric(const char *s, int prec, int scale, const char *expected)
+{
+	CONV_RESULT cr, out;
+	TDS_INT res;
+
+	cr.n.precision = prec;
+	cr.n.scale = scale;
+	res = convert(s, SYBNUMERIC, &cr);
+	if (!expected) {
+		if (res >= 0) {
+			fprintf(stderr, "Converting '%s' to NUMERIC(%d,%d) should fail\n", s, prec, scale);
+			exit(1);
+		}
+		return;
+	}
+	if (res < 0) {
+		fprintf(stderr, "Failed converting '%s' to NUMERIC(%d,%d)\n", s, prec, scale);
+		exit(1);
+	}
+	res = tds_convert(ctx, SYBNUMERIC, &cr.n, sizeof(cr.n), SYBVARCHAR, &out);
+	assert(res >= 0);
+	if (strcmp(out.c, expected) != 0) {
+		fprintf(stderr, "Wrong result converting '%s' to NUMERIC(%d,%d): got '%s' expected '%s'\n",
+			s, prec, scale, out.c, expected);
+		exit(1);
+	}
+	free(out.c);
+}
+
+static void
+test_numerics(void)
+{
+	int i;
+	char buf[64], expected[64];
+
+	check_numeric("123.456", 10, 2, "123.45");
+	check_numeric("-123.456", 10, 4, "-123.4560");
+	check_numeric("1234567890123456789", 19, 0, "1234567890123456789");
+	check_numeric("12345678901234567890", 20, 0, "12345678901234567890");
+	check_numeric("99999999999999999999999999999999999999", 38, 0, "99999999999999999999999999999999999999");
+	check_numeric("9999999999999999999999999999999999999.9", 38, 1, "9999999999999999999999999999999999999.9");
+	check_numeric("100", 2, 0, NULL);
+	check_numeric("1a", 10, 0, NULL);
+
+	for (i = 0; i < 100000; ++i) {
+		int prec = (int) (next_rand() % 38u) + 1;
+		int scale = (int) (next_rand() % (unsigned) (prec + 1));
+		int int_digits = prec - scale, n;
+		char *p = buf, *e = expected;
+
+		if (next_rand() & 1) {
+			*p++ = '-';
+			*e++ = '-';
+		}
+		n = int_digits ? (int) (next_rand() % (unsigned) int_digits) + 1 : 0;
+		/* first digit must not be zero */
+		if (n) {
+			*p++ = *e++ = (char) ('1' + next_rand() % 9u);
+			--n;
+		} else {
+			*e++ = '0';
+		}
+		while (n--)
+			*p++ = *e++ = (char) ('0' + next_rand() % 10u);
+		if (scale) {
+			*p++ = *e++ = '.';
+			for (n = 0; n < scale; ++n)
+				*p++ = *e++ = (char) ('0' + next_rand() % 10u);
+		}
+		*p = *e = 0;
+		check_numeric(buf, prec, scale, expected);
+	}
+}
+
+static void
+benchmark(int iterations)
+{
+	static const char *const values[] = {
+		"0", "7", "-123", "45678", "2147483647", "1234567890123", "  1999.25  ", "-123456.789"
+	};
+	static const int types[] = { SYBINT4, SYBINT8, SYBFLT8, SYBNUMERIC };
+	struct timeval start, end;
+	double elapsed;
+	unsigned int i, t;
+	int j;
+	CONV_RESULT cr;
+
+	for (t = 0; t < TDS_VECTOR_SIZE(types); ++t) {
+		gettimeofday(&start, NULL);
+		for (j = 0; j < iterations; ++j)
+			for (i = 0; i < TDS_VECTOR_SIZE(values); ++i) {
+				cr.n.precision = 20;
+				cr.n.scale = 2;
+				convert(values[i], types[t], &cr);
+			}
+		gettimeofday(&end, NULL);
+		elapsed = (end.tv_sec - start.tv_sec) + (end.tv_usec - start.tv_usec) * 0.000001;
+		if (elapsed > 0)
+			printf("%9.0f conversions/second converting to %s\n",
+			       iterations * TDS_VECTOR_SIZE(values) / elapsed, tds_prtype(types[t]));
+	}
+}
+
+TEST_MAIN()
+{
+	setbuf(stdout, NULL);
+	setbuf(stderr, NULL);
+
+	ctx = tds_alloc_context(NULL);
+	assert(ctx);
+
+	test_ints();
+	test_floats();
+	test_numerics();
+
+	if (argc > 1)
+		benchmark(atoi(argv[1]));
+
+	tds_free_context(ctx);
+	return 0;
+}
@@ -0,0 +1,273 @@
+/* FreeTDS - Library of routines accessing Sybase and Microsoft databases
+ * Copyright (C) 2026  Frediano Ziglio
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Purpose: test tds_convert_resolve and tds_convert_batch.
+ * Resolved converters must give the same results as tds_convert.
+ * To test performance, call this program with an iteration count.
+ */
+#include "common.h"
+#include <assert.h>
+#include <freetds/convert.h>
+
+#include <freetds/time.h>
+
+static TDSCONTEXT *ctx;
+
+static const int types[] = {
+	SYBINT1, SYBSINT1, SYBINT2, SYBUINT2, SYBINT4, SYBUINT4, SYBINT8, SYBUINT8,
+	SYBREAL, SYBFLT8, SYBBIT, SYBMONEY4, SYBMONEY, SYBNUMERIC,
+	SYBDATETIME, SYBDATETIME4, SYBDATE, SYBTIME, SYBUNIQUE, SYBVARCHAR, SYBBINARY,
+};
+
+static const char *const strings[] = {
+	"0", "1", "-1", "123", "12345678", "1.5", "-32768", "2020-01-01 12:34:56",
+	"0x1234", "abc", "", "1e10", "4294967296", "00000000-0000-0000-0000-000000000000",
+};
+
+/* compare results of conversions, free allocated results */
+static void
+compare(int srctype, int desttype, TDS_INT res1, CONV_RESULT *cr1, TDS_INT res2, CONV_RESULT *cr2)
+{
+	bool allocated = res1 >= 0 && (is_char_type(desttype) || is_binary_type(desttype));
+
+	if (res1 != res2
+	    || (res1 > 0 && memcmp(allocated ? cr1->c : (char *) cr1, allocated ? cr2->c : (char *) cr2, res1) != 0)) {
+		fprintf(stderr, "Different result converting %s to %s (%d %d)\n",
+			tds_prtype(srctype), tds_prtype(desttype), res1, res2);
+		exit(1);
+	}
+	if (allocated) {
+		free(cr1->c);
+		free(cr2->c);
+	}
+}
+
+static void
+test_resolve(void)
+{
+	unsigned int s, d, n;
+
+	for (s = 0; s < TDS_VECTOR_SIZE(types); ++s) {
+		for (d = 0; d < TDS_VECTOR_SIZE(types); ++d) {
+			TDS_CONVERTER conv;
+			TDS_CONVERT_FUNC func;
+			int srctype = types[s], desttype = types[d];
+
+			func = tds_convert_resolve(&conv, srctype, desttype);
+			assert(func == conv.convert && conv.srctype == srctype && conv.desttype == desttype);
+
+			for (n = 0; n < 2000; ++n) {
+				CONV_RESULT cr1, cr2;
+				TDS_INT res1, res2;
+				union {
+					uint64_t u[4];
+					TDS_NUMERIC num;
+				} src;
+				const void *psrc = &src;
+				TDS_UINT srclen = tds_get_size_by_type(srctype);
+
+				src.u[0] = next_rand();
+				src.u[1] = next_rand();
+				src.u[2] = next_rand();
+				src.u[3] = next_rand();
+				/* use some small values */
+				if (n & 1)
+					src.u[0] &= 0xff;
+				if (srctype == SYBNUMERIC) {
+					src.num.precision = (unsigned char) (next_rand() % 38u + 1u);
+					src.num.scale = (unsigned char) (next_rand() % (src.num.precision + 1u));
+					src.num.array[0] &= 1;
+					memset(src.num.array + 1, 0, 8);
+					srclen = sizeof(TDS_NUMERIC);
+				} else if (srctype == SYBVARCHAR) {
+					psrc = strings[n % TDS_VECTOR_SIZE(strings)];
+					srclen = (TDS_UINT) strlen((const char *) psrc);
+				} else if (srctype == SYBBINARY) {
+					srclen = n % 9u;
+				} else if (srctype == SYBFLT8) {
+					/* keep in range, huge values are not handled converting to numeric */
+					TDS_FLOAT f = (int64_t) src.u[1] / 1000.0;
+
+					memcpy(&src, &f, sizeof(f));
+				} else if (srctype == SYBREAL) {
+					TDS_REAL r = (TDS_REAL) ((int32_t) src.u[1] / 1000.0);
+
+					memcpy(&src, &r, sizeof(r));
+				}
+
+				memset(&cr1, 0, sizeof(cr1));
+				memset(&cr2, 0, sizeof(cr2));
+				cr1.n.precision = cr2.n.precision = 20;
+				cr1.n.scale = cr2.n.scale = 4;
+				res1 = tds_convert(ctx, srctype, psrc, srclen, desttype, &cr1);
+				res2 = conv.convert(ctx, &conv, psrc, srclen, &cr2);
+				compare(srctype, desttype, res1, &cr1, res2, &cr2);
+			}
+		}
+	}
+}
+
+static void
+test_batch(void)
+{
+	static const TDS_SMALLINT shorts[] = { 0, 1, -1, 32767, -32768 };
+	static const char strs[4][12] = { "12", " -34 ", "abc", "2147483648" };
+	static const TDS_UINT strlens[] = { 2, 5, 3, 10 };
+	TDS_CONVERTER conv;
+	TDS_INT ints[TDS_VECTOR_SIZE(shorts)];
+	TDS_INT lengths[TDS_VECTOR_SIZE(shorts)];
+	char chars[TDS_VECTOR_SIZE(shorts)][8];
+	TDS_NUMERIC nums[2];
+	unsigned int i;
+	char out[64];
+
+	/* fixed to fixed */
+	tds_convert_resolve(&conv, SYBINT2, SYBINT4);
+	assert(tds_convert_batch(ctx, &conv, TDS_VECTOR_SIZE(shorts), shorts, sizeof(shorts[0]), NULL,
+				 ints, sizeof(ints[0]), lengths) == 0);
+	for (i = 0; i < TDS_VECTOR_SIZE(shorts); ++i)
+		assert(ints[i] == shorts[i] && lengths[i] == sizeof(TDS_INT));
+
+	/* strings with lengths, errors reported */
+	tds_convert_resolve(&conv, SYBVARCHAR, SYBINT4);
+	assert(tds_convert_batch(ctx, &conv, 4, strs, sizeof(strs[0]), strlens,
+				 ints, sizeof(ints[0]), lengths) == TDS_CONVERT_SYNTAX);
+	assert(ints[0] == 12 && lengths[0] == sizeof(TDS_INT));
+	assert(ints[1] == -34 && lengths[1] == sizeof(TDS_INT));
+	assert(lengths[2] == TDS_CONVERT_SYNTAX);
+	assert(lengths[3] == TDS_CONVERT_OVERFLOW);
+
+	/* fixed buffers */
+	tds_convert_resolve(&conv, SYBINT2, TDS_CONVERT_CHAR);
+	memset(chars, 'x', sizeof(chars));
+	assert(tds_convert_batch(ctx, &conv, TDS_VECTOR_SIZE(shorts), shorts, sizeof(shorts[0]), NULL,
+				 chars, sizeof(chars[0]), lengths) == 0);
+	for (i = 0; i < TDS_VECTOR_SIZE(shorts); ++i) {
+		sprintf(out, "%d", shorts[i]);
+		assert(lengths[i] == (TDS_INT) strlen(out) && memcmp(chars[i], out, lengths[i]) == 0);
+	}
+
+	/* destination too small */
+	tds_convert_resolve(&conv, SYBINT2, SYBINT8);
+	assert(tds_convert_batch(ctx, &conv, 1, shorts, sizeof(shorts[0]), NULL,
+				 ints, sizeof(ints[0]), lengths) == TDS_CONVERT_OVERFLOW);
+
+	/* numeric use precision from converter */
+	tds_convert_resolve(&conv, SYBINT2, SYBNUMERIC);
+	conv.precision = 10;
+	conv.scale = 2;
+	assert(tds_convert_batch(ctx, &conv, 2, shorts + 3, sizeof(shorts[0]), NULL,
+				 nums, sizeof(nums[0]), NULL) == 0);
+	tds_numeric_to_string(&nums[0], out);
+	assert(strcmp(out, "32767.00") == 0);
+	tds_numeric_to_string(&nums[1], out);
+	assert(strcmp(out, "-32768.00") == 0);
+
+	/* allocated results are not supported */
+	tds_convert_resolve(&conv, SYBINT2, SYBVARCHAR);
+	assert(tds_convert_batch(ctx, &conv, 1, shorts, sizeof(shorts[0]), NULL,
+				 chars, sizeof(chars[0]), lengths) == TDS_CONVERT_NOAVAIL);
+	assert(lengths[0] == TDS_CONVERT_NOAVAIL);
+}
+
+static const char *
+type_name(int type)
+{
+	return type == TDS_CONVERT_CHAR ? "fixed char" : tds_prtype(type);
+}
+
+static void
+benchmark(int iterations)
+{
+	static const struct {
+		int srctype, desttype;
+		TDS_UINT srclen, destlen;
+	} tests[] = {
+		{ SYBINT4, SYBINT8, sizeof(TDS_INT), sizeof(TDS_INT8) },
+		{ SYBINT2, SYBFLT8, sizeof(TDS_SMALLINT), sizeof(TDS_FLOAT) },
+		{ SYBINT8, TDS_CONVERT_CHAR, sizeof(TDS_INT8), 24 },
+	};
+	enum { NUM_VALUES = 1024 };
+	uint64_t src[NUM_VALUES];
+	char dest[NUM_VALUES * 24];
+	struct timeval start, end;
+	double elapsed;
+	unsigned int i, t;
+	int j;
+
+	for (i = 0; i < NUM_VALUES; ++i)
+		src[i] = next_rand() & 0x7fff;
+
+	for (t = 0; t < TDS_VECTOR_SIZE(tests); ++t) {
+		TDS_CONVERTER conv;
+		CONV_RESULT cr;
+
+		gettimeofday(&start, NULL);
+		for (j = 0; j < iterations; ++j)
+			for (i = 0; i < NUM_VALUES; ++i) {
+				cr.cc.c = dest + i * tests[t].destlen;
+				cr.cc.len = tests[t].destlen;
+				tds_convert(ctx, tests[t].srctype, (char *) src + i * tests[t].srclen, tests[t].srclen,
+					    tests[t].desttype, &cr);
+				if (tests[t].desttype != TDS_CONVERT_CHAR)
+					memcpy(dest + i * tests[t].destlen, &cr, tests[t].destlen);
+			}
+		gettimeofday(&end, NULL);
+		elapsed = (end.tv_sec - start.tv_sec) + (end.tv_usec - start.tv_usec) * 0.000001;
+		if (elapsed > 0)
+			printf("%9.0f values/second converting %s to %s with tds_convert\n",
+			       iterations * NUM_VALUES / elapsed, type_name(tests[t].srctype),
+			       type_name(tests[t].desttype));
+
+		tds_convert_resolve(&conv, tests[t].srctype, tests[t].desttype);
+		gettimeofday(&start, NULL);
+		for (j = 0; j < iterations; ++j)
+			tds_convert_batch(ctx, &conv, NUM_VALUES, src, tests[t].srclen, NULL,
+					  dest, tests[t].destlen, NULL);
+		gettimeofday(&end, NULL);
+		elapsed = (end.tv_sec - start.tv_sec) + (end.tv_usec - start.tv_usec) * 0.000001;
+		if (elapsed > 0)
+			printf("%9.0f values/second converting %s to %s with tds_convert_batch\n",
+			       iterations * NUM_VALUES / elapsed, type_name(tests[t].srctype),
+			       type_name(tests[t].desttype));
+	}
+}
+
+TEST_MAIN()
+{
+	setbuf(stdout, NULL);
+	setbuf(stderr, NULL);
+
+	ctx = tds_alloc_context(NULL);
+	assert(ctx);
+	if (ctx->locale && !ctx->locale->datetime_fmt) {
+		/* set default in case there's no locale file */
+		ctx->locale->datetime_fmt = strdup(STD_DATETIME_FMT);
+	}
+
+	test_resolve();
+	test_batch();
+
+	if (argc > 1)
+		benchmark(atoi(argv[1]));
+
+	tds_free_context(ctx);
+	return 0;
+}
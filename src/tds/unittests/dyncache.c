@@ -0,0 +1,407 @@
+/* FreeTDS - Library of routines accessing Sybase and Microsoft databases
+ * Copyright (C) 2026  Frediano Ziglio
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Purpose: test prepared statement cache.
+ * A fake server answers prepare and unprepare requests counting them.
+ * To test performance, call this program with an iteration count.
+ */
+#include "common.h"
+#include <assert.h>
+#include <freetds/bytes.h>
+
+#if HAVE_UNISTD_H
+#undef getpid
+#include <unistd.h>
+#endif /* HAVE_UNISTD_H */
+
+#include <freetds/replacements.h>
+#include <freetds/utils.h>
+#include <freetds/time.h>
+
+#ifdef TDS_HAVE_MUTEX
+#ifdef _WIN32
+#define SHUT_WR SD_SEND
+#endif
+
+static TDSSOCKET *tds = NULL;
+static TDS_SYS_SOCKET server_socket = INVALID_SOCKET;
+
+/* counters updated by fake server */
+static unsigned int num_prepares, num_unprepares, num_unprepare_requests;
+static TDS_INT next_handle = 1000;
+
+static bool
+read_all(TDS_SYS_SOCKET s, void *buf, size_t len)
+{
+	char *p = (char *) buf;
+
+	while (len) {
+		int got = READSOCKET(s, p, len);
+		if (got <= 0)
+			return false;
+		p += got;
+		len -= got;
+	}
+	return true;
+}
+
+static void
+write_reply(TDS_SYS_SOCKET s, const unsigned char *tokens, size_t len)
+{
+	unsigned char header[8] = { TDS_REPLY, 1, 0, 0, 0, 0, 1, 0 };
+	int written;
+
+	TDS_PUT_UA2BE(header + 2, len + 8);
+	written = WRITESOCKET(s, header, 8);
+	assert(written == 8);
+	written = WRITESOCKET(s, tokens, len);
+	assert(written == (int) len);
+}
+
+static size_t
+put_doneproc(unsigned char *p, bool more)
+{
+	memset(p, 0, 13);
+	p[0] = TDS_DONEPROC_TOKEN;
+	p[1] = more ? TDS_DONE_MORE_RESULTS : 0;
+	return 13;
+}
+
+/* answer to a request, body does not contain packet headers */
+static void
+handle_request(TDS_SYS_SOCKET s, const unsigned char *body, size_t len)
+{
+	static const unsigned char unprepare[] = { 0xff, 0xff, TDS_SP_UNPREPARE, 0 };
+	unsigned char reply[4096], *p = reply;
+	unsigned int n = 0;
+	size_t i;
+
+	/* skip ALL_HEADERS */
+	assert(len >= 8);
+	i = TDS_GET_UA4LE(body);
+	assert(i + 4 <= len);
+	body += i;
+	len -= i;
+
+	if (TDS_GET_UA2LE(body) == 0xffff && TDS_GET_UA2LE(body + 2) == TDS_SP_PREPARE) {
+		++num_prepares;
+		/* return value with handle */
+		*p++ = TDS_PARAM_TOKEN;
+		TDS_PUT_UA2LE(p, 0);
+		p += 2;
+		*p++ = 0;	/* name */
+		*p++ = 1;	/* status */
+		TDS_PUT_UA4LE(p, 0);	/* user type */
+		p += 4;
+		TDS_PUT_UA2LE(p, 0);	/* flags */
+		p += 2;
+		*p++ = SYBINTN;
+		*p++ = 4;
+		*p++ = 4;
+		TDS_PUT_UA4LE(p, next_handle);
+		p += 4;
+		++next_handle;
+		p += put_doneproc(p, false);
+		write_reply(s, reply, p - reply);
+		return;
+	}
+
+	for (i = 0; i + sizeof(unprepare) <= len; ++i)
+		if (memcmp(body + i, unprepare, sizeof(unprepare)) == 0)
+			++n;
+	assert(n > 0 && n < 256);
+	num_unprepares += n;
+	++num_unprepare_requests;
+	while (n--)
+		p += put_doneproc(p, n != 0);
+	write_reply(s, reply, p - reply);
+}
+
+/* thread answering requests from main thread */
+static TDS_THREAD_PROC_DECLARE(fake_thread_proc, arg)
+{
+	TDS_SYS_SOCKET s = TDS_PTR2INT(arg);
+	unsigned char header[8], *body = NULL;
+	size_t body_len = 0;
+
+	for (;;) {
+		size_t len;
+
+		if (!read_all(s, header, 8))
+			break;
+		len = TDS_GET_UA2BE(header + 2) - 8;
+		if (!TDS_RESIZE(body, body_len + len))
+			break;
+		if (!read_all(s, body + body_len, len))
+			break;
+		body_len += len;
+		if ((header[1] & 1) == 0)
+			continue;
+		handle_request(s, body, body_len);
+		body_len = 0;
+	}
+	free(body);
+
+	/* close socket to cleanup and signal main thread */
+	CLOSESOCKET(s);
+	return TDS_THREAD_RESULT(0);
+}
+
+/* prepare a query like ODBC does, using the cache if possible */
+static TDSDYNAMIC *
+prepare(const char *query, TDSPARAMINFO *params)
+{
+	TDSDYNAMIC *dyn;
+	TDSRET rc;
+
+	dyn = tds_dynamic_cache_get(tds, query, params);
+	if (dyn)
+		return dyn;
+
+	rc = tds_submit_prepare(tds, query, NULL, &dyn, params);
+	assert(rc == TDS_SUCCESS);
+	rc = tds_process_simple_query(tds);
+	assert(rc == TDS_SUCCESS);
+	assert(dyn && dyn->num_id);
+	return dyn;
+}
+
+static void
+release(TDSDYNAMIC *dyn)
+{
+	TDSRET rc;
+
+	rc = tds_deferred_unprepare(tds->conn, dyn);
+	assert(rc == TDS_SUCCESS);
+	tds_release_dynamic(&dyn);
+}
+
+static TDSPARAMINFO *
+int_param(void)
+{
+	TDSPARAMINFO *params = tds_alloc_param_result(NULL);
+
+	assert(params);
+	tds_set_param_type(tds->conn, params->columns[0], SYBINT4);
+	return params;
+}
+
+static void
+test_cache(void)
+{
+	TDSDYNAMIC *dyn, *dyn2;
+	TDSPARAMINFO *params;
+	TDS_INT id;
+	TDSRET rc;
+
+	tds->conn->dyn_cache_size = 2;
+
+	/* released dynamic is reused */
+	dyn = prepare("SELECT 1", NULL);
+	id = dyn->num_id;
+	release(dyn);
+	assert(tds->conn->dyn_cache_count == 1);
+	dyn = prepare("SELECT 1", NULL);
+	assert(num_prepares == 1 && dyn->num_id == id);
+	assert(tds->conn->dyn_cache_count == 0);
+
+	/* dynamic in use is not shared */
+	dyn2 = prepare("SELECT 1", NULL);
+	assert(num_prepares == 2 && dyn2 != dyn);
+	release(dyn2);
+	/* no duplicates */
+	release(dyn);
+	assert(tds->conn->dyn_cache_count == 1);
+	assert(tds->conn->pending_close);
+
+	/* parameters are part of the key */
+	params = int_param();
+	dyn = prepare("SELECT 1", params);
+	assert(num_prepares == 3);
+	release(dyn);
+	assert(num_unprepares == 1);
+	dyn = prepare("SELECT 1", params);
+	assert(num_prepares == 3);
+	release(dyn);
+	tds_free_param_results(params);
+
+	/* least recently used is evicted */
+	dyn = prepare("SELECT 2", NULL);
+	release(dyn);
+	assert(tds->conn->dyn_cache_count == 2);
+	assert(num_unprepares == 1);
+	dyn = prepare("SELECT 1", NULL);
+	assert(num_prepares == 5);
+	assert(num_unprepares == 2);
+	release(dyn);
+
+	/* client ids are not cached */
+	dyn = NULL;
+	rc = tds_submit_prepare(tds, "SELECT 3", "client_id", &dyn, NULL);
+	assert(rc == TDS_SUCCESS);
+	rc = tds_process_simple_query(tds);
+	assert(rc == TDS_SUCCESS);
+	release(dyn);
+	assert(tds->conn->pending_close);
+	dyn = prepare("SELECT 4", NULL);
+	release(dyn);
+	assert(num_unprepares == 4);
+}
+
+static void
+test_batch(void)
+{
+	TDSDYNAMIC *dyns[5];
+	unsigned int n, requests, unprepares;
+	char query[64];
+
+	tds->conn->dyn_cache_size = 1;
+
+	for (n = 0; n < TDS_VECTOR_SIZE(dyns); ++n) {
+		sprintf(query, "SELECT %u", n + 100);
+		dyns[n] = prepare(query, NULL);
+	}
+	requests = num_unprepare_requests;
+	unprepares = num_unprepares;
+	/* all but one are evicted, together with the ones already cached */
+	for (n = 0; n < TDS_VECTOR_SIZE(dyns); ++n)
+		release(dyns[n]);
+	assert(tds->conn->dyn_cache_count == 1);
+
+	/* all evicted are unprepared with a single request */
+	release(prepare("SELECT 1000", NULL));
+	assert(num_unprepare_requests == requests + 1);
+	assert(num_unprepares == unprepares + 6);
+}
+
+/* many dynamics with many parameters are found in the cache */
+static void
+test_many(void)
+{
+	TDSDYNAMIC *dyns[64];
+	TDSPARAMINFO *params = NULL;
+	unsigned int n, prepares;
+	char query[64];
+
+	for (n = 0; n < 40; ++n) {
+		params = tds_alloc_param_result(params);
+		assert(params);
+		tds_set_param_type(tds->conn, params->columns[n], SYBINT4);
+	}
+	tds->conn->dyn_cache_size = TDS_VECTOR_SIZE(dyns);
+
+	for (n = 0; n < TDS_VECTOR_SIZE(dyns); ++n) {
+		sprintf(query, "SELECT %u", n + 200);
+		dyns[n] = prepare(query, params);
+	}
+	for (n = 0; n < TDS_VECTOR_SIZE(dyns); ++n)
+		release(dyns[n]);
+	assert(tds->conn->dyn_cache_count == TDS_VECTOR_SIZE(dyns));
+
+	prepares = num_prepares;
+	for (n = TDS_VECTOR_SIZE(dyns); n-- > 0; ) {
+		sprintf(query, "SELECT %u", n + 200);
+		dyns[n] = prepare(query, params);
+	}
+	assert(num_prepares == prepares);
+	assert(tds->conn->dyn_cache_count == 0);
+	for (n = 0; n < TDS_VECTOR_SIZE(dyns); ++n)
+		release(dyns[n]);
+	tds_free_param_results(params);
+}
+
+static void
+benchmark(int iterations)
+{
+	struct timeval start, end;
+	double elapsed;
+	unsigned int size;
+	int i;
+
+	for (size = 0; size < 2; ++size) {
+		tds->conn->dyn_cache_size = size * 16;
+		gettimeofday(&start, NULL);
+		for (i = 0; i < iterations; ++i)
+			release(prepare("SELECT * FROM table WHERE id = ?", NULL));
+		gettimeofday(&end, NULL);
+		elapsed = (end.tv_sec - start.tv_sec) + (end.tv_usec - start.tv_usec) * 0.000001;
+		if (elapsed > 0)
+			printf("%9.0f prepares/second (cache %s)\n", iterations / elapsed, size ? "enabled" : "disabled");
+	}
+}
+
+TEST_MAIN()
+{
+	TDSCONTEXT *ctx;
+	TDS_SYS_SOCKET sockets[2];
+	tds_thread fake_thread;
+	char sock_buf[32];
+
+	setbuf(stdout, NULL);
+	setbuf(stderr, NULL);
+
+	tdsdump_open(tds_dir_getenv(TDS_DIR("TDSDUMP")));
+
+	ctx = tds_alloc_context(NULL);
+	assert(ctx);
+	tds = tds_alloc_socket(ctx, 512);
+	assert(tds);
+	tds->conn->tds_version = 0x704;
+	tds_iconv_open(tds->conn, "ISO-8859-1", 0);
+
+	/* provide connection to a fake remove server */
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) < 0) {
+		perror("socketpair");
+		exit(1);
+	}
+	tds_socket_set_nosigpipe(sockets[0], 1);
+	tds->state = TDS_IDLE;
+	tds_set_s(tds, sockets[0]);
+
+	if (tds_thread_create(&fake_thread, fake_thread_proc, TDS_INT2PTR(sockets[1])) != 0) {
+		perror("tds_thread_create");
+		exit(1);
+	}
+	server_socket = sockets[0];
+
+	test_cache();
+	test_batch();
+	test_many();
+
+	if (argc > 1)
+		benchmark(atoi(argv[1]));
+
+	/* wait for other thread to finish cleanly */
+	shutdown(server_socket, SHUT_WR);
+	while (READSOCKET(server_socket, sock_buf, sizeof(sock_buf)) > 0)
+		continue;
+	tds_thread_join(fake_thread, NULL);
+
+	tds_free_socket(tds);
+	tds_free_context(ctx);
+	return 0;
+}
+#else	/* !TDS_HAVE_MUTEX */
+TEST_MAIN()
+{
+	printf("Not possible for this platform.\n");
+	return 0; /* TODO 77 ? */
+}
+#endif
@@ -0,0 +1,189 @@
+/* FreeTDS - Library of routines accessing Sybase and Microsoft databases
+ * Copyright (C) 2026  Frediano Ziglio
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Purpose: test connection lists of dynamics and cursors with a lot of items.
+ * Dynamics are indexed by id, check index is kept in sync with the list.
+ * To test performance, call this program with an iteration count.
+ */
+#include "common.h"
+#include <assert.h>
+
+#include <freetds/time.h>
+
+#define NUM_DYNS 10000
+#define NUM_CURSORS 1000
+
+static TDSSOCKET *tds;
+static TDSDYNAMIC *dyns[NUM_DYNS];
+static char ids[NUM_DYNS][TDS_MAX_DYNID_LEN];
+
+/* check list is consistent and contains the expected number of items */
+static void
+check_dyns(unsigned int expected)
+{
+	TDSDYNAMIC *dyn, *prev = NULL;
+	unsigned int n = 0;
+
+	for (dyn = tds->conn->dyns; dyn; prev = dyn, dyn = dyn->next) {
+		assert(dyn->prev == prev);
+		assert(tds_lookup_dynamic(tds->conn, dyn->id) == dyn);
+		++n;
+	}
+	assert(n == expected);
+	assert(tds->conn->num_dyns == expected);
+}
+
+static void
+test_dynamics(void)
+{
+	TDSDYNAMIC *dyn;
+	unsigned int i, n, removed;
+
+	/* half generated ids, half given by client */
+	for (i = 0; i < NUM_DYNS; ++i) {
+		if (i & 1) {
+			sprintf(ids[i], "stmt_%u", i);
+			dyn = tds_alloc_dynamic(tds->conn, ids[i]);
+		} else {
+			dyn = tds_alloc_dynamic(tds->conn, NULL);
+			assert(dyn);
+			strcpy(ids[i], dyn->id);
+		}
+		assert(dyn);
+		dyns[i] = dyn;
+	}
+	check_dyns(NUM_DYNS);
+
+	for (i = 0; i < NUM_DYNS; ++i) {
+		assert(tds_lookup_dynamic(tds->conn, ids[i]) == dyns[i]);
+		/* duplicate ids are refused */
+		assert(tds_alloc_dynamic(tds->conn, ids[i]) == NULL);
+	}
+	assert(tds_lookup_dynamic(tds->conn, "stmt_0") == NULL);
+	assert(tds_lookup_dynamic(tds->conn, "") == NULL);
+
+	/* remove some dynamics in random order */
+	removed = 0;
+	for (n = 0; n < NUM_DYNS / 2; ++n) {
+		i = (unsigned int) (next_rand() % NUM_DYNS);
+		if (!dyns[i])
+			continue;
+		tds_dynamic_deallocated(tds->conn, dyns[i]);
+		/* deallocate twice is harmless */
+		tds_dynamic_deallocated(tds->conn, dyns[i]);
+		tds_release_dynamic(&dyns[i]);
+		++removed;
+	}
+	check_dyns(NUM_DYNS - removed);
+
+	for (i = 0; i < NUM_DYNS; ++i)
+		assert(tds_lookup_dynamic(tds->conn, ids[i]) == dyns[i]);
+
+	/* removed ids can be used again */
+	for (i = 0; i < NUM_DYNS; ++i) {
+		if (dyns[i])
+			continue;
+		dyns[i] = tds_alloc_dynamic(tds->conn, ids[i]);
+		assert(dyns[i]);
+	}
+	check_dyns(NUM_DYNS);
+}
+
+static void
+test_cursors(void)
+{
+	TDSCURSOR *cursors[NUM_CURSORS], *cursor, *prev;
+	unsigned int i, n, num_cursors = NUM_CURSORS;
+	char name[32];
+
+	for (i = 0; i < NUM_CURSORS; ++i) {
+		sprintf(name, "cursor%u", i);
+		cursors[i] = tds_alloc_cursor(tds, name, strlen(name), "SELECT 1", 8);
+		assert(cursors[i]);
+	}
+
+	for (n = 0; n < NUM_CURSORS / 2; ++n) {
+		i = (unsigned int) (next_rand() % NUM_CURSORS);
+		if (!cursors[i])
+			continue;
+		tds_cursor_deallocated(tds->conn, cursors[i]);
+		tds_cursor_deallocated(tds->conn, cursors[i]);
+		tds_release_cursor(&cursors[i]);
+		--num_cursors;
+	}
+
+	n = 0;
+	prev = NULL;
+	for (cursor = tds->conn->cursors; cursor; prev = cursor, cursor = cursor->next) {
+		assert(cursor->prev == prev);
+		++n;
+	}
+	assert(n == num_cursors);
+
+	for (i = 0; i < NUM_CURSORS; ++i)
+		tds_release_cursor(&cursors[i]);
+}
+
+static void
+benchmark(int iterations)
+{
+	struct timeval start, end;
+	double elapsed;
+	int j;
+	unsigned int i;
+
+	gettimeofday(&start, NULL);
+	for (j = 0; j < iterations; ++j)
+		for (i = 0; i < NUM_DYNS; ++i)
+			if (tds_lookup_dynamic(tds->conn, ids[i]) != dyns[i])
+				exit(1);
+	gettimeofday(&end, NULL);
+	elapsed = (end.tv_sec - start.tv_sec) + (end.tv_usec - start.tv_usec) * 0.000001;
+	if (elapsed > 0)
+		printf("%9.0f lookups/second with %u dynamics\n", iterations * (double) NUM_DYNS / elapsed, NUM_DYNS);
+}
+
+TEST_MAIN()
+{
+	TDSCONTEXT *ctx;
+	unsigned int i;
+
+	setbuf(stdout, NULL);
+	setbuf(stderr, NULL);
+
+	ctx = tds_alloc_context(NULL);
+	assert(ctx);
+	tds = tds_alloc_socket(ctx, 512);
+	assert(tds);
+
+	test_dynamics();
+	test_cursors();
+
+	if (argc > 1)
+		benchmark(atoi(argv[1]));
+
+	for (i = 0; i < NUM_DYNS; ++i)
+		tds_release_dynamic(&dyns[i]);
+
+	/* remaining dynamics are freed with the connection */
+	tds_free_socket(tds);
+	tds_free_context(ctx);
+	return 0;
+}
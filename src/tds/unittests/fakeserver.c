@@ -0,0 +1,211 @@
+/* FreeTDS - Library of routines accessing Sybase and Microsoft databases
+ * Copyright (C) 2026  Frediano Ziglio
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Fake server for tests of client libraries.
+ * Accepts a single connection on a port chosen by the system, answers
+ * the login and the requests using callbacks provided by the test.
+ */
+#define TDS_DONT_DEFINE_DEFAULT_FUNCTIONS
+#include "common.h"
+#include "fakeserver.h"
+
+#include <assert.h>
+
+#if HAVE_UNISTD_H
+#include <unistd.h>
+#endif /* HAVE_UNISTD_H */
+
+#if HAVE_SYS_SOCKET_H
+#include <sys/socket.h>
+#endif /* HAVE_SYS_SOCKET_H */
+
+#if HAVE_NETINET_IN_H
+#include <netinet/in.h>
+#endif /* HAVE_NETINET_IN_H */
+
+#include <freetds/server.h>
+#include <freetds/replacements.h>
+
+#ifdef TDS_HAVE_MUTEX
+
+typedef struct
+{
+	TDS_SYS_SOCKET s;
+	const FAKE_SERVER *server;
+} SERVER_ARGS;
+
+/* search marker in a query encoded in UCS-2 */
+static bool
+has_marker(const unsigned char *msg, size_t msg_len, const char *marker)
+{
+	size_t len, i, marker_len = strlen(marker);
+
+	for (len = 0; len + marker_len * 2 <= msg_len; len += 2) {
+		for (i = 0; i < marker_len; ++i)
+			if (msg[len + i * 2] != (unsigned char) marker[i] || msg[len + i * 2 + 1] != 0)
+				break;
+		if (i == marker_len)
+			return true;
+	}
+	return false;
+}
+
+static void
+handle_requests(TDSSOCKET *tds, const FAKE_SERVER *server)
+{
+	unsigned char *msg = NULL;
+	size_t msg_len = 0, msg_size = 0;
+
+	while (tds_read_packet(tds) > 0) {
+		unsigned char type = tds->in_flag;
+		size_t len;
+
+		/* read full message */
+		msg_len = 0;
+		for (;;) {
+			len = tds->in_len - tds->in_pos;
+			if (msg_len + len > msg_size) {
+				msg_size = (msg_len + len) * 2;
+				msg = (unsigned char *) realloc(msg, msg_size);
+				assert(msg);
+			}
+			memcpy(msg + msg_len, tds->in_buf + tds->in_pos, len);
+			msg_len += len;
+			/* last packet */
+			if (tds->in_buf[1] & 1)
+				break;
+			assert(tds_read_packet(tds) > 0);
+		}
+
+		tds->out_flag = TDS_REPLY;
+		if (type == TDS_BULK && server->bulk)
+			server->bulk(tds, msg, msg_len);
+		else if (type != TDS_BULK && has_marker(msg, msg_len, server->marker))
+			server->send_results(tds);
+		else
+			tds_send_done_token(tds, TDS_DONE_FINAL, 0);
+		tds_flush_packet(tds);
+	}
+	free(msg);
+}
+
+/* accept a single connection and emulate a server */
+static TDS_THREAD_PROC_DECLARE(server_proc, arg)
+{
+	SERVER_ARGS *args = (SERVER_ARGS *) arg;
+	const FAKE_SERVER *server = args->server;
+	TDS_SYS_SOCKET sock;
+	TDSCONTEXT *ctx;
+	TDSSOCKET *tds;
+	TDSLOGIN *login;
+
+	sock = tds_accept(args->s, NULL, NULL);
+	assert(!TDS_IS_SOCKET_INVALID(sock));
+	CLOSESOCKET(args->s);
+	free(args);
+
+	ctx = tds_alloc_context(NULL);
+	assert(ctx);
+	tds = tds_alloc_socket(ctx, 4096);
+	assert(tds);
+	tds_set_s(tds, sock);
+	tds->out_flag = TDS_LOGIN;
+	tds_iconv_open(tds->conn, "ISO8859-1", 0);
+	tds->state = TDS_IDLE;
+	tds->conn->product_version = TDS_MS_VER(11, 0, 2100);
+
+	login = tds_alloc_read_login(tds);
+	assert(login);
+	tds->out_flag = TDS_REPLY;
+	tds_send_login_ack(tds, "Microsoft SQL Server");
+	tds_env_change(tds, TDS_ENV_PACKSIZE, "4096", "4096");
+	tds_send_done_token(tds, TDS_DONE_FINAL, 0);
+	tds_flush_packet(tds);
+	tds_free_login(login);
+
+	handle_requests(tds, server);
+
+	tds_close_socket(tds);
+	tds_free_socket(tds);
+	tds_free_context(ctx);
+	return TDS_THREAD_RESULT(0);
+}
+
+/**
+ * Start a fake server in a new thread.
+ * The server listens on loopback, on a port chosen by the system.
+ * \param th     filled with thread to join once the client disconnected
+ * \param server callbacks used to answer requests, must be kept valid
+ * \return port the server is listening on
+ */
+int
+fake_server_start(tds_thread *th, const FAKE_SERVER *server)
+{
+	struct sockaddr_in sin;
+	SOCKLEN_T addrlen = sizeof(sin);
+	SERVER_ARGS *args;
+	TDS_SYS_SOCKET s;
+
+	memset(&sin, 0, sizeof(sin));
+	sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	sin.sin_port = 0;
+	sin.sin_family = AF_INET;
+
+	s = socket(AF_INET, SOCK_STREAM, 0);
+	assert(!TDS_IS_SOCKET_INVALID(s));
+	if (bind(s, (struct sockaddr *) &sin, sizeof(sin)) != 0 || listen(s, 1) != 0
+	    || tds_getsockname(s, (struct sockaddr *) &sin, &addrlen) != 0) {
+		fprintf(stderr, "Cannot bind to a port\n");
+		exit(1);
+	}
+
+	args = tds_new(SERVER_ARGS, 1);
+	assert(args);
+	args->s = s;
+	args->server = server;
+	assert(tds_thread_create(th, server_proc, args) == 0);
+	return ntohs(sin.sin_port);
+}
+#endif
+
+/**
+ * Print the rate of operations done since start, used by benchmarks.
+ * \param start time the operations started
+ * \param count number of operations done
+ * \param fmt   printf like description of the rate (like "rows/second")
+ */
+void
+print_rate(const struct timeval *start, double count, const char *fmt, ...)
+{
+	struct timeval end;
+	double elapsed;
+	va_list ap;
+
+	gettimeofday(&end, NULL);
+	elapsed = (end.tv_sec - start->tv_sec) + (end.tv_usec - start->tv_usec) * 0.000001;
+	if (elapsed <= 0)
+		return;
+
+	printf("%9.0f ", count / elapsed);
+	va_start(ap, fmt);
+	vprintf(fmt, ap);
+	va_end(ap);
+	printf("\n");
+}
@@ -0,0 +1,28 @@
+#ifndef _tdsguard_fKp3YqWv8SxNc2RzT5uHbA_
+#define _tdsguard_fKp3YqWv8SxNc2RzT5uHbA_
+
+#include <freetds/tds.h>
+#include <freetds/thread.h>
+#include <freetds/time.h>
+
+#ifdef TDS_HAVE_MUTEX
+/**
+ * Fake Microsoft SQL Server used by tests of client libraries.
+ * Queries are recognized by a marker, other requests get just a DONE.
+ */
+typedef struct fake_server
+{
+	/** text searched in queries, queries are encoded in UCS-2 */
+	const char *marker;
+	/** send results of a query containing marker, final DONE included */
+	void (*send_results)(TDSSOCKET *tds);
+	/** handle a bulk request and send the reply, can be NULL */
+	void (*bulk)(TDSSOCKET *tds, const unsigned char *data, size_t len);
+} FAKE_SERVER;
+
+int fake_server_start(tds_thread *th, const FAKE_SERVER *server);
+#endif
+
+void print_rate(const struct timeval *start, double count, const char *fmt, ...);
+
+#endif
@@ -0,0 +1,397 @@
+/* FreeTDS - Library of routines accessing Sybase and Microsoft databases
+ * Copyright (C) 2026  Frediano Ziglio
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Purpose: test reading of bcp data files.
+ * Fields read from mapped files, from pipes and from compressed files
+ * must be the same as fields read by tds_bcp_fread.
+ * To test performance, call this program with a number of rows.
+ */
+#include "common.h"
+#include <assert.h>
+
+#if HAVE_UNISTD_H
+#undef getpid
+#include <unistd.h>
+#endif /* HAVE_UNISTD_H */
+
+#if HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif /* HAVE_SYS_MMAN_H */
+
+#if HAVE_ZLIB
+#include <zlib.h>
+#endif /* HAVE_ZLIB */
+
+#include <freetds/replacements.h>
+#include <freetds/thread.h>
+#include <freetds/time.h>
+
+#define NUM_FIELDS 5000
+
+static TDSSOCKET *tds;
+
+static const char *const terminators[] = { "\t", "\n", "|@|", "@@", "\r\n" };
+
+/*
+ * Generate file content.
+ * Every field is followed by the terminator with the same index,
+ * fields contain partial terminators.
+ */
+static char *
+generate(size_t *p_len)
+{
+	static const char chars[] = "abc|@\r\n\t";
+	size_t len = 0, i;
+	char *buf;
+	int n;
+
+	buf = tds_new(char, NUM_FIELDS * 64);
+	assert(buf);
+	for (n = 0; n < NUM_FIELDS; ++n) {
+		const char *term = terminators[n % TDS_VECTOR_SIZE(terminators)];
+		size_t field_len = next_rand() % 40;
+
+		for (i = 0; i < field_len; ++i) {
+			char c = chars[next_rand() % (sizeof(chars) - 1)];
+
+			/* avoid full terminator inside field */
+			buf[len] = c;
+			if (len + 1 >= strlen(term) && memcmp(buf + len + 1 - strlen(term), term, strlen(term)) == 0)
+				buf[len] = 'x';
+			/* avoid terminator starting inside field */
+			if (i + 1 == field_len)
+				buf[len] = 'z';
+			++len;
+		}
+		strcpy(buf + len, term);
+		len += strlen(term);
+	}
+	*p_len = len;
+	return buf;
+}
+
+static FILE *
+create_file(const char *buf, size_t len)
+{
+	FILE *f = tmpfile();
+
+	assert(f);
+	assert(fwrite(buf, 1, len, f) == len);
+	rewind(f);
+	return f;
+}
+
+#if HAVE_ZLIB
+static FILE *
+create_compressed_file(const char *buf, size_t len)
+{
+	FILE *f = tmpfile();
+	gzFile gz;
+
+	assert(f);
+	gz = gzdopen(dup(fileno(f)), "wb");
+	assert(gz);
+	assert(gzwrite(gz, buf, (unsigned) len) == (int) len);
+	assert(gzclose(gz) == Z_OK);
+	rewind(f);
+	return f;
+}
+#endif
+
+typedef struct
+{
+	int fd;
+	const char *buf;
+	size_t len;
+} WRITER;
+
+static TDS_THREAD_PROC_DECLARE(write_pipe_proc, arg)
+{
+	WRITER *w = (WRITER *) arg;
+	const char *p = w->buf;
+	size_t len = w->len;
+
+	while (len) {
+		ssize_t written = write(w->fd, p, len);
+
+		assert(written > 0);
+		p += written;
+		len -= written;
+	}
+	close(w->fd);
+	return TDS_THREAD_RESULT(0);
+}
+
+/* compare all fields read from a data file with tds_bcp_fread ones */
+static void
+compare_fields(FILE *ref, TDSBCPHOSTFILE *hf, TDSICONV *conv)
+{
+	int n;
+
+	for (n = 0; ; ++n) {
+		const char *term = terminators[n % TDS_VECTOR_SIZE(terminators)];
+		char *ref_data = NULL;
+		size_t ref_len = 0, len = 0;
+		const char *data = NULL;
+		TDSRET ref_rc, rc;
+
+		ref_rc = tds_bcp_fread(tds, conv, ref, term, strlen(term), &ref_data, &ref_len);
+		rc = tds_bcp_hostfile_read_field(tds, conv, hf, term, strlen(term), &data, &len);
+		assert(ref_rc == rc);
+		if (rc != TDS_SUCCESS) {
+			free(ref_data);
+			assert(n == NUM_FIELDS);
+			break;
+		}
+		assert(len == ref_len);
+		assert(memcmp(data, ref_data, len) == 0);
+		free(ref_data);
+	}
+	assert(tds_bcp_hostfile_eof(hf));
+}
+
+static void
+test_fields(const char *buf, size_t len, TDSICONV *conv)
+{
+	FILE *ref, *f;
+	TDSBCPHOSTFILE *hf;
+	int fds[2];
+	tds_thread th;
+	WRITER w;
+
+	/* regular file */
+	ref = create_file(buf, len);
+	hf = tds_bcp_hostfile_open(create_file(buf, len));
+	assert(hf);
+#if HAVE_SYS_MMAN_H
+	assert(hf->map != NULL);
+#endif
+	compare_fields(ref, hf, conv);
+	assert(tds_bcp_hostfile_close(hf) == 0);
+
+	/* pipe, read using stdio */
+	rewind(ref);
+	assert(pipe(fds) == 0);
+	f = fdopen(fds[0], "r");
+	assert(f);
+	hf = tds_bcp_hostfile_open(f);
+	assert(hf && hf->map == NULL);
+	w.fd = fds[1];
+	w.buf = buf;
+	w.len = len;
+	assert(tds_thread_create(&th, write_pipe_proc, &w) == 0);
+	compare_fields(ref, hf, conv);
+	tds_thread_join(th, NULL);
+	assert(tds_bcp_hostfile_close(hf) == 0);
+
+#if HAVE_ZLIB
+	/* compressed file */
+	rewind(ref);
+	hf = tds_bcp_hostfile_open_compressed(create_compressed_file(buf, len));
+	assert(hf && hf->gz != NULL);
+	compare_fields(ref, hf, conv);
+
+	/* going back decompresses again from the beginning */
+	rewind(ref);
+	assert(tds_bcp_hostfile_seek(hf, 0) == TDS_SUCCESS);
+	assert(tds_bcp_hostfile_tell(hf) == 0);
+	compare_fields(ref, hf, conv);
+	assert(tds_bcp_hostfile_close(hf) == 0);
+
+	/* not compressed files are read as they are */
+	rewind(ref);
+	hf = tds_bcp_hostfile_open_compressed(create_file(buf, len));
+	assert(hf);
+	compare_fields(ref, hf, conv);
+	assert(tds_bcp_hostfile_close(hf) == 0);
+#endif
+
+	fclose(ref);
+}
+
+static void
+test_read(void)
+{
+	static const char content[] = "\x03" "abc" "12345" "data,last";
+	TDSBCPHOSTFILE *hf;
+	FILE *f;
+	const char *data;
+	size_t len;
+	int i;
+	char c;
+
+	for (i = 0; i < 3; ++i) {
+		if (i == 2) {
+#if HAVE_ZLIB
+			/* compressed, skip first byte */
+			hf = tds_bcp_hostfile_open_compressed(create_compressed_file(content, sizeof(content) - 1));
+			assert(hf);
+			assert(tds_bcp_hostfile_read(hf, 1, &data) == TDS_SUCCESS && data[0] == 3);
+#else
+			break;
+#endif
+		} else {
+			f = create_file(content, sizeof(content) - 1);
+
+			/* part of file already read */
+			assert(fread(&c, 1, 1, f) == 1 && c == 3);
+			hf = tds_bcp_hostfile_open(f);
+			assert(hf);
+		}
+		if (i == 1) {
+			/* force stdio */
+#if HAVE_SYS_MMAN_H
+			munmap((void *) hf->map, hf->map_size);
+#endif
+			hf->map = NULL;
+		}
+
+		assert(tds_bcp_hostfile_read(hf, 3, &data) == TDS_SUCCESS);
+		assert(memcmp(data, "abc", 3) == 0);
+		assert(tds_bcp_hostfile_read(hf, 5, &data) == TDS_SUCCESS);
+		assert(memcmp(data, "12345", 5) == 0);
+		assert(tds_bcp_hostfile_read(hf, 0, &data) == TDS_SUCCESS);
+		assert(tds_bcp_hostfile_read_field(tds, NULL, hf, ",", 1, &data, &len) == TDS_SUCCESS);
+		assert(len == 4 && memcmp(data, "data", 4) == 0);
+		assert(!tds_bcp_hostfile_eof(hf));
+
+		/* position can be saved and restored */
+		assert(tds_bcp_hostfile_tell(hf) == 14);
+		assert(tds_bcp_hostfile_seek(hf, 4) == TDS_SUCCESS);
+		assert(tds_bcp_hostfile_read(hf, 3, &data) == TDS_SUCCESS);
+		assert(memcmp(data, "123", 3) == 0);
+		assert(tds_bcp_hostfile_seek(hf, 14) == TDS_SUCCESS);
+		/* mapped file cannot go past end */
+		if (i == 0)
+			assert(tds_bcp_hostfile_seek(hf, 100) == TDS_FAIL);
+
+		/* no terminator */
+		assert(tds_bcp_hostfile_read_field(tds, NULL, hf, ",", 1, &data, &len) == TDS_FAIL);
+		assert(tds_bcp_hostfile_eof(hf));
+		assert(tds_bcp_hostfile_read(hf, 1, &data) == TDS_FAIL);
+		assert(tds_bcp_hostfile_close(hf) == 0);
+	}
+
+	/* short read */
+	hf = tds_bcp_hostfile_open(create_file(content, sizeof(content) - 1));
+	assert(hf);
+	assert(tds_bcp_hostfile_read(hf, sizeof(content), &data) == TDS_FAIL);
+	assert(tds_bcp_hostfile_eof(hf));
+	assert(tds_bcp_hostfile_close(hf) == 0);
+
+	/* empty file */
+	hf = tds_bcp_hostfile_open(create_file(content, 0));
+	assert(hf);
+	assert(tds_bcp_hostfile_read_field(tds, NULL, hf, ",", 1, &data, &len) == TDS_NO_MORE_RESULTS);
+	assert(tds_bcp_hostfile_eof(hf));
+	assert(tds_bcp_hostfile_close(hf) == 0);
+}
+
+static void
+benchmark(int num_rows)
+{
+	struct timeval start, end;
+	double elapsed;
+	char *buf;
+	size_t len = 0, total;
+	int i, n;
+
+	buf = tds_new(char, num_rows * 64u);
+	assert(buf);
+	for (n = 0; n < num_rows; ++n)
+		len += sprintf(buf + len, "%d\tsome text for row %d\t%d.%02d\n", n, n, n * 3, n % 100);
+
+	for (i = 0; i < 3; ++i) {
+		FILE *f = create_file(buf, len);
+		TDSBCPHOSTFILE *hf = i == 1 ? tds_bcp_hostfile_open(f) : NULL;
+
+		if (i == 2) {
+#if HAVE_ZLIB
+			fclose(f);
+			f = NULL;
+			hf = tds_bcp_hostfile_open_compressed(create_compressed_file(buf, len));
+#else
+			fclose(f);
+			break;
+#endif
+		}
+
+		total = 0;
+		gettimeofday(&start, NULL);
+		for (n = 0; n < num_rows * 3; ++n) {
+			const char *term = (n % 3) == 2 ? "\n" : "\t";
+			size_t field_len;
+
+			if (i) {
+				const char *data;
+
+				assert(tds_bcp_hostfile_read_field(tds, NULL, hf, term, 1, &data, &field_len) == TDS_SUCCESS);
+			} else {
+				char *data = NULL;
+
+				assert(tds_bcp_fread(tds, NULL, f, term, 1, &data, &field_len) == TDS_SUCCESS);
+				free(data);
+			}
+			total += field_len;
+		}
+		gettimeofday(&end, NULL);
+		elapsed = (end.tv_sec - start.tv_sec) + (end.tv_usec - start.tv_usec) * 0.000001;
+		if (elapsed > 0)
+			printf("%9.1f MB/second reading %lu bytes of fields (%s)\n", len / elapsed / 1e6,
+			       (unsigned long) total, i == 2 ? "compressed host file" : i ? "host file" : "tds_bcp_fread");
+		if (i)
+			tds_bcp_hostfile_close(hf);
+		else
+			fclose(f);
+	}
+	free(buf);
+}
+
+TEST_MAIN()
+{
+	TDSCONTEXT *ctx;
+	char *buf;
+	size_t len;
+
+	setbuf(stdout, NULL);
+	setbuf(stderr, NULL);
+
+	ctx = tds_alloc_context(NULL);
+	assert(ctx);
+	tds = tds_alloc_socket(ctx, 512);
+	assert(tds);
+	tds->conn->tds_version = 0x704;
+	tds_iconv_open(tds->conn, "ISO-8859-1", 0);
+
+	test_read();
+
+	buf = generate(&len);
+	test_fields(buf, len, NULL);
+	/* data converted to server encoding */
+	test_fields(buf, len, tds->conn->char_convs[client2ucs2]);
+	free(buf);
+
+	if (argc > 1)
+		benchmark(atoi(argv[1]));
+
+	tds_free_socket(tds);
+	tds_free_context(ctx);
+	return 0;
+}
@@ -0,0 +1,174 @@
+/* FreeTDS - Library of routines accessing Sybase and Microsoft databases
+ * Copyright (C) 2026  Frediano Ziglio
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Purpose: test multiple RPC calls are packed in a single request.
+ * Every call must be encoded like a single tds_submit_rpc one.
+ */
+#include "common.h"
+#include <assert.h>
+#include <freetds/bytes.h>
+
+#if HAVE_UNISTD_H
+#undef getpid
+#include <unistd.h>
+#endif /* HAVE_UNISTD_H */
+
+#include <freetds/replacements.h>
+#include <freetds/utils.h>
+
+#define NUM_CALLS 5
+
+static TDSSOCKET *tds;
+static TDS_SYS_SOCKET server_socket = INVALID_SOCKET;
+
+static void
+read_all(TDS_SYS_SOCKET s, void *buf, size_t len)
+{
+	char *p = (char *) buf;
+
+	while (len) {
+		int got = READSOCKET(s, p, len);
+		assert(got > 0);
+		p += got;
+		len -= got;
+	}
+}
+
+/* read a full request sent by the client, removing packet headers */
+static size_t
+read_request(unsigned char *request, size_t size)
+{
+	unsigned char header[8];
+	size_t len, request_len = 0;
+
+	do {
+		read_all(server_socket, header, 8);
+		assert(header[0] == TDS_RPC);
+		len = TDS_GET_UA2BE(header + 2) - 8;
+		assert(request_len + len <= size);
+		read_all(server_socket, request + request_len, len);
+		request_len += len;
+	} while ((header[1] & 1) == 0);
+
+	/* we do not send any reply, just allows another request */
+	tds->state = TDS_IDLE;
+	return request_len;
+}
+
+static TDSPARAMINFO *
+create_params(int value)
+{
+	TDSPARAMINFO *params;
+	TDSCOLUMN *col;
+	void *data;
+
+	params = tds_alloc_param_result(NULL);
+	assert(params);
+	col = params->columns[0];
+	tds_set_param_type(tds->conn, col, SYBINT4);
+	tds_dstr_copy(&col->column_name, "@value");
+	data = tds_alloc_param_data(col);
+	assert(data);
+	*(TDS_INT *) col->column_data = value;
+	col->column_cur_size = 4;
+	return params;
+}
+
+static void
+test_version(TDS_USMALLINT version)
+{
+	static unsigned char single[NUM_CALLS][512], multiple[8192];
+	size_t single_len[NUM_CALLS], multiple_len, headers_len, pos;
+	TDSPARAMINFO *params[NUM_CALLS];
+	TDSMULTIPLE mul;
+	TDSRET rc;
+	int i;
+
+	tds->conn->tds_version = version;
+
+	for (i = 0; i < NUM_CALLS; ++i) {
+		params[i] = create_params(i * 1234567);
+		rc = tds_submit_rpc(tds, "my_proc", params[i], NULL);
+		assert(rc == TDS_SUCCESS);
+		single_len[i] = read_request(single[i], sizeof(single[i]));
+	}
+
+	rc = tds_multiple_init(tds, &mul, TDS_MULTIPLE_RPC, NULL);
+	assert(rc == TDS_SUCCESS);
+	for (i = 0; i < NUM_CALLS; ++i) {
+		rc = tds_multiple_rpc(tds, &mul, "my_proc", params[i]);
+		assert(rc == TDS_SUCCESS);
+	}
+	rc = tds_multiple_done(tds, &mul);
+	assert(rc == TDS_SUCCESS);
+	multiple_len = read_request(multiple, sizeof(multiple));
+
+	/* same headers, calls separated by batch flag */
+	headers_len = IS_TDS72_PLUS(tds->conn) ? TDS_GET_UA4LE(single[0]) : 0;
+	assert(memcmp(multiple, single[0], headers_len) == 0);
+	pos = headers_len;
+	for (i = 0; i < NUM_CALLS; ++i) {
+		if (i) {
+			assert(multiple[pos] == (IS_TDS72_PLUS(tds->conn) ? 0xff : 0x80));
+			++pos;
+		}
+		assert(pos + single_len[i] - headers_len <= multiple_len);
+		assert(memcmp(multiple + pos, single[i] + headers_len, single_len[i] - headers_len) == 0);
+		pos += single_len[i] - headers_len;
+	}
+	assert(pos == multiple_len);
+
+	for (i = 0; i < NUM_CALLS; ++i)
+		tds_free_param_results(params[i]);
+}
+
+TEST_MAIN()
+{
+	TDSCONTEXT *ctx;
+	TDS_SYS_SOCKET sockets[2];
+
+	setbuf(stdout, NULL);
+	setbuf(stderr, NULL);
+
+	ctx = tds_alloc_context(NULL);
+	assert(ctx);
+	tds = tds_alloc_socket(ctx, 512);
+	assert(tds);
+	tds->conn->tds_version = 0x704;
+	tds_iconv_open(tds->conn, "ISO-8859-1", 0);
+
+	/* requests are read back from the other end of the pair */
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) < 0) {
+		perror("socketpair");
+		exit(1);
+	}
+	tds_socket_set_nosigpipe(sockets[0], 1);
+	tds->state = TDS_IDLE;
+	tds_set_s(tds, sockets[0]);
+	server_socket = sockets[1];
+
+	test_version(0x701);
+	test_version(0x704);
+
+	tds_free_socket(tds);
+	tds_free_context(ctx);
+	CLOSESOCKET(server_socket);
+	return 0;
+}
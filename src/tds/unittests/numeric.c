@@ -21,6 +21,8 @@
 #include <freetds/convert.h>
 #include <assert.h>
 
+#include <freetds/time.h>
+
 /* test numeric scale */
 
 static int g_result = 0;
@@ -90,6 +92,184 @@ test(const char *src, int prec, int scale, int scale2)
 	test0(src, prec, scale, prec, scale2);
 }
 
+/* convert absolute value to decimal digits using plain long division */
+static void
+numeric_digits(const TDS_NUMERIC *num, char *out)
+{
+	unsigned char bytes[sizeof(num->array)];
+	char digits[200], *p = digits + sizeof(digits);
+	int i, len = tds_numeric_bytes_per_prec[num->precision] - 1;
+	bool zero;
+
+	memcpy(bytes, num->array + 1, len);
+	*--p = 0;
+	do {
+		unsigned int remainder = 0;
+
+		zero = true;
+		for (i = 0; i < len; ++i) {
+			remainder = remainder * 256u + bytes[i];
+			bytes[i] = remainder / 10u;
+			remainder %= 10u;
+			if (bytes[i])
+				zero = false;
+		}
+		*--p = '0' + remainder;
+	} while (!zero);
+	strcpy(out, p);
+}
+
+/* format digits with sign and decimal point like tds_numeric_to_string */
+static void
+format_digits(const char *digits, bool negative, int scale, char *out)
+{
+	int len = (int) strlen(digits);
+
+	if (negative)
+		*out++ = '-';
+	if (len <= scale) {
+		*out++ = '0';
+		*out++ = '.';
+		for (; len < scale; --scale)
+			*out++ = '0';
+		strcpy(out, digits);
+		return;
+	}
+	memcpy(out, digits, len - scale);
+	out += len - scale;
+	if (scale)
+		*out++ = '.';
+	strcpy(out, digits + len - scale);
+}
+
+static void
+random_numeric(TDS_NUMERIC *num, int prec, int scale)
+{
+	int i, len = (int) (next_rand() % (unsigned) prec) + 1;
+	char digits[100], buf[100];
+	CONV_RESULT cr;
+
+	for (i = 0; i < len; ++i)
+		digits[i] = '0' + next_rand() % 10u;
+	digits[len] = 0;
+	format_digits(digits, false, scale, buf);
+
+	memset(&cr.n, 0, sizeof(cr.n));
+	cr.n.precision = prec;
+	cr.n.scale = scale;
+	if (tds_convert(&ctx, SYBVARCHAR, buf, (TDS_UINT) strlen(buf), SYBNUMERIC, &cr) < 0) {
+		fprintf(stderr, "Error getting numeric %s(%d,%d)\n", buf, prec, scale);
+		exit(1);
+	}
+	*num = cr.n;
+	num->array[0] = next_rand() & 1;
+}
+
+/* check conversions of random numbers against simple implementations */
+static void
+test_random(void)
+{
+	int n;
+	char digits[200], expected[200], result[200];
+
+	for (n = 0; n < 100000; ++n) {
+		int prec = (int) (next_rand() % (n & 1 ? 38u : (unsigned) MAXPRECISION)) + 1;
+		int scale = (int) (next_rand() % (unsigned) (prec + 1));
+		int prec2 = (int) (next_rand() % (n & 2 ? 38u : (unsigned) MAXPRECISION)) + 1;
+		int scale2 = (int) (next_rand() % (unsigned) (prec2 + 1));
+		int len;
+		const char *p;
+		TDS_NUMERIC num;
+		CONV_RESULT cr;
+		double d;
+
+		random_numeric(&num, prec, scale);
+
+		/* to string */
+		numeric_digits(&num, digits);
+		format_digits(digits, num.array[0] == 1, scale, expected);
+		tds_numeric_to_string(&num, result);
+		if (strcmp(expected, result) != 0) {
+			fprintf(stderr, "Wrong string from (%d,%d): got %s expected %s\n", prec, scale, result, expected);
+			exit(1);
+		}
+
+		/* to float */
+		d = atof(expected);
+		if (tds_convert(&ctx, SYBNUMERIC, &num, sizeof(num), SYBFLT8, &cr) < 0
+		    || memcmp(&cr.f, &d, sizeof(d)) != 0) {
+			fprintf(stderr, "Wrong float from %s\n", expected);
+			exit(1);
+		}
+
+		/* change scale, compute expected result with strings */
+		len = (int) strlen(digits);
+		if (scale2 >= scale) {
+			memset(digits + len, '0', scale2 - scale);
+			digits[len + scale2 - scale] = 0;
+		} else if (len > scale - scale2) {
+			digits[len - (scale - scale2)] = 0;
+		} else {
+			strcpy(digits, "0");
+		}
+		for (p = digits; p[0] == '0' && p[1]; ++p)
+			continue;
+		if ((int) strlen(p) > prec2)
+			strcpy(expected, "error");
+		else
+			format_digits(p, num.array[0] == 1, scale2, expected);
+
+		if (tds_numeric_change_prec_scale(&num, prec2, scale2) < 0)
+			strcpy(result, "error");
+		else
+			tds_numeric_to_string(&num, result);
+		if (strcmp(expected, result) != 0) {
+			fprintf(stderr, "Wrong conversion (%d,%d) -> (%d,%d): got %s expected %s\n",
+				prec, scale, prec2, scale2, result, expected);
+			exit(1);
+		}
+	}
+}
+
+static void
+benchmark(int iterations)
+{
+	static const struct {
+		int prec, scale;
+	} types[] = {
+		{ 10, 0 }, { 18, 2 }, { 19, 4 }, { 28, 8 }, { 38, 0 }, { 38, 10 }
+	};
+	TDS_NUMERIC nums[64];
+	struct timeval start, end;
+	double elapsed;
+	unsigned int i, t;
+	int j;
+	char buf[100];
+	CONV_RESULT cr;
+
+	for (t = 0; t < TDS_VECTOR_SIZE(types); ++t) {
+		TDS_NUMERIC num;
+
+		for (i = 0; i < TDS_VECTOR_SIZE(nums); ++i)
+			random_numeric(&nums[i], types[t].prec, types[t].scale);
+
+		gettimeofday(&start, NULL);
+		for (j = 0; j < iterations; ++j)
+			for (i = 0; i < TDS_VECTOR_SIZE(nums); ++i) {
+				tds_numeric_to_string(&nums[i], buf);
+				tds_convert(&ctx, SYBNUMERIC, &nums[i], sizeof(nums[i]), SYBFLT8, &cr);
+				tds_convert(&ctx, SYBNUMERIC, &nums[i], sizeof(nums[i]), SYBINT8, &cr);
+				num = nums[i];
+				tds_numeric_change_prec_scale(&num, 38, types[t].scale + 4);
+			}
+		gettimeofday(&end, NULL);
+		elapsed = (end.tv_sec - start.tv_sec) + (end.tv_usec - start.tv_usec) * 0.000001;
+		if (elapsed > 0)
+			printf("%9.0f numbers/second processing NUMERIC(%d,%d)\n",
+			       iterations * TDS_VECTOR_SIZE(nums) / elapsed, types[t].prec, types[t].scale);
+	}
+}
+
 TEST_MAIN()
 {
 	int i;
@@ -138,6 +318,11 @@ TEST_MAIN()
 	}
 #endif
 
+	test_random();
+
+	if (argc > 1)
+		benchmark(atoi(argv[1]));
+
 	if (!g_result)
 		printf("All passed!\n");
 
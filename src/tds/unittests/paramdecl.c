@@ -0,0 +1,311 @@
+/* FreeTDS - Library of routines accessing Sybase and Microsoft databases
+ * Copyright (C) 2026  Frediano Ziglio
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Purpose: test parameters declaration sent with sp_executesql.
+ * Declaration is cached in parameters, check it's updated when
+ * parameter types change.
+ * To test performance, call this program with an iteration count.
+ */
+#include "common.h"
+#include <assert.h>
+#include <freetds/bytes.h>
+
+#if HAVE_UNISTD_H
+#undef getpid
+#include <unistd.h>
+#endif /* HAVE_UNISTD_H */
+
+#include <freetds/replacements.h>
+#include <freetds/utils.h>
+#include <freetds/time.h>
+
+#define NUM_PARAMS 60
+
+static TDSSOCKET *tds;
+static TDS_SYS_SOCKET server_socket = INVALID_SOCKET;
+static char query[NUM_PARAMS * 2 + 64];
+static unsigned char request[65536];
+static size_t request_len;
+
+static void
+read_all(TDS_SYS_SOCKET s, void *buf, size_t len)
+{
+	char *p = (char *) buf;
+
+	while (len) {
+		int got = READSOCKET(s, p, len);
+		assert(got > 0);
+		p += got;
+		len -= got;
+	}
+}
+
+/* read a full request sent by the client, removing packet headers */
+static void
+read_request(void)
+{
+	unsigned char header[8];
+	size_t len;
+
+	request_len = 0;
+	do {
+		read_all(server_socket, header, 8);
+		len = TDS_GET_UA2BE(header + 2) - 8;
+		assert(request_len + len <= sizeof(request));
+		read_all(server_socket, request + request_len, len);
+		request_len += len;
+	} while ((header[1] & 1) == 0);
+
+	/* we do not send any reply, just allows another request */
+	tds->state = TDS_IDLE;
+}
+
+static void
+execute(TDSPARAMINFO *params)
+{
+	TDSRET rc;
+
+	rc = tds_submit_execdirect(tds, query, params, NULL);
+	assert(rc == TDS_SUCCESS);
+	read_request();
+}
+
+/* check request contains the declaration built without any cache */
+static void
+check_declaration(TDSPARAMINFO *params, int num_placeholders)
+{
+	char declaration[128];
+	unsigned char *expected, *p;
+	size_t i, len = 0;
+	int n;
+
+	expected = tds_new(unsigned char, num_placeholders * 256);
+	assert(expected);
+	for (n = 0; n < num_placeholders; ++n) {
+		char *d = declaration;
+
+		if (n)
+			*d++ = ',';
+		d += sprintf(d, "@P%d ", n + 1);
+		if (n >= params->num_cols) {
+			strcpy(d, "varchar(4000)");
+		} else {
+			TDSRET rc = tds_get_column_declaration(tds, params->columns[n], d);
+			assert(rc == TDS_SUCCESS);
+		}
+		for (d = declaration; *d; ++d) {
+			expected[len++] = (unsigned char) *d;
+			expected[len++] = 0;
+		}
+	}
+
+	/* declaration is preceded by NTEXT type, sizes and collation */
+	for (i = 0, p = request; i + len + 14 <= request_len; ++i, ++p) {
+		if (p[0] != SYBNTEXT || TDS_GET_UA4LE(p + 1) != len || TDS_GET_UA4LE(p + 10) != len)
+			continue;
+		if (memcmp(p + 14, expected, len) == 0)
+			break;
+	}
+	assert(i + len + 14 <= request_len);
+	free(expected);
+}
+
+static TDSPARAMINFO *
+create_params(void)
+{
+	TDSPARAMINFO *params = NULL;
+	TDSCOLUMN *col;
+	void *data;
+	int i;
+
+	for (i = 0; i < NUM_PARAMS; ++i) {
+		params = tds_alloc_param_result(params);
+		assert(params);
+		col = params->columns[i];
+		switch (i % 4) {
+		case 0:
+			tds_set_param_type(tds->conn, col, SYBINT4);
+			break;
+		case 1:
+			tds_set_param_type(tds->conn, col, SYBVARCHAR);
+			col->column_size = 10 + i;
+			break;
+		case 2:
+			tds_set_param_type(tds->conn, col, SYBNUMERIC);
+			col->column_prec = 18;
+			col->column_scale = (TDS_TINYINT) (i % 10);
+			break;
+		case 3:
+			tds_set_param_type(tds->conn, col, XSYBNVARCHAR);
+			col->column_size = 20 + i;
+			break;
+		}
+		data = tds_alloc_param_data(col);
+		assert(data);
+		/* send all NULLs */
+		col->column_cur_size = -1;
+	}
+	return params;
+}
+
+static void
+set_placeholders(int num)
+{
+	char *p = query;
+	int i;
+
+	p += sprintf(p, "INSERT INTO t VALUES(");
+	for (i = 0; i < num; ++i) {
+		if (i)
+			*p++ = ',';
+		*p++ = '?';
+	}
+	strcpy(p, ")");
+}
+
+static void
+test_cache(void)
+{
+	TDSPARAMINFO *params;
+	struct tds_param_decl *decl;
+
+	params = create_params();
+	set_placeholders(NUM_PARAMS);
+
+	/* first execution build declaration */
+	assert(params->param_decl == NULL);
+	execute(params);
+	check_declaration(params, NUM_PARAMS);
+	decl = params->param_decl;
+	assert(decl);
+
+	/* cache is reused */
+	execute(params);
+	check_declaration(params, NUM_PARAMS);
+	assert(params->param_decl == decl);
+
+	/* size change */
+	params->columns[1]->column_size = 200;
+	execute(params);
+	check_declaration(params, NUM_PARAMS);
+
+	/* precision change */
+	params->columns[2]->column_scale = 4;
+	execute(params);
+	check_declaration(params, NUM_PARAMS);
+
+	/* type change */
+	tds_set_param_type(tds->conn, params->columns[0], SYBINT8);
+	execute(params);
+	check_declaration(params, NUM_PARAMS);
+
+	/* varchar(max), data is not a blob, restore before freeing */
+	params->columns[1]->column_varint_size = 8;
+	execute(params);
+	check_declaration(params, NUM_PARAMS);
+	assert(params->param_decl != NULL);
+	params->columns[1]->column_varint_size = 2;
+
+	/* more placeholders than parameters */
+	set_placeholders(NUM_PARAMS + 3);
+	execute(params);
+	check_declaration(params, NUM_PARAMS + 3);
+
+	/* less parameters */
+	tds_free_param_result(params);
+	execute(params);
+	check_declaration(params, NUM_PARAMS + 3);
+
+	/* no parameters at all */
+	set_placeholders(3);
+	tds_free_param_results(params);
+	params = tds_alloc_results(0);
+	assert(params);
+	execute(params);
+	check_declaration(params, 3);
+
+	tds_free_param_results(params);
+}
+
+static void
+benchmark(int iterations)
+{
+	struct timeval start, end;
+	double elapsed;
+	TDSPARAMINFO *params;
+	int i, cached;
+
+	params = create_params();
+	set_placeholders(NUM_PARAMS);
+
+	for (cached = 0; cached < 2; ++cached) {
+		gettimeofday(&start, NULL);
+		for (i = 0; i < iterations; ++i) {
+			if (!cached) {
+				tds_free_param_decl(params->param_decl);
+				params->param_decl = NULL;
+			}
+			execute(params);
+		}
+		gettimeofday(&end, NULL);
+		elapsed = (end.tv_sec - start.tv_sec) + (end.tv_usec - start.tv_usec) * 0.000001;
+		if (elapsed > 0)
+			printf("%9.0f executions/second with %d parameters (cache %s)\n", iterations / elapsed,
+			       NUM_PARAMS, cached ? "enabled" : "disabled");
+	}
+
+	tds_free_param_results(params);
+}
+
+TEST_MAIN()
+{
+	TDSCONTEXT *ctx;
+	TDS_SYS_SOCKET sockets[2];
+
+	setbuf(stdout, NULL);
+	setbuf(stderr, NULL);
+
+	ctx = tds_alloc_context(NULL);
+	assert(ctx);
+	tds = tds_alloc_socket(ctx, 512);
+	assert(tds);
+	tds->conn->tds_version = 0x704;
+	tds_iconv_open(tds->conn, "ISO-8859-1", 0);
+
+	/* requests are read back from the other end of the pair */
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) < 0) {
+		perror("socketpair");
+		exit(1);
+	}
+	tds_socket_set_nosigpipe(sockets[0], 1);
+	tds->state = TDS_IDLE;
+	tds_set_s(tds, sockets[0]);
+	server_socket = sockets[1];
+
+	test_cache();
+
+	if (argc > 1)
+		benchmark(atoi(argv[1]));
+
+	tds_free_socket(tds);
+	tds_free_context(ctx);
+	CLOSESOCKET(server_socket);
+	return 0;
+}
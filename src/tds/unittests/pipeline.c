@@ -0,0 +1,291 @@
+/* FreeTDS - Library of routines accessing Sybase and Microsoft databases
+ * Copyright (C) 2026  Frediano Ziglio
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Purpose: test pipelining of multiple requests.
+ * Queries and RPCs are sent together, results are attributed
+ * to every request.
+ */
+#include "common.h"
+#include <assert.h>
+#include <freetds/bytes.h>
+
+#if HAVE_UNISTD_H
+#undef getpid
+#include <unistd.h>
+#endif /* HAVE_UNISTD_H */
+
+#include <freetds/replacements.h>
+#include <freetds/utils.h>
+
+static TDSSOCKET *tds;
+static TDS_SYS_SOCKET server_socket = INVALID_SOCKET;
+static unsigned char reply[4096];
+static size_t reply_len;
+
+static void
+read_all(TDS_SYS_SOCKET s, void *buf, size_t len)
+{
+	char *p = (char *) buf;
+
+	while (len) {
+		int got = READSOCKET(s, p, len);
+		assert(got > 0);
+		p += got;
+		len -= got;
+	}
+}
+
+/* read a full request sent by the client, removing packet headers */
+static size_t
+read_request(unsigned char *request, size_t size)
+{
+	unsigned char header[8];
+	size_t len, request_len = 0;
+
+	do {
+		read_all(server_socket, header, 8);
+		assert(header[0] == TDS_RPC);
+		len = TDS_GET_UA2BE(header + 2) - 8;
+		assert(request_len + len <= size);
+		read_all(server_socket, request + request_len, len);
+		request_len += len;
+	} while ((header[1] & 1) == 0);
+
+	return request_len;
+}
+
+static void
+add_done(unsigned char token, unsigned int status, TDS_INT8 rows)
+{
+	unsigned char *p = reply + reply_len;
+
+	p[0] = token;
+	TDS_PUT_UA2LE(p + 1, status);
+	TDS_PUT_UA2LE(p + 3, 0);
+	TDS_PUT_UA4LE(p + 5, (TDS_UINT) rows);
+	TDS_PUT_UA4LE(p + 9, (TDS_UINT) (rows >> 32));
+	reply_len += 13;
+}
+
+static void
+add_status(TDS_INT status)
+{
+	reply[reply_len] = TDS_RETURNSTATUS_TOKEN;
+	TDS_PUT_UA4LE(reply + reply_len + 1, (TDS_UINT) status);
+	reply_len += 5;
+}
+
+/* send reply prepared, in a single packet */
+static void
+send_reply(void)
+{
+	unsigned char header[8] = { TDS_REPLY, 1, 0, 0, 0, 0, 1, 0 };
+	int written;
+
+	TDS_PUT_UA2BE(header + 2, reply_len + 8);
+	written = WRITESOCKET(server_socket, header, 8);
+	assert(written == 8);
+	written = WRITESOCKET(server_socket, reply, reply_len);
+	assert(written == (int) reply_len);
+	reply_len = 0;
+}
+
+static TDSPARAMINFO *
+create_params(void)
+{
+	TDSPARAMINFO *params;
+	TDSCOLUMN *col;
+	void *data;
+
+	params = tds_alloc_param_result(NULL);
+	assert(params);
+	col = params->columns[0];
+	tds_set_param_type(tds->conn, col, SYBINT4);
+	tds_dstr_copy(&col->column_name, "@id");
+	data = tds_alloc_param_data(col);
+	assert(data);
+	*(TDS_INT *) col->column_data = 123;
+	col->column_cur_size = 4;
+	return params;
+}
+
+/* send some requests in a single batch */
+static void
+send_requests(TDSMULTIPLE *multiple, TDSPARAMINFO *params)
+{
+	unsigned char request[8192];
+	size_t len;
+	TDSRET rc;
+
+	rc = tds_multiple_init(tds, multiple, TDS_MULTIPLE_RPC, NULL);
+	assert(rc == TDS_SUCCESS);
+	rc = tds_multiple_execdirect(tds, multiple, "INSERT INTO t VALUES(?)", params);
+	assert(rc == TDS_SUCCESS);
+	rc = tds_multiple_execdirect(tds, multiple, "DELETE FROM t", NULL);
+	assert(rc == TDS_SUCCESS);
+	rc = tds_multiple_rpc(tds, multiple, "my_proc", params);
+	assert(rc == TDS_SUCCESS);
+	rc = tds_multiple_rpc(tds, multiple, "other_proc", NULL);
+	assert(rc == TDS_SUCCESS);
+	assert(multiple->count == 4);
+	rc = tds_multiple_done(tds, multiple);
+	assert(rc == TDS_SUCCESS);
+
+	/* requests are all sent before reading any result */
+	len = read_request(request, sizeof(request));
+	assert(len > 0);
+}
+
+static void
+test_results(void)
+{
+	TDSPARAMINFO *params = create_params();
+	TDSMULTIPLERESULT results[4];
+	TDSMULTIPLE multiple;
+	TDSRET rc;
+
+	send_requests(&multiple, params);
+
+	/* insert, 1 row */
+	add_done(TDS_DONEINPROC_TOKEN, TDS_DONE_COUNT | TDS_DONE_MORE_RESULTS, 1);
+	add_status(0);
+	add_done(TDS_DONEPROC_TOKEN, TDS_DONE_MORE_RESULTS, 0);
+	/* delete, failed */
+	add_done(TDS_DONEINPROC_TOKEN, TDS_DONE_ERROR | TDS_DONE_MORE_RESULTS, 0);
+	add_status(-6);
+	add_done(TDS_DONEPROC_TOKEN, TDS_DONE_ERROR | TDS_DONE_MORE_RESULTS, 0);
+	/* procedure with two statements */
+	add_done(TDS_DONEINPROC_TOKEN, TDS_DONE_COUNT | TDS_DONE_MORE_RESULTS, 3);
+	add_done(TDS_DONEINPROC_TOKEN, TDS_DONE_COUNT | TDS_DONE_MORE_RESULTS, 2);
+	add_status(12);
+	add_done(TDS_DONEPROC_TOKEN, TDS_DONE_MORE_RESULTS, 0);
+	/* count of procedure is ignored */
+	add_done(TDS_DONEINPROC_TOKEN, TDS_DONE_COUNT | TDS_DONE_MORE_RESULTS, 7);
+	add_done(TDS_DONEPROC_TOKEN, TDS_DONE_COUNT, 100);
+	send_reply();
+
+	rc = tds_process_multiple_results(tds, &multiple, results);
+	assert(rc == TDS_FAIL);
+	assert(tds->state == TDS_IDLE);
+	assert(multiple.current == 4);
+
+	assert(!results[0].failed && results[0].rows_affected == 1);
+	assert(results[0].has_status && results[0].ret_status == 0);
+	assert(results[1].failed && results[1].rows_affected == TDS_NO_COUNT);
+	assert(results[1].has_status && results[1].ret_status == -6);
+	assert(!results[2].failed && results[2].rows_affected == 5);
+	assert(results[2].has_status && results[2].ret_status == 12);
+	assert(!results[3].failed && results[3].rows_affected == 7);
+	assert(!results[3].has_status);
+
+	/* batch aborted, last requests are not executed */
+	send_requests(&multiple, params);
+	add_done(TDS_DONEINPROC_TOKEN, TDS_DONE_COUNT | TDS_DONE_MORE_RESULTS, 1);
+	add_done(TDS_DONEPROC_TOKEN, TDS_DONE_MORE_RESULTS, 0);
+	add_done(TDS_DONEPROC_TOKEN, TDS_DONE_ERROR, 0);
+	send_reply();
+
+	rc = tds_process_multiple_results(tds, &multiple, results);
+	assert(rc == TDS_FAIL);
+	assert(tds->state == TDS_IDLE);
+	assert(!results[0].failed && results[0].rows_affected == 1);
+	assert(results[1].failed && results[2].failed && results[3].failed);
+
+	/* all fine */
+	send_requests(&multiple, params);
+	add_done(TDS_DONEPROC_TOKEN, TDS_DONE_MORE_RESULTS, 0);
+	add_done(TDS_DONEPROC_TOKEN, TDS_DONE_MORE_RESULTS, 0);
+	add_done(TDS_DONEPROC_TOKEN, TDS_DONE_MORE_RESULTS, 0);
+	add_done(TDS_DONEPROC_TOKEN, 0, 0);
+	send_reply();
+
+	rc = tds_process_multiple_results(tds, &multiple, results);
+	assert(rc == TDS_SUCCESS);
+	assert(!results[3].failed && results[3].rows_affected == TDS_NO_COUNT);
+
+	tds_free_param_results(params);
+}
+
+/* a batch of only queries still reports return status of every query */
+static void
+test_execdirect_only(void)
+{
+	unsigned char request[8192];
+	TDSMULTIPLERESULT results[2];
+	TDSMULTIPLE multiple;
+	TDSRET rc;
+
+	rc = tds_multiple_init(tds, &multiple, TDS_MULTIPLE_RPC, NULL);
+	assert(rc == TDS_SUCCESS);
+	rc = tds_multiple_execdirect(tds, &multiple, "DELETE FROM t", NULL);
+	assert(rc == TDS_SUCCESS);
+	rc = tds_multiple_execdirect(tds, &multiple, "DELETE FROM u", NULL);
+	assert(rc == TDS_SUCCESS);
+	assert(tds->current_op == TDS_OP_NONE);
+	rc = tds_multiple_done(tds, &multiple);
+	assert(rc == TDS_SUCCESS);
+	assert(read_request(request, sizeof(request)) > 0);
+
+	add_status(0);
+	add_done(TDS_DONEPROC_TOKEN, TDS_DONE_MORE_RESULTS, 0);
+	add_status(-6);
+	add_done(TDS_DONEPROC_TOKEN, TDS_DONE_ERROR, 0);
+	send_reply();
+
+	rc = tds_process_multiple_results(tds, &multiple, results);
+	assert(rc == TDS_FAIL);
+	assert(tds->state == TDS_IDLE);
+	assert(!results[0].failed && results[0].has_status && results[0].ret_status == 0);
+	assert(results[1].failed && results[1].has_status && results[1].ret_status == -6);
+}
+
+TEST_MAIN()
+{
+	TDSCONTEXT *ctx;
+	TDS_SYS_SOCKET sockets[2];
+
+	setbuf(stdout, NULL);
+	setbuf(stderr, NULL);
+
+	ctx = tds_alloc_context(NULL);
+	assert(ctx);
+	tds = tds_alloc_socket(ctx, 512);
+	assert(tds);
+	tds->conn->tds_version = 0x704;
+	tds_iconv_open(tds->conn, "ISO-8859-1", 0);
+
+	/* requests are read back from the other end of the pair */
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) < 0) {
+		perror("socketpair");
+		exit(1);
+	}
+	tds_socket_set_nosigpipe(sockets[0], 1);
+	tds->state = TDS_IDLE;
+	tds_set_s(tds, sockets[0]);
+	server_socket = sockets[1];
+
+	test_results();
+	test_execdirect_only();
+
+	tds_free_socket(tds);
+	tds_free_context(ctx);
+	CLOSESOCKET(server_socket);
+	return 0;
+}
@@ -0,0 +1,219 @@
+/* FreeTDS - Library of routines accessing Sybase and Microsoft databases
+ * Copyright (C) 2026  Frediano Ziglio
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Purpose: test placeholders scanning.
+ * Scanning is compared with a simple character by character one
+ * using random queries.
+ * To test performance, call this program with an iteration count.
+ */
+
+/* allows to use some internal functions */
+#undef NDEBUG
+#include "../query.c"
+
+#include "common.h"
+
+#include <freetds/time.h>
+
+#define MAX_LEN 64
+
+/* reference implementations, scanning a character at a time */
+static const char *
+ref_skip_comment(const char *s)
+{
+	const char *p = s;
+
+	if (*p == '-' && p[1] == '-') {
+		for (;*++p != '\0';)
+			if (*p == '\n')
+				return p + 1;
+	} else if (*p == '/' && p[1] == '*') {
+		++p;
+		for(;*++p != '\0';)
+			if (*p == '*' && p[1] == '/')
+				return p + 2;
+	} else
+		++p;
+
+	return p;
+}
+
+static const char *
+ref_skip_quoted(const char *s)
+{
+	const char *p = s;
+	char quote = (*s == '[') ? ']' : *s;
+
+	for (; *++p;) {
+		if (*p == quote) {
+			if (*++p != quote)
+				return p;
+		}
+	}
+	return p;
+}
+
+static const char *
+ref_next_placeholder(const char *p)
+{
+	for (;;) {
+		switch (*p) {
+		case '\0':
+			return NULL;
+		case '\'':
+		case '\"':
+		case '[':
+			p = ref_skip_quoted(p);
+			break;
+		case '-':
+		case '/':
+			p = ref_skip_comment(p);
+			break;
+		case '?':
+			return p;
+		default:
+			++p;
+			break;
+		}
+	}
+}
+
+/*
+ * Generate a random query with a lot of tokens.
+ * In ucs2 version 'x' characters are replaced with non ASCII
+ * characters containing quotes and other tokens bytes.
+ */
+static size_t
+random_query(char *query, char *ucs2)
+{
+	static const char chars[] = "ab x?'\"[]-/*\n";
+	static const char non_ascii[][2] = {
+		{ '\'', 0x20 }, { 0, '\'' }, { ']', '?' }, { '*', '/' }, { 0, '\n' }, { '?', '?' },
+	};
+	size_t i, len = next_rand() % MAX_LEN;
+
+	for (i = 0; i < len; ++i) {
+		char c = chars[next_rand() % (sizeof(chars) - 1)];
+
+		query[i] = c;
+		ucs2[i * 2] = c;
+		ucs2[i * 2 + 1] = 0;
+		if (c == 'x')
+			memcpy(ucs2 + i * 2, non_ascii[next_rand() % TDS_VECTOR_SIZE(non_ascii)], 2);
+	}
+	query[len] = 0;
+	return len;
+}
+
+static void
+test_random(void)
+{
+	char query[MAX_LEN + 1], ucs2[MAX_LEN * 2];
+	const char *p, *ref, *u;
+	int n, count;
+	size_t len;
+
+	for (n = 0; n < 200000; ++n) {
+		len = random_query(query, ucs2);
+
+		/* skipping functions */
+		for (p = query; *p; ++p) {
+			if (*p == '\'' || *p == '"' || *p == '[') {
+				assert(tds_skip_quoted(p) == ref_skip_quoted(p));
+				assert(tds_skip_quoted_ucs2le(ucs2 + (p - query) * 2, ucs2 + len * 2)
+				       == ucs2 + (ref_skip_quoted(p) - query) * 2);
+			}
+			assert(tds_skip_comment(p) == ref_skip_comment(p));
+		}
+
+		/* all placeholders are found in both encodings */
+		count = 0;
+		p = query;
+		ref = query;
+		u = ucs2;
+		for (;;) {
+			p = tds_next_placeholder(p);
+			ref = ref_next_placeholder(ref);
+			assert(p == ref);
+			u = tds_next_placeholder_ucs2le(u, ucs2 + len * 2, 0);
+			if (!p) {
+				assert(u == ucs2 + len * 2);
+				break;
+			}
+			assert(u == ucs2 + (p - query) * 2);
+			++p;
+			++ref;
+			u += 2;
+			++count;
+		}
+		assert(tds_count_placeholders(query) == count);
+		assert(tds_count_placeholders_ucs2le(ucs2, ucs2 + len * 2) == count);
+	}
+}
+
+static void
+benchmark(int iterations)
+{
+	struct timeval start, end;
+	double elapsed;
+	char *query;
+	size_t len = 0, query_len;
+	int i, count = 0;
+
+	/* a long query with few placeholders */
+	query = tds_new(char, 64 * 1024);
+	assert(query);
+	while (len < 60 * 1024)
+		len += sprintf(query + len, "INSERT INTO table_name(column_name, [other column]) VALUES('some text', ?) "
+			       "-- comment\n");
+	query_len = len;
+
+	for (i = 0; i < 2; ++i) {
+		int j;
+
+		gettimeofday(&start, NULL);
+		for (j = 0; j < iterations; ++j) {
+			const char *p = query;
+
+			count = 0;
+			while ((p = (i ? tds_next_placeholder(p) : ref_next_placeholder(p))) != NULL) {
+				++p;
+				++count;
+			}
+		}
+		gettimeofday(&end, NULL);
+		elapsed = (end.tv_sec - start.tv_sec) + (end.tv_usec - start.tv_usec) * 0.000001;
+		if (elapsed > 0)
+			printf("%9.1f MB/second scanning %d placeholders (%s)\n", iterations * (double) query_len / elapsed / 1e6,
+			       count, i ? "optimized" : "reference");
+	}
+
+	free(query);
+}
+
+TEST_MAIN()
+{
+	test_random();
+
+	if (argc > 1)
+		benchmark(atoi(argv[1]));
+
+	return 0;
+}
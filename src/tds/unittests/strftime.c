@@ -20,6 +20,9 @@
 /*
  * Purpose: test tds_strftime.
  * This is a wrapper to strftime for portability and extension.
+ * Conversions from dates to strings use formats compiled from locale,
+ * check they give the same results.
+ * To test performance, call this program with an iteration count.
  */
 #include "common.h"
 #include <assert.h>
@@ -43,6 +46,101 @@ test(const TDSDATEREC* dr, int prec, const char *fmt, const char *expected, int
 	free(format);
 }
 
+/* compare conversion of a date to string with tds_strftime */
+static void
+test_convert(TDSCONTEXT *ctx, const char *fmt, int srctype, const void *src, TDS_UINT srclen, int prec)
+{
+	CONV_RESULT cr;
+	TDSDATEREC dr;
+	char expected[256];
+	TDS_INT res;
+
+	free(ctx->locale->datetime_fmt);
+	ctx->locale->datetime_fmt = strdup(fmt);
+	assert(ctx->locale->datetime_fmt);
+	tds_locale_compile_date_plans(ctx->locale);
+
+	res = tds_datecrack(srctype, src, &dr);
+	assert(res == TDS_SUCCESS);
+	tds_strftime(expected, 64, fmt, &dr, prec);
+
+	res = tds_convert(ctx, srctype, src, srclen, SYBVARCHAR, &cr);
+	assert(res >= 0);
+	if (strcmp(cr.c, expected) != 0) {
+		fprintf(stderr, "Wrong conversion with format '%s', got '%s' expected '%s'\n", fmt, cr.c, expected);
+		exit(1);
+	}
+	free(cr.c);
+}
+
+static void
+test_plans(void)
+{
+	static const char *const formats[] = {
+		"%b %e %Y %I:%M%p", "%Y-%m-%d %H:%M:%S.%z", "%Y-%m-%d", "%H:%M:%S", "%z", ".%z", "x.%z.%H",
+		"%%.%z", "%a %A %B %h %j %y %l%n%t%%", "%", "abc%", "%Y%Z", "%c", "%d/%m/%Y %H:%M:%S.%z", "",
+		"%p%p%p%p%p%p%p%p%p%p%p%p%p%p%p%p%p%p%p%p%p%p%p%p%p%p%p%p%p%p%p",
+		NULL
+	};
+	TDSCONTEXT *ctx;
+	int i, n;
+
+	ctx = tds_alloc_context(NULL);
+	assert(ctx && ctx->locale);
+
+	for (n = 0; n < 20000; ++n) {
+		uint64_t r = next_rand();
+		TDS_DATETIME dt;
+		TDS_DATETIMEALL dta;
+
+		dt.dtdays = (TDS_INT) (r % 2958463u + 2958463u) - 53690 - 2958463;
+		dt.dttime = (TDS_INT) ((r >> 32) % (300u * 86400u));
+		memset(&dta, 0, sizeof(dta));
+		dta.date = (TDS_INT) (r % 3652059u) - 693595;
+		dta.time = (r >> 24) % (UINT64_C(864000000000));
+		dta.time_prec = (r >> 60) % 8u;
+		dta.has_date = 1;
+		dta.has_time = 1;
+		for (i = 0; formats[i]; ++i) {
+			test_convert(ctx, formats[i], SYBDATETIME, &dt, sizeof(dt), 3);
+			test_convert(ctx, formats[i], SYBMSDATETIME2, &dta, sizeof(dta), dta.time_prec);
+		}
+	}
+	tds_free_context(ctx);
+}
+
+static void
+benchmark(int iterations)
+{
+	TDSCONTEXT *ctx;
+	TDS_DATETIME dt;
+	struct timeval start, end;
+	double elapsed;
+	CONV_RESULT cr;
+	char buf[64];
+	int i;
+
+	ctx = tds_alloc_context(NULL);
+	assert(ctx && ctx->locale);
+	free(ctx->locale->datetime_fmt);
+	ctx->locale->datetime_fmt = strdup(STD_DATETIME_FMT);
+	tds_locale_compile_date_plans(ctx->locale);
+
+	dt.dtdays = 42000;
+	dt.dttime = 12345678;
+	cr.cc.c = buf;
+	cr.cc.len = sizeof(buf);
+
+	gettimeofday(&start, NULL);
+	for (i = 0; i < iterations; ++i)
+		tds_convert(ctx, SYBDATETIME, &dt, sizeof(dt), TDS_CONVERT_CHAR, &cr);
+	gettimeofday(&end, NULL);
+	elapsed = (end.tv_sec - start.tv_sec) + (end.tv_usec - start.tv_usec) * 0.000001;
+	if (elapsed > 0)
+		printf("%9.0f conversions/second converting dates to strings\n", iterations / elapsed);
+	tds_free_context(ctx);
+}
+
 TEST_MAIN()
 {
 	TDSDATEREC dr;
@@ -75,5 +173,10 @@ TEST_MAIN()
 	TEST(0, "%e", "23");
 	dr.day = 5;
 	TEST(0, "x%e", "x 5");
+
+	test_plans();
+
+	if (argc > 1)
+		benchmark(atoi(argv[1]));
 	return 0;
 }
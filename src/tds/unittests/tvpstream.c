@@ -0,0 +1,358 @@
+/* FreeTDS - Library of routines accessing Sybase and Microsoft databases
+ * Copyright (C) 2026  Frediano Ziglio
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Purpose: test table valued parameters streamed from a callback.
+ * Rows produced by the callback must be encoded like rows in list.
+ * To test performance, call this program with a number of rows.
+ */
+#include "common.h"
+#include <assert.h>
+#include <freetds/bytes.h>
+
+#if HAVE_UNISTD_H
+#undef getpid
+#include <unistd.h>
+#endif /* HAVE_UNISTD_H */
+
+#include <freetds/replacements.h>
+#include <freetds/utils.h>
+#include <freetds/thread.h>
+#include <freetds/time.h>
+
+#define NUM_ROWS 500
+
+static TDSSOCKET *tds;
+static TDS_SYS_SOCKET server_socket = INVALID_SOCKET;
+
+typedef struct
+{
+	unsigned char *buf;
+	size_t len;
+	bool keep;
+	bool cancelled;
+} REQUEST;
+
+static void
+read_all(TDS_SYS_SOCKET s, void *buf, size_t len)
+{
+	char *p = (char *) buf;
+
+	while (len) {
+		int got = READSOCKET(s, p, len);
+		assert(got > 0);
+		p += got;
+		len -= got;
+	}
+}
+
+/* thread reading a full request, removing packet headers */
+static TDS_THREAD_PROC_DECLARE(read_request_proc, arg)
+{
+	REQUEST *req = (REQUEST *) arg;
+	unsigned char header[8], data[4096];
+	size_t len, capacity = 0;
+
+	req->buf = NULL;
+	req->len = 0;
+	do {
+		read_all(server_socket, header, 8);
+		assert(header[0] == TDS_RPC);
+		len = TDS_GET_UA2BE(header + 2) - 8;
+		assert(len <= sizeof(data));
+		read_all(server_socket, data, len);
+		if (req->keep) {
+			if (req->len + len > capacity) {
+				capacity = (req->len + len) * 2;
+				req->buf = (unsigned char *) realloc(req->buf, capacity);
+				assert(req->buf);
+			}
+			memcpy(req->buf + req->len, data, len);
+		}
+		req->len += len;
+	} while ((header[1] & TDS_STATUS_EOM) == 0);
+
+	/* request discarded, acknowledge the following cancel */
+	req->cancelled = (header[1] & TDS_STATUS_IGNORE) != 0;
+	if (req->cancelled) {
+		static const unsigned char done_attn[] = {
+			TDS_REPLY, TDS_STATUS_EOM, 0, 8 + 13, 0, 0, 1, 0,
+			TDS_DONE_TOKEN, TDS_DONE_CANCELLED, 0, 0, 0,
+			0, 0, 0, 0, 0, 0, 0, 0
+		};
+
+		read_all(server_socket, header, 8);
+		assert(header[0] == TDS_CANCEL && TDS_GET_UA2BE(header + 2) == 8);
+		assert(WRITESOCKET(server_socket, done_attn, sizeof(done_attn)) == sizeof(done_attn));
+	}
+
+	return TDS_THREAD_RESULT(0);
+}
+
+static TDSRET
+submit(TDSPARAMINFO *params, REQUEST *req, bool keep)
+{
+	tds_thread th;
+	TDSRET rc;
+
+	req->keep = keep;
+	assert(tds_thread_create(&th, read_request_proc, req) == 0);
+	rc = tds_submit_rpc(tds, "my_proc", params, NULL);
+	tds_thread_join(th, NULL);
+
+	/* failed requests are cancelled */
+	assert(req->cancelled == TDS_FAILED(rc));
+	if (req->cancelled)
+		assert(tds->state == TDS_IDLE);
+
+	/* we do not send any reply, just allows another request */
+	tds->state = TDS_IDLE;
+	return rc;
+}
+
+/* allocate a row with an int and a varchar column */
+static TDSPARAMINFO *
+alloc_row(void)
+{
+	TDSPARAMINFO *row;
+	TDSCOLUMN *col;
+
+	row = tds_alloc_param_result(NULL);
+	assert(row);
+	col = row->columns[0];
+	tds_set_param_type(tds->conn, col, SYBINT4);
+	assert(tds_alloc_param_data(col));
+
+	row = tds_alloc_param_result(row);
+	assert(row);
+	col = row->columns[1];
+	tds_set_param_type(tds->conn, col, XSYBVARCHAR);
+	col->column_size = col->on_server.column_size = 30;
+	assert(tds_alloc_param_data(col));
+	return row;
+}
+
+static void
+fill_row(TDSPARAMINFO *row, TDS_INT8 n)
+{
+	TDSCOLUMN *col;
+
+	col = row->columns[0];
+	*(TDS_INT *) col->column_data = (TDS_INT) (n * 7);
+	col->column_cur_size = (n % 5) == 3 ? -1 : 4;
+
+	col = row->columns[1];
+	col->column_cur_size = sprintf((char *) col->column_data, "row %d", (int) n);
+	if ((n % 7) == 2)
+		col->column_cur_size = -1;
+}
+
+static TDS_INT8 fetch_limit;
+static TDS_INT8 fetch_fail = -1;
+
+static TDSRET
+fetch_rows(TDSSOCKET *tds_arg, TDS_TVP *table)
+{
+	TDS_INT8 *first = (TDS_INT8 *) table->fetch_param;
+
+	assert(tds_arg == tds);
+	if (table->num_fetched == fetch_fail)
+		return TDS_FAIL;
+	if (table->num_fetched >= fetch_limit)
+		return TDS_NO_MORE_RESULTS;
+
+	/* row is reused */
+	if (!table->fetch_row)
+		table->fetch_row = alloc_row();
+	fill_row(table->fetch_row, *first + table->num_fetched);
+	return TDS_SUCCESS;
+}
+
+static TDSPARAMINFO *
+create_params(TDS_TVP **p_table)
+{
+	TDSPARAMINFO *params;
+	TDSCOLUMN *col;
+	TDS_TVP *table;
+
+	params = tds_alloc_param_result(NULL);
+	assert(params);
+	col = params->columns[0];
+	tds_set_param_type(tds->conn, col, SYBMSTABLE);
+	tds_dstr_copy(&col->column_name, "@table");
+	col->column_size = col->column_cur_size = sizeof(TDS_TVP);
+	table = (TDS_TVP *) tds_alloc_param_data(col);
+	assert(table);
+
+	table->schema = strdup("dbo");
+	table->name = strdup("my_type");
+	table->metadata = alloc_row();
+	assert(table->schema && table->name);
+	*p_table = table;
+	return params;
+}
+
+static void
+test_stream(void)
+{
+	TDSPARAMINFO *list_params, *stream_params;
+	TDS_TVP *list, *stream;
+	TDS_TVP_ROW **prow;
+	REQUEST list_req, stream_req;
+	TDS_INT8 first = 0;
+	int i;
+
+	/* all rows in a list */
+	list_params = create_params(&list);
+	prow = &list->row;
+	for (i = 0; i < NUM_ROWS; ++i) {
+		*prow = tds_new0(TDS_TVP_ROW, 1);
+		assert(*prow);
+		(*prow)->params = alloc_row();
+		fill_row((*prow)->params, i);
+		prow = &(*prow)->next;
+	}
+	assert(submit(list_params, &list_req, true) == TDS_SUCCESS);
+
+	/* all rows from callback */
+	stream_params = create_params(&stream);
+	stream->fetch = fetch_rows;
+	stream->fetch_param = &first;
+	fetch_limit = NUM_ROWS;
+	assert(submit(stream_params, &stream_req, true) == TDS_SUCCESS);
+	assert(stream->num_fetched == NUM_ROWS);
+	assert(stream_req.len == list_req.len);
+	assert(memcmp(stream_req.buf, list_req.buf, list_req.len) == 0);
+	free(stream_req.buf);
+
+	/* sending again starts from first row */
+	assert(submit(stream_params, &stream_req, true) == TDS_SUCCESS);
+	assert(stream_req.len == list_req.len);
+	assert(memcmp(stream_req.buf, list_req.buf, list_req.len) == 0);
+	free(stream_req.buf);
+
+	/* rows both in list and from callback */
+	tds_free_param_results(stream_params);
+	stream_params = create_params(&stream);
+	prow = &stream->row;
+	for (i = 0; i < NUM_ROWS / 2; ++i) {
+		*prow = tds_new0(TDS_TVP_ROW, 1);
+		assert(*prow);
+		(*prow)->params = alloc_row();
+		fill_row((*prow)->params, i);
+		prow = &(*prow)->next;
+	}
+	stream->fetch = fetch_rows;
+	stream->fetch_param = &first;
+	first = NUM_ROWS / 2;
+	fetch_limit = NUM_ROWS - NUM_ROWS / 2;
+	assert(submit(stream_params, &stream_req, true) == TDS_SUCCESS);
+	assert(stream_req.len == list_req.len);
+	assert(memcmp(stream_req.buf, list_req.buf, list_req.len) == 0);
+	free(stream_req.buf);
+
+	/* errors from callback are reported */
+	fetch_fail = 10;
+	assert(TDS_FAILED(submit(stream_params, &stream_req, false)));
+	assert(stream->num_fetched == 10);
+	fetch_fail = -1;
+
+	/* connection is still usable after a cancelled request */
+	assert(submit(stream_params, &stream_req, true) == TDS_SUCCESS);
+	assert(stream_req.len == list_req.len);
+	assert(memcmp(stream_req.buf, list_req.buf, list_req.len) == 0);
+	free(stream_req.buf);
+
+	/* empty table */
+	fetch_limit = 0;
+	tds_deinit_tvp(stream);
+	stream->schema = strdup("dbo");
+	stream->name = strdup("my_type");
+	stream->metadata = alloc_row();
+	stream->fetch = fetch_rows;
+	stream->fetch_param = &first;
+	assert(submit(stream_params, &stream_req, true) == TDS_SUCCESS);
+	assert(stream->num_fetched == 0 && stream->fetch_row == NULL);
+	free(stream_req.buf);
+
+	free(list_req.buf);
+	tds_free_param_results(list_params);
+	tds_free_param_results(stream_params);
+}
+
+static void
+benchmark(TDS_INT8 num_rows)
+{
+	struct timeval start, end;
+	double elapsed;
+	TDSPARAMINFO *params;
+	TDS_TVP *table;
+	REQUEST req;
+	TDS_INT8 first = 0;
+
+	params = create_params(&table);
+	table->fetch = fetch_rows;
+	table->fetch_param = &first;
+	fetch_limit = num_rows;
+
+	gettimeofday(&start, NULL);
+	assert(submit(params, &req, false) == TDS_SUCCESS);
+	gettimeofday(&end, NULL);
+	elapsed = (end.tv_sec - start.tv_sec) + (end.tv_usec - start.tv_usec) * 0.000001;
+	if (elapsed > 0)
+		printf("%9.0f rows/second streamed, %.1f MB sent\n", num_rows / elapsed, req.len / 1e6);
+
+	tds_free_param_results(params);
+}
+
+TEST_MAIN()
+{
+	TDSCONTEXT *ctx;
+	TDS_SYS_SOCKET sockets[2];
+
+	setbuf(stdout, NULL);
+	setbuf(stderr, NULL);
+
+	ctx = tds_alloc_context(NULL);
+	assert(ctx);
+	tds = tds_alloc_socket(ctx, 512);
+	assert(tds);
+	tds->conn->tds_version = 0x704;
+	tds_iconv_open(tds->conn, "ISO-8859-1", 0);
+
+	/* requests are read back from the other end of the pair */
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) < 0) {
+		perror("socketpair");
+		exit(1);
+	}
+	tds_socket_set_nosigpipe(sockets[0], 1);
+	tds->state = TDS_IDLE;
+	tds_set_s(tds, sockets[0]);
+	server_socket = sockets[1];
+
+	test_stream();
+
+	if (argc > 1)
+		benchmark(atoi(argv[1]));
+
+	tds_free_socket(tds);
+	tds_free_context(ctx);
+	CLOSESOCKET(server_socket);
+	return 0;
+}
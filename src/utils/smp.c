@@ -37,18 +37,51 @@ const smp smp_one = {
 	{ 1, 0, 0, 0, 0, 0, 0, 0 },
 };
 
+#undef USE_UINT128
+#if defined(__GNUC__) && SIZEOF___INT128 > 0
+/* number fits exactly into a 128 bit integer, use it if available */
+#define USE_UINT128 1
+typedef unsigned __int128 smp_uint128;
+
+static smp_uint128
+smp_to_uint128(smp a)
+{
+	size_t i;
+	smp_uint128 n = 0;
+
+	for (i = SMP_NUM_COMPONENTS; i > 0;)
+		n = (n << 16) | a.comp[--i];
+	return n;
+}
+
+static smp
+smp_from_uint128(smp_uint128 n)
+{
+	size_t i;
+	smp res;
+
+	for (i = 0; i < SMP_NUM_COMPONENTS; ++i, n >>= 16)
+		res.comp[i] = (uint16_t) (n & 0xffffu);
+	return res;
+}
+#endif
+
 smp
 smp_add(smp a, smp b)
 {
+	smp res;
+#ifdef USE_UINT128
+	res = smp_from_uint128(smp_to_uint128(a) + smp_to_uint128(b));
+#else
 	size_t i;
 	uint32_t carry = 0;
-	smp res;
 
 	for (i = 0; i < SMP_NUM_COMPONENTS; ++i) {
 		uint32_t sum = carry + a.comp[i] + b.comp[i];
 		res.comp[i] = (uint16_t) (sum & 0xffffu);
 		carry = sum >> 16;
 	}
+#endif
 	assert(smp_is_negative(a) != smp_is_negative(b) || smp_is_negative(a) == smp_is_negative(res));
 	return res;
 }
@@ -66,7 +99,11 @@ smp_not(smp a)
 smp
 smp_negate(smp a)
 {
+#ifdef USE_UINT128
+	return smp_from_uint128(0u - smp_to_uint128(a));
+#else
 	return smp_add(smp_not(a), smp_one);
+#endif
 }
 
 smp
@@ -135,14 +172,23 @@ smp_to_double(smp a)
 int
 smp_cmp(smp a, smp b)
 {
+#ifdef USE_UINT128
+	/* flip sign bits to compare as unsigned */
+	const smp_uint128 sign = ((smp_uint128) 1) << 127;
+	smp_uint128 ua = smp_to_uint128(a) ^ sign, ub = smp_to_uint128(b) ^ sign;
+
+	return ua > ub ? 1 : (ua < ub ? -1 : 0);
+#else
 	smp diff = smp_sub(a, b);
 	if (smp_is_negative(diff))
 		return -1;
 	if (smp_is_zero(diff))
 		return 0;
 	return 1;
+#endif
 }
 
+#ifndef USE_UINT128
 // divide and return remainder
 static uint16_t
 div_small(smp *n, uint16_t div)
@@ -156,6 +202,7 @@ div_small(smp *n, uint16_t div)
 	}
 	return (uint16_t) remainder;
 }
+#endif
 
 char *
 smp_to_string(smp a)
@@ -166,9 +213,29 @@ smp_to_string(smp a)
 	smp n = negative ? smp_negate(a) : a;
 
 	*--p = 0;
+#ifdef USE_UINT128
+	{
+		smp_uint128 un = smp_to_uint128(n);
+		uint64_t low;
+		int i;
+
+		/* use 64 bit operations for 19 digits at a time */
+		while ((un >> 64) != 0) {
+			low = (uint64_t) (un % UINT64_C(10000000000000000000));
+			un /= UINT64_C(10000000000000000000);
+			for (i = 0; i < 19; ++i, low /= 10u)
+				*--p = (char) (low % 10u) + '0';
+		}
+		low = (uint64_t) un;
+		do
+			*--p = (char) (low % 10u) + '0';
+		while ((low /= 10u) != 0);
+	}
+#else
 	do
 		*--p = (char) div_small(&n, 10) + '0';
 	while (!smp_is_zero(n));
+#endif
 	if (negative)
 		*--p = '-';
 	return strdup(p);